@@ -30,6 +30,52 @@
 #define DMA_INSTANCE_COUNT 2
 #define DMA_STREAM_COUNT 8
 
+// BDMA (D3 domain), addressed as a third instance with channels 0-7 (see bdma_start_transfer())
+#define DMA_INSTANCE_BDMA 3
+#define BDMA_CHANNEL_COUNT 8
+
+// MDMA, addressed as a fourth instance with channels 0-15 where a stream is named (completion
+// dispatch, see dma_set_dispatch_mode())
+#define DMA_INSTANCE_MDMA 4
+#define MDMA_CHANNEL_COUNT 16
+
+// DMA-safe memory (see dma_mem_alloc())
+#define DMA_CACHE_LINE_SIZE 32
+#ifndef DMA_MEM_POOL_SIZE
+#define DMA_MEM_POOL_SIZE 16384 // Bytes of AXI SRAM reserved for DMA buffers
+#endif
+#define DMA_MEM_SECTION ".dma_buffers" // Must be placed in AXI SRAM or D2 SRAM by the linker script
+
+// Places a static buffer where DMA1/DMA2 can reach it, aligned to whole cache lines
+#define DMA_BUFFER __attribute__((section(DMA_MEM_SECTION), aligned(DMA_CACHE_LINE_SIZE)))
+
+// Places a static buffer in SRAM4, the only general purpose RAM the BDMA can reach
+#define BDMA_MEM_SECTION ".sram4" // Must be placed in SRAM4 (0x38000000) by the linker script
+#define BDMA_BUFFER __attribute__((section(BDMA_MEM_SECTION), aligned(DMA_CACHE_LINE_SIZE)))
+
+// Deferred completion dispatch (see dma_dispatch_deferred())
+#ifndef DMA_DEFERRED_QUEUE_DEPTH
+#define DMA_DEFERRED_QUEUE_DEPTH 32 // Must be a power of two
+#endif
+
+// Memory copy engine (see dma_memcpy_async())
+#ifndef DMA_MEMCPY_CHANNELS
+#define DMA_MEMCPY_CHANNELS 2 // MDMA channels 0..n-1 are reserved for copies and fills
+#endif
+#ifndef DMA_MEMCPY_THRESHOLD
+#define DMA_MEMCPY_THRESHOLD 256 // Smaller requests are done by the CPU (see dma_memcpy_calibrate())
+#endif
+
+// MDMA linked lists (see dma_chain_start())
+#define DMA_CHAIN_SOFTWARE 0xFF // dma_chain_stage_t.trigger for stages that run without a request
+
+// DMAMUX request generators (see dma_trigger_bind())
+#define DMA_TRIGGER_GENERATOR_COUNT 8
+#define DMA_TRIGGER_MAX_REQUESTS 32
+
+// Stream allocation flags (see dma_claim_stream())
+#define DMA_CLAIM_SHAREABLE 0x1 // Stream may be lent to dma_borrow_stream() while the owner is idle
+
 /**************************************************************************************************
  * @section Type Definitions
  **************************************************************************************************/
@@ -37,6 +83,7 @@
 typedef enum {
     PERIPH_TO_MEM,
     MEM_TO_PERIPH,
+    MEM_TO_MEM,    // Not available in circular or double buffer mode
 } dma_direction_t;
 
 // Enum for FIFO threshold
@@ -47,19 +94,44 @@ typedef enum {
     DMA_FIFO_THRESHOLD_QUARTER, 
 } dma_fifo_threshold_t;
 
+// Enum for transfer mode
+typedef enum {
+    DMA_MODE_NORMAL,        // One-shot transfer
+    DMA_MODE_CIRCULAR,      // Wraps back to the start of the buffer and keeps going
+    DMA_MODE_DOUBLE_BUFFER, // Alternates between the memory buffer and mem1 (M0AR/M1AR)
+} dma_mode_t;
+
+// Enum for continuous-mode events
+typedef enum {
+    DMA_EVENT_HALF,  // The first half of the current buffer has been transferred
+    DMA_EVENT_FULL,  // The current buffer has been transferred (and swapped in double buffer mode)
+    DMA_EVENT_ERROR, // Transfer or FIFO error; the stream has been stopped
+} dma_event_t;
+
 // Callback function type for DMA events
 typedef void (*dma_callback_t)(bool success, void *context);
 
+/**
+ * Callback function type for circular/double-buffer events, called from the DMA ISR (or from
+ * dma_dispatch_deferred() for streams in deferred mode).
+ * @p buffer is the buffer the event refers to: always 0 in circular mode, and in double buffer
+ * mode 0 for the main buffer or 1 for mem1. On DMA_EVENT_FULL that buffer is now owned by the
+ * CPU until the DMA switches back to it.
+ */
+typedef void (*dma_event_callback_t)(dma_event_t event, uint8_t buffer, void *context);
+
 /**
  * @brief DMA transfer config
  * 
  * Specifies all necessary parameters for dma transfer.
  */
 typedef struct {
+    uint8_t instance; // DMA controller (1-2), or DMA_INSTANCE_BDMA
+    uint8_t stream;   // Stream on the controller (0-7), e.g. from dma_claim_stream(), or BDMA channel
     uint32_t request_id;
     dma_direction_t direction;
-    uint8_t src_data_size;
-    uint8_t dest_data_size;
+    uint8_t src_data_size;  // Bytes per item (1, 2 or 4)
+    uint8_t dest_data_size; // Bytes per item (1, 2 or 4)
     uint8_t priority; // 0-3 Incrementing priority
     bool fifo_enabled;
     dma_fifo_threshold_t fifo_threshold;
@@ -69,13 +141,110 @@ typedef struct {
     size_t size;
     void *context;
     bool disable_mem_inc; // Useful for dummy spi transactions
+    dma_mode_t mode;
+    void *mem1;           // Second memory buffer (same size) for DMA_MODE_DOUBLE_BUFFER
+    dma_event_callback_t event_callback; // Half/full callbacks for circular and double buffer modes
 } dma_transfer_t;
 
+// Trigger edge that makes a DMAMUX request generator fire
+typedef enum {
+    DMA_TRIGGER_RISING = 1,
+    DMA_TRIGGER_FALLING = 2,
+    DMA_TRIGGER_BOTH = 3,
+} dma_trigger_edge_t;
+
+/**
+ * @brief DMAMUX request generator config
+ *
+ * On every trigger edge the generator issues a fixed number of DMA requests, so a timer or EXTI
+ * line can launch a transfer with no CPU involvement. DMA1/DMA2 use the generators of DMAMUX1,
+ * the BDMA those of DMAMUX2.
+ */
+typedef struct {
+    uint8_t generator;       // Request generator (0-7)
+    uint8_t signal_id;       // Trigger input (SIG_ID), e.g. a timer TRGO or EXTI line, see the DMAMUX trigger table
+    dma_trigger_edge_t edge;
+    uint8_t requests;        // DMA requests per trigger (1-32), e.g. one per register of a sensor read
+} dma_trigger_config_t;
+
+// Where completion callbacks of a stream are run
+typedef enum {
+    DMA_DISPATCH_ISR,      // Directly in the DMA ISR (default)
+    DMA_DISPATCH_DEFERRED, // Queued by the ISR and run from dma_dispatch_deferred()
+} dma_dispatch_mode_t;
+
+/**
+ * @brief Dispatch statistics
+ *
+ * Kept separately for each dispatch mode so the two can be compared. Times are in CPU cycles.
+ * isr_cycles is what the notification cost inside the ISR (the whole callback in ISR mode, just
+ * the queue push in deferred mode); latency is the time from the ISR to the start of the callback.
+ */
+typedef struct {
+    uint32_t events;
+    uint32_t overflows;    // Deferred events run in the ISR because the queue was full
+    uint32_t high_water;   // Most deferred events pending at once
+    uint64_t isr_cycles;
+    uint32_t isr_max;
+    uint64_t latency_cycles;
+    uint32_t latency_max;
+} dma_dispatch_stats_t;
+
+/**
+ * @brief One stage of an MDMA linked list
+ *
+ * Software stages run back to back as soon as the chain starts, or as soon as the hardware stage
+ * before them ends. Hardware stages wait for their MDMA trigger (e.g. a QSPI FIFO threshold or a
+ * DMA1/DMA2 stream completing) and move request_bytes per request. A software stage after a
+ * hardware stage costs one MDMA interrupt per stage, since the CPU has to issue its request.
+ */
+typedef struct {
+    const void *src;
+    void *dest;
+    uint32_t size;           // Bytes in this stage (at most 65536)
+    uint8_t src_data_size;   // Bytes per item (1, 2, 4 or 8)
+    uint8_t dest_data_size;  // Bytes per item (1, 2, 4 or 8), packed if different from the source
+    bool src_fixed;          // Do not increment the source, e.g. a peripheral data register
+    bool dest_fixed;         // Do not increment the destination
+    uint8_t trigger;         // MDMA request (TSEL), or DMA_CHAIN_SOFTWARE
+    uint8_t request_bytes;   // Bytes per hardware request (1-128), ignored for software stages
+    volatile uint32_t *mask_addr; // If not NULL, mask_data is written here when the stage ends
+    uint32_t mask_data;
+} dma_chain_stage_t;
+
+// Hardware layout of a linked-list node, fetched by the MDMA when it moves to the next stage
+typedef struct {
+    uint32_t tcr;
+    uint32_t bndtr;
+    uint32_t sar;
+    uint32_t dar;
+    uint32_t brur;
+    uint32_t lar;
+    uint32_t tbr;
+    uint32_t reserved;
+    uint32_t mar;
+    uint32_t mdr;
+} __attribute__((aligned(8))) dma_chain_node_t;
+
+// A linked list built in caller-provided nodes
+typedef struct {
+    dma_chain_node_t *nodes; // Should be declared with DMA_BUFFER
+    uint8_t capacity;
+    uint8_t count;
+    int8_t channel;          // MDMA channel while running, -1 otherwise
+} dma_chain_t;
+
 typedef struct {
     uint8_t instance;
     uint32_t blocking_timeout; // How many time to poll 
 } dma_config_t;
 
+// Identifies a single DMA stream
+typedef struct {
+    uint8_t instance; // 1-2
+    uint8_t stream;   // 0-7
+} dma_stream_t;
+
 /**************************************************************************************************
  * @section Public Functions
  **************************************************************************************************/
@@ -95,4 +264,387 @@ void dma_init(void);
  * @param size Number of bytes to transfer.
  * @return bool, whether the transfer was successfully started.
  */
-int dma_start_transfer(dma_transfer_t *dma_transfer);
\ No newline at end of file
+int dma_start_transfer(dma_transfer_t *dma_transfer);
+
+/**************************************************************************************************
+ * @section DMA Memory
+ *
+ * DMA1/DMA2 cannot reach the TCMs, and with the D-cache enabled the CPU and the DMA can see
+ * different data. Buffers from dma_mem_alloc() (or declared with DMA_BUFFER) sit in AXI SRAM
+ * and own whole cache lines, so cache maintenance on them never touches a neighbouring
+ * variable. The DMA drivers clean memory before memory-to-peripheral transfers and
+ * invalidate it after peripheral-to-memory transfers.
+ **************************************************************************************************/
+
+/**
+ * @brief Allocates a DMA-safe buffer from the pool. Safe to call from an ISR.
+ * @param size Number of bytes (rounded up to whole cache lines).
+ * @return Pointer to a cache-line aligned buffer, or NULL if the pool is exhausted.
+ */
+void *dma_mem_alloc(size_t size);
+
+/**
+ * @brief Returns a buffer from dma_mem_alloc() to the pool. Safe to call from an ISR.
+ * @return TI_ERRC_INVALID_ARG if @p buffer was not allocated from the pool.
+ */
+int dma_mem_free(void *buffer);
+
+/**
+ * @brief Number of bytes currently free in the pool (not necessarily contiguous).
+ */
+size_t dma_mem_available(void);
+
+/**
+ * @brief Whether DMA1/DMA2 can access the given memory range (i.e. it is not in ITCM/DTCM).
+ */
+bool dma_mem_is_accessible(const void *buffer, size_t size);
+
+/**
+ * @brief Writes any dirty cache lines covering the range back to memory. Call before the DMA
+ * reads memory the CPU has written.
+ */
+void dma_cache_clean(const void *buffer, size_t size);
+
+/**
+ * @brief Discards cache lines covering the range so the CPU re-reads what the DMA wrote.
+ * Partial lines at either end are cleaned first so neighbouring data is not lost.
+ */
+void dma_cache_invalidate(void *buffer, size_t size);
+
+/**************************************************************************************************
+ * @section Continuous Transfers
+ **************************************************************************************************/
+
+/**
+ * @brief Starts a circular or double-buffer transfer on transfer->instance/stream. The stream
+ * keeps running without being re-armed; progress is reported through transfer->event_callback.
+ * The transfer struct is copied and does not need to outlive the call.
+ * @param dma_transfer Transfer description. mode must not be DMA_MODE_NORMAL.
+ * @return ti_errc_t error code.
+ */
+int dma_start_continuous(dma_transfer_t *dma_transfer);
+
+/**
+ * @brief Stops a continuous transfer.
+ * @return ti_errc_t error code.
+ */
+int dma_stop_continuous(uint8_t instance, uint8_t stream);
+
+/**
+ * @brief Replaces the buffer the DMA is NOT currently using in double buffer mode. Typically
+ * called from the DMA_EVENT_FULL callback to hand the hardware a fresh buffer.
+ * @return TI_ERRC_INVALID_STATE if the stream is not running in double buffer mode.
+ */
+int dma_set_idle_buffer(uint8_t instance, uint8_t stream, void *buffer);
+
+/**
+ * @brief Number of items the stream still has to transfer in its current buffer (NDTR).
+ * Useful for finding out how far a circular receive has progressed between events.
+ */
+uint32_t dma_get_remaining(uint8_t instance, uint8_t stream);
+
+/**
+ * @brief Interrupt handler for continuous transfers. Call from DMAx_Streamy_IRQHandler().
+ */
+void dma_continuous_irq(uint8_t instance, uint8_t stream);
+
+/**************************************************************************************************
+ * @section Memory Copy
+ *
+ * Copies and fills run on the MDMA, which can reach every memory including the TCMs and does
+ * not take a DMA1/DMA2 stream away from the peripherals. Requests below the offload threshold
+ * are done by the CPU right away, since programming the channel and taking the interrupt costs
+ * more than the copy itself. Callbacks run from the MDMA ISR (or are deferred, see
+ * dma_set_dispatch_mode() with DMA_INSTANCE_MDMA), or from the calling context for requests the
+ * CPU handled.
+ **************************************************************************************************/
+
+/**
+ * @brief Enables the MDMA clock and resets the copy channels. Call once before the functions below.
+ */
+void dma_memcpy_init(void);
+
+/**
+ * @brief Copies @p size bytes from @p src to @p dest in the background. The buffers must not
+ * overlap and must not be touched until the callback runs. Cache maintenance is done here.
+ * @param callback Called with success = false on a bus error. May be NULL.
+ * @return TI_ERRC_BUSY if every copy channel is in use, otherwise a ti_errc_t error code.
+ */
+int dma_memcpy_async(void *dest, const void *src, size_t size, dma_callback_t callback,
+                     void *context);
+
+/**
+ * @brief Sets @p size bytes at @p dest to @p value in the background. See dma_memcpy_async().
+ * @return TI_ERRC_BUSY if every copy channel is in use, otherwise a ti_errc_t error code.
+ */
+int dma_memset_async(void *dest, uint8_t value, size_t size, dma_callback_t callback,
+                     void *context);
+
+/**
+ * @brief Whether any copy or fill is still running.
+ */
+bool dma_memcpy_busy(void);
+
+/**
+ * @brief Sets the size below which requests are done by the CPU (0 offloads everything).
+ */
+void dma_memcpy_set_threshold(size_t size);
+
+/**
+ * @brief Measures CPU memcpy() against an MDMA copy of growing sizes between two buffers and
+ * sets the threshold to the smallest size at which the MDMA finishes first. Blocks, and needs
+ * the cycle counter (see dma_dispatch_init()) and the MDMA interrupt to be enabled. The copy
+ * channels are switched to ISR dispatch for the duration and then restored.
+ * @param scratch_a, scratch_b Two buffers of @p max_size bytes each. Their contents are lost.
+ * @param result Receives the new threshold, or @p max_size if the CPU was faster at every size
+ * tried. May be NULL.
+ * @return TI_ERRC_TIMEOUT if a copy did not complete within 100 ms (the copy is stopped), or
+ * another ti_errc_t error code. The threshold is left unchanged on error.
+ */
+int dma_memcpy_calibrate(void *scratch_a, void *scratch_b, size_t max_size, size_t *result);
+
+/**
+ * @brief Interrupt handler for the copy channels. Call from MDMA_IRQHandler().
+ */
+void dma_memcpy_irq(void);
+
+/**************************************************************************************************
+ * @section MDMA Linked Lists
+ *
+ * A chain is a list of stages that the MDMA walks on its own, loading each node from memory
+ * when the previous stage ends. Multi-step pipelines such as QSPI -> RAM -> CRC then run without
+ * the CPU and raise a single interrupt at the end. Chains use the MDMA channels above the
+ * memory copy channels.
+ **************************************************************************************************/
+
+/**
+ * @brief Prepares an empty chain over @p capacity nodes.
+ * @return ti_errc_t error code.
+ */
+int dma_chain_init(dma_chain_t *chain, dma_chain_node_t *nodes, uint8_t capacity);
+
+/**
+ * @brief Appends a stage to the end of a chain that is not running.
+ * @return TI_ERRC_NO_MEM if the chain is full, otherwise a ti_errc_t error code.
+ */
+int dma_chain_append(dma_chain_t *chain, const dma_chain_stage_t *stage);
+
+/**
+ * @brief Starts a chain on a free MDMA channel. The chain and its nodes must stay untouched
+ * until the callback runs. A chain may be started again once it has completed.
+ * @param priority MDMA priority (0-3).
+ * @param callback Called once after the last stage, or with success = false on a bus error.
+ * @return TI_ERRC_BUSY if no channel is free, otherwise a ti_errc_t error code.
+ */
+int dma_chain_start(dma_chain_t *chain, uint8_t priority, dma_callback_t callback, void *context);
+
+/**
+ * @brief Stops a running chain. Its callback is not called.
+ * @return TI_ERRC_INVALID_STATE if the chain is not running, otherwise a ti_errc_t error code.
+ */
+int dma_chain_abort(dma_chain_t *chain);
+
+/**
+ * @brief Interrupt handler for the chain channels. Call from MDMA_IRQHandler().
+ */
+void dma_chain_irq(void);
+
+/**************************************************************************************************
+ * @section BDMA
+ *
+ * LPUART1, SPI6, I2C4 and the other D3 peripherals can only be served by the BDMA, which in turn
+ * only reaches SRAM4 and the backup SRAM. Transfers use the same dma_transfer_t as DMA1/DMA2,
+ * with instance = DMA_INSTANCE_BDMA, stream = BDMA channel and request_id from DMAMUX2.
+ * Normal and circular modes are supported; double buffer mode is not. Callbacks go through
+ * dma_notify_complete()/dma_notify_event(), so channels can use deferred dispatch as well.
+ **************************************************************************************************/
+
+/**
+ * @brief Enables the BDMA/DMAMUX2 clocks and keeps them running while the D3 domain is
+ * autonomous, so transfers continue while the CPU sleeps.
+ */
+void bdma_init(void);
+
+/**
+ * @brief Starts a BDMA transfer. The memory buffer must be in SRAM4 (see BDMA_BUFFER).
+ * @return TI_ERRC_UNSUPPORTED for double buffer mode, otherwise a ti_errc_t error code.
+ */
+int bdma_start_transfer(dma_transfer_t *dma_transfer);
+
+/**
+ * @brief Stops a transfer on a BDMA channel.
+ * @return TI_ERRC_INVALID_STATE if the channel is idle, otherwise a ti_errc_t error code.
+ */
+int bdma_stop_transfer(uint8_t channel);
+
+/**
+ * @brief Number of items the channel still has to transfer (CNDTR).
+ */
+uint32_t bdma_get_remaining(uint8_t channel);
+
+/**
+ * @brief Whether the BDMA can access the given memory range (SRAM4 or backup SRAM).
+ */
+bool bdma_mem_is_accessible(const void *buffer, size_t size);
+
+/**
+ * @brief Interrupt handler. Call from BDMA_Channely_IRQHandler().
+ */
+void bdma_irq(uint8_t channel);
+
+/**************************************************************************************************
+ * @section Triggered Transfers
+ *
+ * Binds a transfer to a DMAMUX request generator. Bind first, then start the transfer as usual
+ * (circular mode is the natural fit for periodic sampling) and enable the generator; from then
+ * on the hardware alone decides when each burst runs.
+ **************************************************************************************************/
+
+/**
+ * @brief Configures a request generator and points the transfer at it by setting its
+ * request_id. The generator stays disabled until dma_trigger_enable().
+ * @param dma_transfer Transfer on DMA1, DMA2 or the BDMA (instance must be set).
+ * @return TI_ERRC_BUSY if the generator is enabled, otherwise a ti_errc_t error code.
+ */
+int dma_trigger_bind(dma_transfer_t *dma_transfer, const dma_trigger_config_t *config);
+
+/**
+ * @brief Starts reacting to trigger edges. Call after the transfer has been started.
+ * @return ti_errc_t error code.
+ */
+int dma_trigger_enable(uint8_t instance, uint8_t generator);
+
+/**
+ * @brief Stops reacting to trigger edges. Requests already issued are still served.
+ * @return ti_errc_t error code.
+ */
+int dma_trigger_disable(uint8_t instance, uint8_t generator);
+
+/**
+ * @brief Number of trigger edges that arrived before the previous burst was served, i.e.
+ * samples that were missed.
+ */
+uint32_t dma_trigger_get_overruns(uint8_t instance, uint8_t generator);
+
+/**
+ * @brief Overrun interrupt handler. Call from DMAMUX1_OVR_IRQHandler() with instance 1, or from
+ * DMAMUX2_OVR_IRQHandler() with DMA_INSTANCE_BDMA.
+ */
+void dma_trigger_irq(uint8_t instance);
+
+/**************************************************************************************************
+ * @section Completion Dispatch
+ *
+ * The DMA ISRs hand every callback to dma_notify_complete()/dma_notify_event(). By default the
+ * callback runs right away. In deferred mode the ISR only pushes a small record into a lock-free
+ * queue, and the callback runs later from dma_dispatch_deferred() in the main loop or a
+ * low-priority handler, so a slow callback no longer delays other DMA interrupts.
+ * Deferred callbacks run in the order their events occurred. No event is ever dropped: if the
+ * queue is full the callback runs in the ISR as in ISR mode, and is counted in overflows. A
+ * one-shot transfer has a single completion outstanding, so its callback is never reordered;
+ * only a circular stream's HALF/FULL events can then overtake its older queued ones.
+ * Note that a deferred DMA_EVENT_FULL may arrive too late for dma_set_idle_buffer().
+ **************************************************************************************************/
+
+/**
+ * @brief Enables the cycle counter used for the dispatch statistics and clears them.
+ */
+void dma_dispatch_init(void);
+
+/**
+ * @brief Selects where completion callbacks for a stream (or BDMA/MDMA channel) run.
+ * @return ti_errc_t error code.
+ */
+int dma_set_dispatch_mode(uint8_t instance, uint8_t stream, dma_dispatch_mode_t mode);
+
+/**
+ * @brief Returns where completion callbacks for a stream run (DMA_DISPATCH_ISR for an invalid one).
+ */
+dma_dispatch_mode_t dma_get_dispatch_mode(uint8_t instance, uint8_t stream);
+
+/**
+ * @brief Reports a completed transfer. Called by the DMA ISR.
+ */
+void dma_notify_complete(uint8_t instance, uint8_t stream, dma_callback_t callback, bool success,
+                         void *context);
+
+/**
+ * @brief Reports a circular/double-buffer event. Called by the DMA ISR.
+ */
+void dma_notify_event(uint8_t instance, uint8_t stream, dma_event_callback_t callback,
+                      dma_event_t event, uint8_t buffer, void *context);
+
+/**
+ * @brief Runs deferred callbacks in the order their events occurred.
+ * @param max_events Upper bound on callbacks to run (0 for no limit).
+ * @return Number of callbacks run.
+ */
+uint32_t dma_dispatch_deferred(uint32_t max_events);
+
+/**
+ * @brief Copies the dispatch statistics for one mode.
+ * @return ti_errc_t error code.
+ */
+int dma_get_dispatch_stats(dma_dispatch_mode_t mode, dma_dispatch_stats_t *stats);
+
+/**
+ * @brief Clears the dispatch statistics of both modes.
+ */
+void dma_reset_dispatch_stats(void);
+
+/**************************************************************************************************
+ * @section Stream Allocation
+ *
+ * All stream state changes are single atomic compare-and-swaps, so claims from different
+ * contexts can never hand out the same stream twice.
+ **************************************************************************************************/
+
+/**
+ * @brief Claims a free stream for exclusive, long-term use by a driver.
+ *
+ * The controller with fewer claimed streams is preferred so that load is spread over DMA1 and
+ * DMA2. Within a controller the arbiter favours lower stream numbers when software priorities
+ * are equal, so high priority (2-3) claims take the lowest free stream and low priority (0-1)
+ * claims take the highest.
+ *
+ * @param priority DMA priority the stream will be used with (0-3).
+ * @param flags 0 or DMA_CLAIM_SHAREABLE.
+ * @param stream Output for the claimed stream.
+ * @return TI_ERRC_NO_MEM if no stream is free, otherwise a ti_errc_t error code.
+ */
+int dma_claim_stream(uint8_t priority, uint8_t flags, dma_stream_t *stream);
+
+/**
+ * @brief Claims a specific stream, e.g. one that is wired to a fixed request on the board.
+ * @return TI_ERRC_BUSY if the stream is claimed or lent out, otherwise a ti_errc_t error code.
+ */
+int dma_claim_specific_stream(dma_stream_t stream, uint8_t flags);
+
+/**
+ * @brief Releases a claimed stream.
+ * @return TI_ERRC_BUSY if a transfer is still running on it, otherwise a ti_errc_t error code.
+ */
+int dma_release_stream(dma_stream_t stream);
+
+/**
+ * @brief Marks a stream as running a transfer. Owners of DMA_CLAIM_SHAREABLE streams must call
+ * this before each transfer, since the stream may currently be lent out.
+ * @return TI_ERRC_BUSY if the stream is lent out, otherwise a ti_errc_t error code.
+ */
+int dma_stream_begin(dma_stream_t stream);
+
+/**
+ * @brief Marks the transfer on a stream as finished, returning a borrowed stream to its owner
+ * (or to the free pool). Safe to call from the DMA completion callback.
+ */
+int dma_stream_end(dma_stream_t stream);
+
+/**
+ * @brief Borrows a stream for a single transfer. Free streams are used first, then idle
+ * DMA_CLAIM_SHAREABLE streams. The stream must be handed back with dma_stream_end().
+ *
+ * @param priority DMA priority the transfer will use (0-3).
+ * @param stream Output for the borrowed stream.
+ * @return TI_ERRC_BUSY if every stream is in use, otherwise a ti_errc_t error code.
+ */
+int dma_borrow_stream(uint8_t priority, dma_stream_t *stream);
@@ -24,9 +24,28 @@
 #include "util/include/errc.h"
 #include "internal/include/dma.h"
 
-// This interface only supports a single I2C at a time.
-// Only I2C 1-3 are supported.
-#define I2C_INSTANCE 1
+// I2C1-3 are served by DMA1/DMA2, I2C4 (D3 domain) by the BDMA.
+// Each instance has its own state, so transactions on different buses run in parallel.
+#define I2C_INSTANCE_COUNT 4
+
+// Bus speeds (Hz) of the I2C modes, see i2c_compute_timing()
+#define I2C_SPEED_STANDARD 100000U
+#define I2C_SPEED_FAST 400000U
+#define I2C_SPEED_FAST_PLUS 1000000U
+
+// Register address width for i2c_mem_read_*() / i2c_mem_write_*()
+#define I2C_MEM_ADDR_8BIT 1
+#define I2C_MEM_ADDR_16BIT 2 // Sent MSB first
+
+// Requests each instance can hold in its i2c_submit() queue. Must be a power of two.
+#ifndef I2C_QUEUE_DEPTH
+#define I2C_QUEUE_DEPTH 8
+#endif
+
+// Bus recovery (see i2c_service())
+#define I2C_DEFAULT_BUS_TIMEOUT_US 25000U // SMBus clock low timeout
+#define I2C_RECOVERY_CLOCKS 9             // SCL pulses per attempt to free SDA
+#define I2C_BUSY_REJECTIONS 4             // Async starts refused on a busy bus before recovering it
 
 /**************************************************************************************************
  * @section Type Definitions
@@ -44,59 +63,255 @@ enum i2c_addr_mode_t {
     int scl_pin;
     int sda_pin;
     uint32_t timeout;
+    uint8_t alt_func;        // 0 for AF4 (I2C4 on PB6-PB9 is AF6)
+    uint8_t bdma_tx_channel; // I2C4 only, buffers must then be declared with BDMA_BUFFER
+    uint8_t bdma_rx_channel; // I2C4 only
+    bool fast_mode_plus;     // 20 mA drive on SCL/SDA (SYSCFG_PMCR), needed above 400 kHz
+    uint32_t clk_freq;       // I2C kernel clock in Hz, for the hardware bus timeout (0 disables it)
+    uint32_t bus_timeout_us; // SCL held low this long is a bus fault, 0 for I2C_DEFAULT_BUS_TIMEOUT_US
 }i2c_config_t;
 
-// Callback function type for I2C transactions
-typedef void (*i2c_callback_t)(bool success);
+/**
+ * @brief Bus health counters
+ *
+ * Every bus fault (timeout, bus error, lost arbitration) takes the instance out of service until
+ * i2c_service() has recovered the bus.
+ */
+typedef struct {
+    uint32_t nacks;             // Transactions not acknowledged by the device
+    uint32_t bus_errors;        // Misplaced START/STOP (BERR)
+    uint32_t arbitration_lost;  // SDA read back low while driven high (ARLO), e.g. SDA stuck
+    uint32_t timeouts;          // SCL held low (TIMEOUTR), a blocking wait that ran out or a stuck BUSY
+    uint32_t recoveries;        // Completed bus recoveries
+    uint32_t recovery_failures; // Rounds of I2C_RECOVERY_CLOCKS pulses that did not free SDA
+} i2c_stats_t;
+
+/**
+ * @brief Input of the TIMINGR solver
+ *
+ * Rise and fall times depend on the bus capacitance and pull-ups, measure them or use the
+ * maximums of the mode (1000/300 ns standard, 300/300 ns fast, 120/120 ns fast plus). The
+ * filters must match the ones given to i2c_init().
+ */
+typedef struct {
+    uint32_t clk_freq;       // I2C kernel clock in Hz
+    uint32_t speed;          // Target SCL frequency in Hz, at most I2C_SPEED_FAST_PLUS
+    uint16_t rise_ns;
+    uint16_t fall_ns;
+    bool analog_filter;
+    uint8_t digital_filter;
+} i2c_timing_config_t;
+
+/**
+ * @brief Output of the TIMINGR solver
+ */
+typedef struct {
+    uint32_t timingr;        // For i2c_config_t.timing
+    uint32_t actual_speed;   // SCL frequency with the given rise and fall times, in Hz
+    bool fast_mode_plus;     // For i2c_config_t.fast_mode_plus
+} i2c_timing_t;
+
+// Callback function type for I2C transactions, called from the I2C or DMA interrupt
+typedef void (*i2c_callback_t)(bool success, void *context);
+
+typedef enum {
+    I2C_OP_READ,
+    I2C_OP_WRITE,
+    I2C_OP_MEM_READ,  // Register address write, repeated START, read
+    I2C_OP_MEM_WRITE, // Register address and data in one write
+} i2c_op_t;
+
+/**
+ * @brief Queued I2C transaction
+ *
+ * Each request carries its own callback and context, so several drivers can share a bus and
+ * still tell whose transaction completed.
+ */
+typedef struct {
+    i2c_op_t op;
+    uint16_t addr;
+    uint16_t mem_addr;       // I2C_OP_MEM_* only
+    uint8_t mem_addr_size;   // I2C_OP_MEM_* only, I2C_MEM_ADDR_8BIT or I2C_MEM_ADDR_16BIT
+    uint8_t *data;           // Declared with DMA_BUFFER (BDMA_BUFFER on I2C4), untouched until the callback
+    size_t size;
+    i2c_callback_t callback; // May be NULL
+    void *context;
+} i2c_request_t;
 
 /**************************************************************************************************
  * @section Public Functions
  **************************************************************************************************/
 
 /**
- * @brief Initializes the I2C instance defined by I2C_INSTANCE
+ * @brief Computes a TIMINGR value for a bus speed. Searches the prescaler, data setup and hold
+ * delays that meet the I2C specification limits of the mode (standard, fast or fast plus,
+ * picked from the speed), then the SCL low and high periods that get closest to the speed
+ * without exceeding it.
+ * @param config Kernel clock, speed, rise/fall times and filters.
+ * @param timing Filled with the register value and the resulting speed.
+ * @return enum ti_errc_t, TI_ERRC_INVALID_ARG if the speed is above fast mode plus, or
+ * TI_ERRC_UNSUPPORTED if no setting meets the specification at this kernel clock.
+ */
+ti_errc_t i2c_compute_timing(const i2c_timing_config_t *config, i2c_timing_t *timing);
+
+/**
+ * @brief Initializes an I2C instance. I2C1-3 claim a TX and RX stream on DMA1/DMA2, I2C4 uses
+ * the BDMA channels given in the config.
+ * @param instance I2C instance (1-4).
  * @param config Configuration structure.
- * @param callback The DMA callback.
+ * @param callback Called when a transfer started by one of the i2c_*_async() functions completes.
+ * Requests given to i2c_submit() carry their own.
+ * @param context Passed to the callback.
  * @return emun ti_errc_t, the error code inicating success (TI_ERRC_NONE), or a specific
  * error code if there is a failure. 
  */
-ti_errc_t i2c_init(i2c_config_t *config, dma_callback_t callback);
+ti_errc_t i2c_init(uint8_t instance, i2c_config_t *config, i2c_callback_t callback, void *context);
 
 /**
  * @brief Reads data over I2C from the device with the given address. Asyncronous (DMA-powered) function.
+ * @param instance I2C instance (1-4).
  * @param addr Address of I2C device.
  * @param rx_data Address of data to read.
  * @param size Number of bytes to read.
  * @return emun ti_errc_t, the error code inicating success (TI_ERRC_NONE), or a specific
  * error code if there is a failure. 
  */
-ti_errc_t i2c_read_async(uint16_t addr, uint8_t *rx_data, size_t size);
+ti_errc_t i2c_read_async(uint8_t instance, uint16_t addr, uint8_t *rx_data, size_t size);
 
 /**
  * @brief Writes data over I2C to the device with the given address. Asyncronous (DMA-powered) function.
+ * @param instance I2C instance (1-4).
  * @param addr Address of I2C device.
  * @param tx_data Address of data to write.
  * @param size Number of bytes to write.
  * @return emun ti_errc_t, the error code inicating success (TI_ERRC_NONE), or a specific
  * error code if there is a failure. 
  */
-ti_errc_t i2c_write_async(uint16_t addr, uint8_t *tx_data, size_t size);
+ti_errc_t i2c_write_async(uint8_t instance, uint16_t addr, uint8_t *tx_data, size_t size);
 
 /**
  * @brief Reads data over I2C from the device with the given address. Blocking (syncronous) function.
+ * @param instance I2C instance (1-4).
  * @param addr Address of I2C device.
  * @param rx_data Address of data to read.
  * @param size Number of bytes to read.
  * @return emun ti_errc_t, the error code inicating success (TI_ERRC_NONE), or a specific
  * error code if there is a failure.
  */
-ti_errc_t i2c_read_blocking(uint16_t addr, uint8_t *tx_data, size_t size);
+ti_errc_t i2c_read_blocking(uint8_t instance, uint16_t addr, uint8_t *tx_data, size_t size);
 
 /**
  * @brief Writes data over I2C to the device with the given address. Blocking (syncronous) function.
+ * @param instance I2C instance (1-4).
  * @param addr Address of I2C device.
  * @param tx_data Address of data to write.
  * @param size Number of bytes to write.
  * @return enum ti_errc_t, whether the transfer was successful.
  */
-ti_errc_t i2c_write_blocking(uint16_t addr, uint8_t *tx_data, size_t size);
\ No newline at end of file
+ti_errc_t i2c_write_blocking(uint8_t instance, uint16_t addr, uint8_t *tx_data, size_t size);
+
+/**
+ * @brief Reads registers from a device in one transaction: the register address is written,
+ * then a repeated START (no STOP in between) turns the bus around for the read. Blocking
+ * (syncronous) function.
+ * @param instance I2C instance (1-4).
+ * @param addr Address of I2C device.
+ * @param mem_addr Register address to start reading from.
+ * @param mem_addr_size I2C_MEM_ADDR_8BIT or I2C_MEM_ADDR_16BIT.
+ * @param rx_data Buffer for the data read.
+ * @param size Number of bytes to read.
+ * @return enum ti_errc_t, TI_ERRC_INVALID_STATE if the device did not acknowledge,
+ * TI_ERRC_TIMEOUT if the bus stalled, otherwise whether the transfer was successful.
+ */
+ti_errc_t i2c_mem_read_blocking(uint8_t instance, uint16_t addr, uint16_t mem_addr,
+                                uint8_t mem_addr_size, uint8_t *rx_data, size_t size);
+
+/**
+ * @brief Writes registers of a device: the register address and the data go out in a single
+ * write transaction. Blocking (syncronous) function.
+ * @param instance I2C instance (1-4).
+ * @param addr Address of I2C device.
+ * @param mem_addr Register address to start writing at.
+ * @param mem_addr_size I2C_MEM_ADDR_8BIT or I2C_MEM_ADDR_16BIT.
+ * @param tx_data Data to write.
+ * @param size Number of bytes to write.
+ * @return enum ti_errc_t, whether the transfer was successful.
+ */
+ti_errc_t i2c_mem_write_blocking(uint8_t instance, uint16_t addr, uint16_t mem_addr,
+                                 uint8_t mem_addr_size, const uint8_t *tx_data, size_t size);
+
+/**
+ * @brief Asyncronous (DMA-powered) version of i2c_mem_read_blocking(). The register address is
+ * sent from the I2C interrupt, the data phase runs on DMA, and the callback passed to
+ * i2c_init() for the instance is called once the STOP has been sent.
+ * @param rx_data Buffer for the data read. Should be declared with DMA_BUFFER.
+ * @return enum ti_errc_t, TI_ERRC_BUSY if a transaction is in progress.
+ */
+ti_errc_t i2c_mem_read_async(uint8_t instance, uint16_t addr, uint16_t mem_addr,
+                             uint8_t mem_addr_size, uint8_t *rx_data, size_t size);
+
+/**
+ * @brief Asyncronous (DMA-powered) version of i2c_mem_write_blocking().
+ * @param tx_data Data to write. Should be declared with DMA_BUFFER, and must stay untouched
+ * until the callback.
+ * @return enum ti_errc_t, TI_ERRC_BUSY if a transaction is in progress.
+ */
+ti_errc_t i2c_mem_write_async(uint8_t instance, uint16_t addr, uint16_t mem_addr,
+                              uint8_t mem_addr_size, const uint8_t *tx_data, size_t size);
+
+/**
+ * @brief Queues a transaction. Requests on an instance run one after the other in submission
+ * order, each started from the interrupt that completed the previous one, and each request's
+ * callback runs before the next request starts. Safe to call from an ISR, including from a
+ * request callback.
+ * @param instance I2C instance (1-4).
+ * @param request The transaction (copied, may live on the stack).
+ * @return enum ti_errc_t, TI_ERRC_BUSY if I2C_QUEUE_DEPTH requests are already pending,
+ * TI_ERRC_INVALID_ARG if the request is malformed. A request that fails once started is
+ * reported through its callback.
+ */
+ti_errc_t i2c_submit(uint8_t instance, const i2c_request_t *request);
+
+/**
+ * @brief Advances bus recovery by one step. Call periodically from the main loop for each
+ * instance. It returns immediately when the bus is healthy and never waits on the bus.
+ *
+ * After a bus fault the peripheral is disabled and the instance reports TI_ERRC_BUSY (queued
+ * requests wait). A bus that stays BUSY through I2C_BUSY_REJECTIONS async starts in a row counts
+ * as a fault too: TIMEOUTR only trips while SCL is held low, not for SDA held low with SCL high.
+ * Each call then drives one edge: up to I2C_RECOVERY_CLOCKS SCL pulses until the device holding
+ * SDA lets go, a STOP, and finally a reset and re-initialization of the peripheral. After that
+ * the queue resumes.
+ * @param instance I2C instance (1-4).
+ */
+void i2c_service(uint8_t instance);
+
+/**
+ * @brief Starts a bus recovery, e.g. after a device stopped answering. An async transaction in
+ * progress is failed through its callback.
+ * @param instance I2C instance (1-4).
+ * @return enum ti_errc_t, TI_ERRC_BUSY if a blocking transaction is in progress.
+ */
+ti_errc_t i2c_recover(uint8_t instance);
+
+/**
+ * @brief Whether the instance is out of service for bus recovery.
+ */
+bool i2c_is_recovering(uint8_t instance);
+
+/**
+ * @brief Copies the bus health counters of an instance.
+ * @return enum ti_errc_t, TI_ERRC_INVALID_ARG for an invalid instance or NULL stats.
+ */
+ti_errc_t i2c_get_stats(uint8_t instance, i2c_stats_t *stats);
+
+/**
+ * @brief Clears the bus health counters of an instance.
+ */
+ti_errc_t i2c_reset_stats(uint8_t instance);
+
+/**
+ * @brief I2C event and error interrupt handler. Call from both I2Cx_EV_IRQHandler() and
+ * I2Cx_ER_IRQHandler() of the instance.
+ */
+void i2c_irq(uint8_t instance);
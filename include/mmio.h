@@ -8457,11 +8457,6 @@
     },
   };
 
-  static rw_reg32_t const DMAx_S0CR[3] = {
-    [1] = (rw_reg32_t)0x40020010U,   /** @brief Stream x configuration register. */
-    [2] = (rw_reg32_t)0x40020410U,   /** @brief Stream x configuration register. */
-  };
-
   static rw_reg32_t const DMAx_S1CR[3] = {
     [1] = (rw_reg32_t)0x40020028U,   /** @brief Stream x configuration register. */
     [2] = (rw_reg32_t)0x40020428U,   /** @brief Stream x configuration register. */
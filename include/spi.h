@@ -29,6 +29,15 @@
 #define IS_VALID_DEVICE(device) ((device.instance > 0) && (device.instance < 7) && device.gpio_pin != 0)
 #define SPI_INSTANCE_COUNT 6
 
+// Bus utilization/latency counters. Set to 1 (e.g. -DSPI_STATS_ENABLED=1) to compile them in.
+#ifndef SPI_STATS_ENABLED
+#define SPI_STATS_ENABLED 0
+#endif
+#define SPI_STATS_MAX_DEVICES 16 // Devices tracked individually across all instances
+#define SPI_STATS_HIST_BINS 8    // Latency bins: <1us, <2us, <4us ... <64us, >=64us
+
+#define SPI_ISR_QUEUE_DEPTH 8 // Pending ISR submissions per instance (must be a power of two)
+
 /**************************************************************************************************
  * @section Type definitions
  **************************************************************************************************/
@@ -59,6 +68,21 @@ typedef struct {
     uint64_t mutex_timeout;
 } spi_config_t;
 
+/**
+ * @brief Hardware NSS configuration
+ *
+ * Opt-in mode for instances with a single device. The SPI drives its own NSS pin, so no GPIO
+ * writes are needed around a transfer, and the FIFO threshold lets 8-bit frames be moved four
+ * at a time with 32-bit accesses to TXDR/RXDR.
+ */
+typedef struct {
+    uint8_t nss_pin;          // Pin routed to SPIx_NSS
+    uint8_t nss_af;           // Alternate function number of the NSS pin
+    uint8_t mssi;             // Clock cycles between NSS assertion and the first frame (0-15)
+    uint8_t midi;             // Idle clock cycles inserted between frames (0-15)
+    uint8_t fifo_threshold;   // Frames per TXP/RXP event (1-16). Use 4 or more with 8-bit frames.
+} spi_hw_nss_config_t;
+
 typedef void (*spi_callback_t)(bool success);
 
 // Passed to DMA streams to un-init the SPI transfer
@@ -91,6 +115,24 @@ struct spi_async_transfer_t {
     bool read_mem_inc;
 };
 
+/**
+ * @brief SPI bus statistics
+ *
+ * Snapshot of the counters kept for an SPI instance or a single device. Times are in CPU cycles
+ * (DWT cycle counter). Latency is measured from the call to spi_block() until the end of the
+ * transfer, so it includes both the time spent waiting for the bus and the time on the wire.
+ */
+typedef struct {
+    uint32_t transactions;       // Number of completed transfers
+    uint64_t bytes;              // Number of bytes moved (each byte is clocked out and in once)
+    uint32_t blocks;             // Number of times the bus was acquired via spi_block()
+    uint64_t block_wait_cycles;  // Total time spent waiting in spi_block()
+    uint32_t block_wait_max;     // Longest single wait in spi_block()
+    uint64_t wire_cycles;        // Total time spent on the wire
+    uint32_t wire_max;           // Longest single transfer
+    uint32_t latency_hist[SPI_STATS_HIST_BINS];
+} spi_stats_t;
+
 /**************************************************************************************************
  * @section Function Definitions
  **************************************************************************************************/
@@ -114,13 +156,55 @@ int spi_init(uint8_t instance, spi_config_t *spi_config);
  */
 int spi_device_init(spi_device_t device);
 
+/**
+ * @brief Switches an initialized SPI controller to hardware NSS management and programs the
+ * FIFO threshold. Only valid for instances with a single device: NSS is asserted for the whole
+ * transfer and released at EOT. That device is the one whose gpio_pin is nss_pin. The bus
+ * reservation functions (spi_wait_block(), spi_try_block(), spi_submit_isr()) refuse any other
+ * device and leave the CS GPIO alone on these instances. Do not call spi_device_init() for the
+ * device, since it would take the NSS pin back as a GPIO output.
+ *
+ * @param instance SPI instance (1-6)
+ * @param config Hardware NSS configuration
+ * @returns ti_errc_t error code
+ */
+int spi_hw_nss_init(uint8_t instance, spi_hw_nss_config_t *config);
+
+/**
+ * @brief Whether an instance was switched to hardware NSS with spi_hw_nss_init().
+ */
+bool spi_is_hw_nss(uint8_t instance);
+
+/**
+ * @brief Whether a device may use its instance: on a hardware NSS instance only the device on
+ * the NSS pin is accepted. Always true on other instances.
+ */
+bool spi_hw_nss_accepts(spi_device_t device);
+
+/**
+ * @brief Polling full-duplex transfer for hardware NSS instances with 8-bit frames. Moves data
+ * through TXDR/RXDR in 32-bit words while at least four frames remain, then byte by byte. Words
+ * are only written when the FIFO threshold is at least 4; with a lower threshold TXP does not
+ * guarantee room for a word, so TXDR is written a byte at a time.
+ *
+ * @param instance SPI instance (1-6)
+ * @param source Bytes to send
+ * @param dest Buffer for received bytes (may be NULL to discard them)
+ * @param size Number of frames (1-65535)
+ * @param timeout Number of polls before giving up
+ * @returns ti_errc_t error code
+ */
+int spi_transfer_packed(uint8_t instance, const uint8_t *source, uint8_t *dest, size_t size,
+                        uint32_t timeout);
+
 int spi_transfer_sync(struct spi_sync_transfer_t *transfer);
 
 int spi_transfer_async(struct spi_async_transfer_t *transfer);
 
 /**
  * @brief Block the spi device and instance from talking to anyone else.
- *        (Aquires the mutex and pulls the pin)
+ *        (Aquires the mutex, then the ISR queue reservation with spi_wait_block(), which
+ *        pulls the pin)
  * @param device: the device to block
  * @returns ti_errc_t error code
  */
@@ -128,7 +212,128 @@ int spi_block(spi_device_t device);
 
 /**
  * @brief Releases the spi device (pin and instance) to be used by anyone.
+ *        (Hands the reservation back with spi_try_unblock(), then releases the mutex)
+ * @param device: the device to release
+ * @returns ti_errc_t error code
+ */
+int spi_unblock(spi_device_t device);
+
+/**
+ * @brief Takes the same reservation as spi_try_block() and spi_submit_isr(), waiting for any
+ *        transfers queued from ISRs to finish first, then pulls the pin. Called by spi_block()
+ *        once it holds the mutex, so that only one thread ever waits here.
+ * @param device: the device to block
+ * @param timeout: number of polls before giving up
+ * @returns TI_ERRC_TIMEOUT if the ISR queue kept the instance for the whole timeout, otherwise a
+ *          ti_errc_t error code
+ */
+int spi_wait_block(spi_device_t device, uint64_t timeout);
+
+/**
+ * @brief Non-blocking version of spi_block(). Reserves the instance with an atomic
+ *        compare-and-swap (LDREX/STREX) and pulls the pin. Safe to call from an ISR.
+ * @param device: the device to block
+ * @returns TI_ERRC_BUSY if the instance is already reserved, otherwise a ti_errc_t error code
+ */
+int spi_try_block(spi_device_t device);
+
+/**
+ * @brief Releases a reservation taken with spi_try_block() and starts any transfers that
+ *        were queued with spi_submit_isr() in the meantime.
  * @param device: the device to release
+ * @returns TI_ERRC_INVALID_STATE if the reservation is not held by this device (e.g. the ISR
+ *          queue is running a transfer), otherwise a ti_errc_t error code
+ */
+int spi_try_unblock(spi_device_t device);
+
+/**
+ * @brief Queues an asynchronous transfer without ever blocking. Safe to call from an ISR
+ *        (e.g. a data-ready EXTI or a timer). The transfer is copied into a lock-free
+ *        per-instance queue and started as soon as the instance is free, with the device
+ *        selected for the duration of the transfer. The callback runs in the DMA ISR.
+ * @param transfer: the transfer to queue (copied, may live on the stack)
+ * @returns TI_ERRC_BUSY if SPI_ISR_QUEUE_DEPTH transfers are already pending, otherwise a
+ *          ti_errc_t error code
+ * @note spi_block() takes the same reservation (see spi_wait_block()), so a submission made
+ *       while a thread holds the bus waits in the queue until spi_unblock().
+ */
+int spi_submit_isr(struct spi_async_transfer_t *transfer);
+
+/**************************************************************************************************
+ * @section Statistics
+ *
+ * The driver brackets the mutex acquisition in spi_block() with spi_stats_block_begin() and
+ * spi_stats_block_end(), and each transfer with spi_stats_xfer_begin() and spi_stats_xfer_end()
+ * (for async transfers the end hook runs in the DMA completion callback). When SPI_STATS_ENABLED
+ * is 0 the hooks are empty inline functions and the snapshot API returns TI_ERRC_UNSUPPORTED.
+ **************************************************************************************************/
+#if SPI_STATS_ENABLED
+
+/**
+ * @brief Enables the DWT cycle counter used as the time base and clears all counters.
+ * @param clk_freq: core clock in Hz, the rate CYCCNT counts at (used for the latency bins)
+ * @returns TI_ERRC_INVALID_ARG if clk_freq is below 1 MHz.
+ */
+int spi_stats_init(uint32_t clk_freq);
+
+/**
+ * @brief Starts tracking a device individually. Called from spi_device_init(). Devices that are
+ *        not registered still count towards the totals of their instance.
+ * @param device: the device to track
+ * @returns TI_ERRC_NO_MEM if SPI_STATS_MAX_DEVICES devices are already tracked.
+ */
+int spi_stats_register_device(spi_device_t device);
+
+void spi_stats_block_begin(spi_device_t device);
+void spi_stats_block_end(spi_device_t device);
+void spi_stats_xfer_begin(spi_device_t device);
+void spi_stats_xfer_end(spi_device_t device, size_t size);
+
+/**
+ * @brief Copies a consistent snapshot of the counters for an SPI instance.
+ * @param instance: SPI instance (1-6)
+ * @param stats: destination for the snapshot
+ * @returns ti_errc_t error code
+ */
+int spi_get_stats(uint8_t instance, spi_stats_t *stats);
+
+/**
+ * @brief Copies a consistent snapshot of the counters for a single device.
+ * @param device: the device to query (must have been registered)
+ * @param stats: destination for the snapshot
+ * @returns ti_errc_t error code
+ */
+int spi_get_device_stats(spi_device_t device, spi_stats_t *stats);
+
+/**
+ * @brief Clears the counters of an instance and of every device on it.
+ * @param instance: SPI instance (1-6)
  * @returns ti_errc_t error code
  */
-int spi_unblock(spi_device_t device);
\ No newline at end of file
+int spi_reset_stats(uint8_t instance);
+
+#else
+
+static inline int spi_stats_init(uint32_t clk_freq) { (void)clk_freq; return TI_ERRC_NONE; }
+static inline int spi_stats_register_device(spi_device_t device) { (void)device; return TI_ERRC_NONE; }
+static inline void spi_stats_block_begin(spi_device_t device) { (void)device; }
+static inline void spi_stats_block_end(spi_device_t device) { (void)device; }
+static inline void spi_stats_xfer_begin(spi_device_t device) { (void)device; }
+static inline void spi_stats_xfer_end(spi_device_t device, size_t size) { (void)device; (void)size; }
+
+static inline int spi_get_stats(uint8_t instance, spi_stats_t *stats) {
+    (void)instance; (void)stats;
+    return TI_ERRC_UNSUPPORTED;
+}
+
+static inline int spi_get_device_stats(spi_device_t device, spi_stats_t *stats) {
+    (void)device; (void)stats;
+    return TI_ERRC_UNSUPPORTED;
+}
+
+static inline int spi_reset_stats(uint8_t instance) {
+    (void)instance;
+    return TI_ERRC_UNSUPPORTED;
+}
+
+#endif
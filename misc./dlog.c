@@ -0,0 +1,168 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file src/platform/dlog.c
+ * @authors Jude Merritt
+ * @brief Deferred binary logging
+ *
+ * Wire format: each frame carries a batch of little endian words. The first
+ * word is the running count of dropped records, followed by whole records
+ * (header word, then the arguments).
+ */
+
+#include "dlog.h"
+#include "frame.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DLOG_RING_MASK (DLOG_RING_WORDS - 1)
+#define DLOG_BATCH_WORDS 64
+#define DLOG_PAD DLOG_COUNT_MASK // Skip to the start of the ring
+
+_Static_assert((DLOG_RING_WORDS & DLOG_RING_MASK) == 0,
+               "DLOG_RING_WORDS must be a power of two");
+_Static_assert(DLOG_MAX_ARGS + 1 < DLOG_PAD,
+               "argument count does not fit the header");
+
+/**************************************************************************************************
+ * @section  Data Structures
+ **************************************************************************************************/
+
+// Records never wrap: one that would is preceded by a DLOG_PAD header and
+// placed at the start of the ring. Every slot not covered by a reservation
+// is kept at 0, so a non-zero header means the record is complete.
+static volatile uint32_t dlog_ring[DLOG_RING_WORDS];
+static _Atomic uint32_t dlog_head; // Reserved up to here (free running)
+static _Atomic uint32_t dlog_tail; // Consumed up to here (free running)
+static _Atomic uint32_t dlog_drops;
+
+static uint32_t dlog_batch[DLOG_BATCH_WORDS];
+static uint8_t dlog_frame[FRAME_MAX_ENCODED(sizeof(dlog_batch))];
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+static inline uint32_t record_words(uint32_t header) {
+  return header & DLOG_COUNT_MASK; // Header word plus arguments
+}
+
+static void release(uint32_t from, uint32_t to) {
+  for (uint32_t pos = from; pos != to; pos++) {
+    dlog_ring[pos & DLOG_RING_MASK] = 0;
+  }
+  atomic_store_explicit(&dlog_tail, to, memory_order_release);
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+bool dlog_write(uint32_t header, const uint32_t *args) {
+  uint32_t words = record_words(header);
+  uint32_t head = atomic_load_explicit(&dlog_head, memory_order_relaxed);
+  uint32_t pad;
+  uint32_t next;
+
+  // Reserve with a compare-and-swap so ISRs can preempt each other (and the
+  // thread) at any point without masking interrupts
+  do {
+    uint32_t offset = head & DLOG_RING_MASK;
+    pad = (offset + words > DLOG_RING_WORDS) ? DLOG_RING_WORDS - offset : 0;
+    next = head + pad + words;
+
+    uint32_t tail = atomic_load_explicit(&dlog_tail, memory_order_acquire);
+    if (next - tail > DLOG_RING_WORDS) {
+      atomic_fetch_add_explicit(&dlog_drops, 1, memory_order_relaxed);
+      return false;
+    }
+  } while (!atomic_compare_exchange_weak_explicit(
+      &dlog_head, &head, next, memory_order_relaxed, memory_order_relaxed));
+
+  if (pad != 0) {
+    dlog_ring[head & DLOG_RING_MASK] = DLOG_PAD;
+  }
+
+  uint32_t pos = (head + pad) & DLOG_RING_MASK;
+  for (uint32_t i = 1; i < words; i++) {
+    dlog_ring[pos + i] = args[i - 1];
+  }
+
+  // Publish the header last: it is what the drain waits on
+  atomic_thread_fence(memory_order_release);
+  dlog_ring[pos] = header;
+
+  return true;
+}
+
+size_t dlog_flush(uart_channel_t channel) {
+  size_t sent = 0;
+
+  for (;;) {
+    uint32_t tail = atomic_load_explicit(&dlog_tail, memory_order_relaxed);
+    uint32_t pos = tail;
+    size_t words = 1;
+    size_t records = 0;
+
+    dlog_batch[0] = atomic_load_explicit(&dlog_drops, memory_order_relaxed);
+
+    while (words < DLOG_BATCH_WORDS) {
+      uint32_t header = dlog_ring[pos & DLOG_RING_MASK];
+      if (header == 0) {
+        break; // Not committed yet
+      }
+      if (record_words(header) == DLOG_PAD) {
+        pos += DLOG_RING_WORDS - (pos & DLOG_RING_MASK);
+        continue;
+      }
+
+      uint32_t length = record_words(header);
+      if (words + length > DLOG_BATCH_WORDS) {
+        break;
+      }
+
+      atomic_thread_fence(memory_order_acquire);
+      for (uint32_t i = 0; i < length; i++) {
+        dlog_batch[words + i] = dlog_ring[(pos + i) & DLOG_RING_MASK];
+      }
+      words += length;
+      pos += length;
+      records++;
+    }
+
+    if (pos == tail) {
+      break;
+    }
+
+    if (records != 0) {
+      size_t length = frame_encode(dlog_frame, sizeof(dlog_frame),
+                                   (const uint8_t *)dlog_batch,
+                                   words * sizeof(uint32_t));
+      if (!uart_tx_queue_write(channel, dlog_frame, length)) {
+        break; // Try again once the queue drains
+      }
+    }
+
+    release(tail, pos);
+    sent += records;
+  }
+
+  return sent;
+}
+
+uint32_t dlog_dropped(void) {
+  return atomic_load_explicit(&dlog_drops, memory_order_relaxed);
+}
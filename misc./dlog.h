@@ -0,0 +1,108 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file src/platform/dlog.h
+ * @authors Jude Merritt
+ * @brief Deferred binary logging
+ *
+ * Log calls never format anything on target. DLOG() stores the address of
+ * its format string plus up to DLOG_MAX_ARGS raw 32-bit arguments in a
+ * lock-free ring, and dlog_flush() later ships the records over UART as
+ * frames (see frame.h). The host rebuilds the text by looking the address up
+ * in the .dlog_fmt section of the ELF (tools/dlog_cat).
+ *
+ * The format strings are only needed by the host, so the linker script
+ * should keep them out of flash:
+ *
+ *   .dlog_fmt (INFO) : { KEEP(*(.dlog_fmt)) }
+ */
+#pragma once
+#include "uart.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**************************************************************************************************
+ * @section Macros
+ **************************************************************************************************/
+#ifndef DLOG_RING_WORDS
+#define DLOG_RING_WORDS 512 // Must be a power of two
+#endif
+
+#define DLOG_MAX_ARGS 4
+#define DLOG_FMT_SECTION ".dlog_fmt"
+
+// A record header is the format address with (argument count + 1) in the
+// low bits, which the string alignment leaves free. 0 marks an empty slot.
+#define DLOG_FMT_ALIGN 8
+#define DLOG_COUNT_MASK (DLOG_FMT_ALIGN - 1)
+
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, n, ...) n
+#define DLOG_NARGS(...) DLOG_NARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+
+#define DLOG_ID(fmt)                                                           \
+  ({                                                                           \
+    static const char dlog_fmt_[]                                              \
+        __attribute__((section(DLOG_FMT_SECTION), aligned(DLOG_FMT_ALIGN),     \
+                       used)) = fmt;                                           \
+    (uint32_t)(uintptr_t)dlog_fmt_;                                            \
+  })
+
+/**
+ * Logs a printf-style message with up to DLOG_MAX_ARGS integer arguments.
+ * Arguments are stored as uint32_t; pass floats through dlog_f32().
+ * Usable from any context, including ISRs.
+ */
+#define DLOG(fmt, ...)                                                         \
+  dlog_write(DLOG_ID(fmt) | (DLOG_NARGS(__VA_ARGS__) + 1),                     \
+             (const uint32_t[DLOG_MAX_ARGS + 1]){0, ##__VA_ARGS__} + 1)
+
+/**************************************************************************************************
+ * @section Function Definitions
+ **************************************************************************************************/
+/**
+ * @brief Appends one record to the log ring. Normally called through DLOG().
+ *
+ * @param header Format address ORed with (argument count + 1).
+ * @param args The arguments.
+ * @return false if the ring was full and the record was dropped.
+ */
+bool dlog_write(uint32_t header, const uint32_t *args);
+
+/**
+ * @brief Moves committed records into the UART transmit queue of @p channel
+ * (see uart_tx_queue_init()). Call from thread context, e.g. the main loop.
+ * Records stay in the ring if the queue is full.
+ *
+ * @param channel USART channel carrying the log.
+ * @return Number of records sent.
+ */
+size_t dlog_flush(uart_channel_t channel);
+
+/**
+ * @brief Number of records dropped because the ring was full.
+ */
+uint32_t dlog_dropped(void);
+
+/**
+ * @brief Bit pattern of a float, for passing it to DLOG().
+ */
+static inline uint32_t dlog_f32(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
@@ -0,0 +1,192 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file src/platform/frame.c
+ * @authors Jude Merritt
+ * @brief COBS + CRC-16 telemetry framing
+ */
+
+#include "frame.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FRAME_DELIMITER 0x00
+#define COBS_MAX_CODE 0xFF
+#define CRC16_INIT 0xFFFF
+
+/**************************************************************************************************
+ * @section  Data Structures
+ **************************************************************************************************/
+
+// CRC-16/CCITT-FALSE, one nibble at a time: small enough for flash, and a
+// lot faster than going bit by bit
+static const uint16_t crc16_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+// Single-pass COBS encoder state
+typedef struct {
+  uint8_t *dest;
+  size_t out;      // Next free byte in dest
+  size_t code_pos; // Where the code byte of the current block goes
+  uint8_t code;
+} cobs_encoder_t;
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+static inline uint16_t crc16_update(uint16_t crc, uint8_t byte) {
+  crc = (uint16_t)((crc << 4) ^ crc16_table[((crc >> 12) ^ (byte >> 4)) & 0x0F]);
+  crc = (uint16_t)((crc << 4) ^ crc16_table[((crc >> 12) ^ byte) & 0x0F]);
+  return crc;
+}
+
+static inline void cobs_put(cobs_encoder_t *enc, uint8_t byte) {
+  if (byte != 0) {
+    enc->dest[enc->out++] = byte;
+    enc->code++;
+  }
+  if (byte == 0 || enc->code == COBS_MAX_CODE) {
+    enc->dest[enc->code_pos] = enc->code;
+    enc->code_pos = enc->out++;
+    enc->code = 1;
+  }
+}
+
+static inline void decoder_reset(frame_decoder_t *decoder) {
+  decoder->length = 0;
+  decoder->code = 0;
+  decoder->left = 0;
+  decoder->overflow = false;
+}
+
+static inline void decoder_append(frame_decoder_t *decoder, uint8_t byte) {
+  if (decoder->length >= decoder->capacity) {
+    decoder->overflow = true;
+    return;
+  }
+  decoder->buffer[decoder->length++] = byte;
+}
+
+// Handles a delimiter: returns true if a valid frame was delivered
+static bool decoder_finish(frame_decoder_t *decoder, frame_handler_t handler,
+                           void *context) {
+  bool delivered = false;
+
+  if (decoder->length == 0 && decoder->code == 0) {
+    // Back-to-back delimiters (idle fill or resync), not an error
+  } else if (decoder->overflow) {
+    decoder->stats.overflows++;
+  } else if (decoder->left != 0 || decoder->length < FRAME_CRC_SIZE) {
+    decoder->stats.format_errors++;
+  } else if (frame_crc16(decoder->buffer, decoder->length) != 0) {
+    // The CRC is appended big endian, so a good frame leaves a zero remainder
+    decoder->stats.crc_errors++;
+  } else {
+    decoder->stats.frames++;
+    if (handler != NULL) {
+      handler(decoder->buffer, decoder->length - FRAME_CRC_SIZE, context);
+    }
+    delivered = true;
+  }
+
+  decoder_reset(decoder);
+  return delivered;
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+uint16_t frame_crc16(const uint8_t *data, size_t size) {
+  uint16_t crc = CRC16_INIT;
+  for (size_t i = 0; i < size; i++) {
+    crc = crc16_update(crc, data[i]);
+  }
+  return crc;
+}
+
+size_t frame_encode(uint8_t *dest, size_t capacity, const uint8_t *payload,
+                    size_t size) {
+  if (dest == NULL || (payload == NULL && size != 0)) {
+    return 0;
+  }
+  if (capacity < FRAME_MAX_ENCODED(size)) {
+    return 0;
+  }
+
+  cobs_encoder_t enc = {.dest = dest, .out = 1, .code_pos = 0, .code = 1};
+  uint16_t crc = CRC16_INIT;
+
+  for (size_t i = 0; i < size; i++) {
+    uint8_t byte = payload[i];
+    crc = crc16_update(crc, byte);
+    cobs_put(&enc, byte);
+  }
+  cobs_put(&enc, (uint8_t)(crc >> 8));
+  cobs_put(&enc, (uint8_t)crc);
+
+  dest[enc.code_pos] = enc.code;
+  dest[enc.out++] = FRAME_DELIMITER;
+
+  return enc.out;
+}
+
+void frame_decoder_init(frame_decoder_t *decoder, uint8_t *buffer,
+                        size_t capacity) {
+  if (decoder == NULL) {
+    return;
+  }
+  decoder->buffer = buffer;
+  decoder->capacity = (buffer == NULL) ? 0 : capacity;
+  memset(&decoder->stats, 0, sizeof(decoder->stats));
+  decoder_reset(decoder);
+}
+
+uint32_t frame_decoder_feed(frame_decoder_t *decoder, const uint8_t *data,
+                            size_t size, frame_handler_t handler,
+                            void *context) {
+  uint32_t frames = 0;
+
+  if (decoder == NULL || data == NULL) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    uint8_t byte = data[i];
+
+    if (byte == FRAME_DELIMITER) {
+      if (decoder_finish(decoder, handler, context)) {
+        frames++;
+      }
+    } else if (decoder->left == 0) {
+      // New block. The zero implied by the previous block goes in first,
+      // unless that block was a full run of 254 bytes.
+      if (decoder->code != 0 && decoder->code != COBS_MAX_CODE) {
+        decoder_append(decoder, 0);
+      }
+      decoder->code = byte;
+      decoder->left = byte - 1;
+    } else {
+      decoder_append(decoder, byte);
+      decoder->left--;
+    }
+  }
+
+  return frames;
+}
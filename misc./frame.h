@@ -0,0 +1,112 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file src/platform/frame.h
+ * @authors Jude Merritt
+ * @brief Binary telemetry framing: COBS with a CRC-16, delimited by 0x00.
+ *
+ * A frame on the wire is COBS(payload || CRC-16/CCITT-FALSE big endian)
+ * followed by a single 0x00. COBS guarantees no other 0x00 appears, so a
+ * receiver can always resynchronise on the next delimiter.
+ *
+ * The codec has no dependencies; frame_uart.h sends and receives frames
+ * through the UART driver.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * @section Macros
+ **************************************************************************************************/
+#define FRAME_CRC_SIZE 2
+
+// Worst-case encoded size of a payload, including the CRC and the delimiter
+#define FRAME_MAX_ENCODED(size)                                                \
+  ((size) + FRAME_CRC_SIZE + ((size) + FRAME_CRC_SIZE) / 254 + 2)
+
+/**************************************************************************************************
+ * @section Type Definitions
+ **************************************************************************************************/
+// Called for every frame that decodes with a valid CRC (CRC stripped)
+typedef void (*frame_handler_t)(const uint8_t *payload, size_t size,
+                                void *context);
+
+typedef struct {
+  uint32_t frames;        // Valid frames delivered
+  uint32_t crc_errors;    // Frames dropped because of a CRC mismatch
+  uint32_t format_errors; // Truncated COBS blocks or runt frames
+  uint32_t overflows;     // Frames longer than the decoder buffer
+} frame_stats_t;
+
+/**
+ * Streaming decoder state. Bytes can be fed in pieces of any size, e.g.
+ * straight from uart_rx_ring_peek() spans.
+ */
+typedef struct {
+  uint8_t *buffer; // Holds the decoded frame (payload + CRC)
+  size_t capacity;
+  size_t length;
+  uint8_t code;    // Code byte of the current COBS block, 0 before the first
+  uint8_t left;    // Data bytes left in the current block
+  bool overflow;
+  frame_stats_t stats;
+} frame_decoder_t;
+
+/**************************************************************************************************
+ * @section Function Definitions
+ **************************************************************************************************/
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) of a buffer.
+ */
+uint16_t frame_crc16(const uint8_t *data, size_t size);
+
+/**
+ * @brief Encodes a frame in a single pass, computing the CRC on the way. To
+ * avoid any intermediate copy, encode straight into the buffer the DMA will
+ * send from (declared with DMA_BUFFER).
+ *
+ * @param dest Output buffer.
+ * @param capacity Size of @p dest. FRAME_MAX_ENCODED(size) is always enough.
+ * @param payload Payload bytes.
+ * @param size Number of payload bytes.
+ * @return Number of bytes written including the delimiter, or 0 if @p dest is
+ * too small.
+ */
+size_t frame_encode(uint8_t *dest, size_t capacity, const uint8_t *payload,
+                    size_t size);
+
+/**
+ * @brief Prepares a decoder.
+ *
+ * @param decoder Decoder state.
+ * @param buffer Storage for one decoded frame (largest payload + CRC).
+ * @param capacity Size of @p buffer.
+ */
+void frame_decoder_init(frame_decoder_t *decoder, uint8_t *buffer,
+                        size_t capacity);
+
+/**
+ * @brief Feeds received bytes to the decoder. Malformed or corrupted frames
+ * are dropped and counted; decoding resumes at the next delimiter.
+ *
+ * @param handler Called for each valid frame, before this function returns.
+ * @return Number of valid frames delivered.
+ */
+uint32_t frame_decoder_feed(frame_decoder_t *decoder, const uint8_t *data,
+                            size_t size, frame_handler_t handler,
+                            void *context);
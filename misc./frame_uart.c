@@ -0,0 +1,48 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file src/platform/frame_uart.c
+ * @authors Jude Merritt
+ * @brief UART transport for the telemetry framing
+ */
+
+#include "frame_uart.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+bool frame_send(uart_channel_t channel, uint8_t *scratch, size_t capacity,
+                const uint8_t *payload, size_t size) {
+  size_t length = frame_encode(scratch, capacity, payload, size);
+  if (length == 0) {
+    return false;
+  }
+  return uart_write_async(channel, scratch, length);
+}
+
+uint32_t frame_decoder_poll(frame_decoder_t *decoder, uart_channel_t channel,
+                            frame_handler_t handler, void *context) {
+  uint32_t frames = 0;
+  const uint8_t *span;
+  size_t size;
+
+  while ((size = uart_rx_ring_peek(channel, &span)) > 0) {
+    frames += frame_decoder_feed(decoder, span, size, handler, context);
+    uart_rx_ring_consume(channel, size);
+  }
+
+  return frames;
+}
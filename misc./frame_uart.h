@@ -0,0 +1,47 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file src/platform/frame_uart.h
+ * @authors Jude Merritt
+ * @brief Sending and receiving frames (see frame.h) over a UART channel.
+ */
+#pragma once
+#include "frame.h"
+#include "uart.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * @section Function Definitions
+ **************************************************************************************************/
+/**
+ * @brief Encodes a frame into @p scratch and sends it with uart_write_async().
+ * @p scratch must not be reused until the transfer completes.
+ *
+ * @return false if the frame does not fit or the channel is busy.
+ */
+bool frame_send(uart_channel_t channel, uint8_t *scratch, size_t capacity,
+                const uint8_t *payload, size_t size);
+
+/**
+ * @brief Drains everything available in a channel's RX ring (see
+ * uart_rx_ring_start()) through the decoder without copying it first.
+ *
+ * @return Number of valid frames delivered.
+ */
+uint32_t frame_decoder_poll(frame_decoder_t *decoder, uart_channel_t channel,
+                            frame_handler_t handler, void *context);
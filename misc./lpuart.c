@@ -0,0 +1,424 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file src/platform/lpuart.c
+ * @authors Jude Merritt
+ * @brief LPUART1 command channel with character match wakeup
+ *
+ * In Stop mode LPUART1 (UESM) requests its kernel clock on each start bit,
+ * and with autonomous mode enabled in RCC_D3AMR the BDMA moves the byte to
+ * SRAM4 without involving D1. The only interrupt left enabled in normal
+ * operation is the character match, so the core sleeps until a complete
+ * command has arrived.
+ */
+
+#include "lpuart.h"
+#include "../internal/mmio.h"
+#include "gpio.h"
+#include "../myWork/cpu.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LPUART_BRR_MIN 0x300
+#define LPUART_BRR_MAX 0xFFFFF
+#define LPUART_MAX_RX_SIZE 0xFFFF // BDMA NDTR limit
+#define LPUART_BLOCKING_TIMEOUT 1000000000
+#define LPUART_DMA_SETTLE_TIMEOUT 1000
+#define LPUART_EXTI_LINE 34 // LPUART1 RX wakeup, a direct EXTI event input
+
+// CPU interrupt mask bit of the wakeup line in EXTI_CPUIMR2 (lines 32 to 63)
+static const field32_t lpuart_exti_wakeup = {
+    .msk = 1U << (LPUART_EXTI_LINE - 32), .pos = LPUART_EXTI_LINE - 32};
+
+/**************************************************************************************************
+ * @section  Data Structures
+ **************************************************************************************************/
+
+// Kernel clock divider for each PRESC value
+static const uint16_t lpuart_presc_div[] = {1,  2,  4,  6,   8,   10,
+                                            12, 16, 32, 64, 128, 256};
+
+typedef struct {
+  bool running;
+  uint8_t bdma_channel;
+  uint8_t *buffer;
+  size_t size;
+  size_t last_pos; // BDMA write position at the last publish
+  size_t read_pos;
+  size_t unread;
+  uint32_t overruns;
+  lpuart_rx_callback_t callback;
+  void *context;
+  lpuart_baud_t baud;
+} lpuart_state_t;
+
+static lpuart_state_t lpuart = {0};
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+static bool lpuart_compute_baud(uint32_t clk_freq, uint32_t baud_rate,
+                                lpuart_baud_t *baud) {
+  bool found = false;
+  int64_t best_error = 0;
+
+  if (clk_freq == 0 || baud_rate == 0) {
+    return false;
+  }
+
+  for (uint32_t presc = 0;
+       presc < sizeof(lpuart_presc_div) / sizeof(lpuart_presc_div[0]); presc++) {
+    // BRR = 256 * f_ker / (prescaler * baud), rounded
+    uint64_t num = (uint64_t)clk_freq * 256;
+    uint64_t den = (uint64_t)lpuart_presc_div[presc] * baud_rate;
+    uint64_t brr = (num + den / 2) / den;
+    if (brr < LPUART_BRR_MIN || brr > LPUART_BRR_MAX) {
+      continue;
+    }
+
+    uint64_t achieved = brr * den;
+    int64_t error_ppm =
+        ((int64_t)num - (int64_t)achieved) * 1000000 / (int64_t)achieved;
+    int64_t magnitude = error_ppm < 0 ? -error_ppm : error_ppm;
+    if (found && magnitude >= best_error) {
+      continue;
+    }
+
+    uint64_t rate_den = brr * lpuart_presc_div[presc];
+    *baud = (lpuart_baud_t){
+        .prescaler = (uint8_t)presc,
+        .brr = (uint32_t)brr,
+        .actual_baud = (uint32_t)((num + rate_den / 2) / rate_den),
+        .error_ppm = (int32_t)error_ppm,
+    };
+    best_error = magnitude;
+    found = true;
+  }
+
+  return found;
+}
+
+static bool lpuart_set_pins(uint8_t tx_pin, uint8_t rx_pin) {
+  uint8_t tx_af;
+  uint8_t rx_af;
+
+  if (tx_pin == 98) {
+    tx_af = 3; // PA9
+  } else if (tx_pin == 133) {
+    tx_af = 8; // PB6
+  } else {
+    return false;
+  }
+
+  if (rx_pin == 99) {
+    rx_af = 3; // PA10
+  } else if (rx_pin == 134) {
+    rx_af = 8; // PB7
+  } else {
+    return false;
+  }
+
+  tal_enable_clock(tx_pin);
+  tal_enable_clock(rx_pin);
+  tal_set_mode(tx_pin, 2);
+  tal_set_mode(rx_pin, 2);
+  tal_alternate_mode(tx_pin, tx_af);
+  tal_alternate_mode(rx_pin, rx_af);
+
+  return true;
+}
+
+/**
+ * Publishes everything the BDMA has written since the last call. Called from
+ * the match interrupt and the BDMA events, which may preempt each other.
+ */
+static void lpuart_publish(void) {
+  uint32_t primask = irq_save();
+
+  if (!lpuart.running) {
+    irq_restore(primask);
+    return;
+  }
+
+  size_t remaining = bdma_get_remaining(lpuart.bdma_channel);
+  size_t pos = (remaining >= lpuart.size) ? 0 : lpuart.size - remaining;
+  size_t last = lpuart.last_pos;
+  size_t count = (pos >= last) ? pos - last : lpuart.size - last + pos;
+
+  if (count == 0) {
+    irq_restore(primask);
+    return;
+  }
+
+  if (pos >= last) {
+    dma_cache_invalidate(lpuart.buffer + last, count);
+  } else {
+    dma_cache_invalidate(lpuart.buffer + last, lpuart.size - last);
+    dma_cache_invalidate(lpuart.buffer, pos);
+  }
+
+  lpuart.last_pos = pos;
+  lpuart.unread += count;
+
+  // The BDMA lapped the reader: the oldest data has been overwritten
+  if (lpuart.unread > lpuart.size) {
+    lpuart.unread = lpuart.size;
+    lpuart.read_pos = pos;
+    lpuart.overruns++;
+  }
+
+  size_t available = lpuart.unread;
+  irq_restore(primask);
+
+  if (lpuart.callback != NULL) {
+    lpuart.callback(available, lpuart.context);
+  }
+}
+
+static void lpuart_dma_event(dma_event_t event, uint8_t buffer, void *context) {
+  (void)buffer;
+  (void)context;
+
+  if (event == DMA_EVENT_ERROR) {
+    lpuart.running = false;
+    return;
+  }
+  lpuart_publish();
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+bool lpuart_init(const lpuart_config_t *config) {
+  if (config == NULL || lpuart.running) {
+    return false;
+  }
+  if (config->rx_size == 0 || config->rx_size > LPUART_MAX_RX_SIZE) {
+    return false;
+  }
+  if (config->bdma_channel >= BDMA_CHANNEL_COUNT ||
+      config->clock > LPUART_CLK_LSE) {
+    return false;
+  }
+  if (!bdma_mem_is_accessible(config->rx_buffer, config->rx_size)) {
+    return false;
+  }
+
+  lpuart_baud_t baud;
+  if (!lpuart_compute_baud(config->clk_freq, config->baud_rate, &baud)) {
+    return false;
+  }
+  if (baud.error_ppm > UART_BAUD_MAX_ERROR_PPM ||
+      baud.error_ppm < -UART_BAUD_MAX_ERROR_PPM) {
+    return false;
+  }
+
+  if (!lpuart_set_pins(config->tx_pin, config->rx_pin)) {
+    return false;
+  }
+
+  // Clocks: the kernel clock has to keep running in Stop to receive there
+  SET_FIELD(RCC_APB4ENR, RCC_APB4ENR_LPUART1EN);
+  SET_FIELD(RCC_D3AMR, RCC_D3AMR_LPUART1AMEN);
+  WRITE_FIELD(RCC_D3CCIPR, RCC_D3CCIPR_LPUART1SRC, config->clock);
+  if (config->clock == LPUART_CLK_HSI) {
+    SET_FIELD(RCC_CR, RCC_CR_HSIKERON);
+  } else if (config->clock == LPUART_CLK_CSI) {
+    SET_FIELD(RCC_CR, RCC_CR_CSIKERON);
+  }
+  bdma_init();
+
+  CLR_FIELD(LPUART1_CR1, LPUART1_CR1_UE);
+
+  WRITE_FIELD(LPUART1_PRESC, LPUART1_PRESC_PRESCALER, baud.prescaler);
+  WRITE_FIELD(LPUART1_BRR, LPUART1_BRR_BRR, baud.brr);
+
+  // 8 data bits; with parity that is a 9-bit frame
+  CLR_FIELD(LPUART1_CR1, LPUART1_CR1_Mx[1]);
+  switch (config->parity) {
+    case UART_PARITY_DISABLED:
+      CLR_FIELD(LPUART1_CR1, LPUART1_CR1_PCE);
+      CLR_FIELD(LPUART1_CR1, LPUART1_CR1_Mx[0]);
+      break;
+    case UART_PARITY_EVEN:
+      SET_FIELD(LPUART1_CR1, LPUART1_CR1_PCE);
+      CLR_FIELD(LPUART1_CR1, LPUART1_CR1_PS);
+      SET_FIELD(LPUART1_CR1, LPUART1_CR1_Mx[0]);
+      break;
+    case UART_PARITY_ODD:
+      SET_FIELD(LPUART1_CR1, LPUART1_CR1_PCE);
+      SET_FIELD(LPUART1_CR1, LPUART1_CR1_PS);
+      SET_FIELD(LPUART1_CR1, LPUART1_CR1_Mx[0]);
+      break;
+    default:
+      return false;
+  }
+
+  // Character match: with ADDM7 set, CMF compares the whole 8-bit character
+  // against ADD during normal reception
+  SET_FIELD(LPUART1_CR2, LPUART1_CR2_ADDM7);
+  WRITE_FIELD(LPUART1_CR2, LPUART1_CR2_ADD, config->match);
+
+  // Keep receiving in Stop, and raise WUF on the same match (WUS = 0)
+  SET_FIELD(LPUART1_CR1, LPUART1_CR1_UESM);
+  WRITE_FIELD(LPUART1_CR3, LPUART1_CR3_WUS, 0);
+
+  lpuart = (lpuart_state_t){
+      .bdma_channel = config->bdma_channel,
+      .buffer = config->rx_buffer,
+      .size = config->rx_size,
+      .callback = config->callback,
+      .context = config->context,
+      .baud = baud,
+  };
+
+  dma_transfer_t rx_transfer = {
+      .instance = DMA_INSTANCE_BDMA,
+      .stream = config->bdma_channel,
+      .request_id = LPUART_DMAMUX_RX_REQ,
+      .direction = PERIPH_TO_MEM,
+      .src_data_size = 1,
+      .dest_data_size = 1,
+      .priority = 2,
+      .src = (void *)LPUART1_RDR,
+      .dest = config->rx_buffer,
+      .size = config->rx_size,
+      .mode = DMA_MODE_CIRCULAR,
+      .event_callback = lpuart_dma_event,
+  };
+
+  lpuart.running = true;
+  if (bdma_start_transfer(&rx_transfer) != TI_ERRC_NONE) {
+    lpuart.running = false;
+    return false;
+  }
+
+  *LPUART1_ICR = LPUART1_ICR_CMCF.msk | LPUART1_ICR_ORECF.msk |
+                 LPUART1_ICR_WUCF.msk;
+  SET_FIELD(LPUART1_CR1, LPUART1_CR1_CMIE);
+  SET_FIELD(LPUART1_CR3, LPUART1_CR3_WUFIE);
+
+  // The wakeup only reaches the core in Stop through EXTI line 34, which is
+  // masked out of reset. The NVIC line is still the caller's to enable.
+  SET_FIELD(EXTI_CPUIMR2, lpuart_exti_wakeup);
+  SET_FIELD(LPUART1_CR3, LPUART1_CR3_DMAR);
+  SET_FIELD(LPUART1_CR1, LPUART1_CR1_TE);
+  SET_FIELD(LPUART1_CR1, LPUART1_CR1_RE);
+  SET_FIELD(LPUART1_CR1, LPUART1_CR1_UE);
+
+  return true;
+}
+
+void lpuart_deinit(void) {
+  CLR_FIELD(EXTI_CPUIMR2, lpuart_exti_wakeup);
+  CLR_FIELD(LPUART1_CR3, LPUART1_CR3_WUFIE);
+  CLR_FIELD(LPUART1_CR1, LPUART1_CR1_CMIE);
+  CLR_FIELD(LPUART1_CR3, LPUART1_CR3_DMAR);
+  if (lpuart.running) {
+    lpuart.running = false;
+    bdma_stop_transfer(lpuart.bdma_channel);
+  }
+  CLR_FIELD(LPUART1_CR1, LPUART1_CR1_UE);
+  CLR_FIELD(RCC_D3AMR, RCC_D3AMR_LPUART1AMEN);
+}
+
+bool lpuart_get_baud(lpuart_baud_t *baud) {
+  if (baud == NULL || lpuart.baud.brr == 0) {
+    return false;
+  }
+
+  *baud = lpuart.baud;
+  return true;
+}
+
+size_t lpuart_available(void) {
+  return lpuart.unread;
+}
+
+size_t lpuart_read(uint8_t *dest, size_t size) {
+  if (dest == NULL) {
+    return 0;
+  }
+
+  uint32_t primask = irq_save();
+
+  size_t count = (size < lpuart.unread) ? size : lpuart.unread;
+  size_t first = lpuart.size - lpuart.read_pos;
+  if (first > count) {
+    first = count;
+  }
+  memcpy(dest, lpuart.buffer + lpuart.read_pos, first);
+  memcpy(dest + first, lpuart.buffer, count - first);
+
+  lpuart.read_pos = (lpuart.read_pos + count) % lpuart.size;
+  lpuart.unread -= count;
+
+  irq_restore(primask);
+  return count;
+}
+
+uint32_t lpuart_overruns(void) {
+  return lpuart.overruns;
+}
+
+bool lpuart_write_blocking(const uint8_t *data, size_t size) {
+  if (data == NULL) {
+    return false;
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    uint32_t timeout = LPUART_BLOCKING_TIMEOUT;
+    while (!READ_FIELD(LPUART1_ISR, LPUART1_ISR_TXE)) {
+      if (--timeout == 0) {
+        return false;
+      }
+    }
+    *LPUART1_TDR = data[i];
+  }
+
+  uint32_t timeout = LPUART_BLOCKING_TIMEOUT;
+  while (!READ_FIELD(LPUART1_ISR, LPUART1_ISR_TC)) {
+    if (--timeout == 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void lpuart_irq(void) {
+  uint32_t isr = *LPUART1_ISR;
+
+  if (isr & LPUART1_ISR_ORE.msk) {
+    *LPUART1_ICR = LPUART1_ICR_ORECF.msk;
+  }
+  if (isr & LPUART1_ISR_WUF.msk) {
+    *LPUART1_ICR = LPUART1_ICR_WUCF.msk;
+  }
+
+  if (isr & LPUART1_ISR_CMF.msk) {
+    *LPUART1_ICR = LPUART1_ICR_CMCF.msk;
+
+    // CMF is raised as the character lands in RDR; give the BDMA a moment to
+    // move it so the command is complete in the ring
+    uint32_t timeout = LPUART_DMA_SETTLE_TIMEOUT;
+    while (READ_FIELD(LPUART1_ISR, LPUART1_ISR_RXNE) && --timeout != 0) {
+    }
+    lpuart_publish();
+  }
+}
@@ -0,0 +1,131 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file src/platform/lpuart.h
+ * @authors Jude Merritt
+ * @brief LPUART1 command channel that can wake the system from Stop.
+ *
+ * Reception runs on the BDMA into SRAM4, so bytes keep arriving while D1 is
+ * asleep. The core is only woken when the match character (e.g. a command
+ * terminator or node address) is received.
+ */
+#pragma once
+#include "uart.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * @section Macros
+ **************************************************************************************************/
+#define LPUART_DMAMUX_RX_REQ 9 // lpuart1_rx_dma on DMAMUX2
+
+/**************************************************************************************************
+ * @section Type Definitions
+ **************************************************************************************************/
+// LPUART1 kernel clock (RCC_D3CCIPR LPUART1SEL). Only HSI, CSI and LSE keep
+// running in Stop, so one of those is needed to wake on a match.
+typedef enum {
+  LPUART_CLK_PCLK4,
+  LPUART_CLK_PLL2Q,
+  LPUART_CLK_PLL3Q,
+  LPUART_CLK_HSI,
+  LPUART_CLK_CSI,
+  LPUART_CLK_LSE,
+} lpuart_clock_t;
+
+/**
+ * Called from the LPUART1 interrupt when the match character has been
+ * received (and on BDMA half/full events). @p available is the number of
+ * unread bytes, including the match character.
+ */
+typedef void (*lpuart_rx_callback_t)(size_t available, void *context);
+
+typedef struct {
+  uint8_t prescaler;  // PRESC field value
+  uint32_t brr;       // 256 * f_ck / baud, 20 bits
+  uint32_t actual_baud;
+  int32_t error_ppm;
+} lpuart_baud_t;
+
+typedef struct {
+  lpuart_clock_t clock;
+  uint32_t clk_freq;  // Kernel clock in Hz
+  uint32_t baud_rate;
+  uart_parity_t parity;
+  uint8_t tx_pin;     // 98 (PA9) or 133 (PB6)
+  uint8_t rx_pin;     // 99 (PA10) or 134 (PB7)
+  uint8_t match;      // Character that raises the wakeup/match interrupt
+  uint8_t bdma_channel;
+  uint8_t *rx_buffer; // Receive ring. Must be declared with BDMA_BUFFER.
+  size_t rx_size;     // At most 65535 bytes
+  lpuart_rx_callback_t callback;
+  void *context;
+} lpuart_config_t;
+
+/**************************************************************************************************
+ * @section Function Definitions
+ **************************************************************************************************/
+/**
+ * @brief Sets up LPUART1 with the BDMA receiving into a ring buffer, and arms
+ * the character match wakeup. LPUART1 stays enabled in Stop mode.
+ *
+ * The wakeup line (EXTI line 34) is unmasked here. The caller still has to
+ * enable the LPUART1 interrupt in the NVIC and call lpuart_irq() from it.
+ *
+ * @param config LPUART config.
+ * @return false if the config is invalid (pins, buffer outside SRAM4, baud
+ * rate not reachable) or the BDMA channel could not be started.
+ */
+bool lpuart_init(const lpuart_config_t *config);
+
+/**
+ * @brief Stops reception and disables LPUART1.
+ */
+void lpuart_deinit(void);
+
+/**
+ * @brief Baud rate settings programmed by lpuart_init().
+ */
+bool lpuart_get_baud(lpuart_baud_t *baud);
+
+/**
+ * @brief Number of received bytes that have not been read yet.
+ */
+size_t lpuart_available(void);
+
+/**
+ * @brief Copies up to @p size received bytes out of the ring.
+ *
+ * @return Number of bytes copied.
+ */
+size_t lpuart_read(uint8_t *dest, size_t size);
+
+/**
+ * @brief Number of times the BDMA overwrote data that had not been read.
+ */
+uint32_t lpuart_overruns(void);
+
+/**
+ * @brief Sends bytes, returning once they are all out (replies are short and
+ * rare, so there is no TX DMA).
+ */
+bool lpuart_write_blocking(const uint8_t *data, size_t size);
+
+/**
+ * @brief LPUART1 interrupt handler. Call from LPUART1_IRQHandler().
+ */
+void lpuart_irq(void);
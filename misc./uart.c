@@ -20,8 +20,10 @@
  */
 
 #include "uart.h"
+#include "uart_ring.h"
 #include "../internal/mmio.h"
 #include "gpio.h"
+#include "../myWork/cpu.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -35,6 +37,20 @@
   ((channel) == UART1 || (channel) == UART2 || (channel) == UART3 ||           \
    (channel) == UART6)
 
+// USART and UART share one register layout, so the UARTx_ fields apply to both
+#define UART_REG(reg, channel)                                                 \
+  (IS_USART_CHANNEL(channel) ? USARTx_##reg[channel] : UARTx_##reg[channel])
+
+#define UART_DMA_MAX_SIZE 0xFFFF // DMA NDTR limit
+
+// A late RX request loses data, a late TX one only idles the line
+#define UART_TX_DMA_PRIORITY 1
+#define UART_RX_DMA_PRIORITY 2
+
+#define UART_FIFO_DEPTH 16
+#define UART_TXFT_HALF 2 // TXFTCFG: TXFT is set once half of the TX FIFO is free
+#define UART_BLOCKING_TIMEOUT 1000000000
+
 /**************************************************************************************************
  * @section  Data Structures
  **************************************************************************************************/
@@ -84,14 +100,52 @@ const static uint8_t uart_dmamux_req[UART_CHANNEL_COUNT]
                                             },
 };
 
-volatile dma_periph_streaminfo_t uart_to_dma[UART_CHANNEL_COUNT] = {0};
+// Streams claimed by uart_init(); instance 0 means none yet
+static dma_stream_t uart_tx_dma[UART_CHANNEL_COUNT] = {0};
+static dma_stream_t uart_rx_dma[UART_CHANNEL_COUNT] = {0};
 
-bool uart_busy[UART_CHANNEL_COUNT] = {0};
+static dma_callback_t uart_callbacks[UART_CHANNEL_COUNT] = {0};
 
-uart_context_t uart_contexts[UART_CHANNEL_COUNT] = {0};
+// TX and RX run on their own DMA streams, so each direction has its own state
+bool uart_tx_busy[UART_CHANNEL_COUNT] = {0};
+bool uart_rx_busy[UART_CHANNEL_COUNT] = {0};
+
+uart_context_t uart_tx_contexts[UART_CHANNEL_COUNT] = {0};
+uart_context_t uart_rx_contexts[UART_CHANNEL_COUNT] = {0};
 
 uint32_t timeout;
 
+typedef struct {
+  bool running;
+  uart_channel_t channel;
+  uint8_t *buffer;
+  uart_ring_index_t index;
+  uint32_t overruns;
+  uart_rx_callback_t callback;
+  void *context;
+} uart_rx_ring_t;
+
+static uart_rx_ring_t uart_rx_rings[UART_CHANNEL_COUNT] = {0};
+
+typedef struct {
+  uart_channel_t channel;
+  uint8_t *buffer;
+  size_t size;
+  size_t write_pos;
+  size_t read_pos;
+  size_t pending;     // Bytes queued and not yet sent, including in_flight
+  size_t in_flight;   // Bytes in the running DMA transfer, 0 when idle
+  uint32_t dropped;   // Bytes discarded because their transfer failed
+} uart_tx_queue_t;
+
+static uart_tx_queue_t uart_tx_queues[UART_CHANNEL_COUNT] = {0};
+
+// Kernel clock divider for each PRESC value
+static const uint16_t uart_presc_div[] = {1,  2,  4,  6,   8,   10,
+                                          12, 16, 32, 64, 128, 256};
+
+static uart_baud_t uart_bauds[UART_CHANNEL_COUNT] = {0};
+
 /**************************************************************************************************
  * @section Private Function Implementations
  **************************************************************************************************/
@@ -497,6 +551,187 @@ static inline bool verify_transfer_parameters(uart_channel_t channel, uint8_t *b
   return true;
 }
 
+/**
+ * Publishes everything the DMA has written since the last call. Called from
+ * the DMA events and the idle-line interrupt, which may preempt each other.
+ */
+static void rx_ring_publish(uart_rx_ring_t *ring) {
+  uint32_t primask = irq_save();
+
+  if (!ring->running) {
+    irq_restore(primask);
+    return;
+  }
+
+  size_t remaining = dma_get_remaining(uart_rx_dma[ring->channel].instance,
+                                       uart_rx_dma[ring->channel].stream);
+  size_t size = ring->index.size;
+  size_t pos = (remaining >= size) ? 0 : size - remaining;
+  size_t last = ring->index.last_pos;
+  size_t count = uart_ring_written(&ring->index, pos);
+
+  if (count == 0) {
+    irq_restore(primask);
+    return;
+  }
+
+  // The DMA events invalidate whole halves; the idle case may end anywhere
+  if (pos >= last) {
+    dma_cache_invalidate(ring->buffer + last, count);
+  } else {
+    dma_cache_invalidate(ring->buffer + last, size - last);
+    dma_cache_invalidate(ring->buffer, pos);
+  }
+
+  if (uart_ring_publish(&ring->index, pos) > 0) {
+    ring->overruns++;
+  }
+
+  size_t available = ring->index.unread;
+  irq_restore(primask);
+
+  if (ring->callback != NULL) {
+    ring->callback(ring->channel, available, ring->context);
+  }
+}
+
+static void rx_ring_dma_event(dma_event_t event, uint8_t buffer,
+                              void *context) {
+  uart_rx_ring_t *ring = context;
+  (void)buffer;
+
+  if (event == DMA_EVENT_ERROR) {
+    ring->running = false;
+    return;
+  }
+  rx_ring_publish(ring);
+}
+
+static void tx_queue_complete(bool success, void *context);
+
+// Starts a one-shot transfer. The M7 D-cache sits between the CPU and the
+// DMA: bytes to send are cleaned out to memory first, and a receive buffer is
+// invalidated so no dirty line is evicted over what the DMA writes.
+static int uart_start_dma(dma_transfer_t *transfer) {
+  if (transfer->direction == PERIPH_TO_MEM) {
+    dma_cache_invalidate(transfer->dest, transfer->size);
+  } else {
+    dma_cache_clean(transfer->src, transfer->size);
+  }
+  return dma_start_transfer(transfer);
+}
+
+/**
+ * Sends the longest contiguous run of queued bytes in one transfer. Must be
+ * called with interrupts masked and no transfer running.
+ */
+static void tx_queue_kick(uart_tx_queue_t *queue) {
+  if (queue->pending == 0) {
+    uart_tx_busy[queue->channel] = false;
+    return;
+  }
+
+  size_t start = queue->read_pos;
+  size_t contiguous = queue->size - start;
+  size_t count = (queue->pending < contiguous) ? queue->pending : contiguous;
+
+  uart_channel_t channel = queue->channel;
+  dma_transfer_t tx_transfer = {
+      .instance = uart_tx_dma[channel].instance,
+      .stream = uart_tx_dma[channel].stream,
+      .request_id = uart_dmamux_req[channel][1],
+      .direction = MEM_TO_PERIPH,
+      .src_data_size = 1,
+      .dest_data_size = 1,
+      .priority = UART_TX_DMA_PRIORITY,
+      .callback = tx_queue_complete,
+      .src = queue->buffer + start,
+      .dest = (void *)UART_REG(TDR, channel),
+      .size = count,
+      .context = queue,
+  };
+
+  uart_tx_busy[channel] = true;
+  queue->in_flight = count;
+  if (uart_start_dma(&tx_transfer) != TI_ERRC_NONE) {
+    queue->in_flight = 0;
+    uart_tx_busy[channel] = false;
+    return;
+  }
+  SET_FIELD(UART_REG(CR3, channel), UARTx_CR3_DMAT);
+}
+
+// Chains the next batch, which holds everything queued while this one ran.
+// A failed batch is dropped rather than resent: part of it may already be on
+// the line, and the framing layer rejects the truncated packet.
+static void tx_queue_complete(bool success, void *context) {
+  uart_tx_queue_t *queue = context;
+
+  uint32_t primask = irq_save();
+  if (!success) {
+    queue->dropped += queue->in_flight;
+  }
+  queue->read_pos = (queue->read_pos + queue->in_flight) % queue->size;
+  queue->pending -= queue->in_flight;
+  queue->in_flight = 0;
+  tx_queue_kick(queue);
+  irq_restore(primask);
+}
+
+// Claims one direction of a channel; the check and set must not be split by
+// an ISR starting a transfer on the same direction
+static bool uart_claim(bool *busy) {
+  uint32_t primask = irq_save();
+  bool claimed = !*busy;
+  *busy = true;
+  irq_restore(primask);
+  return claimed;
+}
+
+static void uart_async_complete(bool success, void *context) {
+  uart_context_t *uart_context = context;
+  uart_channel_t channel = uart_context->channel;
+
+  // Lines the CPU speculatively read while the transfer ran are stale
+  if (uart_context->buffer != NULL) {
+    dma_cache_invalidate(uart_context->buffer, uart_context->size);
+  }
+
+  uint32_t primask = irq_save();
+  *uart_context->busy = false;
+
+  // Hand the TX stream to anything queued while this transfer ran
+  if (uart_context->busy == &uart_tx_busy[channel] &&
+      uart_tx_queues[channel].buffer != NULL &&
+      uart_tx_queues[channel].in_flight == 0) {
+    tx_queue_kick(&uart_tx_queues[channel]);
+  }
+  irq_restore(primask);
+
+  if (uart_callbacks[channel] != NULL) {
+    uart_callbacks[channel](success, uart_context);
+  }
+}
+
+// Claims the stream the caller asked for, or any free one when config is NULL.
+// A channel keeps its streams across repeated uart_init() calls.
+static bool uart_claim_dma(periph_dma_config_t *config, uint8_t priority,
+                           dma_stream_t *stream) {
+  if (stream->instance != 0) {
+    return true;
+  }
+  if (config == NULL) {
+    return dma_claim_stream(priority, 0, stream) == TI_ERRC_NONE;
+  }
+
+  dma_stream_t fixed = {.instance = config->instance, .stream = config->stream};
+  if (dma_claim_specific_stream(fixed, 0) != TI_ERRC_NONE) {
+    return false;
+  }
+  *stream = fixed;
+  return true;
+}
+
 /**
  * Macro that generates cases for uart init
  * @author Owen Voskuhl Hayes, Lorde of the Isle, first of his name.
@@ -514,6 +749,65 @@ static inline bool verify_transfer_parameters(uart_channel_t channel, uint8_t *b
 /**************************************************************************************************
  * @section Public Function Implementations
  **************************************************************************************************/
+bool uart_compute_baud(uint32_t clk_freq, uint32_t baud_rate,
+                       uart_baud_t *baud) {
+  if (baud == NULL || clk_freq == 0 || baud_rate == 0) {
+    return false;
+  }
+
+  bool found = false;
+  int64_t best_error = 0;
+
+  // Oversampling by 16 first, so it wins ties
+  for (uint32_t over8 = 0; over8 <= 1; over8++) {
+    for (uint32_t presc = 0;
+         presc < sizeof(uart_presc_div) / sizeof(uart_presc_div[0]); presc++) {
+      // USARTDIV = (2 if OVER8) * f_ker / (prescaler * baud), rounded
+      uint64_t num = (uint64_t)clk_freq << over8;
+      uint64_t den = (uint64_t)uart_presc_div[presc] * baud_rate;
+      uint64_t usartdiv = (num + den / 2) / den;
+      if (usartdiv < 16 || usartdiv > 0xFFFF) {
+        continue;
+      }
+
+      uint64_t achieved = usartdiv * den;
+      int64_t error_ppm = ((int64_t)num - (int64_t)achieved) * 1000000 /
+                          (int64_t)achieved;
+      int64_t magnitude = error_ppm < 0 ? -error_ppm : error_ppm;
+      if (found && magnitude >= best_error) {
+        continue;
+      }
+
+      uint64_t rate_den = usartdiv * uart_presc_div[presc];
+      *baud = (uart_baud_t){
+          .prescaler = (uint8_t)presc,
+          .over8 = (over8 != 0),
+          // With OVER8, BRR[3:0] holds USARTDIV[3:0] shifted right by one
+          .brr = over8 ? (uint16_t)((usartdiv & 0xFFF0) | ((usartdiv & 0xF) >> 1))
+                       : (uint16_t)usartdiv,
+          .actual_baud = (uint32_t)((num + rate_den / 2) / rate_den),
+          .error_ppm = (int32_t)error_ppm,
+      };
+      best_error = magnitude;
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+bool uart_get_baud(uart_channel_t channel, uart_baud_t *baud) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT || baud == NULL) {
+    return false;
+  }
+  if (uart_bauds[channel].brr == 0) {
+    return false;
+  }
+
+  *baud = uart_bauds[channel];
+  return true;
+}
+
 bool uart_init(uart_config_t *usart_config, dma_callback_t *callback,
                periph_dma_config_t *tx_stream, periph_dma_config_t *rx_stream) {
   // De-reference struct members for readability
@@ -606,10 +900,24 @@ bool uart_init(uart_config_t *usart_config, dma_callback_t *callback,
     CLR_FIELD(UARTx_CR2[channel], UARTx_CR2_CLKEN);
   }
 
-  // TODO: maybe calculate via using ints for mantissa/exponent field?
-  uint32_t brr_value = clk_freq / baud_rate;
+  uart_baud_t baud;
+  if (!uart_compute_baud(clk_freq, baud_rate, &baud)) {
+    return false;
+  }
+  if (baud.error_ppm > UART_BAUD_MAX_ERROR_PPM ||
+      baud.error_ppm < -UART_BAUD_MAX_ERROR_PPM) {
+    return false;
+  }
+  WRITE_FIELD(UART_REG(PRESC, channel), UARTx_PRESC_PRESCALER, baud.prescaler);
+  if (baud.over8) {
+    SET_FIELD(UART_REG(CR1, channel), UARTx_CR1_OVER8);
+  } else {
+    CLR_FIELD(UART_REG(CR1, channel), UARTx_CR1_OVER8);
+  }
+  *UART_REG(BRR, channel) = baud.brr;
+  uart_bauds[channel] = baud;
+
   if (IS_USART_CHANNEL(channel)) {
-  WRITE_FIELD(USARTx_BRR[channel], USARTx_BRR_BRR_4_15, brr_value);
 
   // Set parity
   switch (parity) {
@@ -654,9 +962,8 @@ bool uart_init(uart_config_t *usart_config, dma_callback_t *callback,
 
   // Enable FIFOs
   SET_FIELD(USARTx_CR1[channel], USARTx_CR1_FIFOEN);
+  WRITE_FIELD(USARTx_CR3[channel], USARTx_CR3_TXFTCFG, UART_TXFT_HALF);
 } else {
-  WRITE_FIELD(UARTx_BRR[channel], UARTx_BRR_BRR_4_15, brr_value);
-
   // Set parity
   switch (parity) {
     case UART_PARITY_DISABLED:
@@ -700,43 +1007,21 @@ bool uart_init(uart_config_t *usart_config, dma_callback_t *callback,
 
   // Enable FIFOs
   SET_FIELD(UARTx_CR1[channel], UARTx_CR1_FIFOEN);
+  WRITE_FIELD(UARTx_CR3[channel], UARTx_CR3_TXFTCFG, UART_TXFT_HALF);
 
 }
 
-  dma_config_t dma_tx_stream = {
-      .instance = tx_stream->instance,
-      .stream = tx_stream->stream,
-      .request_id = uart_dmamux_req[channel][1],
-      .direction = tx_stream->direction,
-      .src_data_size = tx_stream->src_data_size,
-      .dest_data_size = tx_stream->dest_data_size,
-      .priority = tx_stream->priority,
-      .fifo_enabled = false, // FIFO disabled for tx
-      .fifo_threshold = tx_stream->fifo_threshold,
-      .callback = *callback, // We need to know if it failed.
-  };
-  dma_configure_stream(&dma_tx_stream);
-
-  dma_config_t dma_rx_stream = {
-      .instance = rx_stream->instance,
-      .stream = rx_stream->stream,
-      .request_id = uart_dmamux_req[channel][0],
-      .direction = rx_stream->direction,
-      .src_data_size = rx_stream->src_data_size,
-      .dest_data_size = rx_stream->dest_data_size,
-      .priority = rx_stream->priority,
-      .fifo_enabled = false, // FIFO disabled for tx
-      .fifo_threshold = rx_stream->fifo_threshold,
-      .callback = *callback, // We need to know if it failed.
-  };
-  dma_configure_stream(&dma_rx_stream);
-
-  // Save stream info
-  dma_periph_streaminfo_t info = {.rx_instance = rx_stream->instance,
-                                  .tx_instance = tx_stream->instance,
-                                  .rx_stream = rx_stream->stream,
-                                  .tx_stream = tx_stream->stream};
-  uart_to_dma[channel] = info;
+  // Streams are claimed rather than taken from a fixed table, so the UARTs
+  // share DMA1/DMA2 with every other driver that uses the allocator
+  if (!uart_claim_dma(tx_stream, UART_TX_DMA_PRIORITY, &uart_tx_dma[channel])) {
+    return false;
+  }
+  if (!uart_claim_dma(rx_stream, UART_RX_DMA_PRIORITY, &uart_rx_dma[channel])) {
+    dma_release_stream(uart_tx_dma[channel]);
+    uart_tx_dma[channel] = (dma_stream_t){0};
+    return false;
+  }
+  uart_callbacks[channel] = (callback != NULL) ? *callback : NULL;
 
   // Enable the peripheral
 
@@ -759,33 +1044,44 @@ bool uart_write_async(uart_channel_t channel, uint8_t *tx_buff, uint32_t size) {
   if (!test_params) {
     return false;
   }
+  if (channel >= UART_CHANNEL_COUNT || size > UART_DMA_MAX_SIZE) {
+    return false;
+  }
 
-  // Check if usart channel is busy
-  if (uart_busy[channel]) {
+  // Check if the TX side of the channel is busy
+  if (!uart_claim(&uart_tx_busy[channel])) {
     // tal_raise(flag, "USART channel is busy");
     return false;
   }
-  uart_busy[channel] = true;
 
   // Configure DMA stream
   uart_context_t context = {
-      .busy = &uart_busy[channel],
+      .busy = &uart_tx_busy[channel],
       .channel = channel,
   };
-  uart_contexts[channel] = context;
+  uart_tx_contexts[channel] = context;
   dma_transfer_t tx_transfer = {
-      .instance = uart_to_dma[channel].tx_instance,
-      .stream = uart_to_dma[channel].tx_stream,
+      .instance = uart_tx_dma[channel].instance,
+      .stream = uart_tx_dma[channel].stream,
+      .request_id = uart_dmamux_req[channel][1],
+      .direction = MEM_TO_PERIPH,
+      .src_data_size = 1,
+      .dest_data_size = 1,
+      .priority = UART_TX_DMA_PRIORITY,
+      .callback = uart_async_complete,
       .src = tx_buff,
-      .dest = (void *)UARTx_TDR[channel], // maybe revisit the cast... in dma transfer struct
+      .dest = (void *)UART_REG(TDR, channel),
       .size = size,
-      .context = &uart_contexts[channel],
+      .context = &uart_tx_contexts[channel],
       .disable_mem_inc = false,
   };
-  dma_start_transfer(&tx_transfer);
+  if (uart_start_dma(&tx_transfer) != TI_ERRC_NONE) {
+    uart_tx_busy[channel] = false;
+    return false;
+  }
 
   // Enable the dma requests
-  SET_FIELD(UARTx_CR3[channel], UARTx_CR3_DMAT);
+  SET_FIELD(UART_REG(CR3, channel), UARTx_CR3_DMAT);
 
   return true;
 }
@@ -796,36 +1092,68 @@ bool uart_read_async(uart_channel_t channel, uint8_t *rx_buff, uint32_t size) {
   if (!test_params) {
     return false;
   }
+  if (channel >= UART_CHANNEL_COUNT || size > UART_DMA_MAX_SIZE) {
+    return false;
+  }
 
-  // Check if usart channel is busy
-  if (uart_busy[channel]) {
+  // The RX ring owns the RX stream while it runs
+  if (uart_rx_rings[channel].running) {
+    return false;
+  }
+
+  // Check if the RX side of the channel is busy
+  if (!uart_claim(&uart_rx_busy[channel])) {
     // tal_raise(flag, "USART channel is busy");
     return false;
   }
-  uart_busy[channel] = true;
 
   // Configure DMA stream
   uart_context_t context = {
-      .busy = &uart_busy[channel],
+      .busy = &uart_rx_busy[channel],
       .channel = channel,
+      .buffer = rx_buff,
+      .size = size,
   };
-  uart_contexts[channel] = context;
-  dma_transfer_t tx_transfer = {
-      .instance = uart_to_dma[channel].tx_instance,
-      .stream = uart_to_dma[channel].tx_stream,
-      .src = (void *) UARTx_RDR[channel],
+  uart_rx_contexts[channel] = context;
+  dma_transfer_t rx_transfer = {
+      .instance = uart_rx_dma[channel].instance,
+      .stream = uart_rx_dma[channel].stream,
+      .request_id = uart_dmamux_req[channel][0],
+      .direction = PERIPH_TO_MEM,
+      .src_data_size = 1,
+      .dest_data_size = 1,
+      .priority = UART_RX_DMA_PRIORITY,
+      .callback = uart_async_complete,
+      .src = (void *)UART_REG(RDR, channel),
       .dest = rx_buff,
       .size = size,
-      .context = &uart_contexts[channel],
+      .context = &uart_rx_contexts[channel],
       .disable_mem_inc = false,
   };
-  dma_start_transfer(&tx_transfer);
+  if (uart_start_dma(&rx_transfer) != TI_ERRC_NONE) {
+    uart_rx_busy[channel] = false;
+    return false;
+  }
 
   // Enable the dma requests
-  SET_FIELD(UARTx_CR3[channel], UARTx_CR3_DMAT);
+  SET_FIELD(UART_REG(CR3, channel), UARTx_CR3_DMAR);
   return true;
 }
 
+bool uart_tx_done(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT) {
+    return true;
+  }
+  return !uart_tx_busy[channel];
+}
+
+bool uart_rx_done(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT) {
+    return true;
+  }
+  return !uart_rx_busy[channel];
+}
+
 bool uart_write_blocking(uart_channel_t channel, uint8_t *tx_buff,
                          uint32_t size) {
   // Verify parameters
@@ -835,23 +1163,40 @@ bool uart_write_blocking(uart_channel_t channel, uint8_t *tx_buff,
     return false;
   }
 
-  // Check if usart channel is busy
-  // while (!READ_FIELD(USARTx_ISR[channel], USARTx_ISR_BUSY)) {
-  //   asm("nop");
-  //   // tal_raise(flag, "USART channel is busy");
-  // }
-  // uart_busy[channel] = true;
+  // Keep the TX FIFO topped up so the line never idles between bytes. Once
+  // TXFT is set half the FIFO is free and a whole burst can be written without
+  // polling; otherwise TXE (TXFNF in FIFO mode) is checked per byte.
+  uint32_t i = 0;
+  uint32_t count = 0;
+  while (i < size) {
+    uint32_t isr = *UART_REG(ISR, channel);
 
-  // Transmit the data byte by byte
-  for (uint32_t i = 0; i < size; i++) {
-    if (!uart_write_byte(channel, tx_buff[i])) {
+    if (isr & UARTx_ISR_TXFT.msk) {
+      uint32_t burst = UART_FIFO_DEPTH / 2;
+      if (burst > size - i) {
+        burst = size - i;
+      }
+      for (uint32_t j = 0; j < burst; j++) {
+        *UART_REG(TDR, channel) = tx_buff[i++];
+      }
+      count = 0;
+    } else if (isr & UARTx_ISR_TXE.msk) {
+      *UART_REG(TDR, channel) = tx_buff[i++];
+      count = 0;
+    } else if (count++ >= UART_BLOCKING_TIMEOUT) {
       // tal_raise(flag, "USART write timeout");
-      // uart_busy[channel] = false;
       return false;
     }
   }
 
-  // uart_busy[channel] = false;
+  // Wait for the last byte to leave the shift register, once
+  count = 0;
+  while (!(*UART_REG(ISR, channel) & UARTx_ISR_TC.msk)) {
+    if (count++ >= UART_BLOCKING_TIMEOUT) {
+      return false;
+    }
+  }
+
   return true;
 }
 
@@ -875,18 +1220,235 @@ bool uart_read_blocking(uart_channel_t channel, uint8_t *rx_buff,
     // tal_raise(flag, "USART channel is busy");
   }
 }
-  // uart_busy[channel] = true;
-  
 
   // Receive the data byte by byte
   for (uint32_t i = 0; i < size; i++) {
     if (!uart_read_byte(channel, rx_buff+i)) {
       // tal_raise(flag, "USART read timeout");
-      // uart_busy[channel] = false;
       return false;
     }
   }
 
-  // uart_busy[channel] = false;
   return true;
-}
\ No newline at end of file
+}
+
+bool uart_rx_ring_start(uart_channel_t channel,
+                        const uart_rx_ring_config_t *config) {
+  if (config == NULL) {
+    return false;
+  }
+  if (!verify_transfer_parameters(channel, config->buffer, config->size)) {
+    return false;
+  }
+  if (config->size > UART_DMA_MAX_SIZE || uart_rx_rings[channel].running) {
+    return false;
+  }
+  if (uart_rx_busy[channel]) {
+    return false; // uart_read_async() has the RX stream
+  }
+
+  uart_rx_ring_t *ring = &uart_rx_rings[channel];
+  *ring = (uart_rx_ring_t){
+      .channel = channel,
+      .buffer = config->buffer,
+      .index = {.size = config->size},
+      .callback = config->callback,
+      .context = config->context,
+  };
+
+  dma_transfer_t rx_transfer = {
+      .instance = uart_rx_dma[channel].instance,
+      .stream = uart_rx_dma[channel].stream,
+      .request_id = uart_dmamux_req[channel][0],
+      .direction = PERIPH_TO_MEM,
+      .src_data_size = 1,
+      .dest_data_size = 1,
+      .priority = UART_RX_DMA_PRIORITY,
+      .src = (void *)UART_REG(RDR, channel),
+      .dest = config->buffer,
+      .size = config->size,
+      .context = ring,
+      .mode = DMA_MODE_CIRCULAR,
+      .event_callback = rx_ring_dma_event,
+  };
+
+  ring->running = true;
+  if (dma_start_continuous(&rx_transfer) != TI_ERRC_NONE) {
+    ring->running = false;
+    return false;
+  }
+
+  // Idle line marks the end of a packet
+  *UART_REG(ICR, channel) = UARTx_ICR_IDLECF.msk | UARTx_ICR_ORECF.msk;
+  SET_FIELD(UART_REG(CR1, channel), UARTx_CR1_IDLEIE);
+  SET_FIELD(UART_REG(CR3, channel), UARTx_CR3_DMAR);
+
+  return true;
+}
+
+bool uart_rx_ring_stop(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT) {
+    return false;
+  }
+  if (!uart_rx_rings[channel].running) {
+    return false;
+  }
+
+  CLR_FIELD(UART_REG(CR3, channel), UARTx_CR3_DMAR);
+  CLR_FIELD(UART_REG(CR1, channel), UARTx_CR1_IDLEIE);
+
+  // Pick up whatever arrived since the last event before stopping
+  rx_ring_publish(&uart_rx_rings[channel]);
+  uart_rx_rings[channel].running = false;
+
+  return dma_stop_continuous(uart_rx_dma[channel].instance,
+                             uart_rx_dma[channel].stream) == TI_ERRC_NONE;
+}
+
+size_t uart_rx_ring_available(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT) {
+    return 0;
+  }
+  uart_rx_ring_t *ring = &uart_rx_rings[channel];
+
+  return ring->index.unread;
+}
+
+size_t uart_rx_ring_peek(uart_channel_t channel, const uint8_t **span) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT || span == NULL) {
+    return 0;
+  }
+  uart_rx_ring_t *ring = &uart_rx_rings[channel];
+  if (ring->buffer == NULL) {
+    return 0;
+  }
+
+  uint32_t primask = irq_save();
+  size_t count = uart_ring_contiguous(&ring->index);
+  *span = ring->buffer + ring->index.read_pos;
+  irq_restore(primask);
+
+  return count;
+}
+
+void uart_rx_ring_consume(uart_channel_t channel, size_t count) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT) {
+    return;
+  }
+  uart_rx_ring_t *ring = &uart_rx_rings[channel];
+
+  if (ring->buffer == NULL) {
+    return;
+  }
+
+  uint32_t primask = irq_save();
+  uart_ring_consume(&ring->index, count);
+  irq_restore(primask);
+}
+
+uint32_t uart_rx_ring_overruns(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT) {
+    return 0;
+  }
+  return uart_rx_rings[channel].overruns;
+}
+
+bool uart_tx_queue_init(uart_channel_t channel, uint8_t *buffer, size_t size) {
+  if (!verify_transfer_parameters(channel, buffer, size)) {
+    return false;
+  }
+  if (size > UART_DMA_MAX_SIZE || uart_tx_queues[channel].in_flight) {
+    return false;
+  }
+
+  uart_tx_queues[channel] = (uart_tx_queue_t){
+      .channel = channel,
+      .buffer = buffer,
+      .size = size,
+  };
+  return true;
+}
+
+bool uart_tx_queue_write(uart_channel_t channel, const uint8_t *data,
+                         size_t size) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT || data == NULL) {
+    return false;
+  }
+  uart_tx_queue_t *queue = &uart_tx_queues[channel];
+  if (queue->buffer == NULL) {
+    return false;
+  }
+  if (size == 0) {
+    return true;
+  }
+
+  // Telemetry writes are small, so copying with interrupts masked is cheaper
+  // than reserving space first and committing afterwards
+  uint32_t primask = irq_save();
+
+  if (queue->size - queue->pending < size) {
+    irq_restore(primask);
+    return false;
+  }
+
+  size_t start = queue->write_pos;
+  size_t first = queue->size - start;
+  if (first > size) {
+    first = size;
+  }
+  memcpy(queue->buffer + start, data, first);
+  memcpy(queue->buffer, data + first, size - first);
+  queue->write_pos = (start + size) % queue->size;
+  queue->pending += size;
+
+  // A uart_write_async() transfer may hold the stream; its completion kicks
+  // the queue instead
+  if (queue->in_flight == 0 && !uart_tx_busy[channel]) {
+    tx_queue_kick(queue);
+  }
+
+  irq_restore(primask);
+  return true;
+}
+
+size_t uart_tx_queue_free(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT) {
+    return 0;
+  }
+  uart_tx_queue_t *queue = &uart_tx_queues[channel];
+
+  return queue->size - queue->pending;
+}
+
+uint32_t uart_tx_queue_dropped(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT) {
+    return 0;
+  }
+  return uart_tx_queues[channel].dropped;
+}
+
+bool uart_tx_queue_idle(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT) {
+    return true;
+  }
+  uart_tx_queue_t *queue = &uart_tx_queues[channel];
+
+  return queue->pending == 0;
+}
+
+void uart_irq(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT) {
+    return;
+  }
+
+  uint32_t isr = *UART_REG(ISR, channel);
+
+  if (isr & UARTx_ISR_ORE.msk) {
+    *UART_REG(ICR, channel) = UARTx_ICR_ORECF.msk;
+  }
+
+  if (isr & UARTx_ISR_IDLE.msk) {
+    *UART_REG(ICR, channel) = UARTx_ICR_IDLECF.msk;
+    rx_ring_publish(&uart_rx_rings[channel]);
+  }
+}
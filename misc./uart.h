@@ -26,6 +26,11 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/**************************************************************************************************
+ * @section Macros
+ **************************************************************************************************/
+#define UART_BAUD_MAX_ERROR_PPM 20000 // Combined budget for both ends is ~3%
+
 /**************************************************************************************************
  * @section Data Structures
  **************************************************************************************************/
@@ -69,19 +74,69 @@ typedef struct {
 typedef struct {
   bool *busy;
   uart_channel_t channel;
+  uint8_t *buffer;  // Receive buffer, NULL for a transmit
+  uint32_t size;
 } uart_context_t;
 
+typedef struct {
+  uint8_t prescaler;   // PRESC field value (kernel clock divided by 1..256)
+  bool over8;          // Oversampling by 8 instead of 16
+  uint16_t brr;        // BRR register value
+  uint32_t actual_baud;
+  int32_t error_ppm;   // (actual - requested) / requested, parts per million
+} uart_baud_t;
+
+/**
+ * Called from interrupt context whenever new bytes have been published to an
+ * RX ring (half/full DMA events and line idle). @p available is the number of
+ * unread bytes.
+ */
+typedef void (*uart_rx_callback_t)(uart_channel_t channel, size_t available,
+                                   void *context);
+
+typedef struct {
+  uint8_t *buffer; // Ring storage. Should be declared with DMA_BUFFER.
+  size_t size;     // At most 65535 bytes
+  uart_rx_callback_t callback;
+  void *context;
+} uart_rx_ring_config_t;
+
 /**************************************************************************************************
  * @section Function Definitions
  **************************************************************************************************/
+/**
+ * @brief Picks the prescaler, oversampling mode and BRR that get closest to a
+ * baud rate. Oversampling by 16 is preferred when it is as accurate, since it
+ * tolerates more noise; oversampling by 8 reaches up to clk_freq / 8.
+ *
+ * @param clk_freq UART kernel clock in Hz.
+ * @param baud_rate Requested baud rate.
+ * @param baud Filled with the register values, actual rate and error.
+ * @return false if no setting can produce the rate at this clock.
+ */
+bool uart_compute_baud(uint32_t clk_freq, uint32_t baud_rate,
+                       uart_baud_t *baud);
+
+/**
+ * @brief Baud rate settings programmed by uart_init().
+ *
+ * @return false if the channel has not been initialized.
+ */
+bool uart_get_baud(uart_channel_t channel, uart_baud_t *baud);
+
 /**
  * @brief Initializes the specified UART channel.
  *
  * @param flag: Error flag
  * @param usart_config: Config struct
- * @param dma_tx: TX DMA stream config
- * @param dma_rx: RX DMA stream config
- * @return true if initialization is successful, false otherwise.
+ * @param callback: Called with the channel's uart_context_t when a
+ * uart_write_async() or uart_read_async() transfer ends. May be NULL.
+ * @param dma_tx: TX stream to claim, or NULL to claim any free stream with
+ * dma_claim_stream()
+ * @param dma_rx: RX stream to claim, or NULL to claim any free stream
+ * @return true if initialization is successful, false otherwise. Fails if the
+ * baud rate error would exceed UART_BAUD_MAX_ERROR_PPM or no stream can be
+ * claimed.
  */
 bool uart_init(uart_config_t *usart_config, dma_callback_t *callback,
                periph_dma_config_t *tx_stream, periph_dma_config_t *rx_stream);
@@ -106,9 +161,22 @@ bool uart_write_async(uart_channel_t channel, uint8_t *tx_buff, uint32_t size);
  */
 bool uart_read_async(uart_channel_t channel, uint8_t *rx_buff, uint32_t size);
 
+/**
+ * @brief Whether the last uart_write_async() (or TX queue batch) has finished.
+ * TX and RX have separate streams and state, so this is independent of any
+ * reception in progress on the same channel.
+ */
+bool uart_tx_done(uart_channel_t channel);
+
+/**
+ * @brief Whether the last uart_read_async() has finished.
+ */
+bool uart_rx_done(uart_channel_t channel);
+
 /**
  * @brief Sends data over the specified UART channel. Blocking (syncronous)
- * function.
+ * function. Streams through the TX FIFO and returns once the last byte has
+ * been shifted out.
  *
  * @param channel USART channel
  * @param tx_buff Pointer to the data buffer to be transmitted.
@@ -119,6 +187,17 @@ bool uart_read_async(uart_channel_t channel, uint8_t *rx_buff, uint32_t size);
 bool uart_write_blocking(uart_channel_t channel, uint8_t *tx_buff,
                          uint32_t size);
 
+/**
+ * @brief Sends a single byte over the specified UART channel and waits for
+ * TC, so the byte has been shifted out when this returns.
+ *
+ * @param channel USART channel
+ * @param data Byte to transmit.
+ *
+ * @return true if the byte was sent, false on timeout.
+ */
+bool uart_write_byte(uart_channel_t channel, uint8_t data);
+
 /**
  * @brief Receives data from the specified UART channel. Blocking (syncronous)
  * function.
@@ -130,5 +209,95 @@ bool uart_write_blocking(uart_channel_t channel, uint8_t *tx_buff,
 bool uart_read_blocking(uart_channel_t channel, uint8_t *rx_buff,
                         uint32_t size);
 
+/**
+ * @brief Starts continuous reception into a ring buffer. The RX DMA stream runs
+ * in circular mode and never stops, so no byte is lost between packets. New
+ * data is published on the DMA half/full events and when the line goes idle,
+ * which gives variable-length packets without knowing their size up front.
+ *
+ * @param channel USART channel
+ * @param config Ring buffer and callback. Copied.
+ * @return true if reception was started.
+ */
+bool uart_rx_ring_start(uart_channel_t channel,
+                        const uart_rx_ring_config_t *config);
+
+/**
+ * @brief Stops continuous reception. Unread data stays readable.
+ */
+bool uart_rx_ring_stop(uart_channel_t channel);
+
+/**
+ * @brief Number of unread bytes in the ring.
+ */
+size_t uart_rx_ring_available(uart_channel_t channel);
+
+/**
+ * @brief Returns the longest contiguous run of unread bytes, without copying.
+ * When the data wraps around the end of the ring, consume this span and call
+ * again for the rest.
+ *
+ * @param channel USART channel
+ * @param span Set to the first unread byte.
+ * @return Number of bytes in the span.
+ */
+size_t uart_rx_ring_peek(uart_channel_t channel, const uint8_t **span);
+
+/**
+ * @brief Marks bytes returned by uart_rx_ring_peek() as read.
+ */
+void uart_rx_ring_consume(uart_channel_t channel, size_t count);
+
+/**
+ * @brief Number of times the DMA overwrote data that had not been read yet.
+ */
+uint32_t uart_rx_ring_overruns(uart_channel_t channel);
+
+/**
+ * @brief Sets up a transmit queue for a channel. Writes to the queue are
+ * accepted at any time, and everything pending is sent in as few DMA
+ * transfers as possible.
+ *
+ * @param channel USART channel
+ * @param buffer Queue storage. Should be declared with DMA_BUFFER.
+ * @param size Size of the storage in bytes (at most 65535).
+ * @return true if the queue was set up.
+ */
+bool uart_tx_queue_init(uart_channel_t channel, uint8_t *buffer, size_t size);
+
+/**
+ * @brief Appends bytes to the transmit queue and starts the DMA if it is idle.
+ * Safe to call from any context, including ISRs. The data is copied.
+ *
+ * @param channel USART channel
+ * @param data Bytes to send.
+ * @param size Number of bytes.
+ * @return false if the queue does not have room for all of @p size bytes, in
+ * which case nothing is queued.
+ */
+bool uart_tx_queue_write(uart_channel_t channel, const uint8_t *data,
+                         size_t size);
+
+/**
+ * @brief Number of bytes that can currently be queued.
+ */
+size_t uart_tx_queue_free(uart_channel_t channel);
+
+/**
+ * @brief Whether everything queued has been handed to the UART.
+ */
+bool uart_tx_queue_idle(uart_channel_t channel);
+
+/**
+ * @brief Number of queued bytes discarded because their DMA transfer failed.
+ */
+uint32_t uart_tx_queue_dropped(uart_channel_t channel);
+
+/**
+ * @brief UART interrupt handler for line-idle detection. Call from
+ * USARTx_IRQHandler() / UARTx_IRQHandler().
+ */
+void uart_irq(uart_channel_t channel);
+
 static inline bool verify_transfer_parameters(uart_channel_t channel, uint8_t *buff,
                                        size_t size);
\ No newline at end of file
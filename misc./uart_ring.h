@@ -0,0 +1,80 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file src/platform/uart_ring.h
+ * @authors Jude Merritt
+ * @brief RX ring bookkeeping shared by the driver (uart.c) and its host
+ * stand-in (uart_sim.c). Not part of the public API. Callers provide the
+ * locking: interrupts masked in the driver, the channel mutex in the stand-in.
+ */
+#pragma once
+#include <stddef.h>
+
+/**************************************************************************************************
+ * @section Type Definitions
+ **************************************************************************************************/
+typedef struct {
+  size_t size;
+  size_t last_pos; // DMA write position at the last publish
+  size_t read_pos; // Next unread byte, always below size
+  size_t unread;
+} uart_ring_index_t;
+
+/**************************************************************************************************
+ * @section Function Definitions
+ **************************************************************************************************/
+
+// Bytes the DMA has written since the last publish, given its write position
+static inline size_t uart_ring_written(const uart_ring_index_t *index,
+                                       size_t pos) {
+  size_t last = index->last_pos;
+  return (pos >= last) ? pos - last : index->size - last + pos;
+}
+
+/**
+ * @brief Makes everything up to the DMA write position @p pos readable. If
+ * the DMA lapped the reader, the oldest data has been overwritten: the reader
+ * is moved up to @p pos with a full ring unread.
+ *
+ * @return The bytes lost to an overrun, 0 if there was none.
+ */
+static inline size_t uart_ring_publish(uart_ring_index_t *index, size_t pos) {
+  index->unread += uart_ring_written(index, pos);
+  index->last_pos = pos;
+
+  if (index->unread <= index->size) {
+    return 0;
+  }
+  size_t lost = index->unread - index->size;
+  index->unread = index->size;
+  index->read_pos = pos;
+  return lost;
+}
+
+// Unread bytes that are contiguous from read_pos
+static inline size_t uart_ring_contiguous(const uart_ring_index_t *index) {
+  size_t contiguous = index->size - index->read_pos;
+  return (index->unread < contiguous) ? index->unread : contiguous;
+}
+
+// Frees up to @p count bytes; the DMA may have lapped the reader since a peek
+static inline void uart_ring_consume(uart_ring_index_t *index, size_t count) {
+  if (count > index->unread) {
+    count = index->unread;
+  }
+  index->read_pos = (index->read_pos + count) % index->size;
+  index->unread -= count;
+}
@@ -0,0 +1,439 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file src/platform/uart_sim.c
+ * @authors Jude Merritt
+ * @brief Host-only UART stand-in replaying recorded streams
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "uart_sim.h"
+#include "uart_ring.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define UART_SIM_BITS_PER_CHAR 10 // Start, 8 data, stop
+#define UART_SIM_IDLE_CHARS 2
+#define UART_SIM_RAW_BLOCK 256
+#define UART_SIM_MAX_RECORD 0xFFFF
+#define UART_SIM_TX_ROOM 0xFFFF // Writes never block, so report a full DMA-sized queue
+#define NS_PER_SEC 1000000000LL
+
+/**************************************************************************************************
+ * @section  Data Structures
+ **************************************************************************************************/
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_t thread;
+  bool replaying;
+  uint32_t baud_rate;
+  int tx_fd;
+  FILE *file;
+  double speedup;
+  uint8_t record[UART_SIM_MAX_RECORD]; // Capture record being replayed
+
+  // RX ring, as set up by uart_rx_ring_start()
+  bool running;
+  uint8_t *buffer;
+  uart_ring_index_t index;
+  size_t dma_pos; // Where the simulated DMA writes next
+  uart_rx_callback_t callback;
+  void *context;
+
+  uart_sim_stats_t stats;
+} uart_sim_channel_t;
+
+// Each lock is initialized once here; uart_sim_init() only resets the fields
+static uart_sim_channel_t uart_sims[UART_CHANNEL_COUNT] = {
+    [0 ... UART_CHANNEL_COUNT - 1] = {.lock = PTHREAD_MUTEX_INITIALIZER},
+};
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+static inline bool valid_channel(uart_channel_t channel) {
+  return channel > 0 && channel < UART_CHANNEL_COUNT;
+}
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+static void sleep_until(int64_t deadline) {
+  struct timespec ts = {
+      .tv_sec = deadline / NS_PER_SEC,
+      .tv_nsec = deadline % NS_PER_SEC,
+  };
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+  }
+}
+
+static int64_t line_time(const uart_sim_channel_t *sim, size_t bytes) {
+  return (int64_t)bytes * UART_SIM_BITS_PER_CHAR * NS_PER_SEC / sim->baud_rate;
+}
+
+// Same accounting as rx_ring_publish() in the driver (uart_ring.h). Called
+// with the lock held; the callback runs after it is released, as it would
+// from the ISR.
+static void publish(uart_sim_channel_t *sim, uart_channel_t channel) {
+  if (!sim->running || uart_ring_written(&sim->index, sim->dma_pos) == 0) {
+    return;
+  }
+
+  size_t lost = uart_ring_publish(&sim->index, sim->dma_pos);
+  if (lost > 0) {
+    sim->stats.rx_lost_bytes += lost;
+    sim->stats.rx_overruns++;
+  }
+  sim->stats.rx_events++;
+
+  size_t available = sim->index.unread;
+  uart_rx_callback_t callback = sim->callback;
+  void *context = sim->context;
+
+  if (callback != NULL) {
+    pthread_mutex_unlock(&sim->lock);
+    callback(channel, available, context);
+    pthread_mutex_lock(&sim->lock);
+  }
+}
+
+// Plays the DMA: bytes land in the ring, with half/full events
+static void deliver(uart_sim_channel_t *sim, uart_channel_t channel,
+                    const uint8_t *data, size_t size) {
+  pthread_mutex_lock(&sim->lock);
+
+  for (size_t i = 0; i < size && sim->running; i++) {
+    sim->buffer[sim->dma_pos++] = data[i];
+    sim->stats.rx_bytes++;
+
+    if (sim->dma_pos == sim->index.size / 2) {
+      publish(sim, channel);
+    } else if (sim->dma_pos == sim->index.size) {
+      sim->dma_pos = 0;
+      publish(sim, channel);
+    }
+  }
+
+  pthread_mutex_unlock(&sim->lock);
+}
+
+static void idle(uart_sim_channel_t *sim, uart_channel_t channel) {
+  pthread_mutex_lock(&sim->lock);
+  publish(sim, channel);
+  pthread_mutex_unlock(&sim->lock);
+}
+
+static int64_t scaled(const uart_sim_channel_t *sim, int64_t ns) {
+  return (sim->speedup > 0) ? (int64_t)(ns / sim->speedup) : 0;
+}
+
+static void replay_capture(uart_sim_channel_t *sim, uart_channel_t channel,
+                           int64_t start) {
+  uint8_t *data = sim->record;
+  int64_t line_free = start; // Time the previous record finished on the line
+  uint8_t header[6];
+
+  while (fread(header, 1, sizeof(header), sim->file) == sizeof(header)) {
+    uint32_t delta_us = (uint32_t)header[0] | (uint32_t)header[1] << 8 |
+                        (uint32_t)header[2] << 16 | (uint32_t)header[3] << 24;
+    size_t length = (size_t)header[4] | (size_t)header[5] << 8;
+    if (fread(data, 1, length, sim->file) != length) {
+      break;
+    }
+
+    int64_t gap = (int64_t)delta_us * 1000;
+    int64_t idle_gap = line_time(sim, UART_SIM_IDLE_CHARS);
+    if (gap >= idle_gap) {
+      if (sim->speedup > 0) {
+        sleep_until(line_free + scaled(sim, idle_gap));
+      }
+      idle(sim, channel);
+    }
+
+    int64_t begin = line_free + scaled(sim, gap);
+    if (sim->speedup > 0) {
+      sleep_until(begin);
+    }
+    deliver(sim, channel, data, length);
+    line_free = begin + scaled(sim, line_time(sim, length));
+  }
+
+  if (sim->speedup > 0) {
+    sleep_until(line_free);
+  }
+}
+
+static void replay_raw(uart_sim_channel_t *sim, uart_channel_t channel,
+                       int64_t start) {
+  uint8_t data[UART_SIM_RAW_BLOCK];
+  int64_t line_free = start;
+  size_t length;
+
+  while ((length = fread(data, 1, sizeof(data), sim->file)) > 0) {
+    if (sim->speedup > 0) {
+      sleep_until(line_free);
+    }
+    deliver(sim, channel, data, length);
+    line_free += scaled(sim, line_time(sim, length));
+  }
+
+  if (sim->speedup > 0) {
+    sleep_until(line_free);
+  }
+}
+
+static void *replay_thread(void *arg) {
+  uart_channel_t channel = (uart_channel_t)(uintptr_t)arg;
+  uart_sim_channel_t *sim = &uart_sims[channel];
+  char magic[4];
+  int64_t start = now_ns();
+
+  bool capture = fread(magic, 1, sizeof(magic), sim->file) == sizeof(magic) &&
+                 memcmp(magic, UART_SIM_CAPTURE_MAGIC, sizeof(magic)) == 0;
+  if (capture) {
+    replay_capture(sim, channel, start);
+  } else {
+    rewind(sim->file);
+    replay_raw(sim, channel, start);
+  }
+
+  // The line goes idle after the last byte
+  idle(sim, channel);
+
+  fclose(sim->file);
+  sim->file = NULL;
+  sim->stats.elapsed = (double)(now_ns() - start) / NS_PER_SEC;
+  return NULL;
+}
+
+static bool write_tx(uart_channel_t channel, const uint8_t *data, size_t size) {
+  if (!valid_channel(channel) || data == NULL) {
+    return false;
+  }
+  uart_sim_channel_t *sim = &uart_sims[channel];
+
+  if (sim->tx_fd >= 0) {
+    size_t done = 0;
+    while (done < size) {
+      ssize_t n = write(sim->tx_fd, data + done, size - done);
+      if (n <= 0) {
+        return false;
+      }
+      done += (size_t)n;
+    }
+  }
+
+  pthread_mutex_lock(&sim->lock);
+  sim->stats.tx_bytes += size;
+  pthread_mutex_unlock(&sim->lock);
+  return true;
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+bool uart_sim_init(uart_channel_t channel, uint32_t baud_rate, int tx_fd) {
+  if (!valid_channel(channel) || baud_rate == 0) {
+    return false;
+  }
+  uart_sim_channel_t *sim = &uart_sims[channel];
+  if (sim->replaying) {
+    return false;
+  }
+
+  pthread_mutex_lock(&sim->lock);
+  sim->baud_rate = baud_rate;
+  sim->tx_fd = tx_fd;
+  sim->running = false;
+  sim->buffer = NULL;
+  sim->index = (uart_ring_index_t){0};
+  sim->dma_pos = 0;
+  sim->callback = NULL;
+  sim->context = NULL;
+  sim->stats = (uart_sim_stats_t){0};
+  pthread_mutex_unlock(&sim->lock);
+  return true;
+}
+
+bool uart_sim_replay(uart_channel_t channel, const char *path, double speedup) {
+  if (!valid_channel(channel) || path == NULL || speedup < 0) {
+    return false;
+  }
+  uart_sim_channel_t *sim = &uart_sims[channel];
+  if (sim->replaying || sim->baud_rate == 0 || !sim->running) {
+    return false;
+  }
+
+  sim->file = fopen(path, "rb");
+  if (sim->file == NULL) {
+    return false;
+  }
+  sim->speedup = speedup;
+
+  if (pthread_create(&sim->thread, NULL, replay_thread,
+                     (void *)(uintptr_t)channel) != 0) {
+    fclose(sim->file);
+    sim->file = NULL;
+    return false;
+  }
+  sim->replaying = true;
+  return true;
+}
+
+void uart_sim_wait(uart_channel_t channel) {
+  if (!valid_channel(channel) || !uart_sims[channel].replaying) {
+    return;
+  }
+  pthread_join(uart_sims[channel].thread, NULL);
+  uart_sims[channel].replaying = false;
+}
+
+void uart_sim_stats(uart_channel_t channel, uart_sim_stats_t *stats) {
+  if (!valid_channel(channel) || stats == NULL) {
+    return;
+  }
+  uart_sim_channel_t *sim = &uart_sims[channel];
+
+  pthread_mutex_lock(&sim->lock);
+  *stats = sim->stats;
+  pthread_mutex_unlock(&sim->lock);
+}
+
+// The uart.h API, backed by the simulation
+
+bool uart_rx_ring_start(uart_channel_t channel,
+                        const uart_rx_ring_config_t *config) {
+  if (!valid_channel(channel) || config == NULL || config->buffer == NULL ||
+      config->size == 0) {
+    return false;
+  }
+  uart_sim_channel_t *sim = &uart_sims[channel];
+
+  pthread_mutex_lock(&sim->lock);
+  bool started = !sim->running;
+  if (started) {
+    sim->buffer = config->buffer;
+    sim->index = (uart_ring_index_t){.size = config->size};
+    sim->dma_pos = 0;
+    sim->callback = config->callback;
+    sim->context = config->context;
+    sim->running = true;
+  }
+  pthread_mutex_unlock(&sim->lock);
+  return started;
+}
+
+bool uart_rx_ring_stop(uart_channel_t channel) {
+  if (!valid_channel(channel)) {
+    return false;
+  }
+  uart_sim_channel_t *sim = &uart_sims[channel];
+
+  pthread_mutex_lock(&sim->lock);
+  bool stopped = sim->running;
+  sim->running = false;
+  pthread_mutex_unlock(&sim->lock);
+  return stopped;
+}
+
+size_t uart_rx_ring_available(uart_channel_t channel) {
+  if (!valid_channel(channel)) {
+    return 0;
+  }
+  uart_sim_channel_t *sim = &uart_sims[channel];
+
+  pthread_mutex_lock(&sim->lock);
+  size_t available = sim->index.unread;
+  pthread_mutex_unlock(&sim->lock);
+  return available;
+}
+
+size_t uart_rx_ring_peek(uart_channel_t channel, const uint8_t **span) {
+  if (!valid_channel(channel) || span == NULL) {
+    return 0;
+  }
+  uart_sim_channel_t *sim = &uart_sims[channel];
+
+  pthread_mutex_lock(&sim->lock);
+  size_t count = uart_ring_contiguous(&sim->index);
+  *span = sim->buffer + sim->index.read_pos;
+  pthread_mutex_unlock(&sim->lock);
+  return count;
+}
+
+void uart_rx_ring_consume(uart_channel_t channel, size_t count) {
+  if (!valid_channel(channel)) {
+    return;
+  }
+  uart_sim_channel_t *sim = &uart_sims[channel];
+
+  pthread_mutex_lock(&sim->lock);
+  if (sim->buffer != NULL) {
+    uart_ring_consume(&sim->index, count);
+  }
+  pthread_mutex_unlock(&sim->lock);
+}
+
+uint32_t uart_rx_ring_overruns(uart_channel_t channel) {
+  if (!valid_channel(channel)) {
+    return 0;
+  }
+  return uart_sims[channel].stats.rx_overruns;
+}
+
+bool uart_write_async(uart_channel_t channel, uint8_t *tx_buff, uint32_t size) {
+  return write_tx(channel, tx_buff, size);
+}
+
+bool uart_tx_done(uart_channel_t channel) {
+  (void)channel;
+  return true; // Writes complete synchronously
+}
+
+bool uart_tx_queue_init(uart_channel_t channel, uint8_t *buffer, size_t size) {
+  (void)buffer;
+  (void)size;
+  return valid_channel(channel);
+}
+
+bool uart_tx_queue_write(uart_channel_t channel, const uint8_t *data,
+                         size_t size) {
+  return write_tx(channel, data, size);
+}
+
+size_t uart_tx_queue_free(uart_channel_t channel) {
+  (void)channel;
+  return UART_SIM_TX_ROOM;
+}
+
+bool uart_tx_queue_idle(uart_channel_t channel) {
+  (void)channel;
+  return true;
+}
+
+uint32_t uart_tx_queue_dropped(uart_channel_t channel) {
+  (void)channel;
+  return 0; // There is no DMA to fail
+}
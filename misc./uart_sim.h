@@ -0,0 +1,93 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file src/platform/uart_sim.h
+ * @authors Jude Merritt
+ * @brief Host-only stand-in for the UART driver, for replaying recorded
+ * streams into the RX ring API.
+ *
+ * Build uart_sim.c instead of uart.c on the host (POSIX threads). The code
+ * under test uses uart_rx_ring_*(), uart_write_async() and
+ * uart_tx_queue_write() unchanged; a replay thread plays the part of the DMA
+ * and the idle-line interrupt, with the same overrun accounting as the
+ * driver.
+ *
+ * Recordings are either raw bytes, paced at the configured baud rate, or a
+ * capture file with the original timing:
+ *
+ *   "UREC" then records of { uint32_t delta_us; uint16_t length;
+ *                            uint8_t data[length]; }  (little endian)
+ *
+ * where delta_us is the gap before the record's first byte.
+ */
+#pragma once
+#include "uart.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * @section Macros
+ **************************************************************************************************/
+#define UART_SIM_CAPTURE_MAGIC "UREC"
+
+/**************************************************************************************************
+ * @section Type Definitions
+ **************************************************************************************************/
+typedef struct {
+  uint64_t rx_bytes;      // Bytes delivered into the RX ring
+  uint64_t rx_lost_bytes; // Bytes overwritten before they were consumed
+  uint32_t rx_overruns;   // Times the reader was lapped
+  uint32_t rx_events;     // Callback invocations (half/full/idle)
+  uint64_t tx_bytes;      // Bytes written through the TX API
+  double elapsed;         // Wall time of the replay in seconds
+} uart_sim_stats_t;
+
+/**************************************************************************************************
+ * @section Function Definitions
+ **************************************************************************************************/
+/**
+ * @brief Prepares a simulated channel.
+ *
+ * @param channel Channel to simulate.
+ * @param baud_rate Line rate, used for pacing raw recordings and for the
+ * idle-line gap (two character times).
+ * @param tx_fd Where TX data is written (e.g. one end of a socketpair or a
+ * pty), or -1 to discard it.
+ * @return false if the channel is invalid or a replay is running.
+ */
+bool uart_sim_init(uart_channel_t channel, uint32_t baud_rate, int tx_fd);
+
+/**
+ * @brief Starts replaying a recording into the channel's RX ring, which must
+ * have been started with uart_rx_ring_start().
+ *
+ * @param path Capture file or raw byte stream.
+ * @param speedup Time scale: 1.0 for real time, N for N times faster, 0 to
+ * deliver as fast as possible.
+ * @return false if the file cannot be opened or a replay is running.
+ */
+bool uart_sim_replay(uart_channel_t channel, const char *path, double speedup);
+
+/**
+ * @brief Waits for the replay on @p channel to finish.
+ */
+void uart_sim_wait(uart_channel_t channel);
+
+/**
+ * @brief Statistics of the channel since uart_sim_init().
+ */
+void uart_sim_stats(uart_channel_t channel, uart_sim_stats_t *stats);
@@ -0,0 +1,247 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/src/bdma.c
+ * @authors Jude Merritt
+ * @brief BDMA transfers for the D3 domain peripherals
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "include/mmio.h"
+#include "include/errc.h"
+#include "include/dma.h"
+
+#define MAX_NDTR 0xFFFFU
+#define BDMA_CHANNEL_DISABLE_TIMEOUT 100000U
+
+// Memories on the D3 bus
+#define SRAM4_START   0x38000000U
+#define SRAM4_END     0x38010000U
+#define BKPSRAM_START 0x38800000U
+#define BKPSRAM_END   0x38801000U
+
+// mmio.h numbers the BDMA channels from 1, the reference manual (and DMAMUX2) from 0
+#define REG(channel) ((channel) + 1)
+
+typedef struct {
+    bool running;
+    bool to_mem;
+    void *mem;
+    size_t size;     // Bytes in the memory buffer
+    dma_mode_t mode;
+    dma_callback_t callback;
+    dma_event_callback_t event_callback;
+    void *context;
+} bdma_channel_t;
+
+static bdma_channel_t channels[BDMA_CHANNEL_COUNT];
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+
+static inline uint32_t read_flags(uint8_t channel) {
+    uint32_t isr = *BDMA_ISR;
+    uint32_t flags = 0;
+
+    if (isr & BDMA_ISR_TCIFx[REG(channel)].msk) flags |= BDMA_ISR_TCIFx[REG(channel)].msk;
+    if (isr & BDMA_ISR_HTIFx[REG(channel)].msk) flags |= BDMA_ISR_HTIFx[REG(channel)].msk;
+    if (isr & BDMA_ISR_TEIFx[REG(channel)].msk) flags |= BDMA_ISR_TEIFx[REG(channel)].msk;
+    return flags;
+}
+
+static inline void clear_flags(uint8_t channel) {
+    *BDMA_IFCR = BDMA_IFCR_CGIFx[REG(channel)].msk;
+}
+
+static bool disable_channel(uint8_t channel) {
+    uint32_t count = 0;
+
+    CLR_FIELD(BDMA_CCRx[REG(channel)], BDMA_CCRx_EN);
+    while (READ_FIELD(BDMA_CCRx[REG(channel)], BDMA_CCRx_EN)) {
+        if (count++ >= BDMA_CHANNEL_DISABLE_TIMEOUT) return false;
+    }
+
+    clear_flags(channel);
+    return true;
+}
+
+static inline int size_code(uint8_t bytes) {
+    switch (bytes) {
+        case 1: return 0;
+        case 2: return 1;
+        case 4: return 2;
+        default: return -1;
+    }
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+
+void bdma_init(void) {
+    SET_FIELD(RCC_AHB4ENR, RCC_AHB4ENR_BDMAEN);
+
+    // Keep the BDMA and its memory clocked while D1 is in stop mode
+    SET_FIELD(RCC_D3AMR, RCC_D3AMR_BDMAAMEN);
+    SET_FIELD(RCC_D3AMR, RCC_D3AMR_SRAM4AMEN);
+
+    for (uint8_t i = 0; i < BDMA_CHANNEL_COUNT; i++) disable_channel(i);
+}
+
+bool bdma_mem_is_accessible(const void *buffer, size_t size) {
+    uintptr_t start = (uintptr_t)buffer;
+    uintptr_t end = start + size;
+
+    if (buffer == NULL) return false;
+    if ((start >= SRAM4_START) && (end <= SRAM4_END)) return true;
+    if ((start >= BKPSRAM_START) && (end <= BKPSRAM_END)) return true;
+
+    return false;
+}
+
+int bdma_start_transfer(dma_transfer_t *dma_transfer) {
+    if (dma_transfer == NULL) return TI_ERRC_INVALID_ARG;
+
+    uint8_t channel = dma_transfer->stream;
+    if ((dma_transfer->instance != DMA_INSTANCE_BDMA) || (channel >= BDMA_CHANNEL_COUNT)) return TI_ERRC_INVALID_ARG;
+    if (dma_transfer->mode == DMA_MODE_DOUBLE_BUFFER) return TI_ERRC_UNSUPPORTED;
+    if ((dma_transfer->src == NULL) || (dma_transfer->dest == NULL)) return TI_ERRC_INVALID_ARG;
+    if (dma_transfer->priority > 3) return TI_ERRC_INVALID_ARG;
+
+    bool mem_to_mem = (dma_transfer->direction == MEM_TO_MEM);
+    if (mem_to_mem && (dma_transfer->mode != DMA_MODE_NORMAL)) return TI_ERRC_INVALID_ARG;
+
+    int src_size = size_code(dma_transfer->src_data_size);
+    int dest_size = size_code(dma_transfer->dest_data_size);
+    if ((src_size < 0) || (dest_size < 0)) return TI_ERRC_INVALID_ARG;
+
+    // The "peripheral" side is the source for peripheral-to-memory and memory-to-memory
+    bool to_mem = (dma_transfer->direction != MEM_TO_PERIPH);
+    uint8_t periph_bytes = to_mem ? dma_transfer->src_data_size : dma_transfer->dest_data_size;
+    uint32_t items = dma_transfer->size / periph_bytes;
+    if ((items == 0) || (items > MAX_NDTR) || (dma_transfer->size % periph_bytes != 0)) return TI_ERRC_INVALID_ARG;
+
+    void *mem = to_mem ? dma_transfer->dest : (void *)dma_transfer->src;
+    if (!bdma_mem_is_accessible(mem, dma_transfer->size)) return TI_ERRC_INVALID_ARG;
+    if (mem_to_mem && !bdma_mem_is_accessible(dma_transfer->src, dma_transfer->size)) return TI_ERRC_INVALID_ARG;
+
+    if (READ_FIELD(BDMA_CCRx[REG(channel)], BDMA_CCRx_EN)) return TI_ERRC_BUSY;
+    if (!disable_channel(channel)) return TI_ERRC_TIMEOUT;
+
+    if (mem_to_mem) dma_cache_clean(dma_transfer->src, dma_transfer->size);
+    if (to_mem) {
+        dma_cache_invalidate(mem, dma_transfer->size);
+    } else {
+        dma_cache_clean(mem, dma_transfer->size);
+    }
+
+    channels[channel] = (bdma_channel_t){
+        .running = true,
+        .to_mem = to_mem,
+        .mem = mem,
+        .size = dma_transfer->size,
+        .mode = dma_transfer->mode,
+        .callback = dma_transfer->callback,
+        .event_callback = dma_transfer->event_callback,
+        .context = dma_transfer->context,
+    };
+
+    // Memory-to-memory transfers run without a request
+    if (!mem_to_mem) WRITE_FIELD(DMAMUX2_CxCR[channel], DMAMUXx_CxCR_DMAREQ_ID, dma_transfer->request_id);
+
+    uint32_t periph = to_mem ? (uint32_t)dma_transfer->src : (uint32_t)dma_transfer->dest;
+    *BDMA_CPARx[REG(channel)] = periph;
+    *BDMA_CMARx[REG(channel)] = (uint32_t)mem;
+    WRITE_FIELD(BDMA_CNDTRx[REG(channel)], BDMA_CNDTRx_NDT, items);
+
+    uint32_t psize = to_mem ? (uint32_t)src_size : (uint32_t)dest_size;
+    uint32_t msize = to_mem ? (uint32_t)dest_size : (uint32_t)src_size;
+    uint32_t cr_val = 0;
+
+    cr_val |= ((to_mem ? 0U : 1U) << BDMA_CCRx_DIR.pos) & BDMA_CCRx_DIR.msk;
+    cr_val |= (psize << BDMA_CCRx_PSIZE.pos) & BDMA_CCRx_PSIZE.msk;
+    cr_val |= (msize << BDMA_CCRx_MSIZE.pos) & BDMA_CCRx_MSIZE.msk;
+    cr_val |= ((uint32_t)dma_transfer->priority << BDMA_CCRx_PL.pos) & BDMA_CCRx_PL.msk;
+    if (!dma_transfer->disable_mem_inc) cr_val |= BDMA_CCRx_MINC.msk;
+    if (mem_to_mem) cr_val |= BDMA_CCRx_MEM2MEM.msk | BDMA_CCRx_PINC.msk;
+
+    cr_val |= BDMA_CCRx_TCIE.msk | BDMA_CCRx_TEIE.msk;
+    if (dma_transfer->mode == DMA_MODE_CIRCULAR) cr_val |= BDMA_CCRx_CIRC.msk | BDMA_CCRx_HTIE.msk;
+
+    *BDMA_CCRx[REG(channel)] = cr_val;
+    SET_FIELD(BDMA_CCRx[REG(channel)], BDMA_CCRx_EN);
+
+    return TI_ERRC_NONE;
+}
+
+int bdma_stop_transfer(uint8_t channel) {
+    if (channel >= BDMA_CHANNEL_COUNT) return TI_ERRC_INVALID_ARG;
+    if (!channels[channel].running) return TI_ERRC_INVALID_STATE;
+
+    channels[channel].running = false;
+    if (!disable_channel(channel)) return TI_ERRC_TIMEOUT;
+
+    return TI_ERRC_NONE;
+}
+
+uint32_t bdma_get_remaining(uint8_t channel) {
+    if (channel >= BDMA_CHANNEL_COUNT) return 0;
+    return READ_FIELD(BDMA_CNDTRx[REG(channel)], BDMA_CNDTRx_NDT);
+}
+
+void bdma_irq(uint8_t channel) {
+    if (channel >= BDMA_CHANNEL_COUNT) return;
+
+    bdma_channel_t *state = &channels[channel];
+    uint32_t flags = read_flags(channel);
+    clear_flags(channel);
+
+    if (!state->running) return;
+
+    bool circular = (state->mode == DMA_MODE_CIRCULAR);
+
+    if (flags & BDMA_ISR_TEIFx[REG(channel)].msk) {
+        // The hardware has already disabled the channel on a transfer error
+        state->running = false;
+        disable_channel(channel);
+        if (circular) {
+            dma_notify_event(DMA_INSTANCE_BDMA, channel, state->event_callback, DMA_EVENT_ERROR, 0, state->context);
+        } else {
+            dma_notify_complete(DMA_INSTANCE_BDMA, channel, state->callback, false, state->context);
+        }
+        return;
+    }
+
+    size_t half = state->size / 2;
+
+    if (circular) {
+        if (flags & BDMA_ISR_HTIFx[REG(channel)].msk) {
+            if (state->to_mem) dma_cache_invalidate(state->mem, half);
+            dma_notify_event(DMA_INSTANCE_BDMA, channel, state->event_callback, DMA_EVENT_HALF, 0, state->context);
+        }
+        if (flags & BDMA_ISR_TCIFx[REG(channel)].msk) {
+            if (state->to_mem) dma_cache_invalidate((uint8_t *)state->mem + half, state->size - half);
+            dma_notify_event(DMA_INSTANCE_BDMA, channel, state->event_callback, DMA_EVENT_FULL, 0, state->context);
+        }
+    } else if (flags & BDMA_ISR_TCIFx[REG(channel)].msk) {
+        state->running = false;
+        disable_channel(channel);
+        if (state->to_mem) dma_cache_invalidate(state->mem, state->size);
+        dma_notify_complete(DMA_INSTANCE_BDMA, channel, state->callback, true, state->context);
+    }
+}
@@ -0,0 +1,87 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/include/mcu/cpu.h
+ * @authors Jude Merritt
+ * @brief Cortex-M7 core helpers shared by the drivers: PRIMASK critical sections and the DWT
+ * cycle counter. Not a public interface.
+ */
+
+#pragma once
+#include <stdint.h>
+
+/**************************************************************************************************
+ * @section Macros
+ **************************************************************************************************/
+
+// The DWT block is not part of mmio.h. These are plain pointers so that this header does not
+// depend on which copy of mmio.h the including driver uses.
+#define CPU_DEMCR      ((volatile uint32_t *)0xE000EDFCU)
+#define CPU_DWT_CTRL   ((volatile uint32_t *)0xE0001000U)
+#define CPU_DWT_CYCCNT ((volatile uint32_t *)0xE0001004U)
+#define CPU_DWT_LAR    ((volatile uint32_t *)0xE0001FB0U)
+
+#define CPU_DEMCR_TRCENA       0x01000000U
+#define CPU_DWT_CTRL_CYCCNTENA 0x00000001U
+#define CPU_DWT_LAR_KEY        0xC5ACCE55U
+
+/**************************************************************************************************
+ * @section Critical Sections
+ **************************************************************************************************/
+
+#if defined(__ARM_ARCH)
+
+// Masks interrupts and returns the previous PRIMASK, so sections can nest
+static inline uint32_t irq_save(void) {
+    uint32_t primask;
+    asm volatile ("mrs %0, primask\n cpsid i" : "=r" (primask) :: "memory");
+    return primask;
+}
+
+static inline void irq_restore(uint32_t primask) {
+    asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+}
+
+#else
+
+// Host builds (unit tests) have no interrupts to mask
+static inline uint32_t irq_save(void) {
+    asm volatile ("" ::: "memory");
+    return 0;
+}
+
+static inline void irq_restore(uint32_t primask) {
+    (void)primask;
+    asm volatile ("" ::: "memory");
+}
+
+#endif
+
+/**************************************************************************************************
+ * @section Cycle Counter
+ **************************************************************************************************/
+
+// Starts CYCCNT. Harmless if it is already running.
+static inline void dwt_enable(void) {
+    *CPU_DEMCR |= CPU_DEMCR_TRCENA;
+    *CPU_DWT_LAR = CPU_DWT_LAR_KEY;
+    *CPU_DWT_CTRL |= CPU_DWT_CTRL_CYCCNTENA;
+}
+
+// Core clock cycles; differences stay correct across wrap-around when taken as uint32_t
+static inline uint32_t dwt_cycles(void) {
+    return *CPU_DWT_CYCCNT;
+}
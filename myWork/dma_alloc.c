@@ -0,0 +1,155 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/src/dma_alloc.c
+ * @authors Jude Merritt
+ * @brief DMA stream allocator
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "include/errc.h"
+#include "include/dma.h"
+
+// Stream state bits
+#define STREAM_CLAIMED   0x1 // Owned by a driver
+#define STREAM_SHAREABLE 0x2 // Owner allows lending while idle
+#define STREAM_ACTIVE    0x4 // A transfer (owner's or a borrower's) is running
+
+#define IS_VALID_STREAM(s) \
+    (((s).instance >= 1) && ((s).instance <= DMA_INSTANCE_COUNT) && ((s).stream < DMA_STREAM_COUNT))
+
+static atomic_uint_fast8_t stream_state[DMA_INSTANCE_COUNT + 1][DMA_STREAM_COUNT];
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+
+static inline atomic_uint_fast8_t *state_of(dma_stream_t stream) {
+    return &stream_state[stream.instance][stream.stream];
+}
+
+static inline bool transition(dma_stream_t stream, uint_fast8_t from, uint_fast8_t to) {
+    return atomic_compare_exchange_strong_explicit(state_of(stream), &from, to,
+                                                   memory_order_acq_rel, memory_order_acquire);
+}
+
+// Number of streams on a controller that are claimed or running. Only used as a hint.
+static uint8_t instance_load(uint8_t instance) {
+    uint8_t load = 0;
+    for (uint8_t i = 0; i < DMA_STREAM_COUNT; i++) {
+        if (atomic_load_explicit(&stream_state[instance][i], memory_order_relaxed) != 0) load++;
+    }
+    return load;
+}
+
+/*
+ * Walks the streams in preference order and tries to move one from state `from` to `to`.
+ * Controllers are tried least loaded first. High priority takes low stream numbers, which win
+ * arbitration ties; low priority takes high stream numbers to keep those free.
+ */
+static bool claim_first(uint8_t priority, uint_fast8_t from, uint_fast8_t to, dma_stream_t *out) {
+    uint8_t first = (instance_load(2) < instance_load(1)) ? 2 : 1;
+    uint8_t order[DMA_INSTANCE_COUNT] = {first, (first == 1) ? 2 : 1};
+    bool ascending = (priority >= 2);
+
+    for (uint8_t i = 0; i < DMA_INSTANCE_COUNT; i++) {
+        for (uint8_t j = 0; j < DMA_STREAM_COUNT; j++) {
+            dma_stream_t candidate = {
+                .instance = order[i],
+                .stream = ascending ? j : (DMA_STREAM_COUNT - 1 - j),
+            };
+            if (transition(candidate, from, to)) {
+                *out = candidate;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+
+int dma_claim_stream(uint8_t priority, uint8_t flags, dma_stream_t *stream) {
+    if ((priority > 3) || (stream == NULL)) return TI_ERRC_INVALID_ARG;
+
+    uint_fast8_t claimed = STREAM_CLAIMED | ((flags & DMA_CLAIM_SHAREABLE) ? STREAM_SHAREABLE : 0);
+    if (!claim_first(priority, 0, claimed, stream)) return TI_ERRC_NO_MEM;
+
+    return TI_ERRC_NONE;
+}
+
+int dma_claim_specific_stream(dma_stream_t stream, uint8_t flags) {
+    if (!IS_VALID_STREAM(stream)) return TI_ERRC_INVALID_ARG;
+
+    uint_fast8_t claimed = STREAM_CLAIMED | ((flags & DMA_CLAIM_SHAREABLE) ? STREAM_SHAREABLE : 0);
+    if (!transition(stream, 0, claimed)) return TI_ERRC_BUSY;
+
+    return TI_ERRC_NONE;
+}
+
+int dma_release_stream(dma_stream_t stream) {
+    if (!IS_VALID_STREAM(stream)) return TI_ERRC_INVALID_ARG;
+
+    uint_fast8_t state = atomic_load_explicit(state_of(stream), memory_order_acquire);
+    if (!(state & STREAM_CLAIMED)) return TI_ERRC_INVALID_STATE;
+    if (state & STREAM_ACTIVE) return TI_ERRC_BUSY;
+
+    // Fails if a borrower took the stream since the load above
+    if (!transition(stream, state, 0)) return TI_ERRC_BUSY;
+
+    return TI_ERRC_NONE;
+}
+
+int dma_stream_begin(dma_stream_t stream) {
+    if (!IS_VALID_STREAM(stream)) return TI_ERRC_INVALID_ARG;
+
+    uint_fast8_t state = atomic_load_explicit(state_of(stream), memory_order_acquire);
+    if (!(state & STREAM_CLAIMED)) return TI_ERRC_INVALID_STATE;
+    if (state & STREAM_ACTIVE) return TI_ERRC_BUSY;
+
+    if (!transition(stream, state, state | STREAM_ACTIVE)) return TI_ERRC_BUSY;
+
+    return TI_ERRC_NONE;
+}
+
+int dma_stream_end(dma_stream_t stream) {
+    if (!IS_VALID_STREAM(stream)) return TI_ERRC_INVALID_ARG;
+
+    uint_fast8_t state = atomic_fetch_and_explicit(state_of(stream), (uint_fast8_t)~STREAM_ACTIVE,
+                                                   memory_order_acq_rel);
+    if (!(state & STREAM_ACTIVE)) return TI_ERRC_INVALID_STATE;
+
+    return TI_ERRC_NONE;
+}
+
+int dma_borrow_stream(uint8_t priority, dma_stream_t *stream) {
+    if ((priority > 3) || (stream == NULL)) return TI_ERRC_INVALID_ARG;
+
+    // Unowned streams first, so owners of shareable streams are disturbed as little as possible
+    if (claim_first(priority, 0, STREAM_ACTIVE, stream)) return TI_ERRC_NONE;
+
+    if (claim_first(priority, STREAM_CLAIMED | STREAM_SHAREABLE,
+                    STREAM_CLAIMED | STREAM_SHAREABLE | STREAM_ACTIVE, stream)) {
+        return TI_ERRC_NONE;
+    }
+
+    return TI_ERRC_BUSY;
+}
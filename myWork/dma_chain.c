@@ -0,0 +1,292 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/src/dma_chain.c
+ * @authors Jude Merritt
+ * @brief MDMA linked-list transfers
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "include/mmio.h"
+#include "include/errc.h"
+#include "include/dma.h"
+#include "myWork/mdma_regs.h"
+
+#define FIRST_CHANNEL DMA_MEMCPY_CHANNELS
+#define MAX_TRIGGER   0x3FU
+
+typedef struct {
+    atomic_bool busy;
+    dma_chain_t *chain;
+    uint8_t stage;       // Last stage seen running, for chains that need software requests re-issued
+    dma_callback_t callback;
+    void *context;
+} chain_channel_t;
+
+static chain_channel_t channels[MDMA_CHANNEL_COUNT];
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+
+static inline bool is_fixed(uint32_t tcr, field32_t inc) {
+    return ((tcr & inc.msk) >> inc.pos) == MDMA_INC_FIXED;
+}
+
+static inline uint32_t node_size(const dma_chain_node_t *node) {
+    return (node->bndtr & MDMA_MDMA_CxBNDTR_BNDT.msk) >> MDMA_MDMA_CxBNDTR_BNDT.pos;
+}
+
+// The MDMA reads the nodes and the source buffers from memory, and writes the destinations
+static void prepare_memory(const dma_chain_t *chain) {
+    dma_cache_clean(chain->nodes, chain->count * sizeof(dma_chain_node_t));
+
+    for (uint8_t i = 0; i < chain->count; i++) {
+        const dma_chain_node_t *node = &chain->nodes[i];
+        if (!is_fixed(node->tcr, MDMA_MDMA_CxTCR_SINC)) dma_cache_clean((const void *)node->sar, node_size(node));
+    }
+    for (uint8_t i = 0; i < chain->count; i++) {
+        const dma_chain_node_t *node = &chain->nodes[i];
+        if (!is_fixed(node->tcr, MDMA_MDMA_CxTCR_DINC)) dma_cache_invalidate((void *)node->dar, node_size(node));
+    }
+}
+
+// Drops lines of the destinations that may have been fetched speculatively during the transfer
+static void finish_memory(const dma_chain_t *chain) {
+    for (uint8_t i = 0; i < chain->count; i++) {
+        const dma_chain_node_t *node = &chain->nodes[i];
+        if (!is_fixed(node->tcr, MDMA_MDMA_CxTCR_DINC)) dma_cache_invalidate((void *)node->dar, node_size(node));
+    }
+}
+
+static inline bool is_software(const dma_chain_node_t *node) {
+    return (node->tcr & MDMA_MDMA_CxTCR_SWRM.msk) != 0;
+}
+
+// A software stage only runs back to back with the stage before it if that one is software too.
+// After a hardware stage the MDMA loads the node and then waits for a request that only the CPU
+// can give, so such chains interrupt at the end of every block to re-issue it.
+static bool needs_requests(const dma_chain_t *chain) {
+    for (uint8_t i = 1; i < chain->count; i++) {
+        if (is_software(&chain->nodes[i]) && !is_software(&chain->nodes[i - 1])) return true;
+    }
+    return false;
+}
+
+// The stage the channel has loaded, found from CxLAR (which holds that node's link)
+static uint8_t loaded_stage(uint8_t channel, const dma_chain_t *chain) {
+    uint32_t lar = *MDMA_MDMA_CxLAR[channel];
+    if (lar == 0) return chain->count - 1;
+    return (uint8_t)((lar - (uint32_t)chain->nodes) / sizeof(dma_chain_node_t) - 1);
+}
+
+// Called at the end of a block. The link to the next node may still be loading, so wait for it.
+static void issue_request(uint8_t channel) {
+    chain_channel_t *ch = &channels[channel];
+    uint8_t stage;
+    uint32_t count = 0;
+
+    while ((stage = loaded_stage(channel, ch->chain)) <= ch->stage) {
+        if (count++ >= MDMA_CHANNEL_DISABLE_TIMEOUT) return;
+    }
+    ch->stage = stage;
+
+    const dma_chain_node_t *nodes = ch->chain->nodes;
+    if (is_software(&nodes[stage]) && !is_software(&nodes[stage - 1])) {
+        SET_FIELD(MDMA_MDMA_CxCR[channel], MDMA_MDMA_CxCR_SWRQ);
+    }
+}
+
+static void release(uint8_t channel) {
+    channels[channel].chain->channel = -1;
+    channels[channel].chain = NULL;
+    atomic_store_explicit(&channels[channel].busy, false, memory_order_release);
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+
+int dma_chain_init(dma_chain_t *chain, dma_chain_node_t *nodes, uint8_t capacity) {
+    if ((chain == NULL) || (nodes == NULL) || (capacity == 0)) return TI_ERRC_INVALID_ARG;
+
+    chain->nodes = nodes;
+    chain->capacity = capacity;
+    chain->count = 0;
+    chain->channel = -1;
+
+    return TI_ERRC_NONE;
+}
+
+int dma_chain_append(dma_chain_t *chain, const dma_chain_stage_t *stage) {
+    if ((chain == NULL) || (stage == NULL)) return TI_ERRC_INVALID_ARG;
+    if (chain->channel >= 0) return TI_ERRC_INVALID_STATE;
+    if (chain->count >= chain->capacity) return TI_ERRC_NO_MEM;
+    if ((stage->src == NULL) || (stage->dest == NULL)) return TI_ERRC_INVALID_ARG;
+
+    int src_size = mdma_size_code(stage->src_data_size);
+    int dest_size = mdma_size_code(stage->dest_data_size);
+    if ((src_size < 0) || (dest_size < 0)) return TI_ERRC_INVALID_ARG;
+
+    uint8_t largest = (stage->src_data_size > stage->dest_data_size) ? stage->src_data_size : stage->dest_data_size;
+    if ((stage->size == 0) || (stage->size > MDMA_MAX_BLOCK) || (stage->size % largest != 0)) return TI_ERRC_INVALID_ARG;
+
+    bool software = (stage->trigger == DMA_CHAIN_SOFTWARE);
+    uint32_t tlen;
+    if (software) {
+        tlen = (stage->size < MDMA_MAX_TLEN) ? stage->size : MDMA_MAX_TLEN;
+    } else {
+        if (stage->trigger > MAX_TRIGGER) return TI_ERRC_INVALID_ARG;
+        if ((stage->request_bytes == 0) || (stage->request_bytes > MDMA_MAX_TLEN)) return TI_ERRC_INVALID_ARG;
+        if (stage->request_bytes % largest != 0) return TI_ERRC_INVALID_ARG;
+        tlen = stage->request_bytes;
+    }
+
+    // Software stages run through on the request issued by dma_chain_start(); hardware stages
+    // move one buffer of TLEN + 1 bytes per peripheral request
+    uint32_t trgm = software ? MDMA_TRGM_LIST : MDMA_TRGM_BUFFER;
+    uint32_t sinc = stage->src_fixed ? MDMA_INC_FIXED : MDMA_INC_INCREMENT;
+    uint32_t dinc = stage->dest_fixed ? MDMA_INC_FIXED : MDMA_INC_INCREMENT;
+
+    uint32_t tcr = 0;
+    tcr |= (sinc << MDMA_MDMA_CxTCR_SINC.pos) & MDMA_MDMA_CxTCR_SINC.msk;
+    tcr |= (dinc << MDMA_MDMA_CxTCR_DINC.pos) & MDMA_MDMA_CxTCR_DINC.msk;
+    tcr |= ((uint32_t)src_size << MDMA_MDMA_CxTCR_SSIZE.pos) & MDMA_MDMA_CxTCR_SSIZE.msk;
+    tcr |= ((uint32_t)dest_size << MDMA_MDMA_CxTCR_DSIZE.pos) & MDMA_MDMA_CxTCR_DSIZE.msk;
+    tcr |= ((uint32_t)src_size << MDMA_MDMA_CxTCR_SINCOS.pos) & MDMA_MDMA_CxTCR_SINCOS.msk;
+    tcr |= ((uint32_t)dest_size << MDMA_MDMA_CxTCR_DINCOS.pos) & MDMA_MDMA_CxTCR_DINCOS.msk;
+    tcr |= ((tlen - 1) << MDMA_MDMA_CxTCR_TLEN.pos) & MDMA_MDMA_CxTCR_TLEN.msk;
+    tcr |= (trgm << MDMA_MDMA_CxTCR_TRGM.pos) & MDMA_MDMA_CxTCR_TRGM.msk;
+    if (src_size != dest_size) tcr |= MDMA_MDMA_CxTCR_PKE.msk;
+    if (software) tcr |= MDMA_MDMA_CxTCR_SWRM.msk;
+    tcr |= MDMA_MDMA_CxTCR_BWM.msk;
+
+    uint32_t tbr = 0;
+    if (!software) tbr |= ((uint32_t)stage->trigger << MDMA_MDMA_CxTBR_TSEL.pos) & MDMA_MDMA_CxTBR_TSEL.msk;
+    tbr |= (mdma_bus(stage->src) << MDMA_MDMA_CxTBR_SBUS.pos) & MDMA_MDMA_CxTBR_SBUS.msk;
+    tbr |= (mdma_bus(stage->dest) << MDMA_MDMA_CxTBR_DBUS.pos) & MDMA_MDMA_CxTBR_DBUS.msk;
+
+    dma_chain_node_t *node = &chain->nodes[chain->count];
+    *node = (dma_chain_node_t){
+        .tcr = tcr,
+        .bndtr = (stage->size << MDMA_MDMA_CxBNDTR_BNDT.pos) & MDMA_MDMA_CxBNDTR_BNDT.msk,
+        .sar = (uint32_t)stage->src,
+        .dar = (uint32_t)stage->dest,
+        .brur = 0,
+        .lar = 0,
+        .tbr = tbr,
+        .mar = (uint32_t)stage->mask_addr,
+        .mdr = stage->mask_data,
+    };
+
+    if (chain->count > 0) chain->nodes[chain->count - 1].lar = (uint32_t)node;
+    chain->count++;
+
+    return TI_ERRC_NONE;
+}
+
+int dma_chain_start(dma_chain_t *chain, uint8_t priority, dma_callback_t callback, void *context) {
+    if ((chain == NULL) || (priority > 3)) return TI_ERRC_INVALID_ARG;
+    if (chain->count == 0) return TI_ERRC_INVALID_ARG;
+    if (chain->channel >= 0) return TI_ERRC_INVALID_STATE;
+
+    uint8_t channel = MDMA_CHANNEL_COUNT;
+    for (uint8_t i = FIRST_CHANNEL; i < MDMA_CHANNEL_COUNT; i++) {
+        if (!atomic_exchange_explicit(&channels[i].busy, true, memory_order_acquire)) {
+            channel = i;
+            break;
+        }
+    }
+    if (channel == MDMA_CHANNEL_COUNT) return TI_ERRC_BUSY;
+
+    if (!mdma_disable_channel(channel)) {
+        atomic_store_explicit(&channels[channel].busy, false, memory_order_release);
+        return TI_ERRC_TIMEOUT;
+    }
+
+    prepare_memory(chain);
+
+    channels[channel].chain = chain;
+    channels[channel].stage = 0;
+    channels[channel].callback = callback;
+    channels[channel].context = context;
+    chain->channel = (int8_t)channel;
+
+    // The first node is loaded by hand; the MDMA fetches the rest through LAR
+    const dma_chain_node_t *first = &chain->nodes[0];
+    *MDMA_MDMA_CxTCR[channel] = first->tcr;
+    *MDMA_MDMA_CxBNDTR[channel] = first->bndtr;
+    *MDMA_MDMA_CxSAR[channel] = first->sar;
+    *MDMA_MDMA_CxDAR[channel] = first->dar;
+    *MDMA_MDMA_CxBRUR[channel] = first->brur;
+    *MDMA_MDMA_CxLAR[channel] = first->lar;
+    *MDMA_MDMA_CxTBR[channel] = first->tbr;
+    *MDMA_MDMA_CxMAR[channel] = first->mar;
+    *MDMA_MDMA_CxMDR[channel] = first->mdr;
+
+    // Only the end of the whole list interrupts, unless software requests have to be re-issued
+    uint32_t cr = ((uint32_t)priority << MDMA_MDMA_CxCR_PL.pos) & MDMA_MDMA_CxCR_PL.msk;
+    cr |= MDMA_MDMA_CxCR_TEIE.msk | MDMA_MDMA_CxCR_CTCIE.msk;
+    if (needs_requests(chain)) cr |= MDMA_MDMA_CxCR_BTIE.msk;
+    *MDMA_MDMA_CxCR[channel] = cr;
+    SET_FIELD(MDMA_MDMA_CxCR[channel], MDMA_MDMA_CxCR_EN);
+
+    if (is_software(first)) SET_FIELD(MDMA_MDMA_CxCR[channel], MDMA_MDMA_CxCR_SWRQ);
+
+    return TI_ERRC_NONE;
+}
+
+int dma_chain_abort(dma_chain_t *chain) {
+    if (chain == NULL) return TI_ERRC_INVALID_ARG;
+    if (chain->channel < 0) return TI_ERRC_INVALID_STATE;
+
+    uint8_t channel = (uint8_t)chain->channel;
+    bool stopped = mdma_disable_channel(channel);
+    release(channel);
+
+    return stopped ? TI_ERRC_NONE : TI_ERRC_TIMEOUT;
+}
+
+void dma_chain_irq(void) {
+    for (uint8_t i = FIRST_CHANNEL; i < MDMA_CHANNEL_COUNT; i++) {
+        if (!mdma_pending(i)) continue;
+
+        uint32_t flags = mdma_read_flags(i);
+        mdma_clear_flags(i, flags);
+
+        chain_channel_t *ch = &channels[i];
+        if (ch->chain == NULL) continue;
+        if (!(flags & (MDMA_FLAG_TE | MDMA_FLAG_CTC))) {
+            if (flags & MDMA_FLAG_BT) issue_request(i);
+            continue;
+        }
+
+        bool success = !(flags & MDMA_FLAG_TE);
+        if (success) {
+            finish_memory(ch->chain);
+        } else {
+            mdma_disable_channel(i);
+        }
+
+        dma_callback_t callback = ch->callback;
+        void *context = ch->context;
+        release(i);
+
+        dma_notify_complete(DMA_INSTANCE_MDMA, i, callback, success, context);
+    }
+}
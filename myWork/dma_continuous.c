@@ -0,0 +1,228 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/src/dma_continuous.c
+ * @authors Jude Merritt
+ * @brief Circular and double-buffer DMA transfers
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "include/mmio.h"
+#include "include/errc.h"
+#include "include/dma.h"
+#include "myWork/dma_regs.h"
+
+#define IS_VALID_STREAM(instance, stream) \
+    (((instance) >= 1) && ((instance) <= DMA_INSTANCE_COUNT) && ((stream) < DMA_STREAM_COUNT))
+
+#define MAX_NDTR 0xFFFFU
+
+typedef struct {
+    bool running;
+    bool to_mem;    // Peripheral-to-memory: invalidate on events. Otherwise clean on hand-over.
+    void *mem[2];   // Memory buffers (mem[1] only in double buffer mode)
+    size_t size;    // Bytes per buffer
+    dma_mode_t mode;
+    dma_event_callback_t callback;
+    void *context;
+} dma_continuous_t;
+
+static dma_continuous_t continuous[DMA_INSTANCE_COUNT + 1][DMA_STREAM_COUNT];
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+
+int dma_start_continuous(dma_transfer_t *dma_transfer) {
+    if (dma_transfer == NULL) return TI_ERRC_INVALID_ARG;
+
+    uint8_t instance = dma_transfer->instance;
+    uint8_t stream = dma_transfer->stream;
+    if (!IS_VALID_STREAM(instance, stream)) return TI_ERRC_INVALID_ARG;
+    if (dma_transfer->mode == DMA_MODE_NORMAL) return TI_ERRC_INVALID_ARG;
+    if (dma_transfer->direction == MEM_TO_MEM) return TI_ERRC_INVALID_ARG; // Not allowed by the hardware
+    if ((dma_transfer->mode == DMA_MODE_DOUBLE_BUFFER) && (dma_transfer->mem1 == NULL)) return TI_ERRC_INVALID_ARG;
+    if ((dma_transfer->src == NULL) || (dma_transfer->dest == NULL)) return TI_ERRC_INVALID_ARG;
+    if (dma_transfer->priority > 3) return TI_ERRC_INVALID_ARG;
+
+    int src_size = dma_size_code(dma_transfer->src_data_size);
+    int dest_size = dma_size_code(dma_transfer->dest_data_size);
+    if ((src_size < 0) || (dest_size < 0)) return TI_ERRC_INVALID_ARG;
+
+    // NDTR counts items of the peripheral size
+    bool to_mem = (dma_transfer->direction == PERIPH_TO_MEM);
+    uint8_t periph_bytes = to_mem ? dma_transfer->src_data_size : dma_transfer->dest_data_size;
+    uint32_t items = dma_transfer->size / periph_bytes;
+    if ((items == 0) || (items > MAX_NDTR) || (dma_transfer->size % periph_bytes != 0)) return TI_ERRC_INVALID_ARG;
+
+    void *mem0 = to_mem ? dma_transfer->dest : (void *)dma_transfer->src;
+    void *mem1 = (dma_transfer->mode == DMA_MODE_DOUBLE_BUFFER) ? dma_transfer->mem1 : NULL;
+    if (!dma_mem_is_accessible(mem0, dma_transfer->size)) return TI_ERRC_INVALID_ARG;
+    if ((mem1 != NULL) && !dma_mem_is_accessible(mem1, dma_transfer->size)) return TI_ERRC_INVALID_ARG;
+
+    if (READ_FIELD(dma_sxcr(instance, stream), DMAx_SxCR_EN)) return TI_ERRC_BUSY;
+    if (!dma_disable_stream(instance, stream)) return TI_ERRC_TIMEOUT;
+
+    // Make memory coherent before the DMA touches it. Receive buffers are invalidated so that no
+    // dirty line can later be evicted on top of data written by the DMA.
+    for (uint8_t i = 0; i < 2; i++) {
+        void *mem = (i == 0) ? mem0 : mem1;
+        if (mem == NULL) continue;
+        if (to_mem) {
+            dma_cache_invalidate(mem, dma_transfer->size);
+        } else {
+            dma_cache_clean(mem, dma_transfer->size);
+        }
+    }
+
+    continuous[instance][stream] = (dma_continuous_t){
+        .running = true,
+        .to_mem = to_mem,
+        .mem = {mem0, mem1},
+        .size = dma_transfer->size,
+        .mode = dma_transfer->mode,
+        .callback = dma_transfer->event_callback,
+        .context = dma_transfer->context,
+    };
+
+    // Route the peripheral request to this stream
+    WRITE_FIELD(dma_mux_channel(instance, stream), DMAMUXx_CxCR_DMAREQ_ID, dma_transfer->request_id);
+
+    // Addresses. The memory side uses M0AR (and M1AR in double buffer mode).
+    uint32_t periph = to_mem ? (uint32_t)dma_transfer->src : (uint32_t)dma_transfer->dest;
+    *DMAx_SxPAR[instance][stream] = periph;
+    *DMAx_SxM0AR[instance][stream] = (uint32_t)mem0;
+    if (mem1 != NULL) *DMAx_SxM1AR[instance][stream] = (uint32_t)mem1;
+    WRITE_FIELD(DMAx_SxNDTR[instance][stream], DMAx_SxNDTR_NDT, items);
+
+    // FIFO
+    if (dma_transfer->fifo_enabled) {
+        SET_FIELD(DMAx_SxFCR[instance][stream], DMAx_SxFCR_DMDIS);
+        WRITE_FIELD(DMAx_SxFCR[instance][stream], DMAx_SxFCR_FTH, dma_transfer->fifo_threshold);
+    } else {
+        CLR_FIELD(DMAx_SxFCR[instance][stream], DMAx_SxFCR_DMDIS);
+    }
+
+    // Stream configuration, written in one go
+    rw_reg32_t cr = dma_sxcr(instance, stream);
+    uint32_t psize = to_mem ? (uint32_t)src_size : (uint32_t)dest_size;
+    uint32_t msize = to_mem ? (uint32_t)dest_size : (uint32_t)src_size;
+    uint32_t cr_val = 0;
+
+    cr_val |= ((to_mem ? 0U : 1U) << DMAx_SxCR_DIR.pos) & DMAx_SxCR_DIR.msk;
+    cr_val |= (psize << DMAx_SxCR_PSIZE.pos) & DMAx_SxCR_PSIZE.msk;
+    cr_val |= (msize << DMAx_SxCR_MSIZE.pos) & DMAx_SxCR_MSIZE.msk;
+    cr_val |= ((uint32_t)dma_transfer->priority << DMAx_SxCR_PL.pos) & DMAx_SxCR_PL.msk;
+    if (!dma_transfer->disable_mem_inc) cr_val |= DMAx_SxCR_MINC.msk;
+
+    // Double buffer mode implies circular mode in hardware
+    if (dma_transfer->mode == DMA_MODE_DOUBLE_BUFFER) {
+        cr_val |= DMAx_SxCR_DBM.msk;
+    } else {
+        cr_val |= DMAx_SxCR_CIRC.msk;
+    }
+
+    // Half transfer is always enabled since each half is invalidated separately
+    cr_val |= DMAx_SxCR_TCIE.msk | DMAx_SxCR_HTIE.msk | DMAx_SxCR_TEIE.msk | DMAx_SxCR_DMEIE.msk;
+
+    *cr = cr_val;
+    SET_FIELD(cr, DMAx_SxCR_EN);
+
+    return TI_ERRC_NONE;
+}
+
+int dma_stop_continuous(uint8_t instance, uint8_t stream) {
+    if (!IS_VALID_STREAM(instance, stream)) return TI_ERRC_INVALID_ARG;
+    if (!continuous[instance][stream].running) return TI_ERRC_INVALID_STATE;
+
+    continuous[instance][stream].running = false;
+    if (!dma_disable_stream(instance, stream)) return TI_ERRC_TIMEOUT;
+
+    // Leave the stream in one-shot mode for whoever uses it next
+    CLR_FIELD(dma_sxcr(instance, stream), DMAx_SxCR_DBM);
+    CLR_FIELD(dma_sxcr(instance, stream), DMAx_SxCR_CIRC);
+    CLR_FIELD(dma_sxcr(instance, stream), DMAx_SxCR_HTIE);
+
+    return TI_ERRC_NONE;
+}
+
+int dma_set_idle_buffer(uint8_t instance, uint8_t stream, void *buffer) {
+    if (!IS_VALID_STREAM(instance, stream) || (buffer == NULL)) return TI_ERRC_INVALID_ARG;
+
+    dma_continuous_t *state = &continuous[instance][stream];
+    if (!state->running || (state->mode != DMA_MODE_DOUBLE_BUFFER)) return TI_ERRC_INVALID_STATE;
+
+    if (!dma_mem_is_accessible(buffer, state->size)) return TI_ERRC_INVALID_ARG;
+
+    if (state->to_mem) {
+        dma_cache_invalidate(buffer, state->size);
+    } else {
+        dma_cache_clean(buffer, state->size);
+    }
+
+    // Only the address register that is not the current target may be written
+    if (READ_FIELD(dma_sxcr(instance, stream), DMAx_SxCR_CT)) {
+        *DMAx_SxM0AR[instance][stream] = (uint32_t)buffer;
+        state->mem[0] = buffer;
+    } else {
+        *DMAx_SxM1AR[instance][stream] = (uint32_t)buffer;
+        state->mem[1] = buffer;
+    }
+
+    return TI_ERRC_NONE;
+}
+
+uint32_t dma_get_remaining(uint8_t instance, uint8_t stream) {
+    if (!IS_VALID_STREAM(instance, stream)) return 0;
+    return READ_FIELD(DMAx_SxNDTR[instance][stream], DMAx_SxNDTR_NDT);
+}
+
+void dma_continuous_irq(uint8_t instance, uint8_t stream) {
+    if (!IS_VALID_STREAM(instance, stream)) return;
+
+    dma_continuous_t *state = &continuous[instance][stream];
+    uint32_t flags = dma_read_flags(instance, stream);
+    dma_clear_flags(instance, stream, flags);
+
+    if (!state->running) return;
+
+    bool double_buffer = (state->mode == DMA_MODE_DOUBLE_BUFFER);
+    uint8_t current = double_buffer ? (uint8_t)READ_FIELD(dma_sxcr(instance, stream), DMAx_SxCR_CT) : 0;
+
+    if (flags & (DMA_FLAG_TE | DMA_FLAG_DME)) {
+        // The hardware has already disabled the stream on a transfer error
+        state->running = false;
+        dma_disable_stream(instance, stream);
+        dma_notify_event(instance, stream, state->callback, DMA_EVENT_ERROR, current, state->context);
+        return;
+    }
+
+    // A half transfer refers to the buffer in use. On transfer complete the DMA has already
+    // switched to the other buffer, so the finished one is the previous target. Received data
+    // is invalidated half by half so the CPU sees what the DMA just wrote.
+    size_t half = state->size / 2;
+
+    if (flags & DMA_FLAG_HT) {
+        if (state->to_mem) dma_cache_invalidate(state->mem[current], half);
+        dma_notify_event(instance, stream, state->callback, DMA_EVENT_HALF, current, state->context);
+    }
+    if (flags & DMA_FLAG_TC) {
+        uint8_t finished = double_buffer ? (uint8_t)(current ^ 1U) : 0;
+        if (state->to_mem) dma_cache_invalidate((uint8_t *)state->mem[finished] + half, state->size - half);
+        dma_notify_event(instance, stream, state->callback, DMA_EVENT_FULL, finished, state->context);
+    }
+}
@@ -0,0 +1,228 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/src/dma_dispatch.c
+ * @authors Jude Merritt
+ * @brief Immediate or deferred dispatch of DMA completion callbacks
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "include/mmio.h"
+#include "include/errc.h"
+#include "include/dma.h"
+#include "myWork/cpu.h"
+#include "myWork/mpsc_ring.h"
+
+_Static_assert((DMA_DEFERRED_QUEUE_DEPTH & (DMA_DEFERRED_QUEUE_DEPTH - 1)) == 0, "DMA_DEFERRED_QUEUE_DEPTH must be a power of two");
+
+#define IS_VALID_STREAM(instance, stream)                                                          \
+    ((((instance) >= 1) && ((instance) <= DMA_INSTANCE_BDMA) && ((stream) < DMA_STREAM_COUNT)) || \
+     (((instance) == DMA_INSTANCE_MDMA) && ((stream) < MDMA_CHANNEL_COUNT)))
+
+typedef enum {
+    ENTRY_COMPLETE,
+    ENTRY_EVENT,
+} entry_kind_t;
+
+// Kept small so that the ISR only copies a few words
+typedef struct {
+    uint32_t timestamp;
+    void *context;
+    union {
+        dma_callback_t complete;
+        dma_event_callback_t event;
+    } fn;
+    uint8_t kind;
+    uint8_t arg;    // success flag or dma_event_t
+    uint8_t buffer;
+} dma_deferred_entry_t;
+
+// Produced by the ISRs, consumed by dma_dispatch_deferred()
+static atomic_uint queue_seq[DMA_DEFERRED_QUEUE_DEPTH];
+static dma_deferred_entry_t queue[DMA_DEFERRED_QUEUE_DEPTH];
+static mpsc_ring_t queue_ring;
+
+// BDMA channels are kept as a third instance and MDMA channels as a fourth
+static uint8_t dispatch_mode[DMA_INSTANCE_MDMA + 1][MDMA_CHANNEL_COUNT];
+static dma_dispatch_stats_t dispatch_stats[2];
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+
+static void record(dma_dispatch_mode_t mode, uint32_t isr, uint32_t latency) {
+    dma_dispatch_stats_t *stats = &dispatch_stats[mode];
+
+    uint32_t primask = irq_save();
+    stats->events++;
+    stats->isr_cycles += isr;
+    if (isr > stats->isr_max) stats->isr_max = isr;
+    stats->latency_cycles += latency;
+    if (latency > stats->latency_max) stats->latency_max = latency;
+    irq_restore(primask);
+}
+
+// Records the ISR-side cost of a deferred event (its latency is recorded when it is run)
+static void record_push(uint32_t isr, uint32_t pending) {
+    dma_dispatch_stats_t *stats = &dispatch_stats[DMA_DISPATCH_DEFERRED];
+
+    uint32_t primask = irq_save();
+    stats->isr_cycles += isr;
+    if (isr > stats->isr_max) stats->isr_max = isr;
+    if (pending > stats->high_water) stats->high_water = pending;
+    irq_restore(primask);
+}
+
+static void record_overflow(void) {
+    uint32_t primask = irq_save();
+    dispatch_stats[DMA_DISPATCH_DEFERRED].overflows++;
+    irq_restore(primask);
+}
+
+static bool push(const dma_deferred_entry_t *entry) {
+    uint32_t pos;
+    if (!mpsc_ring_claim(&queue_ring, queue_seq, DMA_DEFERRED_QUEUE_DEPTH, &pos)) return false;
+
+    queue[mpsc_ring_index(DMA_DEFERRED_QUEUE_DEPTH, pos)] = *entry;
+    mpsc_ring_publish(queue_seq, DMA_DEFERRED_QUEUE_DEPTH, pos);
+
+    return true;
+}
+
+static inline void invoke(const dma_deferred_entry_t *entry) {
+    if (entry->kind == ENTRY_COMPLETE) {
+        entry->fn.complete(entry->arg != 0, entry->context);
+    } else {
+        entry->fn.event((dma_event_t)entry->arg, entry->buffer, entry->context);
+    }
+}
+
+static void notify(uint8_t instance, uint8_t stream, dma_deferred_entry_t *entry) {
+    bool deferred = IS_VALID_STREAM(instance, stream) &&
+                    (dispatch_mode[instance][stream] == DMA_DISPATCH_DEFERRED);
+
+    if (deferred) {
+        if (push(entry)) {
+            record_push(dwt_cycles() - entry->timestamp, mpsc_ring_pending(&queue_ring));
+            return;
+        }
+
+        // A lost completion would leave its driver waiting forever, so a full queue runs the
+        // callback here instead. A one-shot stream has at most one event outstanding, so only
+        // circular streams can see it overtake their own queued events.
+        record_overflow();
+    }
+
+    uint32_t start = dwt_cycles();
+    invoke(entry);
+    uint32_t end = dwt_cycles();
+
+    record(DMA_DISPATCH_ISR, end - entry->timestamp, start - entry->timestamp);
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+
+void dma_dispatch_init(void) {
+    dwt_enable();
+
+    dma_reset_dispatch_stats();
+}
+
+int dma_set_dispatch_mode(uint8_t instance, uint8_t stream, dma_dispatch_mode_t mode) {
+    if (!IS_VALID_STREAM(instance, stream)) return TI_ERRC_INVALID_ARG;
+    if ((mode != DMA_DISPATCH_ISR) && (mode != DMA_DISPATCH_DEFERRED)) return TI_ERRC_INVALID_ARG;
+
+    dispatch_mode[instance][stream] = (uint8_t)mode;
+
+    return TI_ERRC_NONE;
+}
+
+dma_dispatch_mode_t dma_get_dispatch_mode(uint8_t instance, uint8_t stream) {
+    if (!IS_VALID_STREAM(instance, stream)) return DMA_DISPATCH_ISR;
+
+    return (dma_dispatch_mode_t)dispatch_mode[instance][stream];
+}
+
+void dma_notify_complete(uint8_t instance, uint8_t stream, dma_callback_t callback, bool success,
+                         void *context) {
+    if (callback == NULL) return;
+
+    dma_deferred_entry_t entry = {
+        .timestamp = dwt_cycles(),
+        .context = context,
+        .fn.complete = callback,
+        .kind = ENTRY_COMPLETE,
+        .arg = success,
+    };
+    notify(instance, stream, &entry);
+}
+
+void dma_notify_event(uint8_t instance, uint8_t stream, dma_event_callback_t callback,
+                      dma_event_t event, uint8_t buffer, void *context) {
+    if (callback == NULL) return;
+
+    dma_deferred_entry_t entry = {
+        .timestamp = dwt_cycles(),
+        .context = context,
+        .fn.event = callback,
+        .kind = ENTRY_EVENT,
+        .arg = (uint8_t)event,
+        .buffer = buffer,
+    };
+    notify(instance, stream, &entry);
+}
+
+uint32_t dma_dispatch_deferred(uint32_t max_events) {
+    uint32_t count = 0;
+
+    while ((max_events == 0) || (count < max_events)) {
+        if (!mpsc_ring_ready(&queue_ring, queue_seq, DMA_DEFERRED_QUEUE_DEPTH)) break;
+
+        // Copy out and free the slot before running the callback, which may queue more work
+        dma_deferred_entry_t entry = queue[mpsc_ring_index(DMA_DEFERRED_QUEUE_DEPTH, queue_ring.tail)];
+        mpsc_ring_consume(&queue_ring, queue_seq, DMA_DEFERRED_QUEUE_DEPTH);
+
+        uint32_t latency = dwt_cycles() - entry.timestamp;
+        invoke(&entry);
+        record(DMA_DISPATCH_DEFERRED, 0, latency);
+        count++;
+    }
+
+    return count;
+}
+
+int dma_get_dispatch_stats(dma_dispatch_mode_t mode, dma_dispatch_stats_t *stats) {
+    if (((mode != DMA_DISPATCH_ISR) && (mode != DMA_DISPATCH_DEFERRED)) || (stats == NULL)) {
+        return TI_ERRC_INVALID_ARG;
+    }
+
+    uint32_t primask = irq_save();
+    *stats = dispatch_stats[mode];
+    irq_restore(primask);
+
+    return TI_ERRC_NONE;
+}
+
+void dma_reset_dispatch_stats(void) {
+    uint32_t primask = irq_save();
+    memset(dispatch_stats, 0, sizeof(dispatch_stats));
+    irq_restore(primask);
+}
@@ -0,0 +1,189 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/src/dma_mem.c
+ * @authors Jude Merritt
+ * @brief DMA-safe buffer pool and D-cache maintenance
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "include/mmio.h"
+#include "include/errc.h"
+#include "include/dma.h"
+#include "myWork/cpu.h"
+
+#define BLOCK_COUNT (DMA_MEM_POOL_SIZE / DMA_CACHE_LINE_SIZE)
+#define BITMAP_WORDS ((BLOCK_COUNT + 31) / 32)
+
+_Static_assert(DMA_MEM_POOL_SIZE % DMA_CACHE_LINE_SIZE == 0, "DMA_MEM_POOL_SIZE must be a multiple of the cache line size");
+
+// Tightly coupled memories, which DMA1/DMA2 cannot access
+#define ITCM_START 0x00000000U
+#define ITCM_END   0x00010000U
+#define DTCM_START 0x20000000U
+#define DTCM_END   0x20020000U
+
+// Cache maintenance operations are not part of mmio.h
+static rw_reg32_t const SCB_DCIMVAC  = (rw_reg32_t)0xE000EF5CU; // Invalidate by address
+static rw_reg32_t const SCB_DCCMVAC  = (rw_reg32_t)0xE000EF68U; // Clean by address
+static rw_reg32_t const SCB_DCCIMVAC = (rw_reg32_t)0xE000EF70U; // Clean and invalidate by address
+
+static uint8_t pool[DMA_MEM_POOL_SIZE] DMA_BUFFER;
+
+// One bit per cache line: in use, and last line of an allocation
+static uint32_t used[BITMAP_WORDS];
+static uint32_t last[BITMAP_WORDS];
+static size_t free_blocks = BLOCK_COUNT;
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+
+static inline void barrier(void) {
+#if defined(__ARM_ARCH)
+    asm volatile ("dsb\n isb" ::: "memory");
+#else
+    asm volatile ("" ::: "memory"); // Host builds (unit tests) have no cache
+#endif
+}
+
+static inline bool test_bit(const uint32_t *map, size_t bit) {
+    return (map[bit / 32] >> (bit % 32)) & 1U;
+}
+
+static inline void set_bit(uint32_t *map, size_t bit) {
+    map[bit / 32] |= (1U << (bit % 32));
+}
+
+static inline void clear_bit(uint32_t *map, size_t bit) {
+    map[bit / 32] &= ~(1U << (bit % 32));
+}
+
+// Applies a by-address maintenance operation to every cache line touching the range
+static void cache_op(rw_reg32_t op, uintptr_t start, uintptr_t end) {
+    start &= ~(uintptr_t)(DMA_CACHE_LINE_SIZE - 1);
+
+    barrier();
+    for (uintptr_t addr = start; addr < end; addr += DMA_CACHE_LINE_SIZE) {
+        *op = (uint32_t)addr;
+    }
+    barrier();
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+
+void *dma_mem_alloc(size_t size) {
+    if ((size == 0) || (size > DMA_MEM_POOL_SIZE)) return NULL;
+
+    size_t blocks = (size + DMA_CACHE_LINE_SIZE - 1) / DMA_CACHE_LINE_SIZE;
+    void *buffer = NULL;
+
+    uint32_t primask = irq_save();
+
+    // First fit
+    size_t run = 0;
+    for (size_t i = 0; (i < BLOCK_COUNT) && (blocks <= free_blocks); i++) {
+        run = test_bit(used, i) ? 0 : run + 1;
+        if (run == blocks) {
+            size_t first = i + 1 - blocks;
+            for (size_t j = first; j <= i; j++) set_bit(used, j);
+            set_bit(last, i);
+            free_blocks -= blocks;
+            buffer = &pool[first * DMA_CACHE_LINE_SIZE];
+            break;
+        }
+    }
+
+    irq_restore(primask);
+
+    return buffer;
+}
+
+int dma_mem_free(void *buffer) {
+    uintptr_t addr = (uintptr_t)buffer;
+    uintptr_t base = (uintptr_t)pool;
+
+    if ((addr < base) || (addr >= base + DMA_MEM_POOL_SIZE)) return TI_ERRC_INVALID_ARG;
+    if ((addr - base) % DMA_CACHE_LINE_SIZE != 0) return TI_ERRC_INVALID_ARG;
+
+    size_t block = (addr - base) / DMA_CACHE_LINE_SIZE;
+
+    uint32_t primask = irq_save();
+
+    // Must be the first line of an allocation: in use, and the previous line is free or ends another one
+    if (!test_bit(used, block) || ((block > 0) && test_bit(used, block - 1) && !test_bit(last, block - 1))) {
+        irq_restore(primask);
+        return TI_ERRC_INVALID_ARG;
+    }
+
+    for (;;) {
+        bool end = test_bit(last, block);
+        clear_bit(used, block);
+        clear_bit(last, block);
+        free_blocks++;
+        if (end) break;
+        block++;
+    }
+
+    irq_restore(primask);
+
+    return TI_ERRC_NONE;
+}
+
+size_t dma_mem_available(void) {
+    return free_blocks * DMA_CACHE_LINE_SIZE;
+}
+
+bool dma_mem_is_accessible(const void *buffer, size_t size) {
+    uintptr_t start = (uintptr_t)buffer;
+    uintptr_t end = start + size;
+
+    if (buffer == NULL) return false;
+    if ((start < ITCM_END) && (end > ITCM_START)) return false;
+    if ((start < DTCM_END) && (end > DTCM_START)) return false;
+
+    return true;
+}
+
+void dma_cache_clean(const void *buffer, size_t size) {
+    if ((buffer == NULL) || (size == 0)) return;
+
+    uintptr_t start = (uintptr_t)buffer;
+    cache_op(SCB_DCCMVAC, start, start + size);
+}
+
+void dma_cache_invalidate(void *buffer, size_t size) {
+    if ((buffer == NULL) || (size == 0)) return;
+
+    uintptr_t start = (uintptr_t)buffer;
+    uintptr_t end = start + size;
+    uintptr_t mask = DMA_CACHE_LINE_SIZE - 1;
+
+    // A partial line at either end is shared with other data, so write it back as well
+    if (start & mask) {
+        cache_op(SCB_DCCIMVAC, start, start + 1);
+        start = (start + mask) & ~mask;
+    }
+    if ((end & mask) && (end > start)) {
+        cache_op(SCB_DCCIMVAC, end - 1, end);
+        end &= ~mask;
+    }
+
+    if (end > start) cache_op(SCB_DCIMVAC, start, end);
+}
@@ -0,0 +1,311 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/src/dma_memcpy.c
+ * @authors Jude Merritt
+ * @brief Memory-to-memory copy and fill on the MDMA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "include/mmio.h"
+#include "include/errc.h"
+#include "include/dma.h"
+#include "myWork/mdma_regs.h"
+#include "myWork/cpu.h"
+
+_Static_assert((DMA_MEMCPY_CHANNELS >= 1) && (DMA_MEMCPY_CHANNELS <= MDMA_CHANNEL_COUNT), "DMA_MEMCPY_CHANNELS must be 1-16");
+
+#define CALIBRATE_MIN_SIZE 32U
+#define CALIBRATE_TIMEOUT_CYCLES 48000000U // 100 ms at 480 MHz for one calibration copy
+
+// Burst encodings (2^n beats). Bursts must fit in one buffer transfer of MDMA_MAX_TLEN bytes.
+#define BURST_SINGLE 0U
+#define BURST_16     4U
+
+typedef struct {
+    atomic_bool busy;
+    uint8_t *dest;
+    const uint8_t *src;  // NULL for a fill
+    size_t remaining;    // Bytes not yet handed to the channel
+    size_t chunk;        // Bytes in the block currently running
+    uint8_t width;       // Bytes per beat (1 or 4)
+    uint8_t *dest_start;
+    size_t size;
+    uint32_t pattern;    // Fill source; read by the MDMA with a fixed address
+    dma_callback_t callback;
+    void *context;
+} copy_channel_t;
+
+static copy_channel_t channels[DMA_MEMCPY_CHANNELS];
+static size_t threshold = DMA_MEMCPY_THRESHOLD;
+static volatile bool calibrate_done;
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+
+static copy_channel_t *claim_channel(uint8_t *index) {
+    for (uint8_t i = 0; i < DMA_MEMCPY_CHANNELS; i++) {
+        if (!atomic_exchange_explicit(&channels[i].busy, true, memory_order_acquire)) {
+            *index = i;
+            return &channels[i];
+        }
+    }
+    return NULL;
+}
+
+// Programs and triggers the next block (at most MDMA_MAX_BLOCK bytes) of a request
+static void start_chunk(uint8_t index) {
+    copy_channel_t *ch = &channels[index];
+    bool fill = (ch->src == NULL);
+    const void *src = fill ? (const void *)&ch->pattern : (const void *)ch->src;
+    uint32_t size = (uint32_t)mdma_size_code(ch->width);
+
+    ch->chunk = (ch->remaining > MDMA_MAX_BLOCK) ? MDMA_MAX_BLOCK : ch->remaining;
+
+    // One software request moves the whole block, TLEN + 1 bytes at a time
+    uint32_t tcr = 0;
+    tcr |= ((fill ? MDMA_INC_FIXED : MDMA_INC_INCREMENT) << MDMA_MDMA_CxTCR_SINC.pos) & MDMA_MDMA_CxTCR_SINC.msk;
+    tcr |= (MDMA_INC_INCREMENT << MDMA_MDMA_CxTCR_DINC.pos) & MDMA_MDMA_CxTCR_DINC.msk;
+    tcr |= (size << MDMA_MDMA_CxTCR_SSIZE.pos) & MDMA_MDMA_CxTCR_SSIZE.msk;
+    tcr |= (size << MDMA_MDMA_CxTCR_DSIZE.pos) & MDMA_MDMA_CxTCR_DSIZE.msk;
+    tcr |= (size << MDMA_MDMA_CxTCR_SINCOS.pos) & MDMA_MDMA_CxTCR_SINCOS.msk;
+    tcr |= (size << MDMA_MDMA_CxTCR_DINCOS.pos) & MDMA_MDMA_CxTCR_DINCOS.msk;
+    tcr |= ((fill ? BURST_SINGLE : BURST_16) << MDMA_MDMA_CxTCR_SBURST.pos) & MDMA_MDMA_CxTCR_SBURST.msk;
+    tcr |= (BURST_16 << MDMA_MDMA_CxTCR_DBURST.pos) & MDMA_MDMA_CxTCR_DBURST.msk;
+    tcr |= ((MDMA_MAX_TLEN - 1) << MDMA_MDMA_CxTCR_TLEN.pos) & MDMA_MDMA_CxTCR_TLEN.msk;
+    tcr |= (MDMA_TRGM_BLOCK << MDMA_MDMA_CxTCR_TRGM.pos) & MDMA_MDMA_CxTCR_TRGM.msk;
+    tcr |= MDMA_MDMA_CxTCR_SWRM.msk | MDMA_MDMA_CxTCR_BWM.msk;
+    *MDMA_MDMA_CxTCR[index] = tcr;
+
+    *MDMA_MDMA_CxBNDTR[index] = (ch->chunk << MDMA_MDMA_CxBNDTR_BNDT.pos) & MDMA_MDMA_CxBNDTR_BNDT.msk;
+    *MDMA_MDMA_CxSAR[index] = (uint32_t)src;
+    *MDMA_MDMA_CxDAR[index] = (uint32_t)ch->dest;
+    *MDMA_MDMA_CxBRUR[index] = 0;
+    *MDMA_MDMA_CxLAR[index] = 0;
+
+    uint32_t tbr = 0;
+    tbr |= (mdma_bus(src) << MDMA_MDMA_CxTBR_SBUS.pos) & MDMA_MDMA_CxTBR_SBUS.msk;
+    tbr |= (mdma_bus(ch->dest) << MDMA_MDMA_CxTBR_DBUS.pos) & MDMA_MDMA_CxTBR_DBUS.msk;
+    *MDMA_MDMA_CxTBR[index] = tbr;
+
+    mdma_clear_flags(index, MDMA_FLAG_ALL);
+    *MDMA_MDMA_CxCR[index] = MDMA_MDMA_CxCR_TEIE.msk | MDMA_MDMA_CxCR_CTCIE.msk;
+    SET_FIELD(MDMA_MDMA_CxCR[index], MDMA_MDMA_CxCR_EN);
+    SET_FIELD(MDMA_MDMA_CxCR[index], MDMA_MDMA_CxCR_SWRQ);
+}
+
+static void finish(uint8_t index, bool success) {
+    copy_channel_t *ch = &channels[index];
+    dma_callback_t callback = ch->callback;
+    void *context = ch->context;
+
+    // Lines of the destination may have been fetched speculatively while the copy ran
+    dma_cache_invalidate(ch->dest_start, ch->size);
+
+    // Free the channel first so the callback can queue the next request
+    atomic_store_explicit(&ch->busy, false, memory_order_release);
+
+    dma_notify_complete(DMA_INSTANCE_MDMA, index, callback, success, context);
+}
+
+static int submit(void *dest, const void *src, uint8_t value, size_t size, dma_callback_t callback,
+                  void *context) {
+    if (size < threshold) {
+        if (src != NULL) {
+            memcpy(dest, src, size);
+        } else {
+            memset(dest, value, size);
+        }
+        if (callback != NULL) callback(true, context);
+        return TI_ERRC_NONE;
+    }
+
+    uint8_t index;
+    copy_channel_t *ch = claim_channel(&index);
+    if (ch == NULL) return TI_ERRC_BUSY;
+
+    // Word beats when everything is aligned, bytes otherwise
+    uintptr_t align = (uintptr_t)dest | (uintptr_t)src | size;
+    ch->width = ((align & 3U) == 0) ? 4 : 1;
+    ch->dest = dest;
+    ch->src = src;
+    ch->remaining = size;
+    ch->dest_start = dest;
+    ch->size = size;
+    ch->pattern = (uint32_t)value * 0x01010101U;
+    ch->callback = callback;
+    ch->context = context;
+
+    if (src != NULL) {
+        dma_cache_clean(src, size);
+    } else {
+        dma_cache_clean(&ch->pattern, sizeof(ch->pattern));
+    }
+    dma_cache_invalidate(dest, size);
+
+    start_chunk(index);
+
+    return TI_ERRC_NONE;
+}
+
+static void calibrate_callback(bool success, void *context) {
+    (void)success;
+    (void)context;
+    calibrate_done = true;
+}
+
+// Stops a calibration copy whose completion never came, and frees its channel
+static void abort_calibration(void) {
+    uint32_t primask = irq_save();
+    for (uint8_t i = 0; i < DMA_MEMCPY_CHANNELS; i++) {
+        copy_channel_t *ch = &channels[i];
+        if (atomic_load_explicit(&ch->busy, memory_order_acquire) && (ch->callback == calibrate_callback)) {
+            mdma_disable_channel(i);
+            finish(i, false);
+        }
+    }
+    irq_restore(primask);
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+
+void dma_memcpy_init(void) {
+    SET_FIELD(RCC_AHB3ENR, RCC_AHB3ENR_MDMAEN);
+
+    for (uint8_t i = 0; i < DMA_MEMCPY_CHANNELS; i++) {
+        mdma_disable_channel(i);
+        atomic_store_explicit(&channels[i].busy, false, memory_order_relaxed);
+    }
+}
+
+int dma_memcpy_async(void *dest, const void *src, size_t size, dma_callback_t callback,
+                     void *context) {
+    if ((dest == NULL) || (src == NULL) || (size == 0)) return TI_ERRC_INVALID_ARG;
+
+    uintptr_t d = (uintptr_t)dest;
+    uintptr_t s = (uintptr_t)src;
+    if ((d < s + size) && (s < d + size)) return TI_ERRC_INVALID_ARG;
+
+    return submit(dest, src, 0, size, callback, context);
+}
+
+int dma_memset_async(void *dest, uint8_t value, size_t size, dma_callback_t callback,
+                     void *context) {
+    if ((dest == NULL) || (size == 0)) return TI_ERRC_INVALID_ARG;
+
+    return submit(dest, NULL, value, size, callback, context);
+}
+
+bool dma_memcpy_busy(void) {
+    for (uint8_t i = 0; i < DMA_MEMCPY_CHANNELS; i++) {
+        if (atomic_load_explicit(&channels[i].busy, memory_order_acquire)) return true;
+    }
+    return false;
+}
+
+void dma_memcpy_set_threshold(size_t size) {
+    threshold = size;
+}
+
+int dma_memcpy_calibrate(void *scratch_a, void *scratch_b, size_t max_size, size_t *result) {
+    if ((scratch_a == NULL) || (scratch_b == NULL) || (max_size < CALIBRATE_MIN_SIZE)) return TI_ERRC_INVALID_ARG;
+
+    size_t previous = threshold;
+    size_t found = max_size;
+    int status = TI_ERRC_NONE;
+
+    // A deferred completion would wait for dma_dispatch_deferred(), which cannot run while the
+    // caller is blocked here, so the copy channels report from the ISR until the end
+    dma_dispatch_mode_t modes[DMA_MEMCPY_CHANNELS];
+    for (uint8_t i = 0; i < DMA_MEMCPY_CHANNELS; i++) {
+        modes[i] = dma_get_dispatch_mode(DMA_INSTANCE_MDMA, i);
+        dma_set_dispatch_mode(DMA_INSTANCE_MDMA, i, DMA_DISPATCH_ISR);
+    }
+
+    threshold = 0;
+    dwt_enable();
+
+    // Both sides are timed from the caller's point of view, so the MDMA figure includes the
+    // channel setup, the cache maintenance and the completion interrupt.
+    for (size_t size = CALIBRATE_MIN_SIZE; size <= max_size; size *= 2) {
+        uint32_t start = dwt_cycles();
+        memcpy(scratch_b, scratch_a, size);
+        uint32_t cpu = dwt_cycles() - start;
+
+        calibrate_done = false;
+        start = dwt_cycles();
+        status = dma_memcpy_async(scratch_b, scratch_a, size, calibrate_callback, NULL);
+        if (status != TI_ERRC_NONE) break;
+
+        while (!calibrate_done) {
+            if (dwt_cycles() - start >= CALIBRATE_TIMEOUT_CYCLES) {
+                abort_calibration();
+                status = TI_ERRC_TIMEOUT;
+                break;
+            }
+        }
+        if (status != TI_ERRC_NONE) break;
+        uint32_t mdma = dwt_cycles() - start;
+
+        if (mdma < cpu) {
+            found = size;
+            break;
+        }
+    }
+
+    for (uint8_t i = 0; i < DMA_MEMCPY_CHANNELS; i++) dma_set_dispatch_mode(DMA_INSTANCE_MDMA, i, modes[i]);
+
+    if (status != TI_ERRC_NONE) {
+        threshold = previous;
+        return status;
+    }
+
+    threshold = found;
+    if (result != NULL) *result = found;
+    return TI_ERRC_NONE;
+}
+
+void dma_memcpy_irq(void) {
+    for (uint8_t i = 0; i < DMA_MEMCPY_CHANNELS; i++) {
+        if (!mdma_pending(i)) continue;
+
+        uint32_t flags = mdma_read_flags(i);
+        mdma_clear_flags(i, flags);
+
+        copy_channel_t *ch = &channels[i];
+
+        if (flags & MDMA_FLAG_TE) {
+            mdma_disable_channel(i);
+            finish(i, false);
+        } else if (flags & MDMA_FLAG_CTC) {
+            ch->remaining -= ch->chunk;
+            ch->dest += ch->chunk;
+            if (ch->src != NULL) ch->src += ch->chunk;
+
+            if (ch->remaining > 0) {
+                start_chunk(i);
+            } else {
+                finish(i, true);
+            }
+        }
+    }
+}
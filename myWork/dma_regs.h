@@ -0,0 +1,95 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/include/mcu/dma_regs.h
+ * @authors Jude Merritt
+ * @brief Register helpers shared by the DMA1/DMA2 stream modules. Not a public interface.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "include/mmio.h"
+#include "include/dma.h"
+
+/**************************************************************************************************
+ * @section Macros
+ **************************************************************************************************/
+
+// Per-stream interrupt flags, normalized to the layout of stream 0 in LISR/LIFCR
+#define DMA_FLAG_FE  0x01U // FIFO error
+#define DMA_FLAG_DME 0x04U // Direct mode error
+#define DMA_FLAG_TE  0x08U // Transfer error
+#define DMA_FLAG_HT  0x10U // Half transfer
+#define DMA_FLAG_TC  0x20U // Transfer complete
+#define DMA_FLAG_ALL (DMA_FLAG_FE | DMA_FLAG_DME | DMA_FLAG_TE | DMA_FLAG_HT | DMA_FLAG_TC)
+
+#define DMA_STREAM_DISABLE_TIMEOUT 100000U
+
+/**************************************************************************************************
+ * @section Register Helpers
+ **************************************************************************************************/
+
+// mmio.h only has one SxCR array per stream, so index them by stream here
+static rw_reg32_t const *const dma_sxcr_table[DMA_STREAM_COUNT] = {
+    DMAx_S0CR, DMAx_S1CR, DMAx_S2CR, DMAx_S3CR,
+    DMAx_S4CR, DMAx_S5CR, DMAx_S6CR, DMAx_S7CR,
+};
+
+// Bit offset of each stream's flag group within LISR/HISR (streams 4-7 mirror 0-3 in HISR)
+static const uint8_t dma_flag_offset[4] = {0, 6, 16, 22};
+
+static inline rw_reg32_t dma_sxcr(uint8_t instance, uint8_t stream) {
+    return dma_sxcr_table[stream][instance];
+}
+
+// DMAMUX1 channels 0-7 feed DMA1 streams 0-7, channels 8-15 feed DMA2 streams 0-7
+static inline rw_reg32_t dma_mux_channel(uint8_t instance, uint8_t stream) {
+    return DMAMUX1_CxCR[(instance - 1) * DMA_STREAM_COUNT + stream];
+}
+
+static inline uint32_t dma_read_flags(uint8_t instance, uint8_t stream) {
+    ro_reg32_t isr = (stream < 4) ? DMAx_LISR[instance] : DMAx_HISR[instance];
+    return (*isr >> dma_flag_offset[stream & 3]) & DMA_FLAG_ALL;
+}
+
+static inline void dma_clear_flags(uint8_t instance, uint8_t stream, uint32_t flags) {
+    rw_reg32_t ifcr = (stream < 4) ? DMAx_LIFCR[instance] : DMAx_HIFCR[instance];
+    *ifcr = (flags & DMA_FLAG_ALL) << dma_flag_offset[stream & 3];
+}
+
+// Disables a stream and waits for any ongoing beat to finish, as required before reprogramming
+static inline bool dma_disable_stream(uint8_t instance, uint8_t stream) {
+    uint32_t count = 0;
+
+    CLR_FIELD(dma_sxcr(instance, stream), DMAx_SxCR_EN);
+    while (READ_FIELD(dma_sxcr(instance, stream), DMAx_SxCR_EN)) {
+        if (count++ >= DMA_STREAM_DISABLE_TIMEOUT) return false;
+    }
+
+    dma_clear_flags(instance, stream, DMA_FLAG_ALL);
+    return true;
+}
+
+// Maps a data size in bytes (1, 2 or 4) to the PSIZE/MSIZE encoding, or -1 if invalid
+static inline int dma_size_code(uint8_t bytes) {
+    switch (bytes) {
+        case 1: return 0;
+        case 2: return 1;
+        case 4: return 2;
+        default: return -1;
+    }
+}
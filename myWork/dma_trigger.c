@@ -0,0 +1,114 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/src/dma_trigger.c
+ * @authors Jude Merritt
+ * @brief Timer/EXTI triggered DMA transfers through the DMAMUX request generators
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "include/mmio.h"
+#include "include/errc.h"
+#include "include/dma.h"
+
+#define DMAMUX_COUNT 2
+#define MAX_SIGNAL_ID 0x1FU
+
+#define IS_VALID_INSTANCE(instance) \
+    (((instance) >= 1) && (((instance) <= DMA_INSTANCE_COUNT) || ((instance) == DMA_INSTANCE_BDMA)))
+
+static uint32_t overruns[DMAMUX_COUNT + 1][DMA_TRIGGER_GENERATOR_COUNT];
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+
+// DMA1/DMA2 sit behind DMAMUX1, the BDMA behind DMAMUX2
+static inline uint8_t mux_of(uint8_t instance) {
+    return (instance == DMA_INSTANCE_BDMA) ? 2 : 1;
+}
+
+// Request line of a generator on its own DMAMUX (dmamuxX_req_gen0 is request 1)
+static inline uint32_t generator_request(uint8_t generator) {
+    return (uint32_t)generator + 1;
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+
+int dma_trigger_bind(dma_transfer_t *dma_transfer, const dma_trigger_config_t *config) {
+    if ((dma_transfer == NULL) || (config == NULL)) return TI_ERRC_INVALID_ARG;
+    if (!IS_VALID_INSTANCE(dma_transfer->instance)) return TI_ERRC_INVALID_ARG;
+    if (config->generator >= DMA_TRIGGER_GENERATOR_COUNT) return TI_ERRC_INVALID_ARG;
+    if (config->signal_id > MAX_SIGNAL_ID) return TI_ERRC_INVALID_ARG;
+    if ((config->edge < DMA_TRIGGER_RISING) || (config->edge > DMA_TRIGGER_BOTH)) return TI_ERRC_INVALID_ARG;
+    if ((config->requests == 0) || (config->requests > DMA_TRIGGER_MAX_REQUESTS)) return TI_ERRC_INVALID_ARG;
+
+    uint8_t mux = mux_of(dma_transfer->instance);
+    rw_reg32_t rgcr = DMAMUXx_RGxCR[mux][config->generator];
+
+    // GNBREQ and GPOL may only change while the generator is disabled
+    if (READ_FIELD(rgcr, DMAMUXx_RGxCR_GE)) return TI_ERRC_BUSY;
+
+    uint32_t val = 0;
+    val |= ((uint32_t)config->signal_id << DMAMUXx_RGxCR_SIG_ID.pos) & DMAMUXx_RGxCR_SIG_ID.msk;
+    val |= ((uint32_t)config->edge << DMAMUXx_RGxCR_GPOL.pos) & DMAMUXx_RGxCR_GPOL.msk;
+    val |= ((uint32_t)(config->requests - 1) << DMAMUXx_RGxCR_GNBREQ.pos) & DMAMUXx_RGxCR_GNBREQ.msk;
+    val |= DMAMUXx_RGxCR_OIE.msk;
+    *rgcr = val;
+
+    *DMAMUXx_RGCFR[mux] = 1U << config->generator;
+    overruns[mux][config->generator] = 0;
+
+    dma_transfer->request_id = generator_request(config->generator);
+
+    return TI_ERRC_NONE;
+}
+
+int dma_trigger_enable(uint8_t instance, uint8_t generator) {
+    if (!IS_VALID_INSTANCE(instance) || (generator >= DMA_TRIGGER_GENERATOR_COUNT)) return TI_ERRC_INVALID_ARG;
+
+    SET_FIELD(DMAMUXx_RGxCR[mux_of(instance)][generator], DMAMUXx_RGxCR_GE);
+
+    return TI_ERRC_NONE;
+}
+
+int dma_trigger_disable(uint8_t instance, uint8_t generator) {
+    if (!IS_VALID_INSTANCE(instance) || (generator >= DMA_TRIGGER_GENERATOR_COUNT)) return TI_ERRC_INVALID_ARG;
+
+    CLR_FIELD(DMAMUXx_RGxCR[mux_of(instance)][generator], DMAMUXx_RGxCR_GE);
+
+    return TI_ERRC_NONE;
+}
+
+uint32_t dma_trigger_get_overruns(uint8_t instance, uint8_t generator) {
+    if (!IS_VALID_INSTANCE(instance) || (generator >= DMA_TRIGGER_GENERATOR_COUNT)) return 0;
+    return overruns[mux_of(instance)][generator];
+}
+
+void dma_trigger_irq(uint8_t instance) {
+    if (!IS_VALID_INSTANCE(instance)) return;
+
+    uint8_t mux = mux_of(instance);
+    uint32_t flags = READ_FIELD(DMAMUXx_RGSR[mux], DMAMUXx_RGSR_OF);
+    *DMAMUXx_RGCFR[mux] = flags;
+
+    for (uint8_t i = 0; i < DMA_TRIGGER_GENERATOR_COUNT; i++) {
+        if (flags & (1U << i)) overruns[mux][i]++;
+    }
+}
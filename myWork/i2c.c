@@ -0,0 +1,1017 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/src/i2c.c
+ * @authors Jude Merritt
+ * @brief I2C master driver with register (write-then-read) transactions
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "include/mmio.h"
+#include "include/errc.h"
+#include "include/dma.h"
+#include "include/i2c.h"
+#include "myWork/dma_regs.h"
+#include "myWork/cpu.h"
+#include "gpio.h"
+
+#define I2C_DEFAULT_AF 4
+#define I2C_MAX_NBYTES 255U          // NBYTES is 8 bits, longer transfers use RELOAD
+#define I2C_MAX_SIZE 0xFFFFU         // Limited by the DMA item counter
+#define I2C_DEFAULT_TIMEOUT 100000U
+#define I2C_DMA_PRIORITY 1
+#define I2C_BDMA_INSTANCE 4          // I2C4 sits in D3 and is served by the BDMA
+#define I2C_TIMEOUT_CLOCKS 2048U     // Kernel clocks per TIMEOUTA step (TIDLE = 0)
+#define I2C_TIMEOUTA_MAX 0xFFFU
+
+// DMA request lines (rx, tx): DMAMUX1 for I2C1-3, DMAMUX2 for I2C4
+static const uint8_t i2c_rx_request[I2C_INSTANCE_COUNT + 1] = {0, 33, 35, 73, 13};
+static const uint8_t i2c_tx_request[I2C_INSTANCE_COUNT + 1] = {0, 34, 36, 74, 14};
+
+// TIMINGR solver
+#define I2C_ANALOG_FILTER_MIN_PS 50000LL   // Analog filter delay (tAF) bounds
+#define I2C_ANALOG_FILTER_MAX_PS 260000LL
+#define I2C_MIN_SPEED_PERCENT 80           // Slowest SCL accepted for a target speed
+#define PS_PER_S 1000000000000LL
+
+// I2C specification limits of each mode, in ns
+typedef struct {
+    uint32_t speed;
+    uint32_t hddat_min; // Data hold time
+    uint32_t vddat_max; // Data valid time
+    uint32_t sudat_min; // Data setup time
+    uint32_t low_min;   // SCL low period
+    uint32_t high_min;  // SCL high period
+} i2c_spec_t;
+
+static const i2c_spec_t i2c_specs[] = {
+    {I2C_SPEED_STANDARD,  0, 3450, 250, 4700, 4000},
+    {I2C_SPEED_FAST,      0,  900, 100, 1300,  600},
+    {I2C_SPEED_FAST_PLUS, 0,  450,  50,  500,  260},
+};
+
+#define QUEUE_MASK (I2C_QUEUE_DEPTH - 1)
+
+_Static_assert((I2C_QUEUE_DEPTH & QUEUE_MASK) == 0, "I2C_QUEUE_DEPTH must be a power of two");
+
+// Parts of an async transaction that still have to finish before the callback
+#define PENDING_STOP 0x1U
+#define PENDING_DMA  0x2U
+
+// The DMA callback context carries the instance and the generation of the transaction it was
+// started for. A completion that was queued for deferred dispatch (see dma_set_dispatch_mode())
+// can arrive after i2c_abort() has finished that transaction, and must not finish the next one.
+#define DMA_CONTEXT(instance, generation) ((void *)(((uintptr_t)(generation) << 3) | (instance)))
+#define DMA_CONTEXT_INSTANCE(context)     ((uint8_t)((uintptr_t)(context) & 0x7U))
+#define DMA_CONTEXT_GENERATION(context)   ((uint8_t)((uintptr_t)(context) >> 3))
+
+_Static_assert(I2C_INSTANCE_COUNT < 8, "the instance must fit in the low 3 bits of the DMA context");
+
+typedef struct {
+    uint16_t addr;
+    uint8_t mem[2];     // Register address, MSB first
+    uint8_t mem_size;
+    uint8_t mem_sent;
+    bool read;
+    uint8_t *data;
+    size_t size;
+    size_t remaining;   // Bytes of the current phase not yet covered by NBYTES
+    uint8_t pending;
+    uint8_t generation; // Advanced by every transaction started
+    int status;
+    i2c_callback_t callback;
+    void *context;
+} i2c_xfer_t;
+
+// Bus recovery steps, advanced by i2c_service()
+typedef enum {
+    RECOVERY_NONE,
+    RECOVERY_START,  // Take SCL/SDA over as GPIOs
+    RECOVERY_CLOCK,  // Pulse SCL until SDA is released
+    RECOVERY_STOP,   // Generate a STOP
+    RECOVERY_REINIT, // Reset and reprogram the peripheral
+} i2c_recovery_t;
+
+typedef struct {
+    uint8_t instance;
+    bool ready;
+    i2c_config_t config;
+    enum i2c_addr_mode_t addr_mode;
+    uint32_t timeout;
+    i2c_callback_t callback; // Of direct async calls
+    void *context;
+    dma_stream_t tx_stream;
+    dma_stream_t rx_stream;
+    volatile bool busy;
+    i2c_xfer_t xfer;
+    i2c_request_t queue[I2C_QUEUE_DEPTH];
+    uint32_t queue_head;  // Next slot written by i2c_submit()
+    uint32_t queue_tail;  // Next request started
+    volatile i2c_recovery_t recovery;
+    uint8_t recovery_step;
+    uint8_t busy_rejections; // Async starts refused in a row because of BUSY
+    i2c_stats_t stats;
+} i2c_state_t;
+
+static i2c_state_t i2c_states[I2C_INSTANCE_COUNT + 1] = {0};
+
+/**************************************************************************************************
+ * @section Private Helper Functions
+ **************************************************************************************************/
+
+static inline bool i2c_is_bdma(uint8_t instance) {
+    return instance == I2C_BDMA_INSTANCE;
+}
+
+static void i2c_clear_flags(uint8_t instance) {
+    SET_WOFIELD(I2Cx_ICR[instance], I2Cx_ICR_NACKCF);
+    SET_WOFIELD(I2Cx_ICR[instance], I2Cx_ICR_STOPCF);
+    SET_WOFIELD(I2Cx_ICR[instance], I2Cx_ICR_BERRCF);
+    SET_WOFIELD(I2Cx_ICR[instance], I2Cx_ICR_ARLOCF);
+    SET_WOFIELD(I2Cx_ICR[instance], I2Cx_ICR_OVRCF);
+    SET_WOFIELD(I2Cx_ICR[instance], I2Cx_ICR_TIMOUTCF);
+}
+
+static void i2c_pins_af(const i2c_config_t *config) {
+    uint8_t af = (config->alt_func != 0) ? config->alt_func : I2C_DEFAULT_AF;
+    tal_set_mode(config->scl_pin, 2);
+    tal_set_mode(config->sda_pin, 2);
+    tal_alternate_mode(config->scl_pin, af);
+    tal_alternate_mode(config->sda_pin, af);
+}
+
+// Programs filters, timing and the SCL low timeout, which can only be changed with PE cleared
+static void i2c_configure(uint8_t instance) {
+    const i2c_config_t *config = &i2c_states[instance].config;
+
+    // Fast mode plus needs the stronger output drive on the instance's pins
+    SET_FIELD(RCC_APB4ENR, RCC_APB4ENR_SYSCFGEN);
+    WRITE_FIELD(SYSCFG_PMCR, SYSCFG_PMCR_I2CxFMP[instance], config->fast_mode_plus);
+
+    CLR_FIELD(I2Cx_CR1[instance], I2Cx_CR1_PE);
+    WRITE_FIELD(I2Cx_CR1[instance], I2Cx_CR1_ANFOFF, !config->analog_filter);
+    WRITE_FIELD(I2Cx_CR1[instance], I2Cx_CR1_DNF, config->digital_filter);
+    *I2Cx_TIMINGR[instance] = (uint32_t)config->timing;
+
+    // TIMEOUTA counts SCL low time in steps of 2048 kernel clocks and raises TIMEOUT (ERRIE)
+    CLR_FIELD(I2Cx_TIMEOUTR[instance], I2Cx_TIMEOUTR_TIMOUTEN);
+    if (config->clk_freq != 0) {
+        uint32_t timeout_us = (config->bus_timeout_us != 0) ? config->bus_timeout_us
+                                                            : I2C_DEFAULT_BUS_TIMEOUT_US;
+        uint64_t steps = ((uint64_t)timeout_us * config->clk_freq + 1000000ULL * I2C_TIMEOUT_CLOCKS - 1) /
+                         (1000000ULL * I2C_TIMEOUT_CLOCKS);
+        if (steps > I2C_TIMEOUTA_MAX + 1) steps = I2C_TIMEOUTA_MAX + 1;
+        if (steps == 0) steps = 1;
+        WRITE_FIELD(I2Cx_TIMEOUTR[instance], I2Cx_TIMEOUTR_TIMEOUTA, (uint32_t)(steps - 1));
+        CLR_FIELD(I2Cx_TIMEOUTR[instance], I2Cx_TIMEOUTR_TIDLE);
+        SET_FIELD(I2Cx_TIMEOUTR[instance], I2Cx_TIMEOUTR_TIMOUTEN);
+    }
+
+    SET_FIELD(I2Cx_CR1[instance], I2Cx_CR1_PE);
+}
+
+static void i2c_reset_peripheral(uint8_t instance) {
+    if (i2c_is_bdma(instance)) {
+        SET_FIELD(RCC_APB4RSTR, RCC_APB4RSTR_I2C4RST);
+        CLR_FIELD(RCC_APB4RSTR, RCC_APB4RSTR_I2C4RST);
+    } else {
+        SET_FIELD(RCC_APB1LRSTR, RCC_APB1LRSTR_I2CxRST[instance]);
+        CLR_FIELD(RCC_APB1LRSTR, RCC_APB1LRSTR_I2CxRST[instance]);
+    }
+}
+
+/**
+ * Takes the bus out of service. The peripheral is disabled so it lets go of SCL/SDA, and the
+ * instance stays claimed until i2c_service() has finished the recovery.
+ */
+static void i2c_begin_recovery(i2c_state_t *state) {
+    CLR_FIELD(I2Cx_CR1[state->instance], I2Cx_CR1_PE);
+    state->recovery_step = 0;
+    state->busy_rejections = 0;
+    state->recovery = RECOVERY_START;
+}
+
+// Checks for the faults that need a bus recovery, counts them and starts the recovery
+static int i2c_check_fault(i2c_state_t *state) {
+    uint8_t instance = state->instance;
+    int status = TI_ERRC_NONE;
+
+    if (READ_FIELD(I2Cx_ISR[instance], I2Cx_ISR_TIMEOUT)) {
+        state->stats.timeouts++;
+        status = TI_ERRC_TIMEOUT;
+    }
+    if (READ_FIELD(I2Cx_ISR[instance], I2Cx_ISR_BERR)) {
+        state->stats.bus_errors++;
+        if (status == TI_ERRC_NONE) status = TI_ERRC_INTERNAL;
+    }
+    if (READ_FIELD(I2Cx_ISR[instance], I2Cx_ISR_ARLO)) {
+        state->stats.arbitration_lost++;
+        if (status == TI_ERRC_NONE) status = TI_ERRC_INTERNAL;
+    }
+
+    if (status != TI_ERRC_NONE) {
+        i2c_clear_flags(instance);
+        i2c_begin_recovery(state);
+    }
+    return status;
+}
+
+/**
+ * Programs CR2 for the next phase and sends a START (a repeated START if the previous phase
+ * ended with TC). Returns the number of bytes covered by this NBYTES, the rest is sent with
+ * RELOAD. AUTOEND is ignored while RELOAD is set, so it can stay as requested throughout.
+ */
+static size_t i2c_start(uint8_t instance, uint16_t addr, bool read, size_t size, bool autoend) {
+    size_t nbytes = (size > I2C_MAX_NBYTES) ? I2C_MAX_NBYTES : size;
+
+    if (i2c_states[instance].addr_mode == I2C_ADDR_10BIT) {
+        WRITE_FIELD(I2Cx_CR2[instance], I2Cx_CR2_SADD_10BIT, addr);
+        SET_FIELD(I2Cx_CR2[instance], I2Cx_CR2_ADD10);
+    } else {
+        WRITE_FIELD(I2Cx_CR2[instance], I2Cx_CR2_SADD_10BIT, (uint32_t)addr << 1);
+        CLR_FIELD(I2Cx_CR2[instance], I2Cx_CR2_ADD10);
+    }
+    WRITE_FIELD(I2Cx_CR2[instance], I2Cx_CR2_RD_WRN, read);
+    WRITE_FIELD(I2Cx_CR2[instance], I2Cx_CR2_RELOAD, size > nbytes);
+    WRITE_FIELD(I2Cx_CR2[instance], I2Cx_CR2_AUTOEND, autoend);
+    WRITE_FIELD(I2Cx_CR2[instance], I2Cx_CR2_NBYTES, nbytes);
+    SET_FIELD(I2Cx_CR2[instance], I2Cx_CR2_START);
+
+    return nbytes;
+}
+
+// Continues a transfer after TCR. RELOAD goes first, writing NBYTES releases SCL.
+static size_t i2c_reload(uint8_t instance, size_t size) {
+    size_t nbytes = (size > I2C_MAX_NBYTES) ? I2C_MAX_NBYTES : size;
+
+    WRITE_FIELD(I2Cx_CR2[instance], I2Cx_CR2_RELOAD, size > nbytes);
+    WRITE_FIELD(I2Cx_CR2[instance], I2Cx_CR2_NBYTES, nbytes);
+
+    return nbytes;
+}
+
+static int i2c_wait_idle(uint8_t instance) {
+    i2c_state_t *state = &i2c_states[instance];
+    uint32_t count = 0;
+
+    while (READ_FIELD(I2Cx_ISR[instance], I2Cx_ISR_BUSY)) {
+        if (count++ >= state->timeout) {
+            state->stats.timeouts++;
+            i2c_begin_recovery(state);
+            return TI_ERRC_TIMEOUT;
+        }
+    }
+    return TI_ERRC_NONE;
+}
+
+/**
+ * Waits for a flag while watching for NACK and bus errors. A NACK ends the transaction: the
+ * STOP is sent by hardware with AUTOEND, otherwise by us, and TXDR is flushed of the byte that
+ * was not taken.
+ */
+static int i2c_wait_flag(uint8_t instance, field32_t flag) {
+    i2c_state_t *state = &i2c_states[instance];
+    uint32_t count = 0;
+
+    while (!READ_FIELD(I2Cx_ISR[instance], flag)) {
+        if (READ_FIELD(I2Cx_ISR[instance], I2Cx_ISR_NACKF)) {
+            if (!READ_FIELD(I2Cx_CR2[instance], I2Cx_CR2_AUTOEND)) {
+                SET_FIELD(I2Cx_CR2[instance], I2Cx_CR2_STOP);
+            }
+            state->stats.nacks++;
+            count = 0;
+            while (!READ_FIELD(I2Cx_ISR[instance], I2Cx_ISR_STOPF)) {
+                if (count++ >= state->timeout) break;
+            }
+            i2c_clear_flags(instance);
+            SET_FIELD(I2Cx_ISR[instance], I2Cx_ISR_TXE);
+            return TI_ERRC_INVALID_STATE;
+        }
+
+        int fault = i2c_check_fault(state);
+        if (fault != TI_ERRC_NONE) return fault;
+
+        if (count++ >= state->timeout) {
+            state->stats.timeouts++;
+            i2c_begin_recovery(state);
+            return TI_ERRC_TIMEOUT;
+        }
+    }
+
+    return TI_ERRC_NONE;
+}
+
+static int i2c_check_args(uint8_t instance, uint16_t addr, uint8_t mem_size, const uint8_t *data,
+                          size_t size) {
+    if ((instance < 1) || (instance > I2C_INSTANCE_COUNT)) return TI_ERRC_INVALID_ARG;
+    if (!i2c_states[instance].ready) return TI_ERRC_INVALID_STATE;
+    if ((data == NULL) || (size == 0) || (size > I2C_MAX_SIZE)) return TI_ERRC_INVALID_ARG;
+    if ((mem_size != 0) && (mem_size != I2C_MEM_ADDR_8BIT) && (mem_size != I2C_MEM_ADDR_16BIT)) {
+        return TI_ERRC_INVALID_ARG;
+    }
+    bool ten_bit = (i2c_states[instance].addr_mode == I2C_ADDR_10BIT);
+    if (addr > (ten_bit ? 0x3FFU : 0x7FU)) return TI_ERRC_INVALID_ARG;
+    return TI_ERRC_NONE;
+}
+
+static bool i2c_claim(uint8_t instance) {
+    uint32_t primask = irq_save();
+    bool claimed = !i2c_states[instance].busy;
+    i2c_states[instance].busy = true;
+    irq_restore(primask);
+    return claimed;
+}
+
+static bool i2c_dma_accessible(uint8_t instance, const uint8_t *data, size_t size) {
+    if (i2c_is_bdma(instance)) return bdma_mem_is_accessible(data, size);
+    return dma_mem_is_accessible(data, size);
+}
+
+static void i2c_encode_mem(uint16_t mem_addr, uint8_t mem_size, uint8_t *mem) {
+    if (mem_size == I2C_MEM_ADDR_16BIT) {
+        mem[0] = (uint8_t)(mem_addr >> 8);
+        mem[1] = (uint8_t)mem_addr;
+    } else {
+        mem[0] = (uint8_t)mem_addr;
+    }
+}
+
+/**
+ * Blocking transaction. With mem_size > 0 a read first writes the register address without a
+ * STOP and turns the bus around with a repeated START, and a write sends the register address
+ * and data as one stream of bytes.
+ */
+static int i2c_transfer_blocking(uint8_t instance, uint16_t addr, const uint8_t *mem,
+                                 uint8_t mem_size, bool read, uint8_t *data, size_t size) {
+    int status = i2c_wait_idle(instance);
+    if (status != TI_ERRC_NONE) return status;
+
+    if (read) {
+        if (mem_size > 0) {
+            i2c_start(instance, addr, false, mem_size, false);
+            for (uint8_t i = 0; i < mem_size; i++) {
+                status = i2c_wait_flag(instance, I2Cx_ISR_TXIS);
+                if (status != TI_ERRC_NONE) return status;
+                *I2Cx_TXDR[instance] = mem[i];
+            }
+            status = i2c_wait_flag(instance, I2Cx_ISR_TC);
+            if (status != TI_ERRC_NONE) return status;
+        }
+
+        size_t chunk = i2c_start(instance, addr, true, size, true);
+        for (size_t i = 0; i < size; i++) {
+            if (chunk == 0) {
+                status = i2c_wait_flag(instance, I2Cx_ISR_TCR);
+                if (status != TI_ERRC_NONE) return status;
+                chunk = i2c_reload(instance, size - i);
+            }
+            status = i2c_wait_flag(instance, I2Cx_ISR_RXNE);
+            if (status != TI_ERRC_NONE) return status;
+            data[i] = (uint8_t)*I2Cx_RXDR[instance];
+            chunk--;
+        }
+    } else {
+        size_t total = mem_size + size;
+        size_t chunk = i2c_start(instance, addr, false, total, true);
+        for (size_t i = 0; i < total; i++) {
+            if (chunk == 0) {
+                status = i2c_wait_flag(instance, I2Cx_ISR_TCR);
+                if (status != TI_ERRC_NONE) return status;
+                chunk = i2c_reload(instance, total - i);
+            }
+            status = i2c_wait_flag(instance, I2Cx_ISR_TXIS);
+            if (status != TI_ERRC_NONE) return status;
+            *I2Cx_TXDR[instance] = (i < mem_size) ? mem[i] : data[i - mem_size];
+            chunk--;
+        }
+    }
+
+    status = i2c_wait_flag(instance, I2Cx_ISR_STOPF);
+    SET_WOFIELD(I2Cx_ICR[instance], I2Cx_ICR_STOPCF);
+    return status;
+}
+
+static int i2c_begin_async(uint8_t instance, uint16_t addr, const uint8_t *mem, uint8_t mem_size,
+                           bool read, uint8_t *data, size_t size, i2c_callback_t callback,
+                           void *context);
+
+static int i2c_begin_request(i2c_state_t *state, const i2c_request_t *request) {
+    uint8_t mem[2];
+    bool mem_op = (request->op == I2C_OP_MEM_READ) || (request->op == I2C_OP_MEM_WRITE);
+    bool read = (request->op == I2C_OP_READ) || (request->op == I2C_OP_MEM_READ);
+    uint8_t mem_size = mem_op ? request->mem_addr_size : 0;
+
+    i2c_encode_mem(request->mem_addr, mem_size, mem);
+    return i2c_begin_async(state->instance, request->addr, mem, mem_size, read, request->data,
+                           request->size, request->callback, request->context);
+}
+
+/**
+ * Hands the instance to the next queued request, or marks it idle. Requests that cannot be
+ * started are failed through their callback so the rest of the queue keeps moving.
+ */
+static void i2c_release(i2c_state_t *state) {
+    for (;;) {
+        uint32_t primask = irq_save();
+        if (state->recovery != RECOVERY_NONE) {
+            // Stays claimed, i2c_service() releases it once the bus is back
+            irq_restore(primask);
+            return;
+        }
+        if (state->queue_tail == state->queue_head) {
+            state->busy = false;
+            irq_restore(primask);
+            return;
+        }
+        i2c_request_t request = state->queue[state->queue_tail & QUEUE_MASK];
+        state->queue_tail++;
+        irq_restore(primask);
+
+        if (i2c_begin_request(state, &request) == TI_ERRC_NONE) return;
+        if (request.callback != NULL) request.callback(false, request.context);
+    }
+}
+
+static void i2c_finish(i2c_state_t *state) {
+    uint8_t instance = state->instance;
+
+    CLR_FIELD(I2Cx_CR1[instance], I2Cx_CR1_TXIE);
+    CLR_FIELD(I2Cx_CR1[instance], I2Cx_CR1_NACKIE);
+    CLR_FIELD(I2Cx_CR1[instance], I2Cx_CR1_STOPIE);
+    CLR_FIELD(I2Cx_CR1[instance], I2Cx_CR1_TCIE);
+    CLR_FIELD(I2Cx_CR1[instance], I2Cx_CR1_ERRIE);
+    CLR_FIELD(I2Cx_CR1[instance], I2Cx_CR1_TXDMAEN);
+    CLR_FIELD(I2Cx_CR1[instance], I2Cx_CR1_RXDMAEN);
+
+    if (state->xfer.read) dma_cache_invalidate(state->xfer.data, state->xfer.size);
+
+    // The callback runs before the next request starts, so completions stay in order
+    bool success = (state->xfer.status == TI_ERRC_NONE);
+    if (state->xfer.callback != NULL) state->xfer.callback(success, state->xfer.context);
+    i2c_release(state);
+}
+
+// The STOP interrupt and the DMA completion can race, whichever comes last finishes
+static void i2c_complete(i2c_state_t *state, uint8_t part) {
+    uint32_t primask = irq_save();
+    bool active = (state->xfer.pending != 0);
+    state->xfer.pending &= (uint8_t)~part;
+    bool last = active && (state->xfer.pending == 0);
+    irq_restore(primask);
+
+    if (last) i2c_finish(state);
+}
+
+static void i2c_abort(i2c_state_t *state, int status) {
+    state->xfer.status = status;
+    dma_stream_t stream = state->xfer.read ? state->rx_stream : state->tx_stream;
+    if (i2c_is_bdma(state->instance)) {
+        bdma_stop_transfer(stream.stream);
+    } else {
+        dma_disable_stream(stream.instance, stream.stream);
+    }
+    i2c_complete(state, PENDING_DMA);
+}
+
+static void i2c_dma_done(bool success, void *context) {
+    i2c_state_t *state = &i2c_states[DMA_CONTEXT_INSTANCE(context)];
+    if ((state->xfer.pending & PENDING_DMA) == 0) return;
+    if (DMA_CONTEXT_GENERATION(context) != state->xfer.generation) return;
+
+    if (!success && (state->xfer.status == TI_ERRC_NONE)) state->xfer.status = TI_ERRC_INTERNAL;
+    i2c_complete(state, PENDING_DMA);
+}
+
+static int i2c_start_dma(uint8_t instance, bool read, uint8_t *data, size_t size) {
+    i2c_state_t *state = &i2c_states[instance];
+    dma_stream_t stream = read ? state->rx_stream : state->tx_stream;
+    dma_transfer_t transfer = {
+        .instance = stream.instance,
+        .stream = stream.stream,
+        .request_id = read ? i2c_rx_request[instance] : i2c_tx_request[instance],
+        .direction = read ? PERIPH_TO_MEM : MEM_TO_PERIPH,
+        .src_data_size = 1,
+        .dest_data_size = 1,
+        .priority = I2C_DMA_PRIORITY,
+        .fifo_enabled = false,
+        .callback = i2c_dma_done,
+        .src = read ? (const void *)I2Cx_RXDR[instance] : (const void *)data,
+        .dest = read ? (void *)data : (void *)I2Cx_TXDR[instance],
+        .size = size,
+        .context = DMA_CONTEXT(instance, state->xfer.generation),
+        .mode = DMA_MODE_NORMAL,
+    };
+
+    if (read) {
+        dma_cache_invalidate(data, size);
+    } else {
+        dma_cache_clean(data, size);
+    }
+
+    if (i2c_is_bdma(instance)) return bdma_start_transfer(&transfer);
+    return dma_start_transfer(&transfer);
+}
+
+/**
+ * Async transaction on a claimed instance. The data phase is on DMA, and the DMA requests only
+ * flow once TXDMAEN/RXDMAEN is set, so the stream is started up front. The (at most two)
+ * register address bytes are written from the TXIS interrupt, then the interrupt hands TXDR over
+ * to the DMA for a write, or waits for TC and sends the repeated START for a read.
+ */
+static int i2c_begin_async(uint8_t instance, uint16_t addr, const uint8_t *mem, uint8_t mem_size,
+                           bool read, uint8_t *data, size_t size, i2c_callback_t callback,
+                           void *context) {
+    i2c_state_t *state = &i2c_states[instance];
+    i2c_xfer_t *xfer = &state->xfer;
+
+    if (READ_FIELD(I2Cx_ISR[instance], I2Cx_ISR_BUSY)) {
+        // A bus held since the last transaction shows up as a TIMEOUT flag with no interrupt.
+        // SDA held low with SCL high never trips TIMEOUTR, so a BUSY that outlasts a few starts
+        // is recovered as well.
+        if ((i2c_check_fault(state) == TI_ERRC_NONE) &&
+            (++state->busy_rejections >= I2C_BUSY_REJECTIONS)) {
+            state->stats.timeouts++;
+            i2c_begin_recovery(state);
+        }
+        return TI_ERRC_BUSY;
+    }
+    state->busy_rejections = 0;
+
+    xfer->addr = addr;
+    xfer->mem_size = mem_size;
+    xfer->mem_sent = 0;
+    for (uint8_t i = 0; i < mem_size; i++) xfer->mem[i] = mem[i];
+    xfer->read = read;
+    xfer->data = data;
+    xfer->size = size;
+    xfer->status = TI_ERRC_NONE;
+    xfer->callback = callback;
+    xfer->context = context;
+    xfer->pending = PENDING_STOP | PENDING_DMA;
+    xfer->generation++;
+
+    int status = i2c_start_dma(instance, read, data, size);
+    if (status != TI_ERRC_NONE) {
+        xfer->pending = 0;
+        return status;
+    }
+
+    i2c_clear_flags(instance);
+    SET_FIELD(I2Cx_CR1[instance], I2Cx_CR1_NACKIE);
+    SET_FIELD(I2Cx_CR1[instance], I2Cx_CR1_STOPIE);
+    SET_FIELD(I2Cx_CR1[instance], I2Cx_CR1_TCIE);
+    SET_FIELD(I2Cx_CR1[instance], I2Cx_CR1_ERRIE);
+
+    if (mem_size > 0) {
+        // Register address first. A write keeps going into the data in the same transfer.
+        size_t total = read ? mem_size : mem_size + size;
+        xfer->remaining = total - i2c_start(instance, addr, false, total, !read);
+        SET_FIELD(I2Cx_CR1[instance], I2Cx_CR1_TXIE);
+    } else if (read) {
+        SET_FIELD(I2Cx_CR1[instance], I2Cx_CR1_RXDMAEN);
+        xfer->remaining = size - i2c_start(instance, addr, true, size, true);
+    } else {
+        SET_FIELD(I2Cx_CR1[instance], I2Cx_CR1_TXDMAEN);
+        xfer->remaining = size - i2c_start(instance, addr, false, size, true);
+    }
+
+    return TI_ERRC_NONE;
+}
+
+// Direct (unqueued) async calls report to the callback given to i2c_init()
+static ti_errc_t i2c_transfer_async(uint8_t instance, uint16_t addr, const uint8_t *mem,
+                                    uint8_t mem_size, bool read, uint8_t *data, size_t size) {
+    i2c_state_t *state = &i2c_states[instance];
+
+    if (!i2c_dma_accessible(instance, data, size)) return TI_ERRC_INVALID_ARG;
+    if (!i2c_claim(instance)) return TI_ERRC_BUSY;
+
+    int status = i2c_begin_async(instance, addr, mem, mem_size, read, data, size, state->callback,
+                                 state->context);
+    if (status != TI_ERRC_NONE) i2c_release(state);
+    return status;
+}
+
+static ti_errc_t i2c_blocking(uint8_t instance, uint16_t addr, const uint8_t *mem,
+                              uint8_t mem_size, bool read, uint8_t *data, size_t size) {
+    if (!i2c_claim(instance)) return TI_ERRC_BUSY;
+
+    int status = i2c_transfer_blocking(instance, addr, mem, mem_size, read, data, size);
+    i2c_release(&i2c_states[instance]);
+    return status;
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+
+ti_errc_t i2c_compute_timing(const i2c_timing_config_t *config, i2c_timing_t *timing) {
+    if ((config == NULL) || (timing == NULL)) return TI_ERRC_INVALID_ARG;
+    if ((config->clk_freq == 0) || (config->speed == 0)) return TI_ERRC_INVALID_ARG;
+    if ((config->speed > I2C_SPEED_FAST_PLUS) || (config->digital_filter > 15)) return TI_ERRC_INVALID_ARG;
+
+    const i2c_spec_t *spec = &i2c_specs[0];
+    while (config->speed > spec->speed) spec++;
+
+    // Everything in ps, so fast kernel clocks keep their precision
+    int64_t t_clk = (PS_PER_S + config->clk_freq / 2) / config->clk_freq;
+    int64_t rise = (int64_t)config->rise_ns * 1000;
+    int64_t fall = (int64_t)config->fall_ns * 1000;
+    int64_t af_min = config->analog_filter ? I2C_ANALOG_FILTER_MIN_PS : 0;
+    int64_t af_max = config->analog_filter ? I2C_ANALOG_FILTER_MAX_PS : 0;
+    int64_t dnf = config->digital_filter * t_clk;
+
+    // SDA changes SDADEL after SCL falls as seen through the filters and the input sync, and
+    // the next SCL rising edge comes SCLDEL after that (RM0399 I2C timings)
+    int64_t sdadel_min = (int64_t)spec->hddat_min * 1000 + fall - af_min -
+                         (config->digital_filter + 3) * t_clk;
+    int64_t sdadel_max = (int64_t)spec->vddat_max * 1000 - rise - af_max -
+                         (config->digital_filter + 4) * t_clk;
+    int64_t scldel_min = rise + (int64_t)spec->sudat_min * 1000;
+    if (sdadel_min < 0) sdadel_min = 0;
+    if (sdadel_max < 0) return TI_ERRC_UNSUPPORTED; // The kernel clock is too slow for the mode
+
+    // SCL sync adds the filter delays and two kernel clocks to each half period
+    int64_t t_sync = af_min + dnf + 2 * t_clk;
+    int64_t period_min = PS_PER_S / config->speed;
+    int64_t period_max = PS_PER_S * 100 / ((int64_t)config->speed * I2C_MIN_SPEED_PERCENT);
+    int64_t best_period = 0;
+    uint32_t best = 0;
+
+    for (uint32_t presc = 0; presc <= 15; presc++) {
+        int64_t t_presc = (presc + 1) * t_clk;
+
+        // Shortest data hold and setup delays that meet the spec
+        int64_t scldel = (scldel_min + t_presc - 1) / t_presc - 1;
+        int64_t sdadel = (sdadel_min + t_presc - 1) / t_presc;
+        if (scldel < 0) scldel = 0;
+        if ((scldel > 15) || (sdadel > 15) || (sdadel * t_presc > sdadel_max)) continue;
+
+        for (uint32_t scll = 0; scll <= 255; scll++) {
+            int64_t t_low = (scll + 1) * t_presc + t_sync;
+            if (t_low + t_presc + t_sync + rise + fall > period_max) break;
+            if ((t_low < (int64_t)spec->low_min * 1000) || (t_low - af_min - dnf <= 4 * t_clk)) continue;
+
+            // The first SCLH long enough is the closest to the target for this SCLL
+            for (uint32_t sclh = 0; sclh <= 255; sclh++) {
+                int64_t t_high = (sclh + 1) * t_presc + t_sync;
+                int64_t period = t_low + t_high + rise + fall;
+                if (period > period_max) break;
+                if ((t_high < (int64_t)spec->high_min * 1000) || (t_high <= t_clk) || (period < period_min)) continue;
+
+                if ((best_period == 0) || (period < best_period)) {
+                    best_period = period;
+                    best = (presc << I2Cx_TIMINGR_PRESC.pos) | ((uint32_t)scldel << I2Cx_TIMINGR_SCLDEL.pos) |
+                           ((uint32_t)sdadel << I2Cx_TIMINGR_SDADEL.pos) | (sclh << I2Cx_TIMINGR_SCLH.pos) |
+                           (scll << I2Cx_TIMINGR_SCLL.pos);
+                }
+                break;
+            }
+        }
+    }
+
+    if (best_period == 0) return TI_ERRC_UNSUPPORTED;
+
+    timing->timingr = best;
+    timing->actual_speed = (uint32_t)((PS_PER_S + best_period / 2) / best_period);
+    timing->fast_mode_plus = (config->speed > I2C_SPEED_FAST);
+
+    return TI_ERRC_NONE;
+}
+
+ti_errc_t i2c_init(uint8_t instance, i2c_config_t *config, i2c_callback_t callback, void *context) {
+    if ((instance < 1) || (instance > I2C_INSTANCE_COUNT)) return TI_ERRC_INVALID_ARG;
+    if ((config == NULL) || (config->digital_filter > 15)) return TI_ERRC_INVALID_ARG;
+
+    i2c_state_t *state = &i2c_states[instance];
+    if (state->ready) return TI_ERRC_INVALID_STATE;
+
+    if (i2c_is_bdma(instance)) {
+        if ((config->bdma_tx_channel >= BDMA_CHANNEL_COUNT) ||
+            (config->bdma_rx_channel >= BDMA_CHANNEL_COUNT) ||
+            (config->bdma_tx_channel == config->bdma_rx_channel)) {
+            return TI_ERRC_INVALID_ARG;
+        }
+        state->tx_stream = (dma_stream_t){.instance = DMA_INSTANCE_BDMA,
+                                          .stream = config->bdma_tx_channel};
+        state->rx_stream = (dma_stream_t){.instance = DMA_INSTANCE_BDMA,
+                                          .stream = config->bdma_rx_channel};
+        SET_FIELD(RCC_APB4ENR, RCC_APB4ENR_I2C4EN);
+    } else {
+        int status = dma_claim_stream(I2C_DMA_PRIORITY, 0, &state->tx_stream);
+        if (status != TI_ERRC_NONE) return status;
+        status = dma_claim_stream(I2C_DMA_PRIORITY, 0, &state->rx_stream);
+        if (status != TI_ERRC_NONE) {
+            dma_release_stream(state->tx_stream);
+            return status;
+        }
+        SET_FIELD(RCC_APB1LENR, RCC_APB1LENR_I2CxEN[instance]);
+    }
+
+    // SCL and SDA are open-drain, pulled up externally. Bus recovery drives them as GPIOs.
+    tal_enable_clock(config->scl_pin);
+    tal_enable_clock(config->sda_pin);
+    tal_set_drain(config->scl_pin, 1);
+    tal_set_drain(config->sda_pin, 1);
+    i2c_pins_af(config);
+
+    state->config = *config;
+    i2c_configure(instance);
+
+    state->instance = instance;
+    state->addr_mode = config->addr_mode;
+    state->timeout = (config->timeout != 0) ? config->timeout : I2C_DEFAULT_TIMEOUT;
+    state->callback = callback;
+    state->context = context;
+    state->busy = false;
+    state->recovery = RECOVERY_NONE;
+    state->ready = true;
+
+    return TI_ERRC_NONE;
+}
+
+ti_errc_t i2c_read_async(uint8_t instance, uint16_t addr, uint8_t *rx_data, size_t size) {
+    int status = i2c_check_args(instance, addr, 0, rx_data, size);
+    if (status != TI_ERRC_NONE) return status;
+    return i2c_transfer_async(instance, addr, NULL, 0, true, rx_data, size);
+}
+
+ti_errc_t i2c_write_async(uint8_t instance, uint16_t addr, uint8_t *tx_data, size_t size) {
+    int status = i2c_check_args(instance, addr, 0, tx_data, size);
+    if (status != TI_ERRC_NONE) return status;
+    return i2c_transfer_async(instance, addr, NULL, 0, false, tx_data, size);
+}
+
+ti_errc_t i2c_read_blocking(uint8_t instance, uint16_t addr, uint8_t *rx_data, size_t size) {
+    int status = i2c_check_args(instance, addr, 0, rx_data, size);
+    if (status != TI_ERRC_NONE) return status;
+    return i2c_blocking(instance, addr, NULL, 0, true, rx_data, size);
+}
+
+ti_errc_t i2c_write_blocking(uint8_t instance, uint16_t addr, uint8_t *tx_data, size_t size) {
+    int status = i2c_check_args(instance, addr, 0, tx_data, size);
+    if (status != TI_ERRC_NONE) return status;
+    return i2c_blocking(instance, addr, NULL, 0, false, tx_data, size);
+}
+
+ti_errc_t i2c_mem_read_blocking(uint8_t instance, uint16_t addr, uint16_t mem_addr,
+                                uint8_t mem_addr_size, uint8_t *rx_data, size_t size) {
+    uint8_t mem[2];
+
+    int status = i2c_check_args(instance, addr, mem_addr_size, rx_data, size);
+    if ((status == TI_ERRC_NONE) && (mem_addr_size == 0)) status = TI_ERRC_INVALID_ARG;
+    if (status != TI_ERRC_NONE) return status;
+
+    i2c_encode_mem(mem_addr, mem_addr_size, mem);
+    return i2c_blocking(instance, addr, mem, mem_addr_size, true, rx_data, size);
+}
+
+ti_errc_t i2c_mem_write_blocking(uint8_t instance, uint16_t addr, uint16_t mem_addr,
+                                 uint8_t mem_addr_size, const uint8_t *tx_data, size_t size) {
+    uint8_t mem[2];
+
+    int status = i2c_check_args(instance, addr, mem_addr_size, tx_data, size);
+    if ((status == TI_ERRC_NONE) && (mem_addr_size == 0)) status = TI_ERRC_INVALID_ARG;
+    if (status != TI_ERRC_NONE) return status;
+
+    i2c_encode_mem(mem_addr, mem_addr_size, mem);
+    return i2c_blocking(instance, addr, mem, mem_addr_size, false, (uint8_t *)tx_data, size);
+}
+
+ti_errc_t i2c_mem_read_async(uint8_t instance, uint16_t addr, uint16_t mem_addr,
+                             uint8_t mem_addr_size, uint8_t *rx_data, size_t size) {
+    uint8_t mem[2];
+
+    int status = i2c_check_args(instance, addr, mem_addr_size, rx_data, size);
+    if ((status == TI_ERRC_NONE) && (mem_addr_size == 0)) status = TI_ERRC_INVALID_ARG;
+    if (status != TI_ERRC_NONE) return status;
+
+    i2c_encode_mem(mem_addr, mem_addr_size, mem);
+    return i2c_transfer_async(instance, addr, mem, mem_addr_size, true, rx_data, size);
+}
+
+ti_errc_t i2c_mem_write_async(uint8_t instance, uint16_t addr, uint16_t mem_addr,
+                              uint8_t mem_addr_size, const uint8_t *tx_data, size_t size) {
+    uint8_t mem[2];
+
+    int status = i2c_check_args(instance, addr, mem_addr_size, tx_data, size);
+    if ((status == TI_ERRC_NONE) && (mem_addr_size == 0)) status = TI_ERRC_INVALID_ARG;
+    if (status != TI_ERRC_NONE) return status;
+
+    i2c_encode_mem(mem_addr, mem_addr_size, mem);
+    return i2c_transfer_async(instance, addr, mem, mem_addr_size, false, (uint8_t *)tx_data, size);
+}
+
+ti_errc_t i2c_submit(uint8_t instance, const i2c_request_t *request) {
+    if (request == NULL) return TI_ERRC_INVALID_ARG;
+    if (request->op > I2C_OP_MEM_WRITE) return TI_ERRC_INVALID_ARG;
+
+    bool mem_op = (request->op == I2C_OP_MEM_READ) || (request->op == I2C_OP_MEM_WRITE);
+    uint8_t mem_size = mem_op ? request->mem_addr_size : 0;
+    int status = i2c_check_args(instance, request->addr, mem_size, request->data, request->size);
+    if ((status == TI_ERRC_NONE) && mem_op && (mem_size == 0)) status = TI_ERRC_INVALID_ARG;
+    if (status != TI_ERRC_NONE) return status;
+    if (!i2c_dma_accessible(instance, request->data, request->size)) return TI_ERRC_INVALID_ARG;
+
+    i2c_state_t *state = &i2c_states[instance];
+    uint32_t primask = irq_save();
+    if (state->queue_head - state->queue_tail >= I2C_QUEUE_DEPTH) {
+        irq_restore(primask);
+        return TI_ERRC_BUSY;
+    }
+    state->queue[state->queue_head & QUEUE_MASK] = *request;
+    state->queue_head++;
+    irq_restore(primask);
+
+    // If a transaction is running, its completion starts this request
+    if (i2c_claim(instance)) i2c_release(state);
+
+    return TI_ERRC_NONE;
+}
+
+void i2c_service(uint8_t instance) {
+    if ((instance < 1) || (instance > I2C_INSTANCE_COUNT)) return;
+
+    i2c_state_t *state = &i2c_states[instance];
+    const i2c_config_t *config = &state->config;
+
+    switch (state->recovery) {
+        case RECOVERY_NONE:
+            return;
+
+        case RECOVERY_START:
+            // Both lines released (open-drain high) before switching them to outputs
+            tal_set_pin(config->scl_pin, 1);
+            tal_set_pin(config->sda_pin, 1);
+            tal_set_mode(config->scl_pin, 1);
+            tal_set_mode(config->sda_pin, 1);
+            state->recovery_step = 0;
+            state->recovery = RECOVERY_CLOCK;
+            return;
+
+        case RECOVERY_CLOCK:
+            // A device stuck mid-byte shifts out one bit per clock and releases SDA at the
+            // latest after the ACK slot, so SDA is sampled after every SCL high edge
+            if ((state->recovery_step & 1U) == 0) {
+                tal_set_pin(config->scl_pin, 0);
+            } else {
+                tal_set_pin(config->scl_pin, 1);
+                if (tal_read_pin(config->sda_pin)) {
+                    state->recovery_step = 0;
+                    state->recovery = RECOVERY_STOP;
+                    return;
+                }
+            }
+            if (++state->recovery_step >= 2 * I2C_RECOVERY_CLOCKS) {
+                state->stats.recovery_failures++;
+                state->recovery_step = 0;
+            }
+            return;
+
+        case RECOVERY_STOP:
+            // SDA rising while SCL is high, so every device sees the end of a transaction
+            switch (state->recovery_step++) {
+                case 0: tal_set_pin(config->scl_pin, 0); break;
+                case 1: tal_set_pin(config->sda_pin, 0); break;
+                case 2: tal_set_pin(config->scl_pin, 1); break;
+                default:
+                    tal_set_pin(config->sda_pin, 1);
+                    state->recovery = RECOVERY_REINIT;
+                    break;
+            }
+            return;
+
+        case RECOVERY_REINIT:
+            i2c_pins_af(config);
+            i2c_reset_peripheral(instance);
+            i2c_configure(instance);
+            state->stats.recoveries++;
+            state->recovery = RECOVERY_NONE;
+            i2c_release(state);
+            return;
+    }
+}
+
+ti_errc_t i2c_recover(uint8_t instance) {
+    if ((instance < 1) || (instance > I2C_INSTANCE_COUNT)) return TI_ERRC_INVALID_ARG;
+
+    i2c_state_t *state = &i2c_states[instance];
+    if (!state->ready) return TI_ERRC_INVALID_STATE;
+
+    uint32_t primask = irq_save();
+    if (state->recovery != RECOVERY_NONE) {
+        irq_restore(primask);
+        return TI_ERRC_NONE;
+    }
+    bool async = (state->xfer.pending != 0);
+    if (state->busy && !async) {
+        irq_restore(primask);
+        return TI_ERRC_BUSY;
+    }
+    state->busy = true;
+    i2c_begin_recovery(state);
+    irq_restore(primask);
+
+    // The peripheral is off now, so no STOP will come for a transaction in progress
+    if (async) {
+        i2c_abort(state, TI_ERRC_INTERNAL);
+        i2c_complete(state, PENDING_STOP);
+    }
+
+    return TI_ERRC_NONE;
+}
+
+bool i2c_is_recovering(uint8_t instance) {
+    if ((instance < 1) || (instance > I2C_INSTANCE_COUNT)) return false;
+    return i2c_states[instance].recovery != RECOVERY_NONE;
+}
+
+ti_errc_t i2c_get_stats(uint8_t instance, i2c_stats_t *stats) {
+    if ((instance < 1) || (instance > I2C_INSTANCE_COUNT) || (stats == NULL)) return TI_ERRC_INVALID_ARG;
+
+    uint32_t primask = irq_save();
+    *stats = i2c_states[instance].stats;
+    irq_restore(primask);
+
+    return TI_ERRC_NONE;
+}
+
+ti_errc_t i2c_reset_stats(uint8_t instance) {
+    if ((instance < 1) || (instance > I2C_INSTANCE_COUNT)) return TI_ERRC_INVALID_ARG;
+
+    uint32_t primask = irq_save();
+    i2c_states[instance].stats = (i2c_stats_t){0};
+    irq_restore(primask);
+
+    return TI_ERRC_NONE;
+}
+
+void i2c_irq(uint8_t instance) {
+    if ((instance < 1) || (instance > I2C_INSTANCE_COUNT)) return;
+
+    i2c_state_t *state = &i2c_states[instance];
+    i2c_xfer_t *xfer = &state->xfer;
+
+    if (xfer->pending == 0) {
+        i2c_clear_flags(instance);
+        return;
+    }
+
+    int fault = i2c_check_fault(state);
+    if (fault != TI_ERRC_NONE) {
+        // No STOP follows a bus fault, so finish here. The instance stays out of service until
+        // i2c_service() has recovered the bus.
+        i2c_abort(state, fault);
+        i2c_complete(state, PENDING_STOP);
+        return;
+    }
+
+    if (READ_FIELD(I2Cx_ISR[instance], I2Cx_ISR_NACKF)) {
+        SET_WOFIELD(I2Cx_ICR[instance], I2Cx_ICR_NACKCF);
+        state->stats.nacks++;
+        CLR_FIELD(I2Cx_CR1[instance], I2Cx_CR1_TXIE);
+        SET_FIELD(I2Cx_ISR[instance], I2Cx_ISR_TXE);
+        if (!READ_FIELD(I2Cx_CR2[instance], I2Cx_CR2_AUTOEND)) {
+            SET_FIELD(I2Cx_CR2[instance], I2Cx_CR2_STOP);
+        }
+        i2c_abort(state, TI_ERRC_INVALID_STATE);
+    }
+
+    if (READ_FIELD(I2Cx_CR1[instance], I2Cx_CR1_TXIE) &&
+        READ_FIELD(I2Cx_ISR[instance], I2Cx_ISR_TXIS)) {
+        *I2Cx_TXDR[instance] = xfer->mem[xfer->mem_sent++];
+        if (xfer->mem_sent == xfer->mem_size) {
+            CLR_FIELD(I2Cx_CR1[instance], I2Cx_CR1_TXIE);
+            if (!xfer->read) SET_FIELD(I2Cx_CR1[instance], I2Cx_CR1_TXDMAEN);
+        }
+    }
+
+    if (READ_FIELD(I2Cx_ISR[instance], I2Cx_ISR_TCR)) {
+        xfer->remaining -= i2c_reload(instance, xfer->remaining);
+    }
+
+    // Register address sent without a STOP: turn the bus around with a repeated START
+    if (READ_FIELD(I2Cx_ISR[instance], I2Cx_ISR_TC)) {
+        SET_FIELD(I2Cx_CR1[instance], I2Cx_CR1_RXDMAEN);
+        xfer->remaining = xfer->size - i2c_start(instance, xfer->addr, true, xfer->size, true);
+    }
+
+    if (READ_FIELD(I2Cx_ISR[instance], I2Cx_ISR_STOPF)) {
+        SET_WOFIELD(I2Cx_ICR[instance], I2Cx_ICR_STOPCF);
+        i2c_complete(state, PENDING_STOP);
+    }
+}
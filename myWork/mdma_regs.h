@@ -0,0 +1,115 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/include/mcu/mdma_regs.h
+ * @authors Jude Merritt
+ * @brief Register helpers shared by the MDMA modules. Not a public interface.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "include/mmio.h"
+#include "include/dma.h"
+
+/**************************************************************************************************
+ * @section Macros
+ **************************************************************************************************/
+
+// Channel interrupt flags, same layout in CxISR and CxIFCR
+#define MDMA_FLAG_TE  0x01U // Transfer error
+#define MDMA_FLAG_CTC 0x02U // Channel transfer complete
+#define MDMA_FLAG_BRT 0x04U // Block repeat transfer complete
+#define MDMA_FLAG_BT  0x08U // Block transfer complete
+#define MDMA_FLAG_TC  0x10U // Buffer transfer complete
+#define MDMA_FLAG_ALL (MDMA_FLAG_TE | MDMA_FLAG_CTC | MDMA_FLAG_BRT | MDMA_FLAG_BT | MDMA_FLAG_TC)
+
+#define MDMA_MAX_BLOCK 65536U  // Largest BNDT in bytes
+#define MDMA_MAX_TLEN  128U    // Largest buffer transfer (TLEN + 1) in bytes
+
+// CxTCR encodings
+#define MDMA_INC_FIXED     0U
+#define MDMA_INC_INCREMENT 2U
+#define MDMA_TRGM_BUFFER   0U // Each request moves one buffer (TLEN + 1 bytes)
+#define MDMA_TRGM_BLOCK    1U // Each request moves a whole block
+#define MDMA_TRGM_REPEAT   2U // Each request moves all repeated blocks
+#define MDMA_TRGM_LIST     3U // Each request moves the whole linked list
+
+#define MDMA_CHANNEL_DISABLE_TIMEOUT 100000U
+
+/**************************************************************************************************
+ * @section Register Helpers
+ **************************************************************************************************/
+
+// mmio.h only defines the status registers one channel at a time, so index them here
+static ro_reg32_t const mdma_isr_table[MDMA_CHANNEL_COUNT] = {
+    MDMA_MDMA_C0ISR,  MDMA_MDMA_C1ISR,  MDMA_MDMA_C2ISR,  MDMA_MDMA_C3ISR,
+    MDMA_MDMA_C4ISR,  MDMA_MDMA_C5ISR,  MDMA_MDMA_C6ISR,  MDMA_MDMA_C7ISR,
+    MDMA_MDMA_C8ISR,  MDMA_MDMA_C9ISR,  MDMA_MDMA_C10ISR, MDMA_MDMA_C11ISR,
+    MDMA_MDMA_C12ISR, MDMA_MDMA_C13ISR, MDMA_MDMA_C14ISR, MDMA_MDMA_C15ISR,
+};
+
+static rw_reg32_t const mdma_ifcr_table[MDMA_CHANNEL_COUNT] = {
+    MDMA_MDMA_C0IFCR,  MDMA_MDMA_C1IFCR,  MDMA_MDMA_C2IFCR,  MDMA_MDMA_C3IFCR,
+    MDMA_MDMA_C4IFCR,  MDMA_MDMA_C5IFCR,  MDMA_MDMA_C6IFCR,  MDMA_MDMA_C7IFCR,
+    MDMA_MDMA_C8IFCR,  MDMA_MDMA_C9IFCR,  MDMA_MDMA_C10IFCR, MDMA_MDMA_C11IFCR,
+    MDMA_MDMA_C12IFCR, MDMA_MDMA_C13IFCR, MDMA_MDMA_C14IFCR, MDMA_MDMA_C15IFCR,
+};
+
+static inline uint32_t mdma_read_flags(uint8_t channel) {
+    return *mdma_isr_table[channel] & MDMA_FLAG_ALL;
+}
+
+static inline void mdma_clear_flags(uint8_t channel, uint32_t flags) {
+    *mdma_ifcr_table[channel] = flags & MDMA_FLAG_ALL;
+}
+
+// Whether the channel has an interrupt pending, without touching the channel registers
+static inline bool mdma_pending(uint8_t channel) {
+    return READ_FIELD(MDMA_MDMA_GISR0, MDMA_MDMA_GISR0_GIFx[channel]) != 0;
+}
+
+// Disables a channel and waits for the current beat to finish, as required before reprogramming
+static inline bool mdma_disable_channel(uint8_t channel) {
+    uint32_t count = 0;
+
+    CLR_FIELD(MDMA_MDMA_CxCR[channel], MDMA_MDMA_CxCR_EN);
+    while (READ_FIELD(MDMA_MDMA_CxCR[channel], MDMA_MDMA_CxCR_EN)) {
+        if (count++ >= MDMA_CHANNEL_DISABLE_TIMEOUT) return false;
+    }
+
+    mdma_clear_flags(channel, MDMA_FLAG_ALL);
+    return true;
+}
+
+// The TCMs are reached through the CPU AHB slave port (SBUS/DBUS = 1), everything else over AXI
+static inline uint32_t mdma_bus(const void *address) {
+    uintptr_t addr = (uintptr_t)address;
+    bool itcm = (addr < 0x00010000U);
+    bool dtcm = (addr >= 0x20000000U) && (addr < 0x20020000U);
+    return (itcm || dtcm) ? 1U : 0U;
+}
+
+// Maps a data size in bytes (1, 2, 4 or 8) to the SSIZE/DSIZE encoding, or -1 if invalid
+static inline int mdma_size_code(uint8_t bytes) {
+    switch (bytes) {
+        case 1: return 0;
+        case 2: return 1;
+        case 4: return 2;
+        case 8: return 3;
+        default: return -1;
+    }
+}
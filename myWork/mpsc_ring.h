@@ -0,0 +1,102 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/include/mcu/mpsc_ring.h
+ * @authors Jude Merritt
+ * @brief Bounded lock-free multi-producer, single-consumer ring shared by the ISR queues. Not a
+ * public interface.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Positions only ever grow; slot i of a ring of depth n holds positions i, i + n, i + 2n, ...
+// Each slot has a sequence number saying whose turn it is: pos when free for the producer of
+// pos, pos + 1 once that producer has published. The payload array belongs to the caller and is
+// indexed with mpsc_ring_index(). Producers never wait on each other, and everything compiles
+// to LDREX/STREX on the M7.
+//
+// Sequence numbers are stored relative to the slot index, so a zero-initialized ring is already
+// empty without an init call. The depth must be a power of two.
+
+typedef struct {
+    atomic_uint head; // Next position claimed by a producer
+    uint32_t tail;    // Next position consumed (only touched by the consumer)
+} mpsc_ring_t;
+
+/**************************************************************************************************
+ * @section Ring Helpers
+ **************************************************************************************************/
+
+static inline uint32_t mpsc_ring_index(uint32_t depth, uint32_t pos) {
+    return pos & (depth - 1);
+}
+
+static inline uint32_t mpsc_ring_seq(atomic_uint *seq, uint32_t depth, uint32_t pos) {
+    uint32_t index = mpsc_ring_index(depth, pos);
+    return atomic_load_explicit(&seq[index], memory_order_acquire) + index;
+}
+
+static inline void mpsc_ring_set_seq(atomic_uint *seq, uint32_t depth, uint32_t pos, uint32_t value) {
+    uint32_t index = mpsc_ring_index(depth, pos);
+    atomic_store_explicit(&seq[index], value - index, memory_order_release);
+}
+
+// Producer: claims the next free position. Returns false if the ring is full.
+static inline bool mpsc_ring_claim(mpsc_ring_t *ring, atomic_uint *seq, uint32_t depth, uint32_t *pos) {
+    uint32_t p = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    for (;;) {
+        int32_t diff = (int32_t)(mpsc_ring_seq(seq, depth, p) - p);
+
+        if (diff == 0) {
+            // Slot is free; claim it. On failure p is reloaded with the current head.
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &p, p + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *pos = p;
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            p = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+}
+
+// Producer: hands a claimed position, with its payload written, to the consumer
+static inline void mpsc_ring_publish(atomic_uint *seq, uint32_t depth, uint32_t pos) {
+    mpsc_ring_set_seq(seq, depth, pos, pos + 1);
+}
+
+// Consumer: true if the payload at ring->tail has been published. A producer that has claimed
+// the slot but not published yet reads as empty.
+static inline bool mpsc_ring_ready(const mpsc_ring_t *ring, atomic_uint *seq, uint32_t depth) {
+    return mpsc_ring_seq(seq, depth, ring->tail) == ring->tail + 1;
+}
+
+// Consumer: frees the slot at ring->tail (after its payload has been copied out) and moves on
+static inline void mpsc_ring_consume(mpsc_ring_t *ring, atomic_uint *seq, uint32_t depth) {
+    mpsc_ring_set_seq(seq, depth, ring->tail, ring->tail + depth);
+    ring->tail++;
+}
+
+// Positions claimed but not consumed yet. Only a hint outside the consumer.
+static inline uint32_t mpsc_ring_pending(const mpsc_ring_t *ring) {
+    return atomic_load_explicit(&ring->head, memory_order_relaxed) - ring->tail;
+}
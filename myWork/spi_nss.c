@@ -0,0 +1,162 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/src/spi_nss.c
+ * @authors Jude Merritt
+ * @brief Hardware NSS and FIFO threshold mode for single-device SPI instances
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "include/mmio.h"
+#include "include/errc.h"
+#include "include/spi.h"
+#include "gpio.h"
+
+#define DSIZE_8BIT 7U
+#define PACKED_FRAMES 4U
+
+// SPI1-3 have a 16 byte FIFO, SPI4-6 have an 8 byte FIFO
+#define FIFO_FRAMES(instance) (((instance) <= 3) ? 16U : 8U)
+
+static bool hw_nss_enabled[SPI_INSTANCE_COUNT + 1] = {0};
+static uint8_t hw_nss_pin[SPI_INSTANCE_COUNT + 1] = {0};
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+
+int spi_hw_nss_init(uint8_t instance, spi_hw_nss_config_t *config) {
+    if ((instance < 1) || (instance > SPI_INSTANCE_COUNT) || (config == NULL)) return TI_ERRC_INVALID_ARG;
+    if ((config->mssi > 15) || (config->midi > 15)) return TI_ERRC_INVALID_ARG;
+    if ((config->fifo_threshold < 1) || (config->fifo_threshold > FIFO_FRAMES(instance))) return TI_ERRC_INVALID_ARG;
+
+    // Configuration registers are locked while the peripheral is enabled
+    if (READ_FIELD(SPIx_CR1[instance], SPIx_CR1_SPE)) return TI_ERRC_BUSY;
+
+    // Route the NSS pin to the peripheral
+    tal_enable_clock(config->nss_pin);
+    tal_set_mode(config->nss_pin, 2);
+    tal_alternate_mode(config->nss_pin, config->nss_af);
+
+    // NSS is an active-low output driven by hardware. With SSOM cleared it stays asserted for
+    // the whole transfer instead of pulsing between frames, and AFCNTR keeps it driven high
+    // while the peripheral is disabled between transfers.
+    CLR_FIELD(SPIx_CFG2[instance], SPIx_CFG2_SSM);
+    SET_FIELD(SPIx_CFG2[instance], SPIx_CFG2_SSOE);
+    CLR_FIELD(SPIx_CFG2[instance], SPIx_CFG2_SSOM);
+    CLR_FIELD(SPIx_CFG2[instance], SPIx_CFG2_SSIOP);
+    SET_FIELD(SPIx_CFG2[instance], SPIx_CFG2_AFCNTR);
+
+    // Idleness between NSS assertion and the first frame, and between frames
+    WRITE_FIELD(SPIx_CFG2[instance], SPIx_CFG2_MSSI, config->mssi);
+    WRITE_FIELD(SPIx_CFG2[instance], SPIx_CFG2_MIDI, config->midi);
+
+    // TXP/RXP are raised per packet of fifo_threshold frames
+    WRITE_FIELD(SPIx_CFG1[instance], SPIx_CFG1_FTHVL, config->fifo_threshold - 1U);
+
+    hw_nss_pin[instance] = config->nss_pin;
+    hw_nss_enabled[instance] = true;
+
+    return TI_ERRC_NONE;
+}
+
+bool spi_is_hw_nss(uint8_t instance) {
+    if ((instance < 1) || (instance > SPI_INSTANCE_COUNT)) return false;
+    return hw_nss_enabled[instance];
+}
+
+bool spi_hw_nss_accepts(spi_device_t device) {
+    if (!spi_is_hw_nss(device.instance)) return true;
+    return device.gpio_pin == hw_nss_pin[device.instance];
+}
+
+int spi_transfer_packed(uint8_t instance, const uint8_t *source, uint8_t *dest, size_t size,
+                        uint32_t timeout) {
+    if (!spi_is_hw_nss(instance)) return TI_ERRC_INVALID_STATE;
+    if ((source == NULL) || (size == 0) || (size > 0xFFFF)) return TI_ERRC_INVALID_ARG;
+    if (READ_FIELD(SPIx_CFG1[instance], SPIx_CFG1_DSIZE) != DSIZE_8BIT) return TI_ERRC_INVALID_STATE;
+    if (READ_FIELD(SPIx_CR1[instance], SPIx_CR1_SPE)) return TI_ERRC_BUSY;
+
+    // TXP only guarantees room for one packet of FTHVL + 1 frames, so a 32-bit write would
+    // overflow the TX FIFO with a smaller threshold
+    bool tx_words = (READ_FIELD(SPIx_CFG1[instance], SPIx_CFG1_FTHVL) + 1U) >= PACKED_FRAMES;
+
+    rw_reg32_t txdr32 = SPIx_TXDR[instance];
+    volatile uint8_t *txdr8 = (volatile uint8_t *)SPIx_TXDR[instance];
+    ro_reg32_t rxdr32 = SPIx_RXDR[instance];
+    const volatile uint8_t *rxdr8 = (const volatile uint8_t *)SPIx_RXDR[instance];
+
+    size_t tx_count = 0;
+    size_t rx_count = 0;
+    uint32_t count = 0;
+    int status = TI_ERRC_NONE;
+
+    // NSS is asserted by hardware once the transfer starts and released at EOT
+    WRITE_FIELD(SPIx_CR2[instance], SPIx_CR2_TSIZE, size);
+    SET_FIELD(SPIx_CR1[instance], SPIx_CR1_SPE);
+    SET_FIELD(SPIx_CR1[instance], SPIx_CR1_CSTART);
+
+    while (rx_count < size) {
+        if ((tx_count < size) && READ_FIELD(SPIx_SR[instance], SPIx_SR_TXP)) {
+            if (tx_words && (size - tx_count >= PACKED_FRAMES)) {
+                uint32_t word = (uint32_t)source[tx_count]            |
+                                ((uint32_t)source[tx_count + 1] << 8)  |
+                                ((uint32_t)source[tx_count + 2] << 16) |
+                                ((uint32_t)source[tx_count + 3] << 24);
+                *txdr32 = word;
+                tx_count += PACKED_FRAMES;
+            } else {
+                *txdr8 = source[tx_count++];
+            }
+            count = 0;
+        }
+
+        if ((size - rx_count >= PACKED_FRAMES) && READ_FIELD(SPIx_SR[instance], SPIx_SR_RXWNE)) {
+            uint32_t word = *rxdr32;
+            if (dest != NULL) {
+                dest[rx_count]     = (uint8_t)word;
+                dest[rx_count + 1] = (uint8_t)(word >> 8);
+                dest[rx_count + 2] = (uint8_t)(word >> 16);
+                dest[rx_count + 3] = (uint8_t)(word >> 24);
+            }
+            rx_count += PACKED_FRAMES;
+            count = 0;
+        } else if ((size - rx_count < PACKED_FRAMES) && READ_FIELD(SPIx_SR[instance], SPIx_SR_RXPLVL)) {
+            uint8_t byte = *rxdr8;
+            if (dest != NULL) dest[rx_count] = byte;
+            rx_count++;
+            count = 0;
+        }
+
+        if (count++ >= timeout) {
+            status = TI_ERRC_TIMEOUT;
+            break;
+        }
+    }
+
+    // Wait for the end of the transfer so NSS is released before the peripheral is disabled
+    count = 0;
+    while ((status == TI_ERRC_NONE) && !READ_FIELD(SPIx_SR[instance], SPIx_SR_EOT)) {
+        if (count++ >= timeout) status = TI_ERRC_TIMEOUT;
+    }
+
+    SET_WOFIELD(SPIx_IFCR[instance], SPIx_IFCR_EOTC);
+    SET_WOFIELD(SPIx_IFCR[instance], SPIx_IFCR_TXTFC);
+    CLR_FIELD(SPIx_CR1[instance], SPIx_CR1_SPE);
+
+    return status;
+}
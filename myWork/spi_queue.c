@@ -0,0 +1,216 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/src/spi_queue.c
+ * @authors Jude Merritt
+ * @brief ISR-safe, lock-free SPI transfer submission
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "include/errc.h"
+#include "include/spi.h"
+#include "myWork/mpsc_ring.h"
+#include "gpio.h"
+
+// Each instance has a bounded multi-producer queue (myWork/mpsc_ring.h) and a reservation
+// word. Whoever holds the reservation is the only consumer of the queue, so producers never
+// wait: they publish their transfer and then try to take the reservation themselves.
+// spi_block() takes the same reservation through spi_wait_block(), so the bus has exactly one
+// owner at a time. The word records who that is, so only the holder can hand it back.
+
+_Static_assert((SPI_ISR_QUEUE_DEPTH & (SPI_ISR_QUEUE_DEPTH - 1)) == 0, "SPI_ISR_QUEUE_DEPTH must be a power of two");
+
+// Reservation holders. A device that blocked the bus is recorded by its gpio_pin, never 0.
+#define OWNER_NONE  0
+#define OWNER_QUEUE INT32_MIN
+
+typedef struct {
+    atomic_uint seq[SPI_ISR_QUEUE_DEPTH];
+    struct spi_async_transfer_t slots[SPI_ISR_QUEUE_DEPTH];
+    mpsc_ring_t ring;   // Consumed only by the reservation holder
+    atomic_int owner;   // OWNER_NONE, OWNER_QUEUE or the gpio_pin of the blocking device
+    spi_device_t active_device;
+    spi_callback_t active_callback;
+} spi_queue_t;
+
+static spi_queue_t spi_queues[SPI_INSTANCE_COUNT + 1];
+
+static void queue_complete(uint8_t instance, bool success);
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+
+// spi_callback_t carries no context, so each instance gets its own completion trampoline
+#define SPI_QUEUE_CALLBACK_GENERATOR(instance)                                 \
+    static void queue_complete_##instance(bool success) {                      \
+        queue_complete(instance, success);                                     \
+    }
+
+SPI_QUEUE_CALLBACK_GENERATOR(1)
+SPI_QUEUE_CALLBACK_GENERATOR(2)
+SPI_QUEUE_CALLBACK_GENERATOR(3)
+SPI_QUEUE_CALLBACK_GENERATOR(4)
+SPI_QUEUE_CALLBACK_GENERATOR(5)
+SPI_QUEUE_CALLBACK_GENERATOR(6)
+
+static const spi_callback_t queue_callbacks[SPI_INSTANCE_COUNT + 1] = {
+    [1] = queue_complete_1,
+    [2] = queue_complete_2,
+    [3] = queue_complete_3,
+    [4] = queue_complete_4,
+    [5] = queue_complete_5,
+    [6] = queue_complete_6,
+};
+
+// Hardware NSS instances drive their own chip select
+static inline void set_cs(spi_device_t device, int level) {
+    if (!spi_is_hw_nss(device.instance)) tal_set_pin(device.gpio_pin, level);
+}
+
+static inline bool try_reserve(spi_queue_t *queue, int32_t owner) {
+    int expected = OWNER_NONE;
+    return atomic_compare_exchange_strong_explicit(&queue->owner, &expected, owner,
+                                                   memory_order_acquire, memory_order_relaxed);
+}
+
+static inline void release(spi_queue_t *queue) {
+    atomic_store_explicit(&queue->owner, OWNER_NONE, memory_order_release);
+}
+
+static inline bool pending(spi_queue_t *queue) {
+    return mpsc_ring_ready(&queue->ring, queue->seq, SPI_ISR_QUEUE_DEPTH);
+}
+
+static bool push(spi_queue_t *queue, const struct spi_async_transfer_t *transfer) {
+    uint32_t pos;
+    if (!mpsc_ring_claim(&queue->ring, queue->seq, SPI_ISR_QUEUE_DEPTH, &pos)) return false;
+
+    queue->slots[mpsc_ring_index(SPI_ISR_QUEUE_DEPTH, pos)] = *transfer;
+    mpsc_ring_publish(queue->seq, SPI_ISR_QUEUE_DEPTH, pos);
+
+    return true;
+}
+
+// Must only be called by the reservation holder.
+static bool pop(spi_queue_t *queue, struct spi_async_transfer_t *transfer) {
+    // A producer that claimed the slot but has not published yet will kick the queue itself
+    if (!pending(queue)) return false;
+
+    *transfer = queue->slots[mpsc_ring_index(SPI_ISR_QUEUE_DEPTH, queue->ring.tail)];
+    mpsc_ring_consume(&queue->ring, queue->seq, SPI_ISR_QUEUE_DEPTH);
+
+    return true;
+}
+
+// Starts the next queued transfer. Called with the reservation held; drops it if idle.
+static void run_next(uint8_t instance) {
+    spi_queue_t *queue = &spi_queues[instance];
+    struct spi_async_transfer_t transfer;
+
+    for (;;) {
+        while (pop(queue, &transfer)) {
+            queue->active_device = transfer.device;
+            queue->active_callback = transfer.callback;
+            transfer.callback = queue_callbacks[instance];
+
+            set_cs(transfer.device, 0);
+            if (spi_transfer_async(&transfer) == TI_ERRC_NONE) return;
+
+            // Could not start; report it and move on to the next request
+            set_cs(transfer.device, 1);
+            if (queue->active_callback != NULL) queue->active_callback(false);
+        }
+
+        release(queue);
+
+        // A producer may have published between the last pop() and release() and failed to
+        // reserve. Take the reservation back if so, otherwise its transfer would sit in the queue.
+        if (!pending(queue) || !try_reserve(queue, OWNER_QUEUE)) return;
+    }
+}
+
+static void queue_complete(uint8_t instance, bool success) {
+    spi_queue_t *queue = &spi_queues[instance];
+
+    set_cs(queue->active_device, 1);
+    if (queue->active_callback != NULL) queue->active_callback(success);
+
+    run_next(instance);
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+
+int spi_try_block(spi_device_t device) {
+    if (!IS_VALID_DEVICE(device) || !spi_hw_nss_accepts(device)) return TI_ERRC_INVALID_ARG;
+
+    spi_queue_t *queue = &spi_queues[device.instance];
+    if (!try_reserve(queue, device.gpio_pin)) return TI_ERRC_BUSY;
+
+    set_cs(device, 0);
+
+    return TI_ERRC_NONE;
+}
+
+int spi_wait_block(spi_device_t device, uint64_t timeout) {
+    if (!IS_VALID_DEVICE(device) || !spi_hw_nss_accepts(device)) return TI_ERRC_INVALID_ARG;
+
+    // Only the mutex holder gets here, so the only competition is the ISR queue, which keeps the
+    // reservation until everything it holds has been sent
+    spi_queue_t *queue = &spi_queues[device.instance];
+    uint64_t count = 0;
+    while (!try_reserve(queue, device.gpio_pin)) {
+        if (count++ >= timeout) return TI_ERRC_TIMEOUT;
+    }
+
+    set_cs(device, 0);
+
+    return TI_ERRC_NONE;
+}
+
+int spi_try_unblock(spi_device_t device) {
+    if (!IS_VALID_DEVICE(device)) return TI_ERRC_INVALID_ARG;
+
+    // Only the holder can move the word away from its own pin, so this check cannot go stale
+    spi_queue_t *queue = &spi_queues[device.instance];
+    if (atomic_load_explicit(&queue->owner, memory_order_acquire) != device.gpio_pin) {
+        return TI_ERRC_INVALID_STATE;
+    }
+
+    set_cs(device, 1);
+    atomic_store_explicit(&queue->owner, OWNER_QUEUE, memory_order_relaxed);
+    run_next(device.instance);
+
+    return TI_ERRC_NONE;
+}
+
+int spi_submit_isr(struct spi_async_transfer_t *transfer) {
+    if ((transfer == NULL) || !IS_VALID_DEVICE(transfer->device)) return TI_ERRC_INVALID_ARG;
+    if (!spi_hw_nss_accepts(transfer->device)) return TI_ERRC_INVALID_ARG;
+
+    uint8_t instance = transfer->device.instance;
+    spi_queue_t *queue = &spi_queues[instance];
+    if (!push(queue, transfer)) return TI_ERRC_BUSY;
+
+    // If the bus is idle, start it now. Otherwise the current holder drains the queue when done.
+    if (try_reserve(queue, OWNER_QUEUE)) run_next(instance);
+
+    return TI_ERRC_NONE;
+}
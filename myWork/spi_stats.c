@@ -0,0 +1,217 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2025 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file modules/mcu/src/spi_stats.c
+ * @authors Jude Merritt
+ * @brief SPI bus utilization and latency counters
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "include/mmio.h"
+#include "include/errc.h"
+#include "include/spi.h"
+#include "myWork/cpu.h"
+
+#if SPI_STATS_ENABLED
+
+typedef struct {
+    spi_device_t device;
+    bool in_use;
+    uint32_t block_start; // Cycle count when spi_block() was entered
+    spi_stats_t stats;
+} spi_device_stats_t;
+
+// Transfers on an instance are serialized by spi_block(), so one set of timestamps per instance
+// covers every device. Unregistered devices share block_start, which is only exact while they
+// do not contend with each other for the bus.
+typedef struct {
+    uint32_t block_start; // spi_block() entry of an unregistered device
+    uint32_t owner_start; // spi_block() entry of the device that holds the bus
+    uint32_t xfer_start;  // Cycle count when the current transfer started
+} spi_instance_timing_t;
+
+// The end-of-transfer hook may run from a DMA ISR, so updates and snapshots mask interrupts.
+static spi_stats_t instance_stats[SPI_INSTANCE_COUNT + 1];
+static spi_instance_timing_t instance_timing[SPI_INSTANCE_COUNT + 1];
+static spi_device_stats_t device_stats[SPI_STATS_MAX_DEVICES];
+static uint32_t core_clk_freq; // CYCCNT rate, set by spi_stats_init()
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+
+static spi_device_stats_t *find_device(spi_device_t device) {
+    for (int i = 0; i < SPI_STATS_MAX_DEVICES; i++) {
+        if (device_stats[i].in_use &&
+            device_stats[i].device.instance == device.instance &&
+            device_stats[i].device.gpio_pin == device.gpio_pin) {
+            return &device_stats[i];
+        }
+    }
+    return NULL;
+}
+
+// Maps a latency to a histogram bin: bin n holds latencies below 2^n us, the last bin holds the rest.
+static inline uint8_t latency_bin(uint32_t cycles) {
+    uint32_t us = (uint32_t)(((uint64_t)cycles * 1000000U) / core_clk_freq);
+    uint8_t bin = 0;
+
+    while ((bin < SPI_STATS_HIST_BINS - 1) && (us >= (1U << bin))) bin++;
+
+    return bin;
+}
+
+static inline void record_block(spi_stats_t *stats, uint32_t wait) {
+    stats->blocks++;
+    stats->block_wait_cycles += wait;
+    if (wait > stats->block_wait_max) stats->block_wait_max = wait;
+}
+
+static inline void record_xfer(spi_stats_t *stats, uint32_t wire, uint32_t latency, size_t size) {
+    stats->transactions++;
+    stats->bytes += size;
+    stats->wire_cycles += wire;
+    if (wire > stats->wire_max) stats->wire_max = wire;
+    stats->latency_hist[latency_bin(latency)]++;
+}
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
+
+int spi_stats_init(uint32_t clk_freq) {
+    if (clk_freq < 1000000U) return TI_ERRC_INVALID_ARG;
+
+    core_clk_freq = clk_freq;
+    dwt_enable();
+    *CPU_DWT_CYCCNT = 0U;
+
+    memset(instance_stats, 0, sizeof(instance_stats));
+    memset(instance_timing, 0, sizeof(instance_timing));
+    memset(device_stats, 0, sizeof(device_stats));
+
+    return TI_ERRC_NONE;
+}
+
+int spi_stats_register_device(spi_device_t device) {
+    if (!IS_VALID_DEVICE(device)) return TI_ERRC_INVALID_ARG;
+    if (find_device(device) != NULL) return TI_ERRC_NONE;
+
+    for (int i = 0; i < SPI_STATS_MAX_DEVICES; i++) {
+        if (!device_stats[i].in_use) {
+            memset(&device_stats[i], 0, sizeof(device_stats[i]));
+            device_stats[i].device = device;
+            device_stats[i].in_use = true;
+            return TI_ERRC_NONE;
+        }
+    }
+
+    return TI_ERRC_NO_MEM;
+}
+
+// Instance totals count every device; only the per-device record depends on registration.
+void spi_stats_block_begin(spi_device_t device) {
+    if (!IS_VALID_DEVICE(device)) return;
+
+    uint32_t start = dwt_cycles();
+    spi_device_stats_t *dev = find_device(device);
+    if (dev != NULL) {
+        dev->block_start = start;
+    } else {
+        instance_timing[device.instance].block_start = start;
+    }
+}
+
+void spi_stats_block_end(spi_device_t device) {
+    if (!IS_VALID_DEVICE(device)) return;
+
+    spi_device_stats_t *dev = find_device(device);
+    spi_instance_timing_t *timing = &instance_timing[device.instance];
+    uint32_t start = (dev != NULL) ? dev->block_start : timing->block_start;
+
+    // Unsigned subtraction handles CYCCNT wrap-around
+    uint32_t wait = dwt_cycles() - start;
+
+    uint32_t primask = irq_save();
+    timing->owner_start = start;
+    record_block(&instance_stats[device.instance], wait);
+    if (dev != NULL) record_block(&dev->stats, wait);
+    irq_restore(primask);
+}
+
+void spi_stats_xfer_begin(spi_device_t device) {
+    if (!IS_VALID_DEVICE(device)) return;
+
+    instance_timing[device.instance].xfer_start = dwt_cycles();
+}
+
+void spi_stats_xfer_end(spi_device_t device, size_t size) {
+    if (!IS_VALID_DEVICE(device)) return;
+
+    spi_device_stats_t *dev = find_device(device);
+    spi_instance_timing_t *timing = &instance_timing[device.instance];
+
+    uint32_t end = dwt_cycles();
+    uint32_t wire = end - timing->xfer_start;
+    uint32_t latency = end - timing->owner_start;
+
+    uint32_t primask = irq_save();
+    record_xfer(&instance_stats[device.instance], wire, latency, size);
+    if (dev != NULL) record_xfer(&dev->stats, wire, latency, size);
+    irq_restore(primask);
+}
+
+int spi_get_stats(uint8_t instance, spi_stats_t *stats) {
+    if ((instance < 1) || (instance > SPI_INSTANCE_COUNT) || (stats == NULL)) return TI_ERRC_INVALID_ARG;
+
+    uint32_t primask = irq_save();
+    *stats = instance_stats[instance];
+    irq_restore(primask);
+
+    return TI_ERRC_NONE;
+}
+
+int spi_get_device_stats(spi_device_t device, spi_stats_t *stats) {
+    if (stats == NULL) return TI_ERRC_INVALID_ARG;
+
+    spi_device_stats_t *dev = find_device(device);
+    if (dev == NULL) return TI_ERRC_INVALID_ARG;
+
+    uint32_t primask = irq_save();
+    *stats = dev->stats;
+    irq_restore(primask);
+
+    return TI_ERRC_NONE;
+}
+
+int spi_reset_stats(uint8_t instance) {
+    if ((instance < 1) || (instance > SPI_INSTANCE_COUNT)) return TI_ERRC_INVALID_ARG;
+
+    uint32_t primask = irq_save();
+    memset(&instance_stats[instance], 0, sizeof(spi_stats_t));
+    for (int i = 0; i < SPI_STATS_MAX_DEVICES; i++) {
+        if (device_stats[i].in_use && device_stats[i].device.instance == instance) {
+            memset(&device_stats[i].stats, 0, sizeof(spi_stats_t));
+        }
+    }
+    irq_restore(primask);
+
+    return TI_ERRC_NONE;
+}
+
+#endif
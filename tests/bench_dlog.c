@@ -0,0 +1,69 @@
+/**
+ * @file tests/bench_dlog.c
+ * @brief Host cost of a DLOG() call (misc./dlog.c), the part of the deferred log that runs in
+ * the caller, e.g. an ISR.
+ *
+ * Records are written in batches that fit the ring, and only the DLOG() calls are timed. The
+ * ring is drained between batches by dlog_flush() into a transmit queue that discards them.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "misc./dlog.h"
+
+#define BATCH   64      // Records per timed batch; five words each still fit DLOG_RING_WORDS
+#define BATCHES 200000
+
+_Static_assert(BATCH * (DLOG_MAX_ARGS + 1) <= DLOG_RING_WORDS, "a batch must fit the ring");
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// dlog_flush() hands frames to the UART transmit queue, which is not under test here
+bool uart_tx_queue_write(uart_channel_t channel, const uint8_t *data, size_t size) {
+    (void)channel;
+    (void)data;
+    (void)size;
+    return true;
+}
+
+static void batch_0(uint32_t b) {
+    (void)b;
+    for (uint32_t i = 0; i < BATCH; i++) DLOG("tick");
+}
+
+static void batch_2(uint32_t b) {
+    for (uint32_t i = 0; i < BATCH; i++) DLOG("sample %u at %u", i, b);
+}
+
+static void batch_4(uint32_t b) {
+    for (uint32_t i = 0; i < BATCH; i++) DLOG("imu %d %d %d %u", i, -(int)i, (int)b, b ^ i);
+}
+
+static void measure(const char *name, void (*batch)(uint32_t)) {
+    double elapsed = 0;
+
+    // One untimed round first, so page faults and cold caches are not counted
+    batch(0);
+    dlog_flush(UART1);
+
+    for (uint32_t b = 0; b < BATCHES; b++) {
+        double start = now_s();
+        batch(b);
+        elapsed += now_s() - start;
+        dlog_flush(UART1);
+    }
+    printf("%-12s %6.1f ns/record\n", name, elapsed / ((double)BATCH * BATCHES) * 1e9);
+}
+
+int main(void) {
+    measure("0 arguments", batch_0);
+    measure("2 arguments", batch_2);
+    measure("4 arguments", batch_4);
+
+    if (dlog_dropped() != 0) printf("%u records dropped\n", dlog_dropped());
+    return 0;
+}
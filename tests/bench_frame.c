@@ -0,0 +1,58 @@
+/**
+ * @file tests/bench_frame.c
+ * @brief Host throughput of frame_encode() and frame_decoder_feed() (misc./frame.c).
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "misc./frame.h"
+
+#define TOTAL_BYTES (64U * 1024U * 1024U) // Payload bytes per measurement
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void count_frame(const uint8_t *payload, size_t size, void *context) {
+    (void)payload;
+    *(size_t *)context += size;
+}
+
+int main(void) {
+    static uint8_t payload[1024];
+    static uint8_t wire[FRAME_MAX_ENCODED(1024)];
+    static uint8_t decoded[1024 + FRAME_CRC_SIZE];
+    const size_t sizes[] = {16, 64, 256, 1024};
+
+    // Telemetry-like content: mostly non-zero with the odd zero byte
+    for (size_t i = 0; i < sizeof(payload); i++) payload[i] = (uint8_t)((i * 37) % 23);
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t size = sizes[s];
+        size_t frames = TOTAL_BYTES / size;
+        size_t length = 0;
+
+        double start = now_s();
+        for (size_t i = 0; i < frames; i++) {
+            payload[0] = (uint8_t)i; // Keep the compiler from hoisting the encode
+            length = frame_encode(wire, sizeof(wire), payload, size);
+        }
+        double encode = now_s() - start;
+
+        frame_decoder_t decoder;
+        frame_decoder_init(&decoder, decoded, sizeof(decoded));
+        size_t delivered = 0;
+        start = now_s();
+        for (size_t i = 0; i < frames; i++) frame_decoder_feed(&decoder, wire, length, count_frame, &delivered);
+        double decode = now_s() - start;
+
+        printf("%4zu-byte payloads: encode %7.1f MB/s (%5.1f ns/frame), decode %7.1f MB/s, "
+               "%zu bytes on the wire\n",
+               size, TOTAL_BYTES / encode / 1e6, encode / frames * 1e9, TOTAL_BYTES / decode / 1e6,
+               length);
+        if (delivered != frames * size) printf("  decoder delivered %zu bytes, expected %zu\n", delivered, frames * size);
+    }
+    return 0;
+}
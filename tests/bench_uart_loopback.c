@@ -0,0 +1,142 @@
+/**
+ * @file tests/bench_uart_loopback.c
+ * @brief Blocking UART write throughput against a register-level model of USART1 in loopback.
+ *
+ * Compares sending byte by byte with uart_write_byte(), which waits for TC after every byte, to
+ * uart_write_blocking(), which keeps the 16-byte TX FIFO topped up and waits for TC once. The
+ * driver runs unchanged; its register accesses trap into the model (host_periph.c). Time is
+ * virtual: every register access costs ACCESS_NS (an estimate for an APB access from the M7),
+ * and the transmitter shifts one 10-bit character per baud period. The bytes that leave the
+ * transmitter are looped back and compared with what was sent.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "host_periph.h"
+#include "misc./uart.h"
+
+#define ACCESS_NS  25.0
+#define FIFO_DEPTH 16
+#define BYTES      2048U
+#define CLK_FREQ   100000000U
+
+typedef struct {
+    double now;         // Virtual time in ns
+    double char_ns;
+    double shift_end;   // When the character in the shift register is out, 0 when idle
+    uint8_t shifting;
+    uint8_t fifo[FIFO_DEPTH];
+    int fifo_head;
+    int fifo_count;
+    bool polling;       // The last access was an ISR read and nothing has changed since
+    uint8_t loopback[BYTES];
+    size_t received;
+    uint32_t overflows;
+} uart_model_t;
+
+static uart_model_t model;
+
+static void advance(uart_model_t *m) {
+    while ((m->shift_end != 0) && (m->shift_end <= m->now)) {
+        if (m->received < BYTES) m->loopback[m->received++] = m->shifting;
+
+        if (m->fifo_count > 0) {
+            m->shifting = m->fifo[m->fifo_head];
+            m->fifo_head = (m->fifo_head + 1) % FIFO_DEPTH;
+            m->fifo_count--;
+            m->shift_end += m->char_ns;
+        } else {
+            m->shift_end = 0;
+        }
+    }
+}
+
+static void before_access(volatile uint32_t *reg, bool write, void *context) {
+    uart_model_t *m = context;
+
+    m->now += ACCESS_NS;
+    if (reg != (volatile uint32_t *)USARTx_ISR[UART1] || write) {
+        m->polling = false;
+        advance(m);
+        return;
+    }
+
+    // A loop polling an unchanged ISR only burns time until the next character is out
+    if (m->polling && (m->shift_end > m->now)) m->now = m->shift_end;
+    m->polling = true;
+    advance(m);
+
+    uint32_t isr = 0;
+    if (m->fifo_count < FIFO_DEPTH) isr |= UARTx_ISR_TXE.msk; // TXFNF in FIFO mode
+    if (m->fifo_count <= FIFO_DEPTH / 2) isr |= UARTx_ISR_TXFT.msk;
+    if ((m->shift_end == 0) && (m->fifo_count == 0)) isr |= UARTx_ISR_TC.msk;
+    *reg = isr;
+}
+
+static void after_access(volatile uint32_t *reg, bool write, void *context) {
+    uart_model_t *m = context;
+
+    if (!write || reg != (volatile uint32_t *)USARTx_TDR[UART1]) return;
+
+    uint8_t data = (uint8_t)*reg;
+    if (m->shift_end == 0) {
+        m->shifting = data;
+        m->shift_end = m->now + m->char_ns;
+    } else if (m->fifo_count < FIFO_DEPTH) {
+        m->fifo[(m->fifo_head + m->fifo_count) % FIFO_DEPTH] = data;
+        m->fifo_count++;
+    } else {
+        m->overflows++;
+    }
+}
+
+static bool send_bytewise(uint8_t *data, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++) {
+        if (!uart_write_byte(UART1, data[i])) return false;
+    }
+    return true;
+}
+
+static bool send_fifo(uint8_t *data, uint32_t size) {
+    return uart_write_blocking(UART1, data, size);
+}
+
+static void run(const char *name, bool (*send)(uint8_t *, uint32_t), uint32_t baud) {
+    static uint8_t data[BYTES];
+    for (uint32_t i = 0; i < BYTES; i++) data[i] = (uint8_t)(i * 7 + 3);
+
+    uart_config_t config = {
+        .channel = UART1,
+        .parity = UART_PARITY_DISABLED,
+        .data_length = UART_DATALENGTH_8,
+        .clk_freq = CLK_FREQ,
+        .baud_rate = baud,
+    };
+    uart_baud_t actual;
+    if (!uart_init(&config, NULL, NULL, NULL) || !uart_get_baud(UART1, &actual)) {
+        printf("%-20s %8u baud: uart_init failed\n", name, baud);
+        return;
+    }
+
+    memset(&model, 0, sizeof(model));
+    model.char_ns = 10.0 * 1e9 / actual.actual_baud;
+    host_periph_trap((uintptr_t)USARTx_ISR[UART1], before_access, after_access, &model);
+    bool ok = send(data, BYTES);
+    host_periph_untrap();
+
+    bool intact = (model.received == BYTES) && (memcmp(model.loopback, data, BYTES) == 0);
+    double rate = BYTES / (model.now * 1e-9);
+    printf("%-20s %8u baud: %9.0f bytes/s, %5.1f%% of the line rate%s\n", name, baud, rate,
+           100.0 * rate / (actual.actual_baud / 10.0),
+           (!ok || !intact || model.overflows) ? "  (LOOPBACK MISMATCH)" : "");
+}
+
+int main(void) {
+    const uint32_t bauds[] = {115200, 921600, 3125000};
+
+    for (size_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+        run("uart_write_byte", send_bytewise, bauds[i]);
+        run("uart_write_blocking", send_fifo, bauds[i]);
+    }
+    return 0;
+}
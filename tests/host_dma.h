@@ -0,0 +1,27 @@
+/**
+ * @file tests/host_dma.h
+ * @brief Host stand-in for the DMA transfer functions. A started transfer stays pending until
+ * the test completes it with host_dma_complete(), which runs the callback the way the DMA ISR
+ * would. Stream claims go through the real allocator (myWork/dma_alloc.c).
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "include/dma.h"
+
+typedef struct {
+    bool active;
+    bool continuous;
+    dma_transfer_t transfer; // The last transfer started
+    uint32_t remaining;      // What dma_get_remaining() returns
+    uint32_t starts;
+} host_dma_stream_t;
+
+extern host_dma_stream_t host_dma[DMA_INSTANCE_COUNT + 1][DMA_STREAM_COUNT];
+
+// Ends the pending single transfer on a stream. Returns false if none was running.
+bool host_dma_complete(uint8_t instance, uint8_t stream, bool success);
+
+// Sum of host_dma[][].starts
+uint32_t host_dma_starts(void);
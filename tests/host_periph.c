@@ -0,0 +1,114 @@
+/**
+ * @file tests/host_periph.c
+ * @brief Traps driver accesses to one register page (see host_periph.h).
+ *
+ * SIGSEGV fires before the faulting access: the page is opened, the before hook runs and the
+ * trap flag is set. The access then executes and SIGTRAP fires after it: the after hook runs and
+ * the page is closed again.
+ */
+
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include "host_periph.h"
+
+#define PAGE_SIZE 4096U
+#define EFLAGS_TF 0x100
+#define PF_WRITE  0x2 // Page fault error code: the access was a write
+
+static uintptr_t page;
+static host_periph_hook_t before_hook;
+static host_periph_hook_t after_hook;
+static void *hook_context;
+
+static volatile uint32_t *pending_reg;
+static bool pending_write;
+static unsigned pending_size;
+
+// Decodes the width of the faulting instruction. Only the forms compilers emit for volatile
+// register accesses are recognized (mov, movzx/movsx and byte compares); anything else is
+// taken to be a 32-bit access.
+static unsigned decode_size(const uint8_t *ip) {
+    unsigned size = 4;
+    for (;; ip++) {
+        if (*ip == 0x66) {
+            size = 2;
+        } else if ((*ip & 0xF0) == 0x40) {
+            if (*ip & 0x08) size = 8; // REX.W
+        } else if ((*ip != 0x67) && (*ip != 0x2E) && (*ip != 0x3E) && (*ip != 0x64) && (*ip != 0x65)) {
+            break;
+        }
+    }
+
+    switch (ip[0]) {
+        case 0x38: case 0x3A: case 0x80: case 0x84: case 0x88: case 0x8A: case 0xC6: case 0xF6:
+            return 1;
+        case 0x0F:
+            if ((ip[1] == 0xB6) || (ip[1] == 0xBE)) return 1;
+            if ((ip[1] == 0xB7) || (ip[1] == 0xBF)) return 2;
+            return size;
+        default:
+            return size;
+    }
+}
+
+static void on_segv(int sig, siginfo_t *info, void *uctx) {
+    ucontext_t *uc = uctx;
+    uintptr_t addr = (uintptr_t)info->si_addr;
+    (void)sig;
+
+    if ((page == 0) || (addr < page) || (addr >= page + PAGE_SIZE)) {
+        fprintf(stderr, "host_periph: fault at %p outside the trapped page\n", info->si_addr);
+        abort();
+    }
+
+    mprotect((void *)page, PAGE_SIZE, PROT_READ | PROT_WRITE);
+    pending_reg = (volatile uint32_t *)(addr & ~(uintptr_t)3);
+    pending_write = (uc->uc_mcontext.gregs[REG_ERR] & PF_WRITE) != 0;
+    pending_size = decode_size((const uint8_t *)uc->uc_mcontext.gregs[REG_RIP]);
+    if (before_hook != NULL) before_hook(pending_reg, pending_write, hook_context);
+
+    uc->uc_mcontext.gregs[REG_EFL] |= EFLAGS_TF;
+}
+
+static void on_trap(int sig, siginfo_t *info, void *uctx) {
+    ucontext_t *uc = uctx;
+    (void)sig;
+    (void)info;
+
+    uc->uc_mcontext.gregs[REG_EFL] &= ~EFLAGS_TF;
+    if (after_hook != NULL) after_hook(pending_reg, pending_write, hook_context);
+    mprotect((void *)page, PAGE_SIZE, PROT_NONE);
+}
+
+bool host_periph_trap(uintptr_t base, host_periph_hook_t before, host_periph_hook_t after,
+                      void *context) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_flags = SA_SIGINFO;
+
+    sa.sa_sigaction = on_segv;
+    if (sigaction(SIGSEGV, &sa, NULL) != 0) return false;
+    sa.sa_sigaction = on_trap;
+    if (sigaction(SIGTRAP, &sa, NULL) != 0) return false;
+
+    page = base & ~(uintptr_t)(PAGE_SIZE - 1);
+    before_hook = before;
+    after_hook = after;
+    hook_context = context;
+
+    return mprotect((void *)page, PAGE_SIZE, PROT_NONE) == 0;
+}
+
+void host_periph_untrap(void) {
+    if (page != 0) mprotect((void *)page, PAGE_SIZE, PROT_READ | PROT_WRITE);
+    page = 0;
+}
+
+unsigned host_periph_access_size(void) {
+    return pending_size;
+}
@@ -0,0 +1,24 @@
+/**
+ * @file tests/host_periph.h
+ * @brief Register-level peripheral models for host tests and benchmarks.
+ *
+ * One 4 KiB page of the memory behind mmio.h (host_mmio.c) is made inaccessible, and every
+ * driver access to it traps. The model's hooks run before the access, to update status
+ * registers the driver is about to read, and after it, to consume what the driver wrote. The
+ * driver code runs unchanged. x86-64 Linux only, since the access is single-stepped.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef void (*host_periph_hook_t)(volatile uint32_t *reg, bool write, void *context);
+
+// Traps accesses to the page holding base. Only one page can be trapped at a time.
+bool host_periph_trap(uintptr_t base, host_periph_hook_t before, host_periph_hook_t after,
+                      void *context);
+
+void host_periph_untrap(void);
+
+// Width in bytes of the access being trapped (1, 2, 4 or 8). Only valid inside a hook.
+unsigned host_periph_access_size(void);
@@ -0,0 +1,35 @@
+/**
+ * @file tests/stubs/hal/gpio.c
+ * @brief Host stand-in for the GPIO driver. See gpio.h.
+ */
+
+#include "gpio.h"
+
+volatile int host_pins[HOST_PIN_COUNT] = {[0 ... HOST_PIN_COUNT - 1] = 1};
+volatile int host_pin_modes[HOST_PIN_COUNT];
+
+void tal_enable_clock(int pin) {
+    (void)pin;
+}
+
+void tal_set_mode(int pin, int mode) {
+    host_pin_modes[pin % HOST_PIN_COUNT] = mode;
+}
+
+void tal_alternate_mode(int pin, int af) {
+    (void)pin;
+    (void)af;
+}
+
+void tal_set_drain(int pin, int drain) {
+    (void)pin;
+    (void)drain;
+}
+
+void tal_set_pin(int pin, int value) {
+    __atomic_store_n(&host_pins[pin % HOST_PIN_COUNT], value, __ATOMIC_SEQ_CST);
+}
+
+bool tal_read_pin(int pin) {
+    return __atomic_load_n(&host_pins[pin % HOST_PIN_COUNT], __ATOMIC_SEQ_CST) != 0;
+}
@@ -0,0 +1,21 @@
+/**
+ * @file tests/stubs/hal/gpio.h
+ * @brief Host stand-in for the GPIO driver. Pin writes are recorded in host_pins so tests can
+ * check chip selects and bit-banged recovery sequences.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HOST_PIN_COUNT 256
+
+extern volatile int host_pins[HOST_PIN_COUNT];      // Last value written, 1 after reset
+extern volatile int host_pin_modes[HOST_PIN_COUNT]; // Last mode set (1 output, 2 alternate)
+
+void tal_enable_clock(int pin);
+void tal_set_mode(int pin, int mode);
+void tal_alternate_mode(int pin, int af);
+void tal_set_drain(int pin, int drain);
+void tal_set_pin(int pin, int value);
+bool tal_read_pin(int pin);
@@ -0,0 +1,25 @@
+/**
+ * @file tests/stubs/internal/dma.h
+ * @brief The flight software's internal/dma.h: include/dma.h plus the peripheral stream types
+ * that misc./ takes from it. Only the fields the drivers in this repository use are declared.
+ */
+
+#pragma once
+#include "include/dma.h"
+
+typedef struct {
+    uint8_t instance;
+    uint8_t stream;
+    dma_direction_t direction;
+    uint8_t src_data_size;
+    uint8_t dest_data_size;
+    uint8_t priority;
+    dma_fifo_threshold_t fifo_threshold;
+} periph_dma_config_t;
+
+typedef struct {
+    uint8_t rx_instance;
+    uint8_t tx_instance;
+    uint8_t rx_stream;
+    uint8_t tx_stream;
+} dma_periph_streaminfo_t;
@@ -0,0 +1,3 @@
+// The drivers include dma.h by its path in the full flight software tree
+#pragma once
+#include "include/dma.h"
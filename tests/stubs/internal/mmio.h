@@ -0,0 +1,3 @@
+// The drivers include mmio.h by its path in the full flight software tree
+#pragma once
+#include "include/mmio.h"
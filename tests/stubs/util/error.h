@@ -0,0 +1,2 @@
+// misc./ includes the flight software's error reporting, which the drivers here do not call
+#pragma once
@@ -0,0 +1,3 @@
+// The drivers include errc.h by its path in the full flight software tree
+#pragma once
+#include "include/errc.h"
@@ -0,0 +1,37 @@
+/**
+ * @file tests/test.h
+ * @brief Minimal assertion helpers for the host tests. A failed CHECK() reports and carries on,
+ * so one run lists every broken case; TEST_MAIN_END returns the failure count to make.
+ */
+
+#pragma once
+#include <stdio.h>
+
+static int test_failures;
+
+#define CHECK(cond)                                                                     \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);    \
+            test_failures++;                                                            \
+        }                                                                               \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                      \
+    do {                                                                                \
+        long long _a = (long long)(actual), _e = (long long)(expected);                 \
+        if (_a != _e) {                                                                 \
+            fprintf(stderr, "%s:%d: %s == %lld, expected %lld\n", __FILE__, __LINE__,   \
+                    #actual, _a, _e);                                                   \
+            test_failures++;                                                            \
+        }                                                                               \
+    } while (0)
+
+#define RUN(test)                                                                       \
+    do {                                                                                \
+        int _before = test_failures;                                                    \
+        test();                                                                         \
+        printf("%-48s %s\n", #test, (test_failures == _before) ? "ok" : "FAILED");     \
+    } while (0)
+
+#define TEST_MAIN_END return (test_failures != 0)
@@ -0,0 +1,185 @@
+/**
+ * @file tests/test_dlog.c
+ * @brief End-to-end test of the deferred binary log: DLOG() and dlog_flush() (misc./dlog.c) on
+ * one side, the host decoder (tools/dlog_decode.c) on the other.
+ *
+ * The test is linked without PIE, so its own format strings sit below 4 GiB as on the target, and
+ * the decoder reads them from the .dlog_fmt section of this executable.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "test.h"
+#include "misc./dlog.h"
+#include "misc./frame.h"
+#include "tools/dlog_decode.h"
+
+#define MAX_LINES 1024
+
+static uint8_t wire[64 * 1024];
+static size_t wire_length;
+static bool queue_full;
+
+static char lines[MAX_LINES][160];
+static size_t line_count;
+static dlog_table_t table;
+
+// Stands in for the UART TX queue that dlog_flush() writes to
+bool uart_tx_queue_write(uart_channel_t channel, const uint8_t *data, size_t size) {
+    (void)channel;
+    if (queue_full || wire_length + size > sizeof(wire)) return false;
+    memcpy(wire + wire_length, data, size);
+    wire_length += size;
+    return true;
+}
+
+static void collect(const char *line, void *context) {
+    (void)context;
+    if (line_count < MAX_LINES) snprintf(lines[line_count++], sizeof(lines[0]), "%s", line);
+}
+
+static void on_frame(const uint8_t *payload, size_t size, void *context) {
+    dlog_decode_batch(context, payload, size);
+}
+
+// Flushes the ring and decodes everything that went out on the wire
+static void flush_and_decode(dlog_decoder_t *decoder) {
+    static uint8_t buffer[1024];
+    frame_decoder_t frames;
+
+    wire_length = 0;
+    line_count = 0;
+    dlog_flush(UART1);
+    frame_decoder_init(&frames, buffer, sizeof(buffer));
+    frame_decoder_feed(&frames, wire, wire_length, on_frame, decoder);
+    CHECK_EQ(frames.stats.crc_errors + frames.stats.format_errors, 0);
+}
+
+static void test_elf_table(void) {
+    uint32_t id = DLOG_ID("looked up %u");
+    const char *format = dlog_table_find(&table, id);
+
+    CHECK(table.count >= 8);
+    CHECK(format != NULL && strcmp(format, "looked up %u") == 0);
+    CHECK(dlog_table_find(&table, id + DLOG_FMT_ALIGN) == NULL ||
+          strcmp(dlog_table_find(&table, id + DLOG_FMT_ALIGN), "looked up %u") != 0);
+}
+
+static void test_round_trip(void) {
+    dlog_decoder_t decoder = {.table = &table, .emit = collect};
+    const char *expected[] = {
+        "boot",
+        "x=-5 y=7",
+        "reg DEADBEEF 0x10",
+        "ok  3.14%",
+        "-1 9029    9",
+        "name (str 0x00001234)",
+        "1 <?>",
+        "ends with a newline",
+    };
+
+    CHECK(DLOG("boot"));
+    CHECK(DLOG("x=%d y=%u", (uint32_t)-5, 7));
+    CHECK(DLOG("reg %08X %#x", 0xDEADBEEF, 0x10));
+    CHECK(DLOG("%c%c %5.2f%%", 'o', 'k', dlog_f32(3.14159f)));
+    CHECK(DLOG("%hhd %hu %*d", 0x1FF, 0x12345, 4, 9));
+    CHECK(DLOG("name %s", 0x1234));
+    CHECK(DLOG("%d %d", 1));
+    CHECK(DLOG("ends with a newline\n"));
+
+    flush_and_decode(&decoder);
+    CHECK_EQ(line_count, sizeof(expected) / sizeof(expected[0]));
+    for (size_t i = 0; i < line_count && i < sizeof(expected) / sizeof(expected[0]); i++) {
+        if (strcmp(lines[i], expected[i]) != 0) {
+            fprintf(stderr, "line %zu: \"%s\", expected \"%s\"\n", i, lines[i], expected[i]);
+            test_failures++;
+        }
+    }
+    CHECK_EQ(decoder.unknown + decoder.malformed, 0);
+}
+
+static void test_many_batches_in_order(void) {
+    dlog_decoder_t decoder = {.table = &table, .emit = collect};
+    char expected[32];
+
+    // More than one frame's worth, and past the end of the ring so records get padded
+    for (uint32_t round = 0; round < 3; round++) {
+        for (uint32_t i = 0; i < 100; i++) CHECK(DLOG("seq %u of %u", round * 100 + i, 300));
+        flush_and_decode(&decoder);
+        CHECK_EQ(line_count, 100);
+        for (uint32_t i = 0; i < line_count; i++) {
+            snprintf(expected, sizeof(expected), "seq %u of 300", round * 100 + i);
+            CHECK(strcmp(lines[i], expected) == 0);
+        }
+    }
+    CHECK_EQ(decoder.records, 300);
+}
+
+static void test_drops_are_reported(void) {
+    dlog_decoder_t decoder = {.table = &table, .emit = collect, .dropped = dlog_dropped()};
+    uint32_t accepted = 0;
+    char expected[32];
+
+    while (DLOG("fill %u", accepted)) accepted++;
+    CHECK(!DLOG("fill %u", accepted));
+    CHECK(!DLOG("fill %u", accepted));
+
+    flush_and_decode(&decoder);
+    CHECK_EQ(line_count, accepted + 1);
+    CHECK(strcmp(lines[0], "dlog: 3 records dropped") == 0);
+    CHECK(strcmp(lines[1], "fill 0") == 0);
+    snprintf(expected, sizeof(expected), "fill %u", accepted - 1);
+    CHECK(strcmp(lines[accepted], expected) == 0);
+}
+
+static void test_table_file_round_trip(void) {
+    dlog_table_t loaded = {0};
+    uint32_t id = DLOG_ID("tab\there\\ and \x01 newline\n");
+    FILE *file = tmpfile();
+
+    dlog_table_write(&table, file);
+    rewind(file);
+    CHECK(dlog_table_load(&loaded, file));
+    fclose(file);
+
+    CHECK_EQ(loaded.count, table.count);
+    for (size_t i = 0; i < loaded.count && i < table.count; i++) {
+        CHECK_EQ(loaded.formats[i].address, table.formats[i].address);
+        CHECK(strcmp(loaded.formats[i].format, table.formats[i].format) == 0);
+    }
+    CHECK(strcmp(dlog_table_find(&loaded, id), "tab\there\\ and \x01 newline\n") == 0);
+    dlog_table_free(&loaded);
+}
+
+static void test_unknown_and_malformed(void) {
+    dlog_decoder_t decoder = {.table = &table, .emit = collect};
+    const uint8_t unknown[] = {0, 0, 0, 0, 0x32, 0x12, 0, 0, 5, 0, 0, 0};
+    const uint8_t truncated[] = {0, 0, 0, 0, 0x33, 0x12, 0, 0, 5, 0, 0, 0};
+    const uint8_t ragged[] = {0, 0, 0, 0, 1};
+
+    line_count = 0;
+    CHECK_EQ(dlog_decode_batch(&decoder, unknown, sizeof(unknown)), 1);
+    CHECK(strcmp(lines[0], "<unknown format 0x00001230> 0x00000005") == 0);
+    CHECK_EQ(decoder.unknown, 1);
+
+    CHECK_EQ(dlog_decode_batch(&decoder, truncated, sizeof(truncated)), 0);
+    CHECK_EQ(dlog_decode_batch(&decoder, ragged, sizeof(ragged)), 0);
+    CHECK_EQ(decoder.malformed, 2);
+    CHECK_EQ(line_count, 1);
+}
+
+int main(void) {
+    if (!dlog_table_load_elf(&table, "/proc/self/exe")) {
+        fprintf(stderr, "no .dlog_fmt section in /proc/self/exe\n");
+        return 1;
+    }
+
+    RUN(test_elf_table);
+    RUN(test_round_trip);
+    RUN(test_many_batches_in_order);
+    RUN(test_drops_are_reported);
+    RUN(test_table_file_round_trip);
+    RUN(test_unknown_and_malformed);
+    dlog_table_free(&table);
+    TEST_MAIN_END;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file tests/test_dma_alloc.c
+ * @brief Tests of the DMA stream allocator (myWork/dma_alloc.c), including concurrent claims.
+ *
+ * Owner threads claim, use and release streams the way drivers do at init and per transfer,
+ * while borrower threads take single transfers with dma_borrow_stream(). Every successful claim
+ * and every transfer marks the stream in a shadow table; finding the mark already set means the
+ * allocator handed the same stream out twice.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "test.h"
+#include "include/errc.h"
+#include "include/dma.h"
+
+#define OWNERS      4
+#define BORROWERS   2
+#define ITERATIONS  20000
+
+static atomic_bool owned[DMA_INSTANCE_COUNT + 1][DMA_STREAM_COUNT];
+static atomic_bool running[DMA_INSTANCE_COUNT + 1][DMA_STREAM_COUNT];
+static atomic_uint owned_count;
+static atomic_uint violations;
+static atomic_uint borrows;
+static atomic_bool stop_borrowers;
+
+static void mark(atomic_bool *flag) {
+    if (atomic_exchange(flag, true)) atomic_fetch_add(&violations, 1);
+}
+
+static void unmark(atomic_bool *flag) {
+    if (!atomic_exchange(flag, false)) atomic_fetch_add(&violations, 1);
+}
+
+static void *owner_thread(void *arg) {
+    unsigned seed = (unsigned)(uintptr_t)arg;
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        seed = seed * 1103515245U + 12345U;
+        uint8_t priority = (seed >> 16) & 3;
+        uint8_t flags = ((seed >> 18) & 1) ? DMA_CLAIM_SHAREABLE : 0;
+
+        dma_stream_t stream;
+        if (dma_claim_stream(priority, flags, &stream) != TI_ERRC_NONE) {
+            sched_yield();
+            continue;
+        }
+        mark(&owned[stream.instance][stream.stream]);
+        if (atomic_fetch_add(&owned_count, 1) >= DMA_INSTANCE_COUNT * DMA_STREAM_COUNT) {
+            atomic_fetch_add(&violations, 1);
+        }
+
+        // A shareable stream may be lent out, so begin can be refused
+        if (dma_stream_begin(stream) == TI_ERRC_NONE) {
+            mark(&running[stream.instance][stream.stream]);
+            unmark(&running[stream.instance][stream.stream]);
+            if (dma_stream_end(stream) != TI_ERRC_NONE) atomic_fetch_add(&violations, 1);
+        } else if (!flags) {
+            atomic_fetch_add(&violations, 1);
+        }
+
+        atomic_fetch_sub(&owned_count, 1);
+        unmark(&owned[stream.instance][stream.stream]);
+        while (dma_release_stream(stream) == TI_ERRC_BUSY) sched_yield();
+    }
+    return NULL;
+}
+
+static void *borrower_thread(void *arg) {
+    (void)arg;
+    uint8_t priority = 0;
+
+    while (!atomic_load(&stop_borrowers)) {
+        dma_stream_t stream;
+        priority = (priority + 1) & 3;
+        if (dma_borrow_stream(priority, &stream) != TI_ERRC_NONE) {
+            sched_yield();
+            continue;
+        }
+        mark(&running[stream.instance][stream.stream]);
+        sched_yield();
+        unmark(&running[stream.instance][stream.stream]);
+        if (dma_stream_end(stream) != TI_ERRC_NONE) atomic_fetch_add(&violations, 1);
+        atomic_fetch_add(&borrows, 1);
+    }
+    return NULL;
+}
+
+static void test_concurrent_claims(void) {
+    pthread_t owners[OWNERS], borrowers[BORROWERS];
+
+    for (int i = 0; i < BORROWERS; i++) pthread_create(&borrowers[i], NULL, borrower_thread, NULL);
+    for (int i = 0; i < OWNERS; i++) {
+        pthread_create(&owners[i], NULL, owner_thread, (void *)(uintptr_t)(i + 1));
+    }
+    for (int i = 0; i < OWNERS; i++) pthread_join(owners[i], NULL);
+    atomic_store(&stop_borrowers, true);
+    for (int i = 0; i < BORROWERS; i++) pthread_join(borrowers[i], NULL);
+
+    CHECK_EQ(atomic_load(&violations), 0);
+    CHECK(atomic_load(&borrows) > 0);
+
+    // Everything was handed back
+    for (uint8_t inst = 1; inst <= DMA_INSTANCE_COUNT; inst++) {
+        for (uint8_t s = 0; s < DMA_STREAM_COUNT; s++) {
+            dma_stream_t stream = {.instance = inst, .stream = s};
+            CHECK_EQ(dma_claim_specific_stream(stream, 0), TI_ERRC_NONE);
+            CHECK_EQ(dma_release_stream(stream), TI_ERRC_NONE);
+        }
+    }
+}
+
+static void test_claim_order_and_exhaustion(void) {
+    dma_stream_t streams[DMA_INSTANCE_COUNT * DMA_STREAM_COUNT + 1];
+
+    // High priority takes the lowest stream, low priority the highest, alternating controllers
+    CHECK_EQ(dma_claim_stream(3, 0, &streams[0]), TI_ERRC_NONE);
+    CHECK_EQ(streams[0].stream, 0);
+    CHECK_EQ(dma_claim_stream(0, 0, &streams[1]), TI_ERRC_NONE);
+    CHECK_EQ(streams[1].stream, DMA_STREAM_COUNT - 1);
+    CHECK(streams[0].instance != streams[1].instance);
+
+    for (int i = 2; i < DMA_INSTANCE_COUNT * DMA_STREAM_COUNT; i++) {
+        CHECK_EQ(dma_claim_stream(1, 0, &streams[i]), TI_ERRC_NONE);
+    }
+    CHECK_EQ(dma_claim_stream(1, 0, &streams[16]), TI_ERRC_NO_MEM);
+    CHECK_EQ(dma_claim_specific_stream(streams[5], 0), TI_ERRC_BUSY);
+    CHECK_EQ(dma_borrow_stream(1, &streams[16]), TI_ERRC_BUSY);
+
+    for (int i = 0; i < DMA_INSTANCE_COUNT * DMA_STREAM_COUNT; i++) {
+        CHECK_EQ(dma_release_stream(streams[i]), TI_ERRC_NONE);
+    }
+    CHECK_EQ(dma_release_stream(streams[0]), TI_ERRC_INVALID_STATE);
+}
+
+static void test_borrow_shareable(void) {
+    dma_stream_t owner = {.instance = 1, .stream = 3};
+    dma_stream_t borrowed;
+    dma_stream_t rest[DMA_INSTANCE_COUNT * DMA_STREAM_COUNT];
+    int n = 0;
+
+    CHECK_EQ(dma_claim_specific_stream(owner, DMA_CLAIM_SHAREABLE), TI_ERRC_NONE);
+    while (dma_claim_stream(1, 0, &rest[n]) == TI_ERRC_NONE) n++;
+    CHECK_EQ(n, DMA_INSTANCE_COUNT * DMA_STREAM_COUNT - 1);
+
+    // Only the idle shareable stream is left to lend
+    CHECK_EQ(dma_borrow_stream(2, &borrowed), TI_ERRC_NONE);
+    CHECK_EQ(borrowed.instance, owner.instance);
+    CHECK_EQ(borrowed.stream, owner.stream);
+    CHECK_EQ(dma_stream_begin(owner), TI_ERRC_BUSY);
+    CHECK_EQ(dma_release_stream(owner), TI_ERRC_BUSY);
+    CHECK_EQ(dma_stream_end(borrowed), TI_ERRC_NONE);
+
+    // Running transfers keep it from being lent
+    CHECK_EQ(dma_stream_begin(owner), TI_ERRC_NONE);
+    CHECK_EQ(dma_borrow_stream(2, &borrowed), TI_ERRC_BUSY);
+    CHECK_EQ(dma_stream_end(owner), TI_ERRC_NONE);
+    CHECK_EQ(dma_stream_end(owner), TI_ERRC_INVALID_STATE);
+
+    CHECK_EQ(dma_release_stream(owner), TI_ERRC_NONE);
+    while (n > 0) CHECK_EQ(dma_release_stream(rest[--n]), TI_ERRC_NONE);
+}
+
+int main(void) {
+    RUN(test_claim_order_and_exhaustion);
+    RUN(test_borrow_shareable);
+    RUN(test_concurrent_claims);
+    TEST_MAIN_END;
+}
@@ -0,0 +1,160 @@
+/**
+ * @file tests/test_dma_chain.c
+ * @brief Tests of the MDMA request handling in myWork/dma_chain.c.
+ *
+ * The MDMA itself is not simulated. The tests play its part on the registers (see host_mmio.c):
+ * they load the next node's link into CxLAR and raise the block flag, then check whether the
+ * driver issued the software request that the loaded stage is waiting for.
+ */
+
+#include <stdint.h>
+#include "test.h"
+#include "include/errc.h"
+#include "include/dma.h"
+#include "myWork/mdma_regs.h"
+
+#define CHANNEL DMA_MEMCPY_CHANNELS // First chain channel
+
+// Nodes and buffers are kept as 32-bit addresses, so they live in the mapped AXI SRAM
+#define NODES  ((dma_chain_node_t *)0x24000000U)
+#define BUFFER ((uint8_t *)0x24001000U)
+
+static int completions;
+static bool last_success;
+
+// The chain module needs these from dma_mem.c and dma_dispatch.c, which are not under test
+void dma_cache_clean(const void *buffer, size_t size) {
+    (void)buffer;
+    (void)size;
+}
+
+void dma_cache_invalidate(void *buffer, size_t size) {
+    (void)buffer;
+    (void)size;
+}
+
+void dma_notify_complete(uint8_t instance, uint8_t stream, dma_callback_t callback, bool success,
+                         void *context) {
+    (void)instance;
+    (void)stream;
+    callback(success, context);
+}
+
+static void done(bool success, void *context) {
+    (void)context;
+    completions++;
+    last_success = success;
+}
+
+static void build(dma_chain_t *chain, const uint8_t *triggers, uint8_t count) {
+    CHECK_EQ(dma_chain_init(chain, NODES, 8), TI_ERRC_NONE);
+    for (uint8_t i = 0; i < count; i++) {
+        dma_chain_stage_t stage = {
+            .src = BUFFER + 256 * i,
+            .dest = BUFFER + 256 * (i + 1),
+            .size = 64,
+            .src_data_size = 4,
+            .dest_data_size = 4,
+            .trigger = triggers[i],
+            .request_bytes = 16,
+        };
+        CHECK_EQ(dma_chain_append(chain, &stage), TI_ERRC_NONE);
+    }
+}
+
+// Plays the MDMA finishing a block and loading `stage`, then runs the ISR
+static void end_block(const dma_chain_t *chain, uint8_t stage, uint32_t flags) {
+    *MDMA_MDMA_CxLAR[CHANNEL] = chain->nodes[stage].lar;
+    *(volatile uint32_t *)mdma_isr_table[CHANNEL] = flags;
+    *(volatile uint32_t *)MDMA_MDMA_GISR0 = MDMA_MDMA_GISR0_GIFx[CHANNEL].msk;
+    CLR_FIELD(MDMA_MDMA_CxCR[CHANNEL], MDMA_MDMA_CxCR_SWRQ);
+    dma_chain_irq();
+}
+
+static bool requested(void) {
+    return READ_FIELD(MDMA_MDMA_CxCR[CHANNEL], MDMA_MDMA_CxCR_SWRQ) != 0;
+}
+
+static void test_software_only_chain_takes_one_request(void) {
+    const uint8_t triggers[] = {DMA_CHAIN_SOFTWARE, DMA_CHAIN_SOFTWARE};
+    dma_chain_t chain;
+    build(&chain, triggers, 2);
+    completions = 0;
+
+    CHECK_EQ(dma_chain_start(&chain, 1, done, NULL), TI_ERRC_NONE);
+    CHECK_EQ(chain.channel, CHANNEL);
+    CHECK(requested());
+    CHECK(!READ_FIELD(MDMA_MDMA_CxCR[CHANNEL], MDMA_MDMA_CxCR_BTIE));
+
+    end_block(&chain, 1, MDMA_FLAG_BT | MDMA_FLAG_CTC);
+    CHECK_EQ(completions, 1);
+    CHECK(last_success);
+    CHECK_EQ(chain.channel, -1);
+}
+
+static void test_software_stage_after_hardware_stage_is_requested(void) {
+    const uint8_t triggers[] = {5, 6, DMA_CHAIN_SOFTWARE, DMA_CHAIN_SOFTWARE, 7};
+    dma_chain_t chain;
+    build(&chain, triggers, 5);
+    completions = 0;
+
+    CHECK_EQ(dma_chain_start(&chain, 1, done, NULL), TI_ERRC_NONE);
+    CHECK(!requested());
+    CHECK(READ_FIELD(MDMA_MDMA_CxCR[CHANNEL], MDMA_MDMA_CxCR_BTIE));
+
+    // Hardware to hardware: nothing to do
+    end_block(&chain, 1, MDMA_FLAG_BT);
+    CHECK(!requested());
+
+    // Hardware to software: the stage waits for the CPU
+    end_block(&chain, 2, MDMA_FLAG_BT);
+    CHECK(requested());
+
+    // Software to software runs through on the same request, and hardware needs none
+    end_block(&chain, 3, MDMA_FLAG_BT);
+    CHECK(!requested());
+    end_block(&chain, 4, MDMA_FLAG_BT);
+    CHECK(!requested());
+    CHECK_EQ(completions, 0);
+
+    end_block(&chain, 4, MDMA_FLAG_BT | MDMA_FLAG_CTC);
+    CHECK_EQ(completions, 1);
+    CHECK(last_success);
+}
+
+static void test_coalesced_blocks_still_request(void) {
+    const uint8_t triggers[] = {5, 6, DMA_CHAIN_SOFTWARE};
+    dma_chain_t chain;
+    build(&chain, triggers, 3);
+    completions = 0;
+
+    // The ISR ran late and both hardware stages ended before it; the software stage is loaded
+    CHECK_EQ(dma_chain_start(&chain, 1, done, NULL), TI_ERRC_NONE);
+    end_block(&chain, 2, MDMA_FLAG_BT);
+    CHECK(requested());
+
+    end_block(&chain, 2, MDMA_FLAG_BT | MDMA_FLAG_CTC);
+    CHECK_EQ(completions, 1);
+}
+
+static void test_error_stops_chain(void) {
+    const uint8_t triggers[] = {5, DMA_CHAIN_SOFTWARE};
+    dma_chain_t chain;
+    build(&chain, triggers, 2);
+    completions = 0;
+
+    CHECK_EQ(dma_chain_start(&chain, 1, done, NULL), TI_ERRC_NONE);
+    end_block(&chain, 0, MDMA_FLAG_TE);
+    CHECK_EQ(completions, 1);
+    CHECK(!last_success);
+    CHECK(!requested());
+    CHECK_EQ(chain.channel, -1);
+}
+
+int main(void) {
+    RUN(test_software_only_chain_takes_one_request);
+    RUN(test_software_stage_after_hardware_stage_is_requested);
+    RUN(test_coalesced_blocks_still_request);
+    RUN(test_error_stops_chain);
+    TEST_MAIN_END;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file tests/test_dma_dispatch.c
+ * @brief Tests of the deferred completion queue (myWork/dma_dispatch.c).
+ *
+ * The overflow test fills the queue past its depth and checks that the events that do not fit
+ * run right away while the queued ones keep their order. The stress test has producer threads
+ * standing in for DMA ISRs while the main thread drains, and checks that every callback runs
+ * exactly once and that each producer's deferred callbacks run in order.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "test.h"
+#include "include/errc.h"
+#include "include/dma.h"
+
+#define PRODUCERS    3
+#define PER_PRODUCER 200000
+
+static uintptr_t ran[DMA_DEFERRED_QUEUE_DEPTH + 4];
+static uint32_t ran_count;
+
+static void record_run(bool success, void *context) {
+    (void)success;
+    ran[ran_count++] = (uintptr_t)context;
+}
+
+static void test_isr_mode_runs_inline(void) {
+    ran_count = 0;
+    dma_notify_complete(1, 0, record_run, true, (void *)7);
+    CHECK_EQ(ran_count, 1);
+    CHECK_EQ(ran[0], 7);
+    CHECK_EQ(dma_dispatch_deferred(0), 0);
+}
+
+static void test_full_queue_loses_nothing(void) {
+    dma_dispatch_stats_t stats;
+    dma_reset_dispatch_stats();
+    ran_count = 0;
+
+    CHECK_EQ(dma_set_dispatch_mode(2, 5, DMA_DISPATCH_DEFERRED), TI_ERRC_NONE);
+    for (uintptr_t i = 1; i <= DMA_DEFERRED_QUEUE_DEPTH + 3; i++) {
+        dma_notify_complete(2, 5, record_run, true, (void *)i);
+    }
+
+    // The three that did not fit ran in the ISR
+    CHECK_EQ(ran_count, 3);
+    for (uint32_t i = 0; i < 3; i++) CHECK_EQ(ran[i], DMA_DEFERRED_QUEUE_DEPTH + 1 + i);
+    CHECK_EQ(dma_get_dispatch_stats(DMA_DISPATCH_DEFERRED, &stats), TI_ERRC_NONE);
+    CHECK_EQ(stats.overflows, 3);
+    CHECK_EQ(stats.high_water, DMA_DEFERRED_QUEUE_DEPTH);
+    CHECK_EQ(dma_get_dispatch_stats(DMA_DISPATCH_ISR, &stats), TI_ERRC_NONE);
+    CHECK_EQ(stats.events, 3);
+
+    // Later events queue behind the older ones again once there is room
+    CHECK_EQ(dma_dispatch_deferred(1), 1);
+    dma_notify_complete(2, 5, record_run, true, (void *)100);
+    CHECK_EQ(dma_dispatch_deferred(0), DMA_DEFERRED_QUEUE_DEPTH);
+    CHECK_EQ(ran_count, DMA_DEFERRED_QUEUE_DEPTH + 4);
+    for (uint32_t i = 0; i < DMA_DEFERRED_QUEUE_DEPTH; i++) CHECK_EQ(ran[3 + i], i + 1);
+    CHECK_EQ(ran[DMA_DEFERRED_QUEUE_DEPTH + 3], 100);
+    CHECK_EQ(dma_get_dispatch_stats(DMA_DISPATCH_DEFERRED, &stats), TI_ERRC_NONE);
+    CHECK_EQ(stats.events + stats.overflows, DMA_DEFERRED_QUEUE_DEPTH + 4);
+
+    CHECK_EQ(dma_set_dispatch_mode(2, 5, DMA_DISPATCH_ISR), TI_ERRC_NONE);
+}
+
+static void test_mdma_channels_have_a_dispatch_mode(void) {
+    ran_count = 0;
+
+    CHECK_EQ(dma_set_dispatch_mode(DMA_INSTANCE_MDMA, MDMA_CHANNEL_COUNT, DMA_DISPATCH_DEFERRED),
+             TI_ERRC_INVALID_ARG);
+    CHECK_EQ(dma_set_dispatch_mode(0, 0, DMA_DISPATCH_DEFERRED), TI_ERRC_INVALID_ARG);
+    CHECK_EQ(dma_set_dispatch_mode(DMA_INSTANCE_MDMA, 15, DMA_DISPATCH_DEFERRED), TI_ERRC_NONE);
+    CHECK_EQ(dma_get_dispatch_mode(DMA_INSTANCE_MDMA, 15), DMA_DISPATCH_DEFERRED);
+    CHECK_EQ(dma_get_dispatch_mode(DMA_INSTANCE_MDMA, 14), DMA_DISPATCH_ISR);
+    CHECK_EQ(dma_get_dispatch_mode(DMA_INSTANCE_MDMA, MDMA_CHANNEL_COUNT), DMA_DISPATCH_ISR);
+
+    dma_notify_complete(DMA_INSTANCE_MDMA, 15, record_run, true, (void *)1);
+    dma_notify_complete(DMA_INSTANCE_MDMA, 14, record_run, true, (void *)2);
+    CHECK_EQ(ran_count, 1);
+    CHECK_EQ(ran[0], 2);
+    CHECK_EQ(dma_dispatch_deferred(0), 1);
+    CHECK_EQ(ran[1], 1);
+
+    CHECK_EQ(dma_set_dispatch_mode(DMA_INSTANCE_MDMA, 15, DMA_DISPATCH_ISR), TI_ERRC_NONE);
+}
+
+typedef struct {
+    uint8_t stream;
+    uintptr_t last;          // Of the callbacks run by the draining thread
+    atomic_uint count;
+} producer_t;
+
+static producer_t producers[PRODUCERS];
+static atomic_uint producers_done;
+static atomic_uint out_of_order;
+static pthread_t drainer;
+
+// Runs on the draining thread, or on a producer when the queue was full
+static void stress_run(bool success, void *context) {
+    producer_t *producer = &producers[(uintptr_t)context % PRODUCERS];
+    uintptr_t seq = (uintptr_t)context / PRODUCERS;
+    (void)success;
+
+    if (pthread_equal(pthread_self(), drainer)) {
+        if (seq <= producer->last) atomic_fetch_add(&out_of_order, 1);
+        producer->last = seq;
+    }
+    atomic_fetch_add(&producer->count, 1);
+}
+
+static void *producer_thread(void *arg) {
+    uintptr_t index = (uintptr_t)arg;
+
+    for (uintptr_t seq = 1; seq <= PER_PRODUCER; seq++) {
+        dma_notify_complete(1, producers[index].stream, stress_run, true,
+                            (void *)(seq * PRODUCERS + index));
+        if ((seq & 7) == 0) sched_yield();
+    }
+    atomic_fetch_add(&producers_done, 1);
+    return NULL;
+}
+
+static void test_concurrent_producers(void) {
+    pthread_t threads[PRODUCERS];
+    dma_dispatch_stats_t stats;
+    uint32_t total = 0;
+
+    dma_reset_dispatch_stats();
+    drainer = pthread_self();
+    for (uintptr_t i = 0; i < PRODUCERS; i++) {
+        producers[i].stream = (uint8_t)i;
+        CHECK_EQ(dma_set_dispatch_mode(1, (uint8_t)i, DMA_DISPATCH_DEFERRED), TI_ERRC_NONE);
+        pthread_create(&threads[i], NULL, producer_thread, (void *)i);
+    }
+
+    while (atomic_load(&producers_done) < PRODUCERS) {
+        if (dma_dispatch_deferred(0) == 0) sched_yield();
+    }
+    for (int i = 0; i < PRODUCERS; i++) pthread_join(threads[i], NULL);
+    dma_dispatch_deferred(0);
+
+    CHECK_EQ(dma_get_dispatch_stats(DMA_DISPATCH_DEFERRED, &stats), TI_ERRC_NONE);
+    for (int i = 0; i < PRODUCERS; i++) {
+        CHECK_EQ(atomic_load(&producers[i].count), PER_PRODUCER);
+        total += atomic_load(&producers[i].count);
+    }
+    CHECK_EQ(atomic_load(&out_of_order), 0);
+    CHECK_EQ(total, PRODUCERS * PER_PRODUCER);
+    CHECK_EQ(stats.events + stats.overflows, total);
+}
+
+int main(void) {
+    dma_dispatch_init();
+
+    RUN(test_isr_mode_runs_inline);
+    RUN(test_full_queue_loses_nothing);
+    RUN(test_mdma_channels_have_a_dispatch_mode);
+    RUN(test_concurrent_producers);
+    TEST_MAIN_END;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file tests/test_dma_mem.c
+ * @brief Tests of the DMA buffer pool (myWork/dma_mem.c).
+ *
+ * Built with an eight-line pool (DMA_MEM_POOL_SIZE = 256) so exhaustion and fragmentation are
+ * reached in a few calls. Every test hands back what it took, so the pool starts empty each time.
+ */
+
+#include <stdint.h>
+#include "test.h"
+#include "include/errc.h"
+#include "include/dma.h"
+
+#define LINE   DMA_CACHE_LINE_SIZE
+#define LINES  (DMA_MEM_POOL_SIZE / DMA_CACHE_LINE_SIZE)
+
+_Static_assert(LINES == 8, "the tests assume an eight-line pool");
+
+static uint8_t *base;
+
+static bool aligned(const void *buffer) {
+    return ((uintptr_t)buffer % LINE) == 0;
+}
+
+// Every size is rounded up to whole cache lines, so a buffer never shares a line
+static void test_alignment(void) {
+    size_t sizes[] = {1, LINE - 1, LINE, LINE + 1, 3 * LINE};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint8_t *buffer = dma_mem_alloc(sizes[i]);
+        CHECK(buffer != NULL);
+        CHECK(aligned(buffer));
+        CHECK_EQ(dma_mem_available(), DMA_MEM_POOL_SIZE - ((sizes[i] + LINE - 1) / LINE) * LINE);
+        CHECK_EQ(dma_mem_free(buffer), TI_ERRC_NONE);
+    }
+    CHECK_EQ(dma_mem_available(), DMA_MEM_POOL_SIZE);
+}
+
+static void test_first_fit(void) {
+    uint8_t *a = dma_mem_alloc(1);
+    uint8_t *b = dma_mem_alloc(LINE + 1);
+    uint8_t *c = dma_mem_alloc(LINE);
+    base = a;
+    CHECK(b == a + LINE);
+    CHECK(c == a + 3 * LINE);
+
+    // A two-line hole takes a two-line request, but not a three-line one
+    CHECK_EQ(dma_mem_free(b), TI_ERRC_NONE);
+    uint8_t *d = dma_mem_alloc(3 * LINE);
+    CHECK(d == a + 4 * LINE);
+    uint8_t *e = dma_mem_alloc(2 * LINE);
+    CHECK(e == b);
+
+    // Freeing the first line and its neighbour makes one run again
+    CHECK_EQ(dma_mem_free(a), TI_ERRC_NONE);
+    CHECK_EQ(dma_mem_free(e), TI_ERRC_NONE);
+    uint8_t *f = dma_mem_alloc(3 * LINE);
+    CHECK(f == a);
+
+    CHECK_EQ(dma_mem_free(c), TI_ERRC_NONE);
+    CHECK_EQ(dma_mem_free(d), TI_ERRC_NONE);
+    CHECK_EQ(dma_mem_free(f), TI_ERRC_NONE);
+    CHECK_EQ(dma_mem_available(), DMA_MEM_POOL_SIZE);
+}
+
+static void test_exhaustion(void) {
+    CHECK(dma_mem_alloc(0) == NULL);
+    CHECK(dma_mem_alloc(DMA_MEM_POOL_SIZE + 1) == NULL);
+
+    uint8_t *lines[LINES];
+    for (size_t i = 0; i < LINES; i++) {
+        lines[i] = dma_mem_alloc(LINE);
+        CHECK(lines[i] == base + i * LINE);
+    }
+    CHECK_EQ(dma_mem_available(), 0);
+    CHECK(dma_mem_alloc(1) == NULL);
+
+    // Enough lines are free in total, but no two of them are adjacent
+    for (size_t i = 0; i < LINES; i += 2) CHECK_EQ(dma_mem_free(lines[i]), TI_ERRC_NONE);
+    CHECK_EQ(dma_mem_available(), DMA_MEM_POOL_SIZE / 2);
+    CHECK(dma_mem_alloc(2 * LINE) == NULL);
+    CHECK(dma_mem_alloc(LINE) == lines[0]);
+
+    CHECK_EQ(dma_mem_free(lines[0]), TI_ERRC_NONE);
+    for (size_t i = 1; i < LINES; i += 2) CHECK_EQ(dma_mem_free(lines[i]), TI_ERRC_NONE);
+    uint8_t *all = dma_mem_alloc(DMA_MEM_POOL_SIZE);
+    CHECK(all == base);
+    CHECK_EQ(dma_mem_available(), 0);
+    CHECK_EQ(dma_mem_free(all), TI_ERRC_NONE);
+}
+
+// Only the start of a live allocation can be freed, and only once
+static void test_free_rejects_bad_pointers(void) {
+    uint8_t *a = dma_mem_alloc(3 * LINE);
+    uint8_t *b = dma_mem_alloc(LINE);
+    static uint8_t outside[LINE];
+
+    CHECK_EQ(dma_mem_free(NULL), TI_ERRC_INVALID_ARG);
+    CHECK_EQ(dma_mem_free(outside), TI_ERRC_INVALID_ARG);
+    CHECK_EQ(dma_mem_free(a + 1), TI_ERRC_INVALID_ARG);
+    CHECK_EQ(dma_mem_free(a + LINE), TI_ERRC_INVALID_ARG);
+    CHECK_EQ(dma_mem_free(a + 2 * LINE), TI_ERRC_INVALID_ARG);
+    CHECK_EQ(dma_mem_free(b + LINE), TI_ERRC_INVALID_ARG);
+    CHECK_EQ(dma_mem_available(), DMA_MEM_POOL_SIZE - 4 * LINE);
+
+    CHECK_EQ(dma_mem_free(a), TI_ERRC_NONE);
+    CHECK_EQ(dma_mem_free(a), TI_ERRC_INVALID_ARG);
+    CHECK_EQ(dma_mem_free(b), TI_ERRC_NONE);
+    CHECK_EQ(dma_mem_available(), DMA_MEM_POOL_SIZE);
+}
+
+static void test_tcm_is_not_accessible(void) {
+    CHECK(!dma_mem_is_accessible((void *)0x00000100, 4));
+    CHECK(!dma_mem_is_accessible((void *)0x2001FFF0, 32));
+    CHECK(!dma_mem_is_accessible((void *)0x1FFFFFF0, 32)); // Runs into the DTCM
+    CHECK(dma_mem_is_accessible((void *)0x24000000, 1024));
+    CHECK(!dma_mem_is_accessible(NULL, 4));
+}
+
+int main(void) {
+    RUN(test_alignment);
+    RUN(test_first_fit);
+    RUN(test_exhaustion);
+    RUN(test_free_rejects_bad_pointers);
+    RUN(test_tcm_is_not_accessible);
+    TEST_MAIN_END;
+}
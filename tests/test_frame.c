@@ -0,0 +1,176 @@
+/**
+ * @file tests/test_frame.c
+ * @brief Fuzz test of the COBS + CRC-16 framing (misc./frame.c). Built with ASan and UBSan.
+ *
+ * Random payloads are encoded and fed back to the decoder in random pieces and must come out
+ * unchanged. Random garbage, and frames with a corrupted data byte, must be dropped and counted
+ * without the decoder reading or writing out of bounds.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "misc./frame.h"
+
+#define ITERATIONS  20000
+#define MAX_PAYLOAD 1100 // Several full 254-byte COBS runs
+
+static uint32_t rng_state = 12345;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+typedef struct {
+    const uint8_t *expected;
+    size_t expected_size;
+    uint32_t matches;
+    uint32_t mismatches;
+} expect_t;
+
+static void check_payload(const uint8_t *payload, size_t size, void *context) {
+    expect_t *expect = context;
+    bool same = (size == expect->expected_size) && (memcmp(payload, expect->expected, size) == 0);
+    if (same) {
+        expect->matches++;
+    } else {
+        expect->mismatches++;
+    }
+}
+
+static void fill(uint8_t *payload, size_t size) {
+    // Vary the share of zeros, which decides the COBS block lengths
+    uint32_t zero_odds = rng() % 4 == 0 ? 0 : 1 + rng() % 64;
+    for (size_t i = 0; i < size; i++) {
+        payload[i] = (zero_odds != 0 && rng() % zero_odds == 0) ? 0 : (uint8_t)(1 + rng() % 255);
+    }
+}
+
+// Feeds in random pieces, including empty ones
+static void feed(frame_decoder_t *decoder, const uint8_t *data, size_t size, expect_t *expect) {
+    size_t pos = 0;
+    while (pos < size) {
+        size_t piece = rng() % 40;
+        if (piece > size - pos) piece = size - pos;
+        frame_decoder_feed(decoder, data + pos, piece, check_payload, expect);
+        pos += piece;
+    }
+}
+
+static void test_round_trip(void) {
+    static uint8_t payload[MAX_PAYLOAD];
+    static uint8_t wire[FRAME_MAX_ENCODED(MAX_PAYLOAD)];
+    static uint8_t decoded[MAX_PAYLOAD + FRAME_CRC_SIZE];
+    frame_decoder_t decoder;
+    frame_decoder_init(&decoder, decoded, sizeof(decoded));
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        size_t size = rng() % (MAX_PAYLOAD + 1);
+        fill(payload, size);
+
+        // Encode into a heap block of exactly the documented size, so ASan sees any overrun
+        size_t capacity = FRAME_MAX_ENCODED(size);
+        uint8_t *exact = malloc(capacity);
+        size_t length = frame_encode(exact, capacity, payload, size);
+        CHECK(length > 0 && length <= capacity);
+        CHECK_EQ(frame_encode(exact, capacity - 1, payload, size), 0);
+        memcpy(wire, exact, length);
+        free(exact);
+
+        CHECK_EQ(wire[length - 1], 0);
+        CHECK(memchr(wire, 0, length - 1) == NULL);
+
+        expect_t expect = {.expected = payload, .expected_size = size};
+        feed(&decoder, wire, length, &expect);
+        CHECK_EQ(expect.matches, 1);
+        CHECK_EQ(expect.mismatches, 0);
+    }
+    CHECK_EQ(decoder.stats.frames, ITERATIONS);
+    CHECK_EQ(decoder.stats.crc_errors + decoder.stats.format_errors + decoder.stats.overflows, 0);
+}
+
+static void test_run_boundaries(void) {
+    static uint8_t payload[600];
+    static uint8_t wire[FRAME_MAX_ENCODED(600)];
+    static uint8_t decoded[600 + FRAME_CRC_SIZE];
+    const size_t sizes[] = {0, 1, 252, 253, 254, 255, 507, 508, 509, 600};
+    frame_decoder_t decoder;
+    frame_decoder_init(&decoder, decoded, sizeof(decoded));
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (int zeros = 0; zeros <= 1; zeros++) {
+            memset(payload, zeros ? 0x00 : 0xA5, sizes[s]);
+            size_t length = frame_encode(wire, sizeof(wire), payload, sizes[s]);
+            expect_t expect = {.expected = payload, .expected_size = sizes[s]};
+            frame_decoder_feed(&decoder, wire, length, check_payload, &expect);
+            CHECK_EQ(expect.matches, 1);
+        }
+    }
+}
+
+static void test_garbage(void) {
+    static uint8_t noise[4096];
+    uint8_t small[64];
+    frame_decoder_t decoder;
+    frame_decoder_init(&decoder, small, sizeof(small));
+
+    uint32_t delimiters = 0;
+    for (int i = 0; i < ITERATIONS / 10; i++) {
+        size_t size = rng() % sizeof(noise);
+        for (size_t j = 0; j < size; j++) {
+            noise[j] = (rng() % 16 == 0) ? 0 : (uint8_t)rng();
+            if (noise[j] == 0) delimiters++;
+        }
+        expect_t expect = {0};
+        feed(&decoder, noise, size, &expect);
+    }
+
+    // Every delimiter either ends an empty run or is accounted for exactly once
+    frame_stats_t *stats = &decoder.stats;
+    CHECK(stats->frames + stats->crc_errors + stats->format_errors + stats->overflows <= delimiters);
+    CHECK(stats->crc_errors > 0);
+    CHECK(stats->overflows > 0);
+}
+
+static void test_corrupted_data_byte(void) {
+    static uint8_t payload[300];
+    static uint8_t wire[FRAME_MAX_ENCODED(300)];
+    static uint8_t decoded[300 + FRAME_CRC_SIZE];
+    frame_decoder_t decoder;
+    frame_decoder_init(&decoder, decoded, sizeof(decoded));
+
+    for (int i = 0; i < ITERATIONS / 4; i++) {
+        size_t size = 1 + rng() % sizeof(payload);
+        fill(payload, size);
+        size_t length = frame_encode(wire, sizeof(wire), payload, size);
+
+        // Walk the COBS blocks to pick a data byte; changing a code byte changes the framing
+        size_t data_bytes[sizeof(wire)];
+        size_t count = 0;
+        for (size_t pos = 0; pos < length - 1; pos += wire[pos]) {
+            for (size_t k = pos + 1; k < pos + wire[pos] && k < length - 1; k++) data_bytes[count++] = k;
+        }
+        if (count == 0) continue;
+
+        size_t victim = data_bytes[rng() % count];
+        wire[victim] = (uint8_t)(wire[victim] % 255 + 1); // Any other non-zero value
+
+        expect_t expect = {.expected = payload, .expected_size = size};
+        uint32_t crc_errors = decoder.stats.crc_errors;
+        frame_decoder_feed(&decoder, wire, length, check_payload, &expect);
+        CHECK_EQ(expect.matches + expect.mismatches, 0);
+        CHECK_EQ(decoder.stats.crc_errors, crc_errors + 1);
+    }
+}
+
+int main(void) {
+    RUN(test_round_trip);
+    RUN(test_run_boundaries);
+    RUN(test_garbage);
+    RUN(test_corrupted_data_byte);
+    TEST_MAIN_END;
+}
@@ -0,0 +1,760 @@
+/**
+ * @file tests/test_i2c.c
+ * @brief Tests of the I2C driver (myWork/i2c.c) against a register-level model of I2C1.
+ *
+ * The driver's accesses to the I2C1 page trap into the model (host_periph.c). The model plays
+ * the master side of the peripheral: a START or RELOAD written to CR2 loads NBYTES, every byte
+ * through TXDR or RXDR uses one up, and at zero it raises TCR (RELOAD), TC (no AUTOEND) or sends
+ * the STOP. Every START, RELOAD and STOP is logged with the CR2 fields it was given. For async
+ * transfers, pump() plays the DMA (host_dma.c) and calls i2c_irq() while an enabled flag is up.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "test.h"
+#include "host_dma.h"
+#include "host_periph.h"
+#include "include/errc.h"
+#include "include/i2c.h"
+#include "include/mmio.h"
+
+#define I2C        1
+#define RX_REQUEST 33 // DMAMUX1 lines of I2C1
+#define TX_REQUEST 34
+#define MAX_EVENTS 32
+#define MAX_BYTES  1024
+#define MAX_DONE   16
+#define DIRECT     0xD1 // Context given to i2c_init()
+
+typedef enum { EV_START, EV_RELOAD, EV_STOP } event_kind_t;
+
+typedef struct {
+    event_kind_t kind;
+    uint16_t addr;
+    bool read;
+    uint32_t nbytes;
+    bool reload;
+    bool autoend;
+    bool after_tc; // START sent as a repeated START, on TC and without a STOP
+} event_t;
+
+typedef struct {
+    bool active;      // Bus owned by the master
+    uint16_t addr;
+    bool read;
+    uint32_t count;   // Bytes of NBYTES not transferred yet
+    bool reload;
+    bool autoend;
+    bool stopf;
+    bool stuck_busy;  // A device holds SDA low with SCL high: BUSY without a timeout
+    bool cr2_written;
+    event_t events[MAX_EVENTS];
+    size_t event_count;
+    uint8_t tx[MAX_BYTES];
+    size_t tx_count;
+    uint32_t rx_count;
+} i2c_model_t;
+
+static i2c_model_t model;
+
+static uint32_t completions;
+static bool last_success;
+static uintptr_t done_context[MAX_DONE];
+static bool done_success[MAX_DONE];
+
+/**************************************************************************************************
+ * @section Stand-ins
+ **************************************************************************************************/
+
+// The DMA reach checks need real memory maps; everything in the test is reachable
+bool dma_mem_is_accessible(const void *buffer, size_t size) {
+    (void)buffer;
+    (void)size;
+    return true;
+}
+
+bool bdma_mem_is_accessible(const void *buffer, size_t size) {
+    (void)buffer;
+    (void)size;
+    return true;
+}
+
+int bdma_start_transfer(dma_transfer_t *dma_transfer) {
+    (void)dma_transfer;
+    return TI_ERRC_UNSUPPORTED; // I2C4 is not under test
+}
+
+int bdma_stop_transfer(uint8_t channel) {
+    (void)channel;
+    return TI_ERRC_NONE;
+}
+
+/**************************************************************************************************
+ * @section I2C1 Model
+ **************************************************************************************************/
+
+static uint8_t rx_byte(uint32_t i) {
+    return (uint8_t)(i * 7 + 3);
+}
+
+static void log_event(event_kind_t kind, bool after_tc) {
+    if (model.event_count == MAX_EVENTS) return;
+    model.events[model.event_count++] = (event_t){
+        .kind = kind,
+        .addr = model.addr,
+        .read = model.read,
+        .nbytes = model.count,
+        .reload = model.reload,
+        .autoend = model.autoend,
+        .after_tc = after_tc,
+    };
+}
+
+static void send_stop(void) {
+    model.active = false;
+    model.count = 0;
+    model.stopf = true;
+    log_event(EV_STOP, false);
+}
+
+// Acts on what was written to CR2 once the driver moves on to another register, so the
+// read-modify-write sequence of i2c_start() and i2c_reload() is seen as a whole
+static void sync_cr2(void) {
+    if (!model.cr2_written) return;
+    model.cr2_written = false;
+
+    uint32_t cr2 = *I2Cx_CR2[I2C];
+    uint32_t nbytes = (cr2 & I2Cx_CR2_NBYTES.msk) >> I2Cx_CR2_NBYTES.pos;
+
+    if (cr2 & I2Cx_CR2_STOP.msk) {
+        *I2Cx_CR2[I2C] = cr2 &= ~I2Cx_CR2_STOP.msk;
+        if (model.active) send_stop();
+    }
+    if (cr2 & I2Cx_CR2_START.msk) {
+        bool on_tc = model.active && (model.count == 0) && !model.reload && !model.autoend;
+        *I2Cx_CR2[I2C] = cr2 & ~I2Cx_CR2_START.msk;
+        model.active = true;
+        model.addr = (uint16_t)((cr2 & I2Cx_CR2_SADD_10BIT.msk) >> 1);
+        model.read = (cr2 & I2Cx_CR2_RD_WRN.msk) != 0;
+        model.count = nbytes;
+        model.reload = (cr2 & I2Cx_CR2_RELOAD.msk) != 0;
+        model.autoend = (cr2 & I2Cx_CR2_AUTOEND.msk) != 0;
+        log_event(EV_START, on_tc);
+    } else if (model.active && (model.count == 0) && model.reload && (nbytes != 0)) {
+        model.count = nbytes;
+        model.reload = (cr2 & I2Cx_CR2_RELOAD.msk) != 0;
+        model.autoend = (cr2 & I2Cx_CR2_AUTOEND.msk) != 0;
+        log_event(EV_RELOAD, false);
+    }
+}
+
+static uint32_t isr_flags(void) {
+    uint32_t isr = I2Cx_ISR_TXE.msk;
+
+    if (model.active) {
+        if (model.count > 0) {
+            isr |= model.read ? I2Cx_ISR_RXNE.msk : I2Cx_ISR_TXIS.msk;
+        } else if (model.reload) {
+            isr |= I2Cx_ISR_TCR.msk;
+        } else if (model.autoend) {
+            send_stop();
+        } else {
+            isr |= I2Cx_ISR_TC.msk;
+        }
+    }
+    if (model.active || model.stuck_busy) isr |= I2Cx_ISR_BUSY.msk;
+    if (model.stopf) isr |= I2Cx_ISR_STOPF.msk;
+    return isr;
+}
+
+static void before_access(volatile uint32_t *reg, bool write, void *context) {
+    (void)context;
+
+    if (reg != I2Cx_CR2[I2C]) sync_cr2();
+    if (write) return;
+
+    if (reg == I2Cx_ISR[I2C]) {
+        *reg = isr_flags();
+    } else if ((reg == I2Cx_RXDR[I2C]) && model.active && model.read && (model.count > 0)) {
+        *reg = rx_byte(model.rx_count++);
+        model.count--;
+    }
+}
+
+static void after_access(volatile uint32_t *reg, bool write, void *context) {
+    (void)context;
+    if (!write) return;
+
+    if (reg == I2Cx_CR2[I2C]) {
+        model.cr2_written = true;
+    } else if (reg == I2Cx_TXDR[I2C]) {
+        if (model.active && !model.read && (model.count > 0) && (model.tx_count < MAX_BYTES)) {
+            model.tx[model.tx_count++] = (uint8_t)*reg;
+            model.count--;
+        }
+    } else if (reg == I2Cx_ICR[I2C]) {
+        if (*reg & I2Cx_ICR_STOPCF.msk) model.stopf = false;
+        *reg = 0;
+    }
+}
+
+static void reset_model(void) {
+    model = (i2c_model_t){0};
+    completions = 0;
+}
+
+static host_dma_stream_t *i2c_dma(uint8_t *instance, uint8_t *stream) {
+    for (uint8_t i = 1; i <= DMA_INSTANCE_COUNT; i++) {
+        for (uint8_t j = 0; j < DMA_STREAM_COUNT; j++) {
+            host_dma_stream_t *s = &host_dma[i][j];
+            if (s->active && ((s->transfer.request_id == RX_REQUEST) || (s->transfer.request_id == TX_REQUEST))) {
+                *instance = i;
+                *stream = j;
+                return s;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Plays the DMA and the interrupt until nothing is left to do
+static void pump(void) {
+    for (int steps = 0; steps < 100000; steps++) {
+        uint32_t isr = *I2Cx_ISR[I2C];
+        uint32_t cr1 = *I2Cx_CR1[I2C];
+        uint8_t inst, stream;
+        host_dma_stream_t *dma = i2c_dma(&inst, &stream);
+
+        if ((dma != NULL) && (dma->remaining > 0)) {
+            uint32_t index = dma->transfer.size - dma->remaining;
+            bool moved = false;
+            if ((dma->transfer.request_id == RX_REQUEST) && (cr1 & I2Cx_CR1_RXDMAEN.msk) && (isr & I2Cx_ISR_RXNE.msk)) {
+                ((uint8_t *)dma->transfer.dest)[index] = rx_byte(model.rx_count++);
+                moved = true;
+            } else if ((dma->transfer.request_id == TX_REQUEST) && (cr1 & I2Cx_CR1_TXDMAEN.msk) &&
+                       (isr & I2Cx_ISR_TXIS.msk) && (model.tx_count < MAX_BYTES)) {
+                model.tx[model.tx_count++] = ((const uint8_t *)dma->transfer.src)[index];
+                moved = true;
+            }
+            if (moved) {
+                model.count--;
+                if (--dma->remaining == 0) host_dma_complete(inst, stream, true);
+                continue;
+            }
+        }
+
+        bool irq = ((isr & I2Cx_ISR_TXIS.msk) && (cr1 & I2Cx_CR1_TXIE.msk)) ||
+                   ((isr & (I2Cx_ISR_TC.msk | I2Cx_ISR_TCR.msk)) && (cr1 & I2Cx_CR1_TCIE.msk)) ||
+                   ((isr & I2Cx_ISR_STOPF.msk) && (cr1 & I2Cx_CR1_STOPIE.msk)) ||
+                   ((isr & I2Cx_ISR_NACKF.msk) && (cr1 & I2Cx_CR1_NACKIE.msk));
+        if (!irq) return;
+        i2c_irq(I2C);
+    }
+    CHECK(false); // Never settled
+}
+
+static void transfer_done(bool success, void *context) {
+    if (completions < MAX_DONE) {
+        done_context[completions] = (uintptr_t)context;
+        done_success[completions] = success;
+    }
+    completions++;
+    last_success = success;
+}
+
+static void check_event(size_t index, event_kind_t kind, bool read, uint32_t nbytes, bool reload,
+                        bool autoend) {
+    if (index >= model.event_count) {
+        fprintf(stderr, "event %zu missing\n", index);
+        test_failures++;
+        return;
+    }
+    const event_t *e = &model.events[index];
+    CHECK_EQ(e->kind, kind);
+    if (kind == EV_STOP) return;
+    CHECK_EQ(e->read, read);
+    CHECK_EQ(e->nbytes, nbytes);
+    CHECK_EQ(e->reload, reload);
+    if (!reload) CHECK_EQ(e->autoend, autoend); // AUTOEND is ignored while RELOAD is set
+}
+
+static uint32_t rx_mismatches(const uint8_t *data, size_t size) {
+    uint32_t wrong = 0;
+    for (size_t i = 0; i < size; i++) wrong += data[i] != rx_byte((uint32_t)i);
+    return wrong;
+}
+
+/**************************************************************************************************
+ * @section CR2 Sequencing
+ **************************************************************************************************/
+
+static void test_mem_read_uses_repeated_start(void) {
+    uint8_t data[4];
+    reset_model();
+
+    CHECK_EQ(i2c_mem_read_blocking(I2C, 0x50, 0x1234, I2C_MEM_ADDR_16BIT, data, sizeof(data)), TI_ERRC_NONE);
+    sync_cr2();
+
+    CHECK_EQ(model.event_count, 3);
+    check_event(0, EV_START, false, 2, false, false);
+    check_event(1, EV_START, true, 4, false, true);
+    check_event(2, EV_STOP, false, 0, false, false);
+    CHECK(model.events[1].after_tc);
+    CHECK_EQ(model.tx_count, 2);
+    CHECK_EQ(model.tx[0], 0x12);
+    CHECK_EQ(model.tx[1], 0x34);
+    CHECK_EQ(rx_mismatches(data, sizeof(data)), 0);
+}
+
+static void test_long_read_reloads_in_255_byte_chunks(void) {
+    static uint8_t data[600];
+    reset_model();
+
+    CHECK_EQ(i2c_read_blocking(I2C, 0x50, data, sizeof(data)), TI_ERRC_NONE);
+    sync_cr2();
+
+    CHECK_EQ(model.event_count, 4);
+    check_event(0, EV_START, true, 255, true, true);
+    check_event(1, EV_RELOAD, true, 255, true, true);
+    check_event(2, EV_RELOAD, true, 90, false, true);
+    check_event(3, EV_STOP, false, 0, false, false);
+    CHECK_EQ(rx_mismatches(data, sizeof(data)), 0);
+}
+
+static void test_long_mem_write_counts_the_register_address(void) {
+    static uint8_t data[600];
+    reset_model();
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i ^ 0x5A);
+
+    CHECK_EQ(i2c_mem_write_blocking(I2C, 0x50, 0xAB, I2C_MEM_ADDR_8BIT, data, sizeof(data)), TI_ERRC_NONE);
+    sync_cr2();
+
+    // 601 bytes on the wire: 255 + 255 + 91
+    CHECK_EQ(model.event_count, 4);
+    check_event(0, EV_START, false, 255, true, true);
+    check_event(1, EV_RELOAD, false, 255, true, true);
+    check_event(2, EV_RELOAD, false, 91, false, true);
+    check_event(3, EV_STOP, false, 0, false, false);
+    CHECK_EQ(model.tx_count, 601);
+    CHECK_EQ(model.tx[0], 0xAB);
+    CHECK(memcmp(model.tx + 1, data, sizeof(data)) == 0);
+}
+
+static void test_async_mem_read_repeated_start_then_reload(void) {
+    static uint8_t data[600];
+    reset_model();
+    memset(data, 0, sizeof(data));
+
+    CHECK_EQ(i2c_mem_read_async(I2C, 0x50, 0x42, I2C_MEM_ADDR_8BIT, data, sizeof(data)), TI_ERRC_NONE);
+    pump();
+
+    CHECK_EQ(model.event_count, 5);
+    check_event(0, EV_START, false, 1, false, false);
+    check_event(1, EV_START, true, 255, true, true);
+    check_event(2, EV_RELOAD, true, 255, true, true);
+    check_event(3, EV_RELOAD, true, 90, false, true);
+    check_event(4, EV_STOP, false, 0, false, false);
+    CHECK(model.events[1].after_tc);
+    CHECK_EQ(model.tx_count, 1);
+    CHECK_EQ(model.tx[0], 0x42);
+    CHECK_EQ(rx_mismatches(data, sizeof(data)), 0);
+    CHECK_EQ(completions, 1);
+    CHECK(last_success);
+}
+
+static void test_async_write_reloads(void) {
+    static uint8_t data[300];
+    reset_model();
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 3);
+
+    CHECK_EQ(i2c_write_async(I2C, 0x50, data, sizeof(data)), TI_ERRC_NONE);
+    pump();
+
+    CHECK_EQ(model.event_count, 3);
+    check_event(0, EV_START, false, 255, true, true);
+    check_event(1, EV_RELOAD, false, 45, false, true);
+    check_event(2, EV_STOP, false, 0, false, false);
+    CHECK_EQ(model.tx_count, sizeof(data));
+    CHECK(memcmp(model.tx, data, sizeof(data)) == 0);
+    CHECK_EQ(completions, 1);
+    CHECK(last_success);
+}
+
+/**************************************************************************************************
+ * @section Queue
+ **************************************************************************************************/
+
+// Finds the stream the driver last used for a DMAMUX request
+static host_dma_stream_t *stream_for(uint8_t request_id) {
+    for (uint8_t i = 1; i <= DMA_INSTANCE_COUNT; i++) {
+        for (uint8_t j = 0; j < DMA_STREAM_COUNT; j++) {
+            if (host_dma[i][j].transfer.request_id == request_id) return &host_dma[i][j];
+        }
+    }
+    return NULL;
+}
+
+static size_t starts_of(uint16_t *addrs, size_t max) {
+    size_t n = 0;
+    for (size_t i = 0; (i < model.event_count) && (n < max); i++) {
+        if ((model.events[i].kind == EV_START) && !model.events[i].after_tc) addrs[n++] = model.events[i].addr;
+    }
+    return n;
+}
+
+static void test_queue_runs_in_submission_order(void) {
+    static uint8_t data[I2C_QUEUE_DEPTH + 1][8];
+    uint16_t addrs[I2C_QUEUE_DEPTH + 2];
+    reset_model();
+
+    // A direct transfer holds the instance while the queue fills
+    CHECK_EQ(i2c_read_async(I2C, 0x20, data[I2C_QUEUE_DEPTH], 8), TI_ERRC_NONE);
+    for (uintptr_t i = 0; i < I2C_QUEUE_DEPTH; i++) {
+        i2c_request_t request = {
+            .op = (i % 3 == 0) ? I2C_OP_WRITE : (i % 3 == 1) ? I2C_OP_READ : I2C_OP_MEM_READ,
+            .addr = (uint16_t)(0x30 + i),
+            .mem_addr = 0x10,
+            .mem_addr_size = I2C_MEM_ADDR_8BIT,
+            .data = data[i],
+            .size = 1 + i,
+            .callback = transfer_done,
+            .context = (void *)(i + 1),
+        };
+        CHECK_EQ(i2c_submit(I2C, &request), TI_ERRC_NONE);
+    }
+    i2c_request_t extra = {.op = I2C_OP_READ, .addr = 0x40, .data = data[0], .size = 1};
+    CHECK_EQ(i2c_submit(I2C, &extra), TI_ERRC_BUSY);
+    CHECK_EQ(completions, 0);
+
+    pump();
+
+    CHECK_EQ(completions, I2C_QUEUE_DEPTH + 1);
+    CHECK_EQ(done_context[0], DIRECT);
+    for (uint32_t i = 0; i <= I2C_QUEUE_DEPTH; i++) {
+        if (i > 0) CHECK_EQ(done_context[i], i);
+        CHECK(done_success[i]);
+    }
+    CHECK_EQ(starts_of(addrs, I2C_QUEUE_DEPTH + 2), I2C_QUEUE_DEPTH + 1);
+    CHECK_EQ(addrs[0], 0x20);
+    for (uint32_t i = 0; i < I2C_QUEUE_DEPTH; i++) CHECK_EQ(addrs[i + 1], 0x30 + i);
+}
+
+static host_dma_stream_t *blocked_tx;
+
+// Unblocks the TX stream and queues one more write from inside a completion
+static void unblock_and_submit(bool success, void *context) {
+    static uint8_t byte = 0x77;
+    transfer_done(success, context);
+    blocked_tx->active = false;
+    blocked_tx->transfer.request_id = TX_REQUEST;
+
+    i2c_request_t request = {
+        .op = I2C_OP_WRITE,
+        .addr = 0x54,
+        .data = &byte,
+        .size = 1,
+        .callback = transfer_done,
+        .context = (void *)4,
+    };
+    CHECK_EQ(i2c_submit(I2C, &request), TI_ERRC_NONE);
+}
+
+static void test_failed_start_fails_through_its_callback(void) {
+    static uint8_t rx[4], tx[4] = {1, 2, 3, 4};
+    uint16_t addrs[8];
+    reset_model();
+
+    // Keep the TX stream taken, so queued writes cannot start
+    blocked_tx = stream_for(TX_REQUEST);
+    CHECK(blocked_tx != NULL);
+    blocked_tx->active = true;
+    blocked_tx->transfer.request_id = 0;
+
+    CHECK_EQ(i2c_read_async(I2C, 0x20, rx, sizeof(rx)), TI_ERRC_NONE);
+    i2c_request_t requests[] = {
+        {I2C_OP_WRITE, 0x51, 0, 0, tx, sizeof(tx), transfer_done, (void *)1},
+        {I2C_OP_MEM_WRITE, 0x52, 0x10, I2C_MEM_ADDR_8BIT, tx, sizeof(tx), transfer_done, (void *)2},
+        {I2C_OP_MEM_READ, 0x53, 0x10, I2C_MEM_ADDR_8BIT, rx, sizeof(rx), unblock_and_submit, (void *)3},
+    };
+    for (size_t i = 0; i < 3; i++) CHECK_EQ(i2c_submit(I2C, &requests[i]), TI_ERRC_NONE);
+
+    pump();
+
+    // The writes failed in order without touching the bus, and the queue kept moving
+    CHECK_EQ(completions, 5);
+    CHECK_EQ(done_context[0], DIRECT);
+    CHECK(done_success[0]);
+    CHECK_EQ(done_context[1], 1);
+    CHECK(!done_success[1]);
+    CHECK_EQ(done_context[2], 2);
+    CHECK(!done_success[2]);
+    CHECK_EQ(done_context[3], 3);
+    CHECK(done_success[3]);
+    CHECK_EQ(done_context[4], 4);
+    CHECK(done_success[4]);
+    CHECK_EQ(starts_of(addrs, 8), 3);
+    CHECK_EQ(addrs[0], 0x20);
+    CHECK_EQ(addrs[1], 0x53);
+    CHECK_EQ(addrs[2], 0x54);
+    CHECK_EQ(model.tx[model.tx_count - 1], 0x77);
+}
+
+/**************************************************************************************************
+ * @section Stuck Bus
+ **************************************************************************************************/
+
+// Runs i2c_service() until the recovery is over. The recovery STOP frees the bus.
+static void recover(void) {
+    CHECK(i2c_is_recovering(I2C));
+    model.stuck_busy = false;
+    model.active = false;
+    for (int steps = 0; (steps < 100) && i2c_is_recovering(I2C); steps++) i2c_service(I2C);
+    CHECK(!i2c_is_recovering(I2C));
+}
+
+static void test_stuck_busy_recovers_direct_calls(void) {
+    static uint8_t data[4];
+    i2c_stats_t before, after;
+    reset_model();
+    CHECK_EQ(i2c_get_stats(I2C, &before), TI_ERRC_NONE);
+
+    model.stuck_busy = true;
+    for (int i = 1; i < I2C_BUSY_REJECTIONS; i++) {
+        CHECK_EQ(i2c_read_async(I2C, 0x50, data, sizeof(data)), TI_ERRC_BUSY);
+        CHECK(!i2c_is_recovering(I2C));
+    }
+    CHECK_EQ(i2c_read_async(I2C, 0x50, data, sizeof(data)), TI_ERRC_BUSY);
+    CHECK_EQ(i2c_read_async(I2C, 0x50, data, sizeof(data)), TI_ERRC_BUSY); // Held for recovery
+
+    recover();
+    CHECK_EQ(i2c_get_stats(I2C, &after), TI_ERRC_NONE);
+    CHECK_EQ(after.timeouts, before.timeouts + 1);
+    CHECK_EQ(after.recoveries, before.recoveries + 1);
+    CHECK_EQ(model.event_count, 0);
+
+    CHECK_EQ(i2c_read_async(I2C, 0x50, data, sizeof(data)), TI_ERRC_NONE);
+    pump();
+    CHECK_EQ(completions, 1);
+    CHECK(last_success);
+    CHECK_EQ(rx_mismatches(data, sizeof(data)), 0);
+}
+
+static void test_stuck_busy_recovers_the_queue(void) {
+    static uint8_t data[4];
+    i2c_request_t request = {
+        .op = I2C_OP_READ,
+        .addr = 0x50,
+        .data = data,
+        .size = sizeof(data),
+        .callback = transfer_done,
+    };
+    reset_model();
+
+    // A start in between resets the count
+    model.stuck_busy = true;
+    CHECK_EQ(i2c_read_async(I2C, 0x50, data, sizeof(data)), TI_ERRC_BUSY);
+    model.stuck_busy = false;
+    CHECK_EQ(i2c_read_async(I2C, 0x50, data, sizeof(data)), TI_ERRC_NONE);
+    pump();
+    CHECK_EQ(completions, 1);
+
+    // Each queued request that cannot start is failed, until the last one starts the recovery
+    model.stuck_busy = true;
+    for (uintptr_t i = 1; i <= I2C_BUSY_REJECTIONS; i++) {
+        request.context = (void *)i;
+        CHECK(!i2c_is_recovering(I2C));
+        CHECK_EQ(i2c_submit(I2C, &request), TI_ERRC_NONE);
+        CHECK_EQ(completions, 1 + i);
+        CHECK(!last_success);
+    }
+
+    // Queued behind the recovery, started once the bus is back
+    request.context = (void *)(I2C_BUSY_REJECTIONS + 1);
+    CHECK_EQ(i2c_submit(I2C, &request), TI_ERRC_NONE);
+    CHECK_EQ(completions, 1 + I2C_BUSY_REJECTIONS);
+    recover();
+    pump();
+    CHECK_EQ(completions, 2 + I2C_BUSY_REJECTIONS);
+    CHECK_EQ(done_context[1 + I2C_BUSY_REJECTIONS], I2C_BUSY_REJECTIONS + 1);
+    CHECK(last_success);
+}
+
+// A completion queued for deferred dispatch can outlive the transaction i2c_recover() aborted
+static void test_stale_dma_completion_is_ignored(void) {
+    static uint8_t data[4];
+    uint8_t inst, stream;
+    reset_model();
+
+    CHECK_EQ(i2c_read_async(I2C, 0x50, data, sizeof(data)), TI_ERRC_NONE);
+    host_dma_stream_t *dma = i2c_dma(&inst, &stream);
+    CHECK(dma != NULL);
+    if (dma == NULL) return;
+    dma_transfer_t stale = dma->transfer;
+
+    CHECK_EQ(i2c_recover(I2C), TI_ERRC_NONE);
+    dma->active = false; // The stream is disabled through its registers, which host_dma cannot see
+    CHECK_EQ(completions, 1);
+    CHECK(!last_success);
+    recover();
+
+    // The old stream reports its disabled transfer while the next read is in progress. That
+    // report must neither fail nor finish the new read.
+    memset(data, 0, sizeof(data));
+    CHECK_EQ(i2c_read_async(I2C, 0x50, data, sizeof(data)), TI_ERRC_NONE);
+    stale.callback(false, stale.context);
+    CHECK_EQ(completions, 1);
+
+    pump();
+    CHECK_EQ(completions, 2);
+    CHECK(last_success);
+    CHECK_EQ(rx_mismatches(data, sizeof(data)), 0);
+}
+
+/**************************************************************************************************
+ * @section Timing
+ **************************************************************************************************/
+
+// I2C specification limits (UM10204 table 10), in ns
+typedef struct {
+    uint32_t speed;
+    double hddat_min, vddat_max, sudat_min, low_min, high_min;
+} mode_limits_t;
+
+static const mode_limits_t mode_limits[] = {
+    {I2C_SPEED_STANDARD,  0, 3450, 250, 4700, 4000},
+    {I2C_SPEED_FAST,      0,  900, 100, 1300,  600},
+    {I2C_SPEED_FAST_PLUS, 0,  450,  50,  500,  260},
+};
+
+// Checks a TIMINGR value against the RM0399 timing equations, independently of the solver
+static bool meets_spec(const i2c_timing_config_t *config, uint32_t timingr) {
+    const mode_limits_t *mode = &mode_limits[0];
+    while (config->speed > mode->speed) mode++;
+
+    double t_clk = 1e9 / config->clk_freq;
+    double t_presc = (((timingr & I2Cx_TIMINGR_PRESC.msk) >> I2Cx_TIMINGR_PRESC.pos) + 1) * t_clk;
+    double scldel = (timingr & I2Cx_TIMINGR_SCLDEL.msk) >> I2Cx_TIMINGR_SCLDEL.pos;
+    double sdadel = (timingr & I2Cx_TIMINGR_SDADEL.msk) >> I2Cx_TIMINGR_SDADEL.pos;
+    double sclh = (timingr & I2Cx_TIMINGR_SCLH.msk) >> I2Cx_TIMINGR_SCLH.pos;
+    double scll = (timingr & I2Cx_TIMINGR_SCLL.msk) >> I2Cx_TIMINGR_SCLL.pos;
+    double af_min = config->analog_filter ? 50 : 0;
+    double af_max = config->analog_filter ? 260 : 0;
+    double dnf = config->digital_filter;
+    double slack = 0.01; // Rounding of the solver's ps arithmetic
+
+    double t_sync = af_min + dnf * t_clk + 2 * t_clk;
+    double t_low = (scll + 1) * t_presc + t_sync;
+    double t_high = (sclh + 1) * t_presc + t_sync;
+    double period = t_low + t_high + config->rise_ns + config->fall_ns;
+    double hold = sdadel * t_presc + (dnf + 3) * t_clk + af_min - config->fall_ns;
+    double valid = sdadel * t_presc + (dnf + 4) * t_clk + af_max + config->rise_ns;
+    double setup = (scldel + 1) * t_presc - config->rise_ns;
+
+    return (t_low + slack >= mode->low_min) && (t_high + slack >= mode->high_min) &&
+           (hold + slack >= mode->hddat_min) && (valid - slack <= mode->vddat_max) &&
+           (setup + slack >= mode->sudat_min) && (period + slack >= 1e9 / config->speed) &&
+           (period - slack <= 1e9 / (config->speed * 0.8));
+}
+
+static void test_timing_reference_values(void) {
+    // Worked through the RM0399 equations by hand and with meets_spec(). The RM0399 example for
+    // 16 MHz fast mode plus (0x00200204) is one SCLL shorter, which leaves the SCL low period
+    // under 500 ns once the two sync clocks are counted.
+    static const struct {
+        i2c_timing_config_t config;
+        uint32_t timingr;
+        uint32_t actual_speed;
+    } cases[] = {
+        {{  8000000, I2C_SPEED_STANDARD,  1000, 300, false, 0}, 0x00901D23,   99502},
+        {{  8000000, I2C_SPEED_FAST,       300, 300, false, 0}, 0x00300208,  384615},
+        {{ 16000000, I2C_SPEED_STANDARD,  1000, 300, true,  0}, 0x10911E24,   98522},
+        {{ 16000000, I2C_SPEED_FAST,       300, 300, true,  0}, 0x00610611,  398010},
+        {{ 16000000, I2C_SPEED_FAST_PLUS,  120, 120, false, 0}, 0x00200205,  950119},
+        {{ 48000000, I2C_SPEED_FAST,       300, 300, true,  0}, 0x4032040B,  391522},
+        {{ 64000000, I2C_SPEED_FAST_PLUS,  120, 120, false, 0}, 0x00A50E1D,  994406},
+        {{100000000, I2C_SPEED_FAST_PLUS,  120, 120, false, 0}, 0x10850B17, 1000000},
+        {{120000000, I2C_SPEED_STANDARD,  1000, 300, true,  0}, 0xA0D32A32,   99506},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        i2c_timing_t timing;
+        CHECK_EQ(i2c_compute_timing(&cases[i].config, &timing), TI_ERRC_NONE);
+        CHECK_EQ(timing.timingr, cases[i].timingr);
+        CHECK_EQ(timing.actual_speed, cases[i].actual_speed);
+        CHECK_EQ(timing.fast_mode_plus, cases[i].config.speed > I2C_SPEED_FAST);
+        CHECK(meets_spec(&cases[i].config, timing.timingr));
+    }
+}
+
+static void test_timing_too_slow_a_clock_is_unsupported(void) {
+    // The data valid time leaves no room for SDADEL. These used to clamp it to zero and return a
+    // setting that misses the data valid time.
+    i2c_timing_config_t cases[] = {
+        { 8000000, I2C_SPEED_FAST_PLUS, 120, 120, false, 0},
+        { 8000000, I2C_SPEED_FAST_PLUS, 120, 120, true,  0},
+        {16000000, I2C_SPEED_FAST_PLUS, 120, 120, true,  0},
+        { 8000000, I2C_SPEED_FAST,      300, 300, true,  0},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        i2c_timing_t timing = {.timingr = 0x12345678};
+        CHECK_EQ(i2c_compute_timing(&cases[i], &timing), TI_ERRC_UNSUPPORTED);
+        CHECK_EQ(timing.timingr, 0x12345678);
+    }
+}
+
+static void test_timing_sweep_meets_spec(void) {
+    static const uint16_t rise[] = {1000, 300, 120};
+    static const uint16_t fall[] = {300, 300, 120};
+    static const uint32_t speeds[] = {I2C_SPEED_STANDARD, I2C_SPEED_FAST, I2C_SPEED_FAST_PLUS};
+    uint32_t solved = 0;
+
+    for (uint32_t clk = 8000000; clk <= 200000000; clk += 4000000) {
+        for (int mode = 0; mode < 3; mode++) {
+            for (uint8_t filters = 0; filters < 4; filters++) {
+                i2c_timing_config_t config = {clk, speeds[mode], rise[mode], fall[mode], filters & 1,
+                                              (filters & 2) ? 2 : 0};
+                i2c_timing_t timing;
+                int status = i2c_compute_timing(&config, &timing);
+                if (status == TI_ERRC_UNSUPPORTED) continue;
+                CHECK_EQ(status, TI_ERRC_NONE);
+                CHECK(meets_spec(&config, timing.timingr));
+                CHECK(timing.actual_speed <= config.speed);
+                solved++;
+            }
+        }
+    }
+    CHECK(solved > 400);
+}
+
+int main(void) {
+    i2c_config_t config = {
+        .addr_mode = I2C_ADDR_7BIT,
+        .scl_pin = 10,
+        .sda_pin = 11,
+        .timeout = 1000,
+    };
+
+    if (!host_periph_trap((uintptr_t)I2Cx_CR1[I2C], before_access, after_access, NULL)) {
+        fprintf(stderr, "cannot trap the I2C1 page\n");
+        return 1;
+    }
+    CHECK_EQ(i2c_init(I2C, &config, transfer_done, (void *)DIRECT), TI_ERRC_NONE);
+
+    RUN(test_mem_read_uses_repeated_start);
+    RUN(test_long_read_reloads_in_255_byte_chunks);
+    RUN(test_long_mem_write_counts_the_register_address);
+    RUN(test_async_mem_read_repeated_start_then_reload);
+    RUN(test_async_write_reloads);
+    RUN(test_queue_runs_in_submission_order);
+    RUN(test_failed_start_fails_through_its_callback);
+    RUN(test_stuck_busy_recovers_direct_calls);
+    RUN(test_stuck_busy_recovers_the_queue);
+    RUN(test_stale_dma_completion_is_ignored);
+    RUN(test_timing_reference_values);
+    RUN(test_timing_too_slow_a_clock_is_unsupported);
+    RUN(test_timing_sweep_meets_spec);
+
+    host_periph_untrap();
+    TEST_MAIN_END;
+}
@@ -0,0 +1,263 @@
+/**
+ * @file tests/test_spi_nss.c
+ * @brief Tests of spi_transfer_packed() (myWork/spi_nss.c) against a register-level model of SPI1.
+ *
+ * The driver's accesses to the SPI1 page trap into the model (host_periph.c), which tells byte
+ * accesses to TXDR/RXDR from word accesses. The model has the 16-frame FIFOs of SPI1 and loops
+ * every frame back inverted: each poll of SR shifts one frame from the TX FIFO to the RX FIFO.
+ * TXP is raised while a packet of FTHVL + 1 frames fits, RXWNE while a word is waiting and
+ * RXPLVL with fewer frames, and EOT once TSIZE frames are out. A word written to TXDR without
+ * room for four frames, or read from RXDR without four frames waiting, is counted as an error.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "test.h"
+#include "host_periph.h"
+#include "include/errc.h"
+#include "include/mmio.h"
+#include "include/spi.h"
+
+#define SPI        1
+#define NSS_PIN    15
+#define FIFO       16
+#define MAX_BYTES  64
+#define TIMEOUT    1000
+
+typedef struct {
+    bool running;
+    bool stalled;       // SCK never toggles: nothing leaves the TX FIFO
+    bool no_eot;        // EOT is never raised
+    uint32_t shifted;
+    uint8_t tx[FIFO];
+    uint32_t tx_count;
+    uint8_t rx[FIFO];
+    uint32_t rx_head;
+    uint32_t rx_count;
+    uint8_t sent[MAX_BYTES];
+    uint32_t byte_writes;
+    uint32_t word_writes;
+    uint32_t byte_reads;
+    uint32_t word_reads;
+    uint32_t errors;
+    bool eot_cleared;
+} spi_model_t;
+
+static spi_model_t model;
+
+/**************************************************************************************************
+ * @section SPI1 Model
+ **************************************************************************************************/
+
+static uint32_t tsize(void) {
+    return (*SPIx_CR2[SPI] & SPIx_CR2_TSIZE.msk) >> SPIx_CR2_TSIZE.pos;
+}
+
+static uint32_t packet(void) {
+    return ((*SPIx_CFG1[SPI] & SPIx_CFG1_FTHVL.msk) >> SPIx_CFG1_FTHVL.pos) + 1U;
+}
+
+static void shift(void) {
+    if (!model.running || model.stalled || (model.tx_count == 0) || (model.rx_count == FIFO)) return;
+    if (model.shifted == tsize()) return;
+
+    uint8_t frame = model.tx[0];
+    memmove(model.tx, model.tx + 1, --model.tx_count);
+    if (model.shifted < MAX_BYTES) model.sent[model.shifted] = frame;
+    model.rx[(model.rx_head + model.rx_count++) % FIFO] = (uint8_t)~frame;
+    model.shifted++;
+}
+
+static uint32_t pop_rx(unsigned frames) {
+    if (model.rx_count < frames) {
+        model.errors++;
+        return 0;
+    }
+
+    uint32_t data = 0;
+    for (unsigned i = 0; i < frames; i++) {
+        data |= (uint32_t)model.rx[model.rx_head] << (8 * i);
+        model.rx_head = (model.rx_head + 1) % FIFO;
+        model.rx_count--;
+    }
+    return data;
+}
+
+static void before_access(volatile uint32_t *reg, bool write, void *context) {
+    (void)context;
+    if (write) return;
+
+    if (reg == (volatile uint32_t *)SPIx_SR[SPI]) {
+        shift();
+        uint32_t sr = 0;
+        if (FIFO - model.tx_count >= packet()) sr |= SPIx_SR_TXP.msk;
+        if (model.rx_count >= 4) sr |= SPIx_SR_RXWNE.msk;
+        else sr |= model.rx_count << SPIx_SR_RXPLVL.pos;
+        if (model.running && !model.no_eot && (model.shifted == tsize())) sr |= SPIx_SR_EOT.msk;
+        *reg = sr;
+    } else if (reg == (volatile uint32_t *)SPIx_RXDR[SPI]) {
+        unsigned size = host_periph_access_size();
+        if (size == 1) model.byte_reads++;
+        else model.word_reads++;
+        *reg = pop_rx(size);
+    }
+}
+
+static void after_access(volatile uint32_t *reg, bool write, void *context) {
+    (void)context;
+    if (!write) return;
+
+    if (reg == (volatile uint32_t *)SPIx_TXDR[SPI]) {
+        unsigned size = host_periph_access_size();
+        if (size == 1) model.byte_writes++;
+        else model.word_writes++;
+
+        if (FIFO - model.tx_count < size) {
+            model.errors++;
+            return;
+        }
+        for (unsigned i = 0; i < size; i++) model.tx[model.tx_count++] = (uint8_t)(*reg >> (8 * i));
+    } else if (reg == (volatile uint32_t *)SPIx_CR1[SPI]) {
+        uint32_t cr1 = *reg;
+        if (!(cr1 & SPIx_CR1_SPE.msk)) {
+            model.running = false;
+        } else if (cr1 & SPIx_CR1_CSTART.msk) {
+            model.running = true;
+        }
+    } else if (reg == (volatile uint32_t *)SPIx_IFCR[SPI]) {
+        if (*reg & SPIx_IFCR_EOTC.msk) model.eot_cleared = true;
+    }
+}
+
+/**************************************************************************************************
+ * @section Helpers
+ **************************************************************************************************/
+
+static void setup(uint8_t threshold) {
+    *SPIx_CR1[SPI] = 0;
+    *SPIx_CR2[SPI] = 0;
+    *SPIx_CFG1[SPI] = 0;
+    *SPIx_CFG2[SPI] = 0;
+    WRITE_FIELD(SPIx_CFG1[SPI], SPIx_CFG1_DSIZE, 7U);
+
+    spi_hw_nss_config_t config = {.nss_pin = NSS_PIN, .nss_af = 5, .fifo_threshold = threshold};
+    CHECK_EQ(spi_hw_nss_init(SPI, &config), TI_ERRC_NONE);
+
+    memset(&model, 0, sizeof(model));
+}
+
+static int transfer(const uint8_t *source, uint8_t *dest, size_t size) {
+    host_periph_trap((uintptr_t)SPIx_CR1[SPI], before_access, after_access, NULL);
+    int status = spi_transfer_packed(SPI, source, dest, size, TIMEOUT);
+    host_periph_untrap();
+    return status;
+}
+
+// Runs one transfer and checks the data in both directions and how it was moved
+static void check_transfer(uint8_t threshold, size_t size) {
+    uint8_t source[MAX_BYTES];
+    uint8_t dest[MAX_BYTES];
+    for (size_t i = 0; i < size; i++) source[i] = (uint8_t)(i * 13 + 5);
+    memset(dest, 0, sizeof(dest));
+
+    setup(threshold);
+    CHECK_EQ(transfer(source, dest, size), TI_ERRC_NONE);
+
+    CHECK_EQ(model.errors, 0);
+    CHECK_EQ(model.shifted, size);
+    CHECK(memcmp(model.sent, source, size) == 0);
+    for (size_t i = 0; i < size; i++) CHECK_EQ(dest[i], (uint8_t)~source[i]);
+
+    uint32_t tx_words = (threshold >= 4) ? size / 4 : 0;
+    CHECK_EQ(model.word_writes, tx_words);
+    CHECK_EQ(model.byte_writes, size - 4 * tx_words);
+    CHECK_EQ(model.word_reads, size / 4);
+    CHECK_EQ(model.byte_reads, size % 4);
+
+    CHECK(model.eot_cleared);
+    CHECK(!READ_FIELD(SPIx_CR1[SPI], SPIx_CR1_SPE));
+}
+
+/**************************************************************************************************
+ * @section Tests
+ **************************************************************************************************/
+
+// With room guaranteed for fewer than four frames, a word write could overflow the TX FIFO
+static void test_low_threshold_writes_bytes(void) {
+    check_transfer(1, 16);
+    check_transfer(2, 11);
+    check_transfer(3, 32);
+}
+
+static void test_word_threshold_writes_words(void) {
+    check_transfer(4, 16);
+    check_transfer(8, 64);
+    check_transfer(16, 48);
+}
+
+// The last size % 4 frames are moved one at a time on RXPLVL once no full word remains
+static void test_odd_tails(void) {
+    for (size_t size = 1; size <= 13; size++) {
+        check_transfer(4, size);
+        check_transfer(2, size);
+    }
+}
+
+static void test_null_dest_discards(void) {
+    uint8_t source[7] = {1, 2, 3, 4, 5, 6, 7};
+
+    setup(4);
+    CHECK_EQ(transfer(source, NULL, sizeof(source)), TI_ERRC_NONE);
+    CHECK_EQ(model.errors, 0);
+    CHECK_EQ(model.rx_count, 0);
+    CHECK(memcmp(model.sent, source, sizeof(source)) == 0);
+}
+
+// The peripheral is disabled after a timeout, so NSS is released either way
+static void test_stalled_bus_times_out(void) {
+    uint8_t source[MAX_BYTES] = {0};
+
+    setup(4);
+    model.stalled = true;
+    CHECK_EQ(transfer(source, NULL, sizeof(source)), TI_ERRC_TIMEOUT);
+    CHECK_EQ(model.errors, 0);
+    CHECK_EQ(model.tx_count, FIFO);
+    CHECK(model.eot_cleared);
+    CHECK(!READ_FIELD(SPIx_CR1[SPI], SPIx_CR1_SPE));
+}
+
+static void test_missing_eot_times_out(void) {
+    uint8_t source[10] = {0};
+    uint8_t dest[10];
+
+    setup(4);
+    model.no_eot = true;
+    CHECK_EQ(transfer(source, dest, sizeof(source)), TI_ERRC_TIMEOUT);
+    CHECK_EQ(model.errors, 0);
+    CHECK_EQ(model.shifted, sizeof(source));
+    CHECK_EQ(model.rx_count, 0);
+    CHECK(!READ_FIELD(SPIx_CR1[SPI], SPIx_CR1_SPE));
+}
+
+static void test_rejects_bad_calls(void) {
+    uint8_t source[4] = {0};
+
+    setup(4);
+    CHECK_EQ(spi_transfer_packed(2, source, NULL, 4, TIMEOUT), TI_ERRC_INVALID_STATE);
+    CHECK_EQ(spi_transfer_packed(SPI, source, NULL, 0, TIMEOUT), TI_ERRC_INVALID_ARG);
+    CHECK_EQ(spi_transfer_packed(SPI, source, NULL, 0x10000, TIMEOUT), TI_ERRC_INVALID_ARG);
+
+    WRITE_FIELD(SPIx_CFG1[SPI], SPIx_CFG1_DSIZE, 15U);
+    CHECK_EQ(spi_transfer_packed(SPI, source, NULL, 4, TIMEOUT), TI_ERRC_INVALID_STATE);
+}
+
+int main(void) {
+    RUN(test_low_threshold_writes_bytes);
+    RUN(test_word_threshold_writes_words);
+    RUN(test_odd_tails);
+    RUN(test_null_dest_discards);
+    RUN(test_stalled_bus_times_out);
+    RUN(test_missing_eot_times_out);
+    RUN(test_rejects_bad_calls);
+    TEST_MAIN_END;
+}
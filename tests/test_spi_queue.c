@@ -0,0 +1,281 @@
+/**
+ * @file tests/test_spi_queue.c
+ * @brief Multithreaded stress test of the lock-free SPI submission path (myWork/spi_queue.c).
+ *
+ * Producer threads stand in for ISRs calling spi_submit_isr(), a DMA thread completes
+ * transfers, and a bus-user thread takes the bus the way spi_block() does, through
+ * spi_wait_block(). On the host these really run in parallel, which is a harsher schedule than
+ * preemption on the M7. The checks: one owner per instance at any time, the right chip select
+ * asserted for every transfer, per-producer FIFO order, and every accepted transfer completed
+ * exactly once.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "test.h"
+#include "include/errc.h"
+#include "include/spi.h"
+#include "gpio.h"
+
+#define INSTANCES      2   // SPI1 and SPI2
+#define PRODUCERS      3   // Per instance
+#define PER_PRODUCER   2000
+#define FAIL_EVERY     97  // Every n-th start is refused, to exercise the failure path
+#define USER_PIN(inst) (100 + (inst))
+#define PRODUCER_PIN(inst, p) (10 * (inst) + (p) + 1)
+
+typedef struct {
+    uint8_t instance;
+    int index;
+    atomic_uint completed;
+    atomic_uint failed;
+    atomic_uintptr_t last_started; // Sequence number of the last transfer started
+} producer_t;
+
+static producer_t producers[INSTANCES + 1][PRODUCERS];
+
+static atomic_bool bus_active[INSTANCES + 1];  // A queued transfer is on the wire
+static atomic_bool user_owns[INSTANCES + 1];   // The bus-user thread holds the bus
+static _Atomic(spi_callback_t) in_flight[INSTANCES + 1];
+static atomic_uint starts;
+static atomic_uint other_starts; // Transfers on instances outside the stress test
+static atomic_uint violations;
+static atomic_bool stop_dma;
+static atomic_bool stop_user;
+
+// spi_callback_t has no context, so each producer gets its own completion function
+#define PRODUCER_CALLBACK(inst, p)                                                       \
+    static void done_##inst##_##p(bool success) {                                        \
+        atomic_fetch_add(success ? &producers[inst][p].completed                         \
+                                 : &producers[inst][p].failed, 1);                       \
+    }
+
+PRODUCER_CALLBACK(1, 0)
+PRODUCER_CALLBACK(1, 1)
+PRODUCER_CALLBACK(1, 2)
+PRODUCER_CALLBACK(2, 0)
+PRODUCER_CALLBACK(2, 1)
+PRODUCER_CALLBACK(2, 2)
+
+static const spi_callback_t producer_callbacks[INSTANCES + 1][PRODUCERS] = {
+    [1] = {done_1_0, done_1_1, done_1_2},
+    [2] = {done_2_0, done_2_1, done_2_2},
+};
+
+static int low_pins(uint8_t instance) {
+    int low = !tal_read_pin(USER_PIN(instance));
+    for (int p = 0; p < PRODUCERS; p++) low += !tal_read_pin(PRODUCER_PIN(instance, p));
+    return low;
+}
+
+// No instance in this test uses hardware NSS (myWork/spi_nss.c)
+bool spi_is_hw_nss(uint8_t instance) {
+    (void)instance;
+    return false;
+}
+
+bool spi_hw_nss_accepts(spi_device_t device) {
+    (void)device;
+    return true;
+}
+
+// Stands in for the DMA driver. Called by whichever thread holds the reservation.
+int spi_transfer_async(struct spi_async_transfer_t *transfer) {
+    uint8_t instance = transfer->device.instance;
+    if (instance > INSTANCES) {
+        atomic_fetch_add(&other_starts, 1);
+        return TI_ERRC_NONE;
+    }
+
+    int p = transfer->device.gpio_pin - PRODUCER_PIN(instance, 0);
+    producer_t *producer = &producers[instance][p];
+
+    if (atomic_load(&user_owns[instance])) atomic_fetch_add(&violations, 1);
+    if (atomic_exchange(&bus_active[instance], true)) atomic_fetch_add(&violations, 1);
+    if (tal_read_pin(transfer->device.gpio_pin) || (low_pins(instance) != 1)) {
+        atomic_fetch_add(&violations, 1);
+    }
+
+    uintptr_t seq = (uintptr_t)transfer->source;
+    if (seq <= atomic_load(&producer->last_started)) atomic_fetch_add(&violations, 1);
+    atomic_store(&producer->last_started, seq);
+
+    if (atomic_fetch_add(&starts, 1) % FAIL_EVERY == FAIL_EVERY - 1) {
+        atomic_store(&bus_active[instance], false);
+        return TI_ERRC_INTERNAL;
+    }
+
+    atomic_store(&in_flight[instance], transfer->callback);
+    return TI_ERRC_NONE;
+}
+
+static void *dma_thread(void *arg) {
+    (void)arg;
+    while (!atomic_load(&stop_dma)) {
+        for (uint8_t instance = 1; instance <= INSTANCES; instance++) {
+            spi_callback_t callback = atomic_exchange(&in_flight[instance], NULL);
+            if (callback == NULL) continue;
+            atomic_store(&bus_active[instance], false);
+            callback(true);
+        }
+        sched_yield();
+    }
+    return NULL;
+}
+
+static void *producer_thread(void *arg) {
+    producer_t *producer = arg;
+    spi_device_t device = {
+        .instance = producer->instance,
+        .gpio_pin = PRODUCER_PIN(producer->instance, producer->index),
+    };
+
+    for (uintptr_t seq = 1; seq <= PER_PRODUCER; seq++) {
+        struct spi_async_transfer_t transfer = {
+            .device = device,
+            .source = (void *)seq,
+            .size = 1,
+            .callback = producer_callbacks[producer->instance][producer->index],
+        };
+        while (spi_submit_isr(&transfer) == TI_ERRC_BUSY) sched_yield();
+    }
+    return NULL;
+}
+
+static void *user_thread(void *arg) {
+    uint8_t instance = (uint8_t)(uintptr_t)arg;
+    spi_device_t device = {.instance = instance, .gpio_pin = USER_PIN(instance)};
+
+    while (!atomic_load(&stop_user)) {
+        if (spi_wait_block(device, UINT64_MAX) != TI_ERRC_NONE) {
+            atomic_fetch_add(&violations, 1);
+            continue;
+        }
+        atomic_store(&user_owns[instance], true);
+        if (atomic_load(&bus_active[instance]) || (low_pins(instance) != 1)) {
+            atomic_fetch_add(&violations, 1);
+        }
+        sched_yield(); // "Transfer" while holding the bus
+        atomic_store(&user_owns[instance], false);
+        spi_try_unblock(device);
+        sched_yield();
+    }
+    return NULL;
+}
+
+static void test_submit_isr_stress(void) {
+    pthread_t dma, users[INSTANCES + 1], threads[INSTANCES + 1][PRODUCERS];
+
+    pthread_create(&dma, NULL, dma_thread, NULL);
+    for (uint8_t instance = 1; instance <= INSTANCES; instance++) {
+        pthread_create(&users[instance], NULL, user_thread, (void *)(uintptr_t)instance);
+        for (int p = 0; p < PRODUCERS; p++) {
+            producers[instance][p].instance = instance;
+            producers[instance][p].index = p;
+            pthread_create(&threads[instance][p], NULL, producer_thread, &producers[instance][p]);
+        }
+    }
+
+    for (uint8_t instance = 1; instance <= INSTANCES; instance++) {
+        for (int p = 0; p < PRODUCERS; p++) pthread_join(threads[instance][p], NULL);
+    }
+
+    // Let the queues drain, then stop the bus users before the DMA so nothing is left in flight
+    for (;;) {
+        unsigned done = 0;
+        for (uint8_t instance = 1; instance <= INSTANCES; instance++) {
+            for (int p = 0; p < PRODUCERS; p++) {
+                done += atomic_load(&producers[instance][p].completed) +
+                        atomic_load(&producers[instance][p].failed);
+            }
+        }
+        if (done == INSTANCES * PRODUCERS * PER_PRODUCER) break;
+        sched_yield();
+    }
+    atomic_store(&stop_user, true);
+    for (uint8_t instance = 1; instance <= INSTANCES; instance++) pthread_join(users[instance], NULL);
+    atomic_store(&stop_dma, true);
+    pthread_join(dma, NULL);
+
+    unsigned failed = 0;
+    for (uint8_t instance = 1; instance <= INSTANCES; instance++) {
+        for (int p = 0; p < PRODUCERS; p++) {
+            failed += atomic_load(&producers[instance][p].failed);
+            CHECK_EQ(atomic_load(&producers[instance][p].last_started), PER_PRODUCER);
+        }
+        CHECK_EQ(low_pins(instance), 0);
+    }
+    CHECK_EQ(atomic_load(&violations), 0);
+    CHECK_EQ(failed, atomic_load(&starts) / FAIL_EVERY);
+}
+
+static void test_wait_block_times_out_while_queue_busy(void) {
+    spi_device_t queued = {.instance = 3, .gpio_pin = 31};
+    spi_device_t user = {.instance = 3, .gpio_pin = 32};
+
+    // A reservation taken with spi_try_block() keeps spi_wait_block() out
+    struct spi_async_transfer_t transfer = {.device = queued, .source = (void *)1, .size = 1};
+    CHECK(spi_try_block(queued) == TI_ERRC_NONE);
+    CHECK_EQ(spi_wait_block(user, 1000), TI_ERRC_TIMEOUT);
+    CHECK(tal_read_pin(user.gpio_pin));
+    CHECK(spi_try_unblock(queued) == TI_ERRC_NONE);
+    CHECK_EQ(spi_wait_block(user, 0), TI_ERRC_NONE);
+    CHECK(!tal_read_pin(user.gpio_pin));
+
+    // Held by a bus user: submissions wait in the queue
+    CHECK_EQ(spi_submit_isr(&transfer), TI_ERRC_NONE);
+    CHECK(tal_read_pin(queued.gpio_pin));
+    CHECK_EQ(atomic_load(&other_starts), 0);
+
+    // Releasing the bus starts it, which keeps the reservation until the transfer completes
+    CHECK_EQ(spi_try_unblock(user), TI_ERRC_NONE);
+    CHECK_EQ(atomic_load(&other_starts), 1);
+    CHECK(!tal_read_pin(queued.gpio_pin));
+    CHECK_EQ(spi_wait_block(user, 1000), TI_ERRC_TIMEOUT);
+}
+
+static void test_unblock_requires_owner(void) {
+    spi_device_t queued = {.instance = 4, .gpio_pin = 41};
+    spi_device_t user = {.instance = 4, .gpio_pin = 42};
+
+    // Nobody holds the bus
+    CHECK_EQ(spi_try_unblock(user), TI_ERRC_INVALID_STATE);
+
+    // The ISR queue holds it while its transfer is in flight, so a device cannot release it
+    struct spi_async_transfer_t transfer = {.device = queued, .source = (void *)1, .size = 1};
+    CHECK_EQ(spi_submit_isr(&transfer), TI_ERRC_NONE);
+    CHECK(!tal_read_pin(queued.gpio_pin));
+    CHECK_EQ(spi_try_unblock(queued), TI_ERRC_INVALID_STATE);
+    CHECK_EQ(spi_try_unblock(user), TI_ERRC_INVALID_STATE);
+    CHECK(!tal_read_pin(queued.gpio_pin));
+    CHECK_EQ(spi_try_block(user), TI_ERRC_BUSY);
+}
+
+static void test_unblock_rejects_other_device(void) {
+    spi_device_t user = {.instance = 5, .gpio_pin = 51};
+    spi_device_t other = {.instance = 5, .gpio_pin = 52};
+
+    CHECK_EQ(spi_try_block(user), TI_ERRC_NONE);
+    CHECK(!tal_read_pin(user.gpio_pin));
+
+    // Only the device that blocked the bus can release it, and the holder's CS stays low
+    CHECK_EQ(spi_try_unblock(other), TI_ERRC_INVALID_STATE);
+    CHECK(!tal_read_pin(user.gpio_pin));
+    CHECK_EQ(spi_try_block(other), TI_ERRC_BUSY);
+
+    CHECK_EQ(spi_try_unblock(user), TI_ERRC_NONE);
+    CHECK(tal_read_pin(user.gpio_pin));
+    CHECK_EQ(spi_try_unblock(user), TI_ERRC_INVALID_STATE);
+    CHECK_EQ(spi_try_block(other), TI_ERRC_NONE);
+    CHECK_EQ(spi_try_unblock(other), TI_ERRC_NONE);
+}
+
+int main(void) {
+    RUN(test_wait_block_times_out_while_queue_busy);
+    RUN(test_unblock_requires_owner);
+    RUN(test_unblock_rejects_other_device);
+    RUN(test_submit_isr_stress);
+    TEST_MAIN_END;
+}
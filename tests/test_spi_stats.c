@@ -0,0 +1,137 @@
+/**
+ * @file tests/test_spi_stats.c
+ * @brief Tests of the SPI utilization and latency counters (myWork/spi_stats.c).
+ *
+ * The DWT cycle counter is ordinary memory here (host_mmio.c), so each test sets CYCCNT to the
+ * time of every hook call and checks the totals, maxima and latency bins that come out.
+ */
+
+#include <stdint.h>
+#include "test.h"
+#include "include/errc.h"
+#include "include/spi.h"
+#include "myWork/cpu.h"
+
+#define MHZ 1000000U
+
+static const spi_device_t tracked = {.instance = 2, .gpio_pin = 5};
+static const spi_device_t untracked = {.instance = 2, .gpio_pin = 6};
+
+static void at(uint32_t cycles) {
+    *CPU_DWT_CYCCNT = cycles;
+}
+
+// One spi_block() that waited from begin to acquired, then one transfer from start to end
+static void transaction(spi_device_t device, uint32_t begin, uint32_t acquired, uint32_t start,
+                        uint32_t end, size_t size) {
+    at(begin);
+    spi_stats_block_begin(device);
+    at(acquired);
+    spi_stats_block_end(device);
+    at(start);
+    spi_stats_xfer_begin(device);
+    at(end);
+    spi_stats_xfer_end(device, size);
+}
+
+static uint32_t hist_bin(const spi_stats_t *stats) {
+    for (uint32_t bin = 0; bin < SPI_STATS_HIST_BINS; bin++) {
+        if (stats->latency_hist[bin] != 0) return bin;
+    }
+    return SPI_STATS_HIST_BINS;
+}
+
+static void test_utilization_totals(void) {
+    spi_stats_t stats;
+    CHECK_EQ(spi_stats_init(480 * MHZ), TI_ERRC_NONE);
+    CHECK_EQ(spi_stats_register_device(tracked), TI_ERRC_NONE);
+
+    transaction(tracked, 1000, 1300, 1400, 2400, 16);
+    transaction(tracked, 5000, 5100, 5200, 9200, 64);
+
+    CHECK_EQ(spi_get_device_stats(tracked, &stats), TI_ERRC_NONE);
+    CHECK_EQ(stats.transactions, 2);
+    CHECK_EQ(stats.bytes, 80);
+    CHECK_EQ(stats.blocks, 2);
+    CHECK_EQ(stats.block_wait_cycles, 400);
+    CHECK_EQ(stats.block_wait_max, 300);
+    CHECK_EQ(stats.wire_cycles, 5000);
+    CHECK_EQ(stats.wire_max, 4000);
+
+    // Unregistered devices still count towards the instance
+    transaction(untracked, 10000, 10050, 10100, 10200, 4);
+    CHECK_EQ(spi_get_device_stats(untracked, &stats), TI_ERRC_INVALID_ARG);
+    CHECK_EQ(spi_get_stats(2, &stats), TI_ERRC_NONE);
+    CHECK_EQ(stats.transactions, 3);
+    CHECK_EQ(stats.bytes, 84);
+    CHECK_EQ(stats.block_wait_cycles, 450);
+    CHECK_EQ(stats.wire_cycles, 5100);
+
+    CHECK_EQ(spi_reset_stats(2), TI_ERRC_NONE);
+    CHECK_EQ(spi_get_stats(2, &stats), TI_ERRC_NONE);
+    CHECK_EQ(stats.transactions, 0);
+    CHECK_EQ(spi_get_device_stats(tracked, &stats), TI_ERRC_NONE);
+    CHECK_EQ(stats.bytes, 0);
+}
+
+static void test_latency_bins_follow_the_clock(void) {
+    spi_stats_t stats;
+
+    // 3340 cycles from spi_block() to the end of the transfer: 6.96 us at 480 MHz
+    CHECK_EQ(spi_stats_init(480 * MHZ), TI_ERRC_NONE);
+    transaction(untracked, 100, 1100, 2000, 3440, 1);
+    CHECK_EQ(spi_get_stats(2, &stats), TI_ERRC_NONE);
+    CHECK_EQ(hist_bin(&stats), 3); // < 8 us
+
+    // The same cycles are 34.8 us at 96 MHz
+    CHECK_EQ(spi_stats_init(96 * MHZ), TI_ERRC_NONE);
+    transaction(untracked, 100, 1100, 2000, 3440, 1);
+    CHECK_EQ(spi_get_stats(2, &stats), TI_ERRC_NONE);
+    CHECK_EQ(hist_bin(&stats), 6); // < 64 us
+
+    CHECK_EQ(spi_stats_init(0), TI_ERRC_INVALID_ARG);
+}
+
+static void test_latency_bin_edges(void) {
+    static const struct {
+        uint32_t cycles;
+        uint32_t bin;
+    } cases[] = {
+        {0, 0}, {63, 0}, {64, 1}, {127, 1}, {128, 2}, {64 * 64 - 1, 6}, {64 * 64, 7}, {UINT32_MAX, 7},
+    };
+
+    // 64 MHz: 64 cycles per us
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        spi_stats_t stats;
+        CHECK_EQ(spi_stats_init(64 * MHZ), TI_ERRC_NONE);
+        transaction(untracked, 0, 0, 0, cases[i].cycles, 1);
+        CHECK_EQ(spi_get_stats(2, &stats), TI_ERRC_NONE);
+        CHECK_EQ(hist_bin(&stats), cases[i].bin);
+    }
+}
+
+static void test_cyccnt_wraparound(void) {
+    spi_stats_t stats;
+    CHECK_EQ(spi_stats_init(480 * MHZ), TI_ERRC_NONE);
+    CHECK_EQ(spi_stats_register_device(tracked), TI_ERRC_NONE);
+
+    // Waits, transfers and latency that straddle the 32-bit wrap (every 8.9 s at 480 MHz)
+    transaction(tracked, 0xFFFFFF00U, 0x00000100U, 0x00000200U, 0x00000A00U, 8);
+    transaction(tracked, 0xFFFFF000U, 0xFFFFF800U, 0xFFFFFC00U, 0x00000400U, 8);
+
+    CHECK_EQ(spi_get_device_stats(tracked, &stats), TI_ERRC_NONE);
+    CHECK_EQ(stats.block_wait_cycles, 0x200 + 0x800);
+    CHECK_EQ(stats.block_wait_max, 0x800);
+    CHECK_EQ(stats.wire_cycles, 0x800 + 0x800);
+    CHECK_EQ(stats.wire_max, 0x800);
+    CHECK_EQ(stats.latency_hist[3], 1); // 0xB00 cycles, 5.9 us
+    CHECK_EQ(stats.latency_hist[4], 1); // 0x1400 cycles, 10.7 us
+}
+
+int main(void) {
+    RUN(test_utilization_totals);
+    RUN(test_latency_bins_follow_the_clock);
+    RUN(test_latency_bin_edges);
+    RUN(test_cyccnt_wraparound);
+    TEST_MAIN_END;
+}
@@ -0,0 +1,399 @@
+/**
+ * @file tests/test_uart_duplex.c
+ * @brief All eight UART channels in full duplex at once, against the driver (misc./uart.c).
+ *
+ * The test plays the DMA (host_dma.c). Each step moves a few bytes on every running stream, so
+ * the TX and RX streams of all eight channels are in flight together. An RX stream only moves
+ * while DMAR is set in its channel's CR3 and fills its buffer from that channel's generator; a TX
+ * stream only moves while DMAT is set and appends to that channel's line. The streams are told
+ * apart by the data register they move to or from. A byte from another channel, a lost byte or a
+ * reordered one fails the check.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "test.h"
+#include "host_dma.h"
+#include "include/mmio.h"
+#include "misc./uart.h"
+
+#define CHANNELS   8
+#define CLK_FREQ   100000000U
+#define BAUD       921600U
+#define LINE_BYTES 16384U
+#define RING_SIZE  256U
+#define QUEUE_SIZE 512U
+#define MAX_STEPS  100000U
+
+#define IS_USART(channel) \
+    ((channel) == UART1 || (channel) == UART2 || (channel) == UART3 || (channel) == UART6)
+#define REG(reg, channel) (IS_USART(channel) ? USARTx_##reg[channel] : UARTx_##reg[channel])
+
+typedef struct {
+    uint32_t rx_sent;            // Bytes the line has handed to the RX stream
+    uint8_t tx_line[LINE_BYTES]; // What the TX stream put on the line
+    uint32_t tx_count;
+    uint32_t rx_done;            // uart_read_async() completions
+    uint32_t tx_done;            // uart_write_async() completions
+    uint32_t failures;
+} line_t;
+
+static line_t lines[UART_CHANNEL_COUNT];
+
+/**************************************************************************************************
+ * @section Line Model
+ **************************************************************************************************/
+
+// Each channel's streams, distinct per channel and per direction
+static uint8_t stream_byte(uart_channel_t channel, bool rx, uint32_t i) {
+    uint32_t x = (i + 1) * 2654435761U ^ ((uint32_t)channel * 2 + rx) * 0x9E3779B9U;
+    x ^= x >> 15;
+    return (uint8_t)(x * 0x2C1B3C6DU >> 24);
+}
+
+static bool channel_of(const dma_transfer_t *transfer, uart_channel_t *channel, bool *rx) {
+    for (uart_channel_t i = UART1; i < UART_CHANNEL_COUNT; i++) {
+        if ((uintptr_t)transfer->src == (uintptr_t)REG(RDR, i)) {
+            *channel = i;
+            *rx = true;
+            return true;
+        }
+        if ((uintptr_t)transfer->dest == (uintptr_t)REG(TDR, i)) {
+            *channel = i;
+            *rx = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+// A circular stream reloads when it reaches the end and reports each half it fills
+static uint32_t move_rx(uint8_t instance, uint8_t stream, uart_channel_t channel, uint32_t burst) {
+    host_dma_stream_t *s = &host_dma[instance][stream];
+    if (!READ_FIELD(REG(CR3, channel), UARTx_CR3_DMAR)) return 0;
+
+    uint8_t *dest = s->transfer.dest;
+    uint32_t size = s->transfer.size;
+    uint32_t n;
+    for (n = 0; (n < burst) && (s->remaining > 0); n++) {
+        dest[size - s->remaining--] = stream_byte(channel, true, lines[channel].rx_sent++);
+        if (!s->continuous) continue;
+
+        if (s->remaining == size / 2) {
+            s->transfer.event_callback(DMA_EVENT_HALF, 0, s->transfer.context);
+        } else if (s->remaining == 0) {
+            s->remaining = size;
+            s->transfer.event_callback(DMA_EVENT_FULL, 0, s->transfer.context);
+        }
+    }
+    if (!s->continuous && (s->remaining == 0)) host_dma_complete(instance, stream, true);
+    return n;
+}
+
+// The line keeps going into a transfer chained from the completion, as it would on the target
+static uint32_t move_tx(uint8_t instance, uint8_t stream, uart_channel_t channel, uint32_t burst) {
+    host_dma_stream_t *s = &host_dma[instance][stream];
+    line_t *line = &lines[channel];
+    uint32_t n = 0;
+
+    while ((n < burst) && s->active && READ_FIELD(REG(CR3, channel), UARTx_CR3_DMAT)) {
+        const uint8_t *src = s->transfer.src;
+        for (; (n < burst) && (s->remaining > 0); n++) {
+            uint8_t byte = src[s->transfer.size - s->remaining--];
+            if (line->tx_count < LINE_BYTES) line->tx_line[line->tx_count] = byte;
+            line->tx_count++;
+        }
+        if (s->remaining == 0) host_dma_complete(instance, stream, true);
+    }
+    return n;
+}
+
+// Moves up to burst bytes on every running stream. Returns false once no single transfer moves.
+static bool step(uint32_t burst) {
+    bool moved = false;
+    for (uint8_t i = 1; i <= DMA_INSTANCE_COUNT; i++) {
+        for (uint8_t j = 0; j < DMA_STREAM_COUNT; j++) {
+            host_dma_stream_t *s = &host_dma[i][j];
+            uart_channel_t channel;
+            bool rx;
+            if (!s->active) continue;
+            if (!channel_of(&s->transfer, &channel, &rx)) {
+                CHECK(false);
+                continue;
+            }
+
+            bool continuous = s->continuous;
+            uint32_t count = rx ? move_rx(i, j, channel, burst) : move_tx(i, j, channel, burst);
+            if (!continuous && (count > 0)) moved = true;
+        }
+    }
+    return moved;
+}
+
+// An idle line after a burst raises IDLE, which publishes a part-filled ring
+static void line_idle(uart_channel_t channel) {
+    *(volatile uint32_t *)REG(ISR, channel) = UARTx_ISR_IDLE.msk;
+    uart_irq(channel);
+    *(volatile uint32_t *)REG(ISR, channel) = 0;
+}
+
+/**************************************************************************************************
+ * @section Helpers
+ **************************************************************************************************/
+
+static void on_complete(bool success, void *context) {
+    uart_context_t *uart_context = context;
+    line_t *line = &lines[uart_context->channel];
+
+    if (!success) line->failures++;
+    if (uart_context->buffer != NULL) {
+        line->rx_done++;
+    } else {
+        line->tx_done++;
+    }
+}
+
+static dma_callback_t callback = on_complete;
+
+static void setup(void) {
+    memset(lines, 0, sizeof(lines));
+    for (uart_channel_t channel = UART1; channel < UART_CHANNEL_COUNT; channel++) {
+        *REG(CR3, channel) = 0;
+        uart_config_t config = {
+            .channel = channel,
+            .data_length = UART_DATALENGTH_8,
+            .clk_freq = CLK_FREQ,
+            .baud_rate = BAUD,
+        };
+        CHECK(uart_init(&config, &callback, NULL, NULL));
+    }
+}
+
+// Runs the line until no single transfer can move; a circular RX stream keeps running
+static void drain(uint32_t burst) {
+    uint32_t steps = 0;
+    while (step(burst) && (++steps < MAX_STEPS)) {}
+    CHECK(steps < MAX_STEPS);
+}
+
+static uint32_t mismatches(const uint8_t *data, uart_channel_t channel, bool rx, uint32_t first,
+                           uint32_t count) {
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < count; i++) wrong += data[i] != stream_byte(channel, rx, first + i);
+    return wrong;
+}
+
+/**************************************************************************************************
+ * @section Tests
+ **************************************************************************************************/
+
+// Every channel claims its own TX and RX stream; the sixteen use up DMA1 and DMA2
+static void test_streams_are_separate(void) {
+    static uint8_t rx[CHANNELS][4];
+    static uint8_t tx[CHANNELS][4];
+
+    setup();
+    for (int i = 0; i < CHANNELS; i++) {
+        CHECK(uart_read_async((uart_channel_t)(UART1 + i), rx[i], sizeof(rx[i])));
+        CHECK(uart_write_async((uart_channel_t)(UART1 + i), tx[i], sizeof(tx[i])));
+    }
+
+    bool seen[UART_CHANNEL_COUNT][2] = {{false}};
+    uint32_t active = 0;
+    for (uint8_t i = 1; i <= DMA_INSTANCE_COUNT; i++) {
+        for (uint8_t j = 0; j < DMA_STREAM_COUNT; j++) {
+            uart_channel_t channel;
+            bool rx_stream;
+            if (!host_dma[i][j].active) continue;
+            CHECK(channel_of(&host_dma[i][j].transfer, &channel, &rx_stream));
+            CHECK(!seen[channel][rx_stream]);
+            seen[channel][rx_stream] = true;
+            active++;
+        }
+    }
+    CHECK_EQ(active, 2 * CHANNELS);
+
+    drain(4);
+    for (uart_channel_t channel = UART1; channel < UART_CHANNEL_COUNT; channel++) {
+        CHECK_EQ(lines[channel].rx_done, 1);
+        CHECK_EQ(lines[channel].tx_done, 1);
+    }
+}
+
+// A running read does not hold up a write on the same channel, and the other way round
+static void test_directions_are_independent(void) {
+    static uint8_t rx[64];
+    static uint8_t tx[64];
+
+    setup();
+    CHECK(uart_read_async(UART4, rx, sizeof(rx)));
+    CHECK(!uart_rx_done(UART4));
+    CHECK(uart_tx_done(UART4));
+    CHECK(!uart_read_async(UART4, rx, sizeof(rx)));
+    CHECK(uart_write_async(UART4, tx, sizeof(tx)));
+    CHECK(!uart_write_async(UART4, tx, sizeof(tx)));
+
+    // Only the transmitter moves while the receiver's requests are off
+    CLR_FIELD(REG(CR3, UART4), UARTx_CR3_DMAR);
+    drain(8);
+    CHECK_EQ(lines[UART4].tx_done, 1);
+    CHECK_EQ(lines[UART4].rx_done, 0);
+    CHECK(uart_tx_done(UART4));
+    CHECK(!uart_rx_done(UART4));
+    CHECK(uart_write_async(UART4, tx, sizeof(tx)));
+
+    // And the other way round
+    SET_FIELD(REG(CR3, UART4), UARTx_CR3_DMAR);
+    CLR_FIELD(REG(CR3, UART4), UARTx_CR3_DMAT);
+    drain(8);
+    CHECK_EQ(lines[UART4].rx_done, 1);
+    CHECK_EQ(lines[UART4].tx_done, 1);
+    CHECK(uart_rx_done(UART4));
+    CHECK(!uart_tx_done(UART4));
+    CHECK_EQ(mismatches(rx, UART4, true, 0, sizeof(rx)), 0);
+
+    SET_FIELD(REG(CR3, UART4), UARTx_CR3_DMAT);
+    drain(8);
+    CHECK_EQ(lines[UART4].tx_done, 2);
+    CHECK_EQ(lines[UART4].tx_count, 2 * sizeof(tx));
+}
+
+// Reads and writes of different sizes on all eight channels at once, round after round
+static void test_eight_channels_full_duplex(void) {
+    static uint8_t rx[UART_CHANNEL_COUNT][LINE_BYTES];
+    static uint8_t tx[UART_CHANNEL_COUNT][LINE_BYTES];
+    uint32_t received[UART_CHANNEL_COUNT] = {0};
+    uint32_t sent[UART_CHANNEL_COUNT] = {0};
+
+    setup();
+    for (uart_channel_t channel = UART1; channel < UART_CHANNEL_COUNT; channel++) {
+        for (uint32_t i = 0; i < LINE_BYTES; i++) tx[channel][i] = stream_byte(channel, false, i);
+    }
+
+    for (uint32_t round = 0; round < 32; round++) {
+        for (uart_channel_t channel = UART1; channel < UART_CHANNEL_COUNT; channel++) {
+            uint32_t rx_size = 16 + (round * 37 + channel * 11) % 480;
+            uint32_t tx_size = 16 + (round * 53 + channel * 29) % 480;
+            if (received[channel] + rx_size > LINE_BYTES) rx_size = LINE_BYTES - received[channel];
+            if (sent[channel] + tx_size > LINE_BYTES) tx_size = LINE_BYTES - sent[channel];
+
+            if (rx_size > 0) {
+                CHECK(uart_read_async(channel, rx[channel] + received[channel], rx_size));
+                received[channel] += rx_size;
+            }
+            if (tx_size > 0) {
+                CHECK(uart_write_async(channel, tx[channel] + sent[channel], tx_size));
+                sent[channel] += tx_size;
+            }
+        }
+        drain(1 + round % 7);
+    }
+
+    for (uart_channel_t channel = UART1; channel < UART_CHANNEL_COUNT; channel++) {
+        line_t *line = &lines[channel];
+        CHECK_EQ(line->failures, 0);
+        CHECK_EQ(line->rx_sent, received[channel]);
+        CHECK_EQ(mismatches(rx[channel], channel, true, 0, received[channel]), 0);
+        CHECK_EQ(line->tx_count, sent[channel]);
+        CHECK_EQ(mismatches(line->tx_line, channel, false, 0, line->tx_count), 0);
+        CHECK(uart_rx_done(channel));
+        CHECK(uart_tx_done(channel));
+    }
+}
+
+// uart_read_async() and the RX ring take turns on the one RX stream
+static void test_rx_ring_excludes_read_async(void) {
+    static uint8_t ring[RING_SIZE];
+    static uint8_t rx[32];
+    static uint8_t tx[32];
+    uart_rx_ring_config_t config = {.buffer = ring, .size = RING_SIZE};
+
+    setup();
+    CHECK(uart_read_async(UART2, rx, sizeof(rx)));
+    CHECK(!uart_rx_ring_start(UART2, &config));
+    drain(8);
+    CHECK_EQ(lines[UART2].rx_done, 1);
+
+    CHECK(uart_rx_ring_start(UART2, &config));
+    CHECK(READ_FIELD(REG(CR3, UART2), UARTx_CR3_DMAR));
+    CHECK(!uart_read_async(UART2, rx, sizeof(rx)));
+    CHECK(uart_rx_done(UART2));
+
+    // The ring leaves the TX stream to uart_write_async()
+    CHECK(uart_write_async(UART2, tx, sizeof(tx)));
+    step(20);
+    line_idle(UART2);
+    CHECK_EQ(uart_rx_ring_available(UART2), 20);
+    drain(8);
+    CHECK_EQ(lines[UART2].tx_done, 1);
+
+    CHECK(uart_rx_ring_stop(UART2));
+    CHECK(!READ_FIELD(REG(CR3, UART2), UARTx_CR3_DMAR));
+    CHECK_EQ(uart_rx_ring_available(UART2), lines[UART2].rx_sent - sizeof(rx));
+
+    uint32_t first = lines[UART2].rx_sent;
+    CHECK(uart_read_async(UART2, rx, sizeof(rx)));
+    drain(8);
+    CHECK_EQ(lines[UART2].rx_done, 2);
+    CHECK_EQ(mismatches(rx, UART2, true, first, sizeof(rx)), 0);
+}
+
+// Every channel echoes its RX ring back through its TX queue, all at the same time
+static void test_eight_channels_ring_echo(void) {
+    static uint8_t rings[UART_CHANNEL_COUNT][RING_SIZE];
+    static uint8_t queues[UART_CHANNEL_COUNT][QUEUE_SIZE];
+    uint32_t echoed[UART_CHANNEL_COUNT] = {0};
+    uint32_t wrong = 0;
+
+    setup();
+    for (uart_channel_t channel = UART1; channel < UART_CHANNEL_COUNT; channel++) {
+        uart_rx_ring_config_t config = {.buffer = rings[channel], .size = RING_SIZE};
+        CHECK(uart_rx_ring_start(channel, &config));
+        CHECK(uart_tx_queue_init(channel, queues[channel], QUEUE_SIZE));
+    }
+
+    for (uint32_t steps = 0; steps < 500; steps++) {
+        step(1 + (steps * 7) % 61);
+        for (uart_channel_t channel = UART1; channel < UART_CHANNEL_COUNT; channel++) {
+            if ((steps + channel) % 3 == 0) line_idle(channel);
+
+            const uint8_t *span;
+            size_t count;
+            while ((count = uart_rx_ring_peek(channel, &span)) > 0) {
+                wrong += mismatches(span, channel, true, echoed[channel], (uint32_t)count);
+                if (!uart_tx_queue_write(channel, span, count)) break;
+                uart_rx_ring_consume(channel, count);
+                echoed[channel] += (uint32_t)count;
+            }
+        }
+    }
+
+    for (uart_channel_t channel = UART1; channel < UART_CHANNEL_COUNT; channel++) {
+        CHECK(uart_rx_ring_stop(channel));
+    }
+    drain(64);
+    CHECK_EQ(wrong, 0);
+
+    for (uart_channel_t channel = UART1; channel < UART_CHANNEL_COUNT; channel++) {
+        line_t *line = &lines[channel];
+        CHECK(echoed[channel] > 0);
+        CHECK_EQ(uart_rx_ring_overruns(channel), 0);
+        CHECK_EQ(uart_tx_queue_dropped(channel), 0);
+        CHECK(uart_tx_queue_idle(channel));
+        CHECK_EQ(echoed[channel] + uart_rx_ring_available(channel), line->rx_sent);
+
+        // The echo carries the channel's own RX stream back out, and nothing else
+        CHECK(line->tx_count <= LINE_BYTES);
+        CHECK_EQ(line->tx_count, echoed[channel]);
+        CHECK_EQ(mismatches(line->tx_line, channel, true, 0, line->tx_count), 0);
+    }
+}
+
+int main(void) {
+    RUN(test_streams_are_separate);
+    RUN(test_directions_are_independent);
+    RUN(test_eight_channels_full_duplex);
+    RUN(test_rx_ring_excludes_read_async);
+    RUN(test_eight_channels_ring_echo);
+    TEST_MAIN_END;
+}
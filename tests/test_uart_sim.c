@@ -0,0 +1,157 @@
+/**
+ * @file tests/test_uart_sim.c
+ * @brief Capture replay on all eight channels of the host stand-in (misc./uart_sim.c).
+ *
+ * Each channel replays its own capture file, records of 1 to 1024 bytes with their recorded
+ * gaps, into its RX ring, while a reader thread per channel checks every byte against that
+ * channel's generator and echoes it back through the TX queue into a pipe. A byte from another
+ * channel, a lost byte or a reordered one fails the check on both directions, so the replay
+ * threads have to keep their records apart. The driver itself is tested in test_uart_duplex.c.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "test.h"
+#include "misc./uart_sim.h"
+
+#define CHANNELS     8
+#define BAUD         2000000U
+#define STREAM_BYTES 40000U
+#define RING_SIZE    4096U
+#define POLL_NS      200000L
+
+typedef struct {
+    uart_channel_t channel;
+    char path[32];
+    int pipe_fd[2];
+    uint8_t ring[RING_SIZE];
+    uint32_t received;
+    uint32_t mismatches;
+} channel_test_t;
+
+static channel_test_t tests[CHANNELS];
+static atomic_bool timed_out;
+
+// Each channel's byte stream, distinct per channel
+static uint8_t expected_byte(uart_channel_t channel, uint32_t i) {
+    uint32_t x = (i + 1) * 2654435761U ^ (uint32_t)channel * 0x9E3779B9U;
+    x ^= x >> 15;
+    return (uint8_t)(x * 0x2C1B3C6DU >> 24);
+}
+
+// Records of 1 to 1024 bytes with gaps of up to 500 us
+static bool write_stream(channel_test_t *test) {
+    snprintf(test->path, sizeof(test->path), "/tmp/uart_sim_XXXXXX");
+    int fd = mkstemp(test->path);
+    if (fd < 0) return false;
+
+    static uint8_t data[STREAM_BYTES * 2];
+    size_t length = 0;
+    uint32_t seed = test->channel;
+    memcpy(data, UART_SIM_CAPTURE_MAGIC, 4);
+    length = 4;
+    for (uint32_t i = 0; i < STREAM_BYTES;) {
+        uint32_t record = STREAM_BYTES - i;
+        seed = seed * 1103515245U + 12345U;
+        uint32_t delta_us = (seed >> 8) % 500;
+        if (record > 1 + (seed >> 20) % 1024) record = 1 + (seed >> 20) % 1024;
+        const uint8_t header[6] = {delta_us, delta_us >> 8, 0, 0, record, record >> 8};
+        memcpy(data + length, header, sizeof(header));
+        length += sizeof(header);
+        for (uint32_t j = 0; j < record; j++) data[length++] = expected_byte(test->channel, i + j);
+        i += record;
+    }
+    bool ok = write(fd, data, length) == (ssize_t)length;
+    close(fd);
+    return ok;
+}
+
+static void *reader_thread(void *arg) {
+    channel_test_t *test = arg;
+    struct timespec poll = {.tv_nsec = POLL_NS};
+    uint32_t idle_polls = 0;
+
+    while (test->received < STREAM_BYTES && !atomic_load(&timed_out)) {
+        const uint8_t *span;
+        size_t count = uart_rx_ring_peek(test->channel, &span);
+        if (count == 0) {
+            if (++idle_polls > 5 * 1000000000L / POLL_NS) atomic_store(&timed_out, true);
+            nanosleep(&poll, NULL);
+            continue;
+        }
+        idle_polls = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            if (span[i] != expected_byte(test->channel, test->received + i)) test->mismatches++;
+        }
+        if (!uart_tx_queue_write(test->channel, span, count)) test->mismatches++;
+        uart_rx_ring_consume(test->channel, count);
+        test->received += count;
+    }
+    return NULL;
+}
+
+static void test_eight_channels_replay_captures(void) {
+    pthread_t readers[CHANNELS];
+
+    atomic_store(&timed_out, false);
+    for (int i = 0; i < CHANNELS; i++) {
+        channel_test_t *test = &tests[i];
+        *test = (channel_test_t){.channel = (uart_channel_t)(UART1 + i)};
+        CHECK(write_stream(test));
+        CHECK_EQ(pipe(test->pipe_fd), 0);
+        CHECK(uart_sim_init(test->channel, BAUD, test->pipe_fd[1]));
+
+        uart_rx_ring_config_t config = {.buffer = test->ring, .size = RING_SIZE};
+        CHECK(uart_rx_ring_start(test->channel, &config));
+    }
+
+    // Start every replay before any reader, so the channels really overlap
+    for (int i = 0; i < CHANNELS; i++) CHECK(uart_sim_replay(tests[i].channel, tests[i].path, 1.0));
+    for (int i = 0; i < CHANNELS; i++) pthread_create(&readers[i], NULL, reader_thread, &tests[i]);
+    for (int i = 0; i < CHANNELS; i++) {
+        pthread_join(readers[i], NULL);
+        uart_sim_wait(tests[i].channel);
+    }
+    CHECK(!atomic_load(&timed_out));
+
+    for (int i = 0; i < CHANNELS; i++) {
+        channel_test_t *test = &tests[i];
+        uart_sim_stats_t stats;
+        uart_sim_stats(test->channel, &stats);
+
+        CHECK_EQ(test->received, STREAM_BYTES);
+        CHECK_EQ(test->mismatches, 0);
+        CHECK_EQ(stats.rx_bytes, STREAM_BYTES);
+        CHECK_EQ(stats.rx_overruns, 0);
+        CHECK_EQ(stats.rx_lost_bytes, 0);
+        CHECK_EQ(stats.tx_bytes, STREAM_BYTES);
+        CHECK_EQ(uart_tx_queue_dropped(test->channel), 0);
+
+        // The echo carries the same stream back out on the same channel only
+        static uint8_t echoed[STREAM_BYTES + 1];
+        close(test->pipe_fd[1]);
+        size_t length = 0;
+        ssize_t n;
+        while ((n = read(test->pipe_fd[0], echoed + length, sizeof(echoed) - length)) > 0) length += (size_t)n;
+        close(test->pipe_fd[0]);
+        CHECK_EQ(length, STREAM_BYTES);
+        uint32_t wrong = 0;
+        for (uint32_t j = 0; j < length; j++) wrong += echoed[j] != expected_byte(test->channel, j);
+        CHECK_EQ(wrong, 0);
+
+        uart_rx_ring_stop(test->channel);
+        unlink(test->path);
+    }
+}
+
+int main(void) {
+    RUN(test_eight_channels_replay_captures);
+    TEST_MAIN_END;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file tools/dlog_cat.c
+ * @brief Prints the deferred binary log (misc./dlog.c) as text.
+ *
+ *   dlog_cat -e firmware.elf [capture]       decode with the strings from the ELF
+ *   dlog_cat -t formats.txt [capture]        decode with a table saved earlier
+ *   dlog_cat -e firmware.elf -o formats.txt  save the table, e.g. to ship with a build
+ *
+ * The capture is the raw byte stream from the log UART: a file, a serial device set up with
+ * stty beforehand, or stdin when omitted.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "dlog_decode.h"
+#include "misc./frame.h"
+
+static void print_line(const char *line, void *context) {
+    (void)context;
+    puts(line);
+    fflush(stdout);
+}
+
+static void on_frame(const uint8_t *payload, size_t size, void *context) {
+    dlog_decode_batch(context, payload, size);
+}
+
+static int usage(void) {
+    fprintf(stderr, "usage: dlog_cat (-e firmware.elf | -t formats.txt) [-o formats.txt] [capture]\n");
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    dlog_table_t table = {0};
+    const char *elf = NULL, *table_in = NULL, *table_out = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "e:t:o:")) != -1) {
+        switch (opt) {
+            case 'e': elf = optarg; break;
+            case 't': table_in = optarg; break;
+            case 'o': table_out = optarg; break;
+            default: return usage();
+        }
+    }
+    if ((elf == NULL) == (table_in == NULL) || argc - optind > 1) return usage();
+
+    if (elf != NULL && !dlog_table_load_elf(&table, elf)) {
+        fprintf(stderr, "dlog_cat: no .dlog_fmt section in %s\n", elf);
+        return 1;
+    }
+    if (table_in != NULL) {
+        FILE *file = fopen(table_in, "r");
+        if (file == NULL || !dlog_table_load(&table, file)) {
+            fprintf(stderr, "dlog_cat: cannot read %s\n", table_in);
+            return 1;
+        }
+        fclose(file);
+    }
+
+    if (table_out != NULL) {
+        FILE *file = fopen(table_out, "w");
+        if (file == NULL) {
+            fprintf(stderr, "dlog_cat: cannot write %s\n", table_out);
+            return 1;
+        }
+        dlog_table_write(&table, file);
+        fclose(file);
+        fprintf(stderr, "dlog_cat: %zu formats\n", table.count);
+        dlog_table_free(&table);
+        return 0;
+    }
+
+    FILE *capture = stdin;
+    if (optind < argc && (capture = fopen(argv[optind], "rb")) == NULL) {
+        fprintf(stderr, "dlog_cat: cannot open %s\n", argv[optind]);
+        return 1;
+    }
+
+    static uint8_t frame_buffer[1024];
+    uint8_t chunk[256];
+    frame_decoder_t frames;
+    dlog_decoder_t decoder = {.table = &table, .emit = print_line};
+    frame_decoder_init(&frames, frame_buffer, sizeof(frame_buffer));
+
+    ssize_t got;
+    while ((got = read(fileno(capture), chunk, sizeof(chunk))) > 0) {
+        frame_decoder_feed(&frames, chunk, (size_t)got, on_frame, &decoder);
+    }
+
+    fprintf(stderr, "dlog_cat: %u records, %u unknown formats, %u malformed batches, "
+            "%u frames failed the CRC\n", (unsigned)decoder.records, (unsigned)decoder.unknown,
+            (unsigned)decoder.malformed, (unsigned)frames.stats.crc_errors);
+    if (capture != stdin) fclose(capture);
+    dlog_table_free(&table);
+    return 0;
+}
@@ -0,0 +1,384 @@
+/**
+ * @file tools/dlog_decode.c
+ * @brief Host-side decoding of the deferred binary log (misc./dlog.c).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "dlog_decode.h"
+#include "misc./dlog.h"
+
+#define DLOG_LINE_MAX 512
+
+/**************************************************************************************************
+ * @section Format Table
+ **************************************************************************************************/
+
+static uint64_t read_le(const uint8_t *p, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = bytes; i > 0; i--) value = (value << 8) | p[i - 1];
+    return value;
+}
+
+static bool add_format(dlog_table_t *table, uint32_t address, const char *format, size_t length) {
+    dlog_format_t *formats = realloc(table->formats, (table->count + 1) * sizeof(*formats));
+    if (formats == NULL) return false;
+    table->formats = formats;
+
+    char *copy = malloc(length + 1);
+    if (copy == NULL) return false;
+    memcpy(copy, format, length);
+    copy[length] = '\0';
+
+    formats[table->count].address = address;
+    formats[table->count].format = copy;
+    table->count++;
+    return true;
+}
+
+static int compare_address(const void *a, const void *b) {
+    uint32_t x = ((const dlog_format_t *)a)->address, y = ((const dlog_format_t *)b)->address;
+    return (x > y) - (x < y);
+}
+
+static void sort_table(dlog_table_t *table) {
+    if (table->count > 1) qsort(table->formats, table->count, sizeof(*table->formats), compare_address);
+}
+
+// The section is a run of NUL-terminated strings, each starting on a DLOG_FMT_ALIGN boundary
+// with zero padding in between
+static bool add_section(dlog_table_t *table, uint32_t address, const uint8_t *data, size_t size) {
+    size_t pos = 0;
+    while (pos < size) {
+        if (data[pos] == 0) {
+            pos++;
+            continue;
+        }
+        size_t length = strnlen((const char *)data + pos, size - pos);
+        if (length == size - pos) break; // Unterminated; not a string
+        if (!add_format(table, address + (uint32_t)pos, (const char *)data + pos, length)) return false;
+        pos += length + 1;
+    }
+    return true;
+}
+
+static bool parse_elf(dlog_table_t *table, const uint8_t *elf, size_t size) {
+    if (size < 64 || memcmp(elf, "\177ELF", 4) != 0 || elf[5] != 1) return false; // Little endian
+
+    bool is64 = (elf[4] == 2);
+    if (!is64 && elf[4] != 1) return false;
+
+    uint64_t shoff = is64 ? read_le(elf + 0x28, 8) : read_le(elf + 0x20, 4);
+    size_t shentsize = read_le(elf + (is64 ? 0x3A : 0x2E), 2);
+    size_t shnum = read_le(elf + (is64 ? 0x3C : 0x30), 2);
+    size_t shstrndx = read_le(elf + (is64 ? 0x3E : 0x32), 2);
+    size_t min_entry = is64 ? 0x28 : 0x18;
+    if (shentsize < min_entry || shstrndx >= shnum || shoff > size || shnum > (size - shoff) / shentsize) {
+        return false;
+    }
+
+    // Section header fields: name, type, address, offset, size
+    #define SH(i) (elf + shoff + (uint64_t)(i) * shentsize)
+    #define SH_ADDR(h) (is64 ? read_le((h) + 0x10, 8) : read_le((h) + 0x0C, 4))
+    #define SH_OFFSET(h) (is64 ? read_le((h) + 0x18, 8) : read_le((h) + 0x10, 4))
+    #define SH_SIZE(h) (is64 ? read_le((h) + 0x20, 8) : read_le((h) + 0x14, 4))
+
+    uint64_t names = SH_OFFSET(SH(shstrndx));
+    uint64_t names_size = SH_SIZE(SH(shstrndx));
+    if (names > size || names_size > size - names) return false;
+
+    bool found = false;
+    for (size_t i = 0; i < shnum; i++) {
+        const uint8_t *sh = SH(i);
+        uint64_t name = read_le(sh, 4);
+        if (name >= names_size || strncmp((const char *)elf + names + name, DLOG_FMT_SECTION,
+                                          names_size - name) != 0) {
+            continue;
+        }
+        if (read_le(sh + 4, 4) == 8) continue; // SHT_NOBITS: nothing to read
+
+        uint64_t offset = SH_OFFSET(sh), length = SH_SIZE(sh);
+        if (offset > size || length > size - offset) return false;
+        if (!add_section(table, (uint32_t)SH_ADDR(sh), elf + offset, length)) return false;
+        found = true;
+    }
+
+    #undef SH
+    #undef SH_ADDR
+    #undef SH_OFFSET
+    #undef SH_SIZE
+    return found;
+}
+
+bool dlog_table_load_elf(dlog_table_t *table, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+
+    uint8_t *elf = NULL;
+    size_t size = 0, capacity = 0;
+    for (;;) {
+        if (size == capacity) {
+            capacity = capacity ? capacity * 2 : 1 << 16;
+            uint8_t *grown = realloc(elf, capacity);
+            if (grown == NULL) break;
+            elf = grown;
+        }
+        size_t got = fread(elf + size, 1, capacity - size, file);
+        if (got == 0) break;
+        size += got;
+    }
+    bool ok = !ferror(file) && elf != NULL && parse_elf(table, elf, size);
+    fclose(file);
+    free(elf);
+
+    sort_table(table);
+    return ok;
+}
+
+bool dlog_table_load(dlog_table_t *table, FILE *file) {
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length;
+    bool ok = true;
+
+    while (ok && (length = getline(&line, &line_capacity, file)) >= 0) {
+        char *tab = strchr(line, '\t');
+        if (tab == NULL) continue;
+
+        // Undo the escapes written by dlog_table_write(); the result is never longer
+        char *out = tab + 1;
+        for (const char *in = tab + 1; *in != '\0' && *in != '\n'; in++) {
+            if (*in != '\\' || in[1] == '\0') {
+                *out++ = *in;
+                continue;
+            }
+            switch (*++in) {
+                case 'n': *out++ = '\n'; break;
+                case 'r': *out++ = '\r'; break;
+                case 't': *out++ = '\t'; break;
+                case 'x': {
+                    char hex[3] = {in[1], in[1] ? in[2] : 0, 0};
+                    *out++ = (char)strtoul(hex, NULL, 16);
+                    in += strlen(hex);
+                    break;
+                }
+                default: *out++ = *in; break;
+            }
+        }
+        ok = add_format(table, (uint32_t)strtoul(line, NULL, 16), tab + 1, (size_t)(out - (tab + 1)));
+    }
+    free(line);
+
+    sort_table(table);
+    return ok && !ferror(file);
+}
+
+void dlog_table_write(const dlog_table_t *table, FILE *file) {
+    for (size_t i = 0; i < table->count; i++) {
+        fprintf(file, "0x%08x\t", (unsigned)table->formats[i].address);
+        for (const unsigned char *c = (const unsigned char *)table->formats[i].format; *c; c++) {
+            switch (*c) {
+                case '\n': fputs("\\n", file); break;
+                case '\r': fputs("\\r", file); break;
+                case '\t': fputs("\\t", file); break;
+                case '\\': fputs("\\\\", file); break;
+                default:
+                    if (*c < 0x20 || *c == 0x7F) {
+                        fprintf(file, "\\x%02x", *c);
+                    } else {
+                        fputc(*c, file);
+                    }
+                    break;
+            }
+        }
+        fputc('\n', file);
+    }
+}
+
+const char *dlog_table_find(const dlog_table_t *table, uint32_t address) {
+    dlog_format_t key = {.address = address};
+    if (table->count == 0) return NULL;
+    dlog_format_t *found = bsearch(&key, table->formats, table->count, sizeof(key), compare_address);
+    return found ? found->format : NULL;
+}
+
+void dlog_table_free(dlog_table_t *table) {
+    for (size_t i = 0; i < table->count; i++) free(table->formats[i].format);
+    free(table->formats);
+    table->formats = NULL;
+    table->count = 0;
+}
+
+/**************************************************************************************************
+ * @section Rendering
+ **************************************************************************************************/
+
+typedef struct {
+    char *out;
+    size_t capacity;
+    size_t length;
+} text_t;
+
+static void append(text_t *text, const char *data, size_t size) {
+    for (size_t i = 0; i < size && text->length + 1 < text->capacity; i++) {
+        text->out[text->length++] = data[i];
+    }
+    if (text->capacity != 0) text->out[text->length] = '\0';
+}
+
+static bool take_arg(const uint32_t *args, size_t count, size_t *next, uint32_t *value) {
+    if (*next >= count) return false;
+    *value = args[(*next)++];
+    return true;
+}
+
+size_t dlog_render(char *out, size_t capacity, const char *format, const uint32_t *args,
+                   size_t count) {
+    text_t text = {.out = out, .capacity = capacity};
+    size_t next = 0;
+    append(&text, "", 0);
+
+    for (const char *c = format; *c != '\0';) {
+        if (*c != '%') {
+            const char *end = strchr(c, '%');
+            size_t run = end ? (size_t)(end - c) : strlen(c);
+            append(&text, c, run);
+            c += run;
+            continue;
+        }
+
+        // Rebuild the conversion for snprintf, with '*' replaced by its argument and the length
+        // modifier applied here: every argument arrives as 32 bits
+        const char *start = c++;
+        char spec[32] = "%";
+        size_t spec_length = 1;
+        int narrow = 0; // 1 for h, 2 for hh
+        bool missing = false;
+
+        while (*c != '\0' && spec_length < sizeof(spec) - 12) {
+            if (*c == '*') {
+                uint32_t value = 0;
+                missing |= !take_arg(args, count, &next, &value);
+                spec_length += snprintf(spec + spec_length, sizeof(spec) - spec_length, "%d", (int32_t)value);
+            } else if (*c == 'h') {
+                narrow++;
+            } else if (strchr("lLqjzt", *c) == NULL) {
+                if (strchr("-+ #0123456789.", *c) == NULL) break;
+                spec[spec_length++] = *c;
+            }
+            c++;
+        }
+
+        char conversion = *c;
+        char piece[128];
+        uint32_t value = 0;
+        if (conversion == '\0' || strchr("%diuoxXcpsfFeEgGaA", conversion) == NULL) {
+            append(&text, start, (size_t)(c - start) + (conversion != '\0')); // Not ours; copy it
+            if (conversion != '\0') c++;
+            continue;
+        }
+        c++;
+
+        if (conversion == '%') {
+            append(&text, "%", 1);
+            continue;
+        }
+        if (missing || !take_arg(args, count, &next, &value)) {
+            append(&text, "<?>", 3);
+            continue;
+        }
+
+        spec[spec_length++] = (conversion == 'p' || conversion == 's') ? 'x' : conversion;
+        spec[spec_length] = '\0';
+        switch (conversion) {
+            case 'd':
+            case 'i': {
+                int32_t v = (int32_t)value;
+                if (narrow == 1) v = (int16_t)value;
+                if (narrow >= 2) v = (int8_t)value;
+                snprintf(piece, sizeof(piece), spec, v);
+                break;
+            }
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                if (narrow == 1) value = (uint16_t)value;
+                if (narrow >= 2) value = (uint8_t)value;
+                snprintf(piece, sizeof(piece), spec, value);
+                break;
+            case 'c':
+                snprintf(piece, sizeof(piece), spec, (int)(unsigned char)value);
+                break;
+            case 'p':
+                snprintf(piece, sizeof(piece), "0x%08x", value);
+                break;
+            case 's':
+                snprintf(piece, sizeof(piece), "(str 0x%08x)", value);
+                break;
+            default: {
+                float f;
+                memcpy(&f, &value, sizeof(f));
+                snprintf(piece, sizeof(piece), spec, (double)f);
+                break;
+            }
+        }
+        append(&text, piece, strlen(piece));
+    }
+
+    return text.length;
+}
+
+/**************************************************************************************************
+ * @section Batches
+ **************************************************************************************************/
+
+uint32_t dlog_decode_batch(dlog_decoder_t *decoder, const uint8_t *payload, size_t size) {
+    char line[DLOG_LINE_MAX];
+    uint32_t decoded = 0;
+
+    if (size < 4 || size % 4 != 0) {
+        decoder->malformed++;
+        return 0;
+    }
+
+    size_t words = size / 4;
+    uint32_t dropped = (uint32_t)read_le(payload, 4);
+    if (dropped > decoder->dropped) {
+        snprintf(line, sizeof(line), "dlog: %u records dropped", (unsigned)(dropped - decoder->dropped));
+        decoder->emit(line, decoder->context);
+    }
+    decoder->dropped = dropped; // Also follows a target reset back to 0
+
+    for (size_t i = 1; i < words;) {
+        uint32_t header = (uint32_t)read_le(payload + 4 * i, 4);
+        uint32_t length = header & DLOG_COUNT_MASK; // Header word plus arguments
+        if (length == 0 || length > DLOG_MAX_ARGS + 1 || i + length > words) {
+            decoder->malformed++;
+            break;
+        }
+
+        uint32_t args[DLOG_MAX_ARGS];
+        for (uint32_t a = 0; a + 1 < length; a++) args[a] = (uint32_t)read_le(payload + 4 * (i + 1 + a), 4);
+
+        uint32_t address = header & ~(uint32_t)DLOG_COUNT_MASK;
+        const char *format = dlog_table_find(decoder->table, address);
+        if (format != NULL) {
+            size_t n = dlog_render(line, sizeof(line), format, args, length - 1);
+            while (n > 0 && line[n - 1] == '\n') line[--n] = '\0';
+        } else {
+            int n = snprintf(line, sizeof(line), "<unknown format 0x%08x>", (unsigned)address);
+            for (uint32_t a = 0; a + 1 < length; a++) {
+                n += snprintf(line + n, sizeof(line) - n, " 0x%08x", (unsigned)args[a]);
+            }
+            decoder->unknown++;
+        }
+        decoder->emit(line, decoder->context);
+
+        i += length;
+        decoder->records++;
+        decoded++;
+    }
+
+    return decoded;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file tools/dlog_decode.h
+ * @brief Host-side decoding of the deferred binary log (misc./dlog.c).
+ *
+ * The target sends frames (misc./frame.h) whose payload is a batch of little endian words: the
+ * running count of dropped records, then whole records. A record header is the address of its
+ * format string ORed with (argument count + 1), followed by the raw 32-bit arguments. The
+ * strings themselves never leave the host: they are read from the .dlog_fmt section of the ELF,
+ * or from a table emitted earlier with dlog_table_write().
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+    uint32_t address;
+    char *format;
+} dlog_format_t;
+
+typedef struct {
+    dlog_format_t *formats; // Sorted by address
+    size_t count;
+} dlog_table_t;
+
+typedef void (*dlog_line_t)(const char *line, void *context);
+
+typedef struct {
+    const dlog_table_t *table;
+    dlog_line_t emit;       // Called once per decoded record, without a trailing newline
+    void *context;
+    uint32_t dropped;       // Last drop count reported by the target
+    uint32_t records;
+    uint32_t unknown;       // Records whose format address is not in the table
+    uint32_t malformed;     // Batches that ended in the middle of a record
+} dlog_decoder_t;
+
+/**
+ * @brief Loads the format strings from the .dlog_fmt section of a 32 or 64-bit little endian ELF.
+ *
+ * @return false if the file cannot be read, is not such an ELF, or has no .dlog_fmt section.
+ */
+bool dlog_table_load_elf(dlog_table_t *table, const char *path);
+
+/**
+ * @brief Loads a table written by dlog_table_write().
+ */
+bool dlog_table_load(dlog_table_t *table, FILE *file);
+
+/**
+ * @brief Writes the table as one "0xADDRESS<TAB>format" line per string, with C escapes.
+ */
+void dlog_table_write(const dlog_table_t *table, FILE *file);
+
+const char *dlog_table_find(const dlog_table_t *table, uint32_t address);
+
+void dlog_table_free(dlog_table_t *table);
+
+/**
+ * @brief Renders one record. The arguments stand in for int, unsigned and (through dlog_f32())
+ * float; %s cannot be rebuilt on the host and prints the pointer instead.
+ *
+ * @return Length of the text, truncated to @p capacity - 1.
+ */
+size_t dlog_render(char *out, size_t capacity, const char *format, const uint32_t *args,
+                   size_t count);
+
+/**
+ * @brief Decodes the payload of one frame and emits a line per record. A rise in the drop count
+ * is reported as its own line before the records.
+ *
+ * @return Number of records decoded.
+ */
+uint32_t dlog_decode_batch(dlog_decoder_t *decoder, const uint8_t *payload, size_t size);